@@ -0,0 +1,448 @@
+#include "common.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <libavutil/log.h>
+#include <libavutil/samplefmt.h>
+
+#include "audio_regulator.h"
+#include "benchmark.h"
+#include "decoder.h"
+#include "demuxer.h"
+#include "recorder.h"
+#include "util/log.h"
+#include "util/net.h"
+
+#define BENCH_DURATION SC_TICK_FROM_SEC(10)
+#define BENCH_TARGET_BUFFERING SC_TICK_FROM_MS(50)
+#define BENCH_RECORD_FILENAME "scrcpy-bench-audio.mka"
+// Duration of audio pushed to measure the push CPU time
+#define BENCH_PUSH_DURATION SC_TICK_FROM_SEC(60)
+#define BENCH_SAMPLE_RATE 48000
+
+/**
+ * Frame sink replacing the audio player: it pushes the decoded frames to the
+ * audio regulator, and immediately pulls the same number of samples (as if
+ * the audio output consumed them exactly at the input rate)
+ */
+struct bench_regulator_sink {
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    struct sc_audio_regulator audioreg;
+    uint8_t *out;
+    size_t out_samples;
+
+    struct sc_bench_durations push_durations;
+    struct sc_bench_durations pull_durations;
+};
+
+struct bench_audio {
+    struct sc_demuxer demuxer;
+    struct sc_bench_packet_probe packet_probe;
+    struct sc_decoder decoder;
+    struct sc_bench_frame_probe decoded_probe;
+    struct bench_regulator_sink regulator_sink;
+    struct sc_recorder recorder;
+    struct sc_bench_writer writer;
+
+    enum sc_demuxer_status demuxer_status;
+    bool recorder_success;
+};
+
+/** Downcast frame_sink to bench_regulator_sink */
+#define DOWNCAST(SINK) \
+    container_of(SINK, struct bench_regulator_sink, frame_sink)
+
+static bool
+bench_regulator_sink_open(struct sc_frame_sink *sink,
+                          const AVCodecContext *ctx) {
+    struct bench_regulator_sink *rs = DOWNCAST(sink);
+
+#ifdef SCRCPY_LAVU_HAS_CHLAYOUT
+    assert(ctx->ch_layout.nb_channels > 0 && ctx->ch_layout.nb_channels < 256);
+    uint8_t nb_channels = ctx->ch_layout.nb_channels;
+#else
+    int tmp = av_get_channel_layout_nb_channels(ctx->channel_layout);
+    assert(tmp > 0 && tmp < 256);
+    uint8_t nb_channels = tmp;
+#endif
+
+    assert(ctx->sample_rate > 0);
+    int out_bytes_per_sample = av_get_bytes_per_sample(SC_AV_SAMPLE_FMT);
+    assert(out_bytes_per_sample > 0);
+
+    uint32_t target_buffering_samples =
+        BENCH_TARGET_BUFFERING * ctx->sample_rate / SC_TICK_FREQ;
+
+    size_t sample_size = nb_channels * out_bytes_per_sample;
+    bool ok = sc_audio_regulator_init(&rs->audioreg, sample_size, ctx,
+                                      target_buffering_samples,
+                                      target_buffering_samples,
+                                      target_buffering_samples);
+    if (!ok) {
+        return false;
+    }
+
+    rs->out = NULL;
+    rs->out_samples = 0;
+
+    return true;
+}
+
+static void
+bench_regulator_sink_close(struct sc_frame_sink *sink) {
+    struct bench_regulator_sink *rs = DOWNCAST(sink);
+
+    free(rs->out);
+    sc_audio_regulator_destroy(&rs->audioreg);
+}
+
+static bool
+bench_regulator_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
+    struct bench_regulator_sink *rs = DOWNCAST(sink);
+
+    assert(frame->nb_samples > 0);
+    size_t samples = frame->nb_samples;
+    if (samples > rs->out_samples) {
+        uint8_t *out = realloc(rs->out, samples * rs->audioreg.sample_size);
+        if (!out) {
+            LOG_OOM();
+            return false;
+        }
+        rs->out = out;
+        rs->out_samples = samples;
+    }
+
+    sc_tick start = sc_tick_now();
+    bool ok = sc_audio_regulator_push(&rs->audioreg, frame);
+    sc_tick pushed = sc_tick_now();
+    if (!ok) {
+        return false;
+    }
+
+    sc_audio_regulator_pull(&rs->audioreg, rs->out, samples);
+    sc_tick pulled = sc_tick_now();
+
+    return sc_bench_durations_add(&rs->push_durations, pushed - start)
+        && sc_bench_durations_add(&rs->pull_durations, pulled - pushed);
+}
+
+static void
+bench_regulator_sink_init(struct bench_regulator_sink *rs) {
+    sc_bench_durations_init(&rs->push_durations);
+    sc_bench_durations_init(&rs->pull_durations);
+
+    static const struct sc_frame_sink_ops ops = {
+        .open = bench_regulator_sink_open,
+        .close = bench_regulator_sink_close,
+        .push = bench_regulator_sink_push,
+    };
+
+    rs->frame_sink.ops = &ops;
+}
+
+static void
+bench_regulator_sink_destroy(struct bench_regulator_sink *rs) {
+    sc_bench_durations_destroy(&rs->pull_durations);
+    sc_bench_durations_destroy(&rs->push_durations);
+}
+
+static void
+bench_demuxer_on_ended(struct sc_demuxer *demuxer,
+                       enum sc_demuxer_status status, void *userdata) {
+    (void) demuxer;
+    struct bench_audio *bench = userdata;
+    bench->demuxer_status = status;
+}
+
+static void
+bench_recorder_on_ended(struct sc_recorder *recorder, bool success,
+                        void *userdata) {
+    (void) recorder;
+    struct bench_audio *bench = userdata;
+    bench->recorder_success = success;
+}
+
+static bool
+run_bench(const char *name, const struct sc_bench_stream *stream) {
+    struct bench_audio bench = {
+        .demuxer_status = SC_DEMUXER_STATUS_ERROR,
+        .recorder_success = false,
+    };
+
+    sc_socket writer_socket;
+    sc_socket reader_socket;
+    if (!sc_bench_socket_pair(&writer_socket, &reader_socket)) {
+        LOGE("Could not create socket pair");
+        return false;
+    }
+
+    bool ret = false;
+
+    static const struct sc_demuxer_callbacks demuxer_cbs = {
+        .on_ended = bench_demuxer_on_ended,
+    };
+    sc_demuxer_init(&bench.demuxer, "audio", reader_socket, &demuxer_cbs,
+                    &bench);
+
+    sc_decoder_init(&bench.decoder, "audio", NULL, NULL);
+    sc_bench_packet_probe_init(&bench.packet_probe,
+                               &bench.decoder.packet_sink);
+    sc_packet_source_add_sink(&bench.demuxer.packet_source,
+                              &bench.packet_probe.packet_sink);
+
+    sc_bench_frame_probe_init(&bench.decoded_probe);
+    sc_frame_source_add_sink(&bench.decoder.frame_source,
+                             &bench.decoded_probe.frame_sink);
+
+    bench_regulator_sink_init(&bench.regulator_sink);
+    sc_frame_source_add_sink(&bench.decoded_probe.frame_source,
+                             &bench.regulator_sink.frame_sink);
+
+    static const struct sc_recorder_callbacks recorder_cbs = {
+        .on_ended = bench_recorder_on_ended,
+    };
+    if (!sc_recorder_init(&bench.recorder, BENCH_RECORD_FILENAME,
+                          SC_RECORD_FORMAT_MKA, false, true, SC_ORIENTATION_0,
+                          0, 0,
+                          &recorder_cbs, &bench)) {
+        goto end;
+    }
+
+    if (!sc_recorder_start(&bench.recorder)) {
+        goto destroy_recorder;
+    }
+
+    sc_packet_source_add_sink(&bench.demuxer.packet_source,
+                              &bench.recorder.audio_packet_sink);
+
+    if (!sc_demuxer_start(&bench.demuxer)) {
+        sc_recorder_stop(&bench.recorder);
+        sc_recorder_join(&bench.recorder);
+        goto destroy_recorder;
+    }
+
+    if (!sc_bench_writer_start(&bench.writer, stream, writer_socket, false)) {
+        net_interrupt(reader_socket);
+        sc_demuxer_join(&bench.demuxer);
+        sc_recorder_join(&bench.recorder);
+        goto destroy_recorder;
+    }
+
+    sc_demuxer_join(&bench.demuxer);
+    sc_tick demuxer_end = sc_tick_now();
+
+    sc_recorder_join(&bench.recorder);
+    sc_tick recorder_end = sc_tick_now();
+
+    sc_bench_writer_join(&bench.writer);
+
+    if (bench.demuxer_status != SC_DEMUXER_STATUS_EOS) {
+        LOGE("[%s] Demuxer failed", name);
+        goto destroy_writer;
+    }
+
+    if (!bench.recorder_success) {
+        LOGE("[%s] Recorder failed", name);
+        goto destroy_writer;
+    }
+
+    sc_tick elapsed = demuxer_end - bench.writer.start;
+    double seconds = (double) elapsed / SC_TICK_FREQ;
+
+    printf("[%s] %" PRIu64 " packets, %" PRIu64 " frames in %.3f s: "
+           "%.1f packets/s, %.1f frames/s\n", name, bench.packet_probe.count,
+           bench.decoded_probe.count, seconds,
+           bench.packet_probe.count / seconds,
+           bench.decoded_probe.count / seconds);
+    printf("[%s] recorder drain: %.3f ms\n", name,
+           (recorder_end - demuxer_end) / 1000.);
+
+    struct sc_bench_durations durations;
+    sc_bench_durations_init(&durations);
+    if (sc_bench_durations_add_latencies(&durations,
+                                         &bench.packet_probe.probe,
+                                         &bench.decoded_probe.probe, 0)) {
+        sc_bench_durations_report(&durations, name, "demuxed -> decoded");
+    }
+    sc_bench_durations_destroy(&durations);
+
+    sc_bench_durations_report(&bench.regulator_sink.push_durations, name,
+                              "audio regulator push");
+    sc_bench_durations_report(&bench.regulator_sink.pull_durations, name,
+                              "audio regulator pull");
+
+    ret = true;
+
+destroy_writer:
+    sc_bench_writer_destroy(&bench.writer);
+destroy_recorder:
+    sc_recorder_destroy(&bench.recorder);
+    remove(BENCH_RECORD_FILENAME);
+end:
+    bench_regulator_sink_destroy(&bench.regulator_sink);
+    sc_bench_frame_probe_destroy(&bench.decoded_probe);
+    sc_bench_packet_probe_destroy(&bench.packet_probe);
+    net_close(writer_socket);
+    net_close(reader_socket);
+
+    return ret;
+}
+
+static bool
+bench_codec(const char *name, enum AVCodecID codec_id, uint32_t raw_codec_id) {
+    struct sc_bench_stream stream;
+    if (!sc_bench_stream_init_audio(&stream, codec_id, raw_codec_id,
+                                    BENCH_DURATION)) {
+        printf("[%s] skipped (no encoder available)\n", name);
+        return true;
+    }
+
+    printf("[%s] %" SC_PRIsizet " packets\n", name,
+           sc_bench_stream_count_media_packets(&stream));
+
+    bool ok = run_bench(name, &stream);
+
+    sc_bench_stream_destroy(&stream);
+    return ok;
+}
+
+/**
+ * Measure the CPU time spent in sc_audio_regulator_push() per second of audio
+ * for the given input sample format, either with the direct conversion (no
+ * compensation) or through libswresample (with compensation applied)
+ */
+static bool
+bench_push(const char *name, enum AVSampleFormat fmt, bool resample) {
+    bool ret = false;
+
+    AVCodecContext *ctx = avcodec_alloc_context3(NULL);
+    if (!ctx) {
+        LOG_OOM();
+        return false;
+    }
+
+    ctx->sample_fmt = fmt;
+    ctx->sample_rate = BENCH_SAMPLE_RATE;
+#ifdef SCRCPY_LAVU_HAS_CHLAYOUT
+    ctx->ch_layout = (AVChannelLayout) AV_CHANNEL_LAYOUT_STEREO;
+#else
+    ctx->channel_layout = AV_CH_LAYOUT_STEREO;
+    ctx->channels = 2;
+#endif
+
+    AVFrame *frame = av_frame_alloc();
+    if (!frame) {
+        LOG_OOM();
+        goto free_ctx;
+    }
+
+    frame->nb_samples = BENCH_SAMPLE_RATE / 50; // 20ms
+    frame->format = fmt;
+#ifdef SCRCPY_LAVU_HAS_CHLAYOUT
+    if (av_channel_layout_copy(&frame->ch_layout, &ctx->ch_layout)) {
+        LOG_OOM();
+        goto free_frame;
+    }
+#else
+    frame->channel_layout = ctx->channel_layout;
+#endif
+    if (av_frame_get_buffer(frame, 0)) {
+        LOG_OOM();
+        goto free_frame;
+    }
+    av_samples_set_silence(frame->extended_data, 0, frame->nb_samples, 2, fmt);
+
+    size_t sample_size = 2 * av_get_bytes_per_sample(SC_AV_SAMPLE_FMT);
+    uint8_t *out = malloc(frame->nb_samples * sample_size);
+    if (!out) {
+        LOG_OOM();
+        goto free_frame;
+    }
+
+    uint32_t target_buffering_samples =
+        BENCH_TARGET_BUFFERING * BENCH_SAMPLE_RATE / SC_TICK_FREQ;
+
+    struct sc_audio_regulator ar;
+    if (!sc_audio_regulator_init(&ar, sample_size, ctx,
+                                 target_buffering_samples,
+                                 target_buffering_samples,
+                                 target_buffering_samples)) {
+        goto free_out;
+    }
+
+    if (resample) {
+        // Force libswresample, with a (tiny) compensation applied
+        ar.convert = NULL;
+        if (swr_set_compensation(ar.swr_ctx, 1,
+                                 4 * BENCH_SAMPLE_RATE) < 0) {
+            LOGE("[%s] Could not set compensation", name);
+            goto destroy_regulator;
+        }
+    }
+
+    uint64_t total_samples =
+        BENCH_PUSH_DURATION * BENCH_SAMPLE_RATE / SC_TICK_FREQ;
+    sc_tick push_duration = 0;
+    for (uint64_t n = 0; n < total_samples; n += frame->nb_samples) {
+        frame->pts = n * SC_TICK_FREQ / BENCH_SAMPLE_RATE;
+
+        sc_tick start = sc_tick_now();
+        bool ok = sc_audio_regulator_push(&ar, frame);
+        push_duration += sc_tick_now() - start;
+        if (!ok) {
+            goto destroy_regulator;
+        }
+
+        sc_audio_regulator_pull(&ar, out, frame->nb_samples);
+    }
+
+    double seconds = (double) total_samples / BENCH_SAMPLE_RATE;
+    printf("[%s] audio regulator push: %.3f ms per second of audio\n", name,
+           push_duration / 1000. / seconds);
+
+    ret = true;
+
+destroy_regulator:
+    sc_audio_regulator_destroy(&ar);
+free_out:
+    free(out);
+free_frame:
+    av_frame_free(&frame);
+free_ctx:
+    avcodec_free_context(&ctx);
+
+    return ret;
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    sc_set_log_level(SC_LOG_LEVEL_WARN);
+    av_log_set_level(AV_LOG_ERROR);
+
+    if (!net_init()) {
+        return 1;
+    }
+
+    bool ok = bench_codec("opus", AV_CODEC_ID_OPUS, SC_CODEC_ID_OPUS)
+           && bench_codec("aac", AV_CODEC_ID_AAC, SC_CODEC_ID_AAC)
+           && bench_codec("flac", AV_CODEC_ID_FLAC, SC_CODEC_ID_FLAC)
+           && bench_push("s16 direct", AV_SAMPLE_FMT_S16, false)
+           && bench_push("s16 swr", AV_SAMPLE_FMT_S16, true)
+           && bench_push("s32 direct", AV_SAMPLE_FMT_S32, false)
+           && bench_push("s32 swr", AV_SAMPLE_FMT_S32, true)
+           && bench_push("flt direct", AV_SAMPLE_FMT_FLT, false)
+           && bench_push("flt swr", AV_SAMPLE_FMT_FLT, true)
+           && bench_push("fltp direct", AV_SAMPLE_FMT_FLTP, false)
+           && bench_push("fltp swr", AV_SAMPLE_FMT_FLTP, true);
+
+    printf("peak RSS: %" PRIu64 " KiB\n", sc_bench_get_peak_rss());
+
+    net_cleanup();
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,257 @@
+#include "common.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <libavutil/log.h>
+
+#include "benchmark.h"
+#include "decoder.h"
+#include "delay_buffer.h"
+#include "demuxer.h"
+#include "recorder.h"
+#include "util/log.h"
+#include "util/net.h"
+
+#define BENCH_WIDTH 1280
+#define BENCH_HEIGHT 720
+#define BENCH_FRAMES 180
+#define BENCH_DELAY SC_TICK_FROM_MS(20)
+#define BENCH_RECORD_FILENAME "scrcpy-bench-video.mkv"
+
+struct bench_video {
+    struct sc_demuxer demuxer;
+    struct sc_bench_packet_probe packet_probe;
+    struct sc_decoder decoder;
+    struct sc_bench_frame_probe decoded_probe;
+    struct sc_delay_buffer delay_buffer;
+    struct sc_bench_frame_probe delayed_probe;
+    struct sc_recorder recorder;
+    struct sc_bench_writer writer;
+
+    enum sc_demuxer_status demuxer_status;
+    bool recorder_success;
+};
+
+static void
+bench_demuxer_on_ended(struct sc_demuxer *demuxer,
+                       enum sc_demuxer_status status, void *userdata) {
+    (void) demuxer;
+    struct bench_video *bench = userdata;
+    bench->demuxer_status = status;
+}
+
+static void
+bench_recorder_on_ended(struct sc_recorder *recorder, bool success,
+                        void *userdata) {
+    (void) recorder;
+    struct bench_video *bench = userdata;
+    bench->recorder_success = success;
+}
+
+static bool
+run_bench(const char *name, const struct sc_bench_stream *stream,
+          bool realtime) {
+    const char *mode = realtime ? "realtime" : "asap";
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "%s/%s", name, mode);
+
+    struct bench_video bench = {
+        .demuxer_status = SC_DEMUXER_STATUS_ERROR,
+        .recorder_success = false,
+    };
+
+    sc_socket writer_socket;
+    sc_socket reader_socket;
+    if (!sc_bench_socket_pair(&writer_socket, &reader_socket)) {
+        LOGE("Could not create socket pair");
+        return false;
+    }
+
+    bool ret = false;
+
+    static const struct sc_demuxer_callbacks demuxer_cbs = {
+        .on_ended = bench_demuxer_on_ended,
+    };
+    sc_demuxer_init(&bench.demuxer, "video", reader_socket, &demuxer_cbs,
+                    &bench);
+
+    sc_decoder_init(&bench.decoder, "video", NULL, NULL);
+    sc_bench_packet_probe_init(&bench.packet_probe,
+                               &bench.decoder.packet_sink);
+    sc_packet_source_add_sink(&bench.demuxer.packet_source,
+                              &bench.packet_probe.packet_sink);
+
+    sc_bench_frame_probe_init(&bench.decoded_probe);
+    sc_frame_source_add_sink(&bench.decoder.frame_source,
+                             &bench.decoded_probe.frame_sink);
+
+    sc_bench_frame_probe_init(&bench.delayed_probe);
+    if (realtime) {
+        // The delay buffer is only relevant if the frames are received at the
+        // expected rate
+        sc_delay_buffer_init(&bench.delay_buffer, BENCH_DELAY, true, NULL);
+        sc_frame_source_add_sink(&bench.decoded_probe.frame_source,
+                                 &bench.delay_buffer.frame_sink);
+        sc_frame_source_add_sink(&bench.delay_buffer.frame_source,
+                                 &bench.delayed_probe.frame_sink);
+    }
+
+    static const struct sc_recorder_callbacks recorder_cbs = {
+        .on_ended = bench_recorder_on_ended,
+    };
+    if (!sc_recorder_init(&bench.recorder, BENCH_RECORD_FILENAME,
+                          SC_RECORD_FORMAT_MKV, true, false, SC_ORIENTATION_0,
+                          0, 0,
+                          &recorder_cbs, &bench)) {
+        goto end;
+    }
+
+    if (!sc_recorder_start(&bench.recorder)) {
+        goto destroy_recorder;
+    }
+
+    sc_packet_source_add_sink(&bench.demuxer.packet_source,
+                              &bench.recorder.video_packet_sink);
+
+    if (!sc_demuxer_start(&bench.demuxer)) {
+        sc_recorder_stop(&bench.recorder);
+        sc_recorder_join(&bench.recorder);
+        goto destroy_recorder;
+    }
+
+    if (!sc_bench_writer_start(&bench.writer, stream, writer_socket,
+                               realtime)) {
+        net_interrupt(reader_socket);
+        sc_demuxer_join(&bench.demuxer);
+        sc_recorder_join(&bench.recorder);
+        goto destroy_recorder;
+    }
+
+    sc_demuxer_join(&bench.demuxer);
+    sc_tick demuxer_end = sc_tick_now();
+
+    // The sinks are closed on demuxer end, so the recorder only has to write
+    // the remaining packets and the trailer
+    sc_recorder_join(&bench.recorder);
+    sc_tick recorder_end = sc_tick_now();
+
+    sc_bench_writer_join(&bench.writer);
+
+    if (bench.demuxer_status != SC_DEMUXER_STATUS_EOS) {
+        LOGE("[%s] Demuxer failed", prefix);
+        goto destroy_writer;
+    }
+
+    if (!bench.recorder_success) {
+        LOGE("[%s] Recorder failed", prefix);
+        goto destroy_writer;
+    }
+
+    sc_tick elapsed = demuxer_end - bench.writer.start;
+    double seconds = (double) elapsed / SC_TICK_FREQ;
+
+    printf("[%s] %" PRIu64 " packets, %" PRIu64 " frames in %.3f s: "
+           "%.1f packets/s, %.1f frames/s\n", prefix,
+           bench.packet_probe.count, bench.decoded_probe.count, seconds,
+           bench.packet_probe.count / seconds,
+           bench.decoded_probe.count / seconds);
+    printf("[%s] recorder drain: %.3f ms\n", prefix,
+           (recorder_end - demuxer_end) / 1000.);
+
+    const struct sc_decoder_stats *decoder_stats = &bench.decoder.stats;
+    if (decoder_stats->packets) {
+        printf("[%s] decode time: avg=%.3f ms max=%.3f ms\n", prefix,
+               (double) decoder_stats->total_time / decoder_stats->packets
+                    / 1000,
+               (double) decoder_stats->max_time / 1000);
+    }
+
+    if (realtime) {
+        struct sc_bench_durations durations;
+
+        sc_bench_durations_init(&durations);
+        if (sc_bench_durations_add_latencies(&durations, &bench.writer.probe,
+                                             &bench.packet_probe.probe, 0)) {
+            sc_bench_durations_report(&durations, prefix, "send -> demuxed");
+        }
+        sc_bench_durations_destroy(&durations);
+
+        sc_bench_durations_init(&durations);
+        if (sc_bench_durations_add_latencies(&durations,
+                                             &bench.packet_probe.probe,
+                                             &bench.decoded_probe.probe, 0)) {
+            sc_bench_durations_report(&durations, prefix, "demuxed -> decoded");
+        }
+        sc_bench_durations_destroy(&durations);
+
+        // Only measure the overhead of the delay buffer
+        sc_bench_durations_init(&durations);
+        if (sc_bench_durations_add_latencies(&durations,
+                                             &bench.decoded_probe.probe,
+                                             &bench.delayed_probe.probe,
+                                             BENCH_DELAY)) {
+            sc_bench_durations_report(&durations, prefix,
+                                      "decoded -> delayed (minus delay)");
+        }
+        sc_bench_durations_destroy(&durations);
+    }
+
+    ret = true;
+
+destroy_writer:
+    sc_bench_writer_destroy(&bench.writer);
+destroy_recorder:
+    sc_recorder_destroy(&bench.recorder);
+    remove(BENCH_RECORD_FILENAME);
+end:
+    sc_bench_frame_probe_destroy(&bench.delayed_probe);
+    sc_bench_frame_probe_destroy(&bench.decoded_probe);
+    sc_bench_packet_probe_destroy(&bench.packet_probe);
+    net_close(writer_socket);
+    net_close(reader_socket);
+
+    return ret;
+}
+
+static bool
+bench_codec(const char *name, enum AVCodecID codec_id, uint32_t raw_codec_id) {
+    struct sc_bench_stream stream;
+    if (!sc_bench_stream_init_video(&stream, codec_id, raw_codec_id,
+                                    BENCH_WIDTH, BENCH_HEIGHT, BENCH_FRAMES)) {
+        printf("[%s] skipped (no encoder available)\n", name);
+        return true;
+    }
+
+    printf("[%s] %dx%d, %" SC_PRIsizet " packets\n", name, BENCH_WIDTH,
+           BENCH_HEIGHT, sc_bench_stream_count_media_packets(&stream));
+
+    bool ok = run_bench(name, &stream, false)
+           && run_bench(name, &stream, true);
+
+    sc_bench_stream_destroy(&stream);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    sc_set_log_level(SC_LOG_LEVEL_WARN);
+    av_log_set_level(AV_LOG_ERROR);
+
+    if (!net_init()) {
+        return 1;
+    }
+
+    bool ok = bench_codec("h264", AV_CODEC_ID_H264, SC_CODEC_ID_H264)
+           && bench_codec("h265", AV_CODEC_ID_HEVC, SC_CODEC_ID_H265);
+#ifdef SCRCPY_LAVC_HAS_AV1
+    ok = ok && bench_codec("av1", AV_CODEC_ID_AV1, SC_CODEC_ID_AV1);
+#endif
+
+    printf("peak RSS: %" PRIu64 " KiB\n", sc_bench_get_peak_rss());
+
+    net_cleanup();
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,862 @@
+#include "benchmark.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libavutil/opt.h>
+#ifdef _WIN32
+# define PSAPI_VERSION 2 // use K32GetProcessMemoryInfo() from kernel32
+# include <windows.h>
+# include <psapi.h>
+#else
+# include <sys/resource.h>
+#endif
+
+#include "util/binary.h"
+#include "util/log.h"
+
+#define SC_BENCH_PACKET_HEADER_SIZE 12
+
+#define SC_BENCH_PACKET_FLAG_CONFIG    (UINT64_C(1) << 63)
+#define SC_BENCH_PACKET_FLAG_KEY_FRAME (UINT64_C(1) << 62)
+
+#define SC_BENCH_VIDEO_FPS 60
+#define SC_BENCH_VIDEO_BIT_RATE 8000000
+#define SC_BENCH_AUDIO_SAMPLE_RATE 48000
+#define SC_BENCH_AUDIO_BIT_RATE 128000
+
+#define SC_BENCH_PORT_FIRST 27300
+#define SC_BENCH_PORT_LAST 27399
+
+static const AVRational SC_BENCH_TIME_BASE_US = {1, 1000000};
+
+static bool
+sc_bench_stream_push(struct sc_bench_stream *stream, const uint8_t *data,
+                     size_t size, int64_t pts, bool key_frame) {
+    uint8_t *copy = malloc(size);
+    if (!copy) {
+        LOG_OOM();
+        return false;
+    }
+
+    memcpy(copy, data, size);
+
+    struct sc_bench_packet packet = {
+        .pts = pts,
+        .key_frame = key_frame,
+        .data = copy,
+        .size = size,
+    };
+
+    bool ok = sc_vector_push(&stream->packets, packet);
+    if (!ok) {
+        LOG_OOM();
+        free(copy);
+        return false;
+    }
+
+    return true;
+}
+
+static bool
+sc_bench_stream_push_config(struct sc_bench_stream *stream,
+                            const AVCodecContext *ctx) {
+    if (!ctx->extradata_size) {
+        // The encoder does not provide global headers, the recorder will not
+        // be able to record the stream
+        LOGW("No config packet for %s", avcodec_get_name(ctx->codec_id));
+        return true;
+    }
+
+    return sc_bench_stream_push(stream, ctx->extradata, ctx->extradata_size,
+                                AV_NOPTS_VALUE, false);
+}
+
+// Encode the frame (or flush the encoder if frame is NULL)
+static bool
+sc_bench_stream_encode(struct sc_bench_stream *stream, AVCodecContext *ctx,
+                       const AVFrame *frame, AVPacket *packet) {
+    int ret = avcodec_send_frame(ctx, frame);
+    if (ret < 0) {
+        LOGE("Could not send frame to encoder: %d", ret);
+        return false;
+    }
+
+    for (;;) {
+        ret = avcodec_receive_packet(ctx, packet);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            break;
+        }
+
+        if (ret < 0) {
+            LOGE("Could not receive packet from encoder: %d", ret);
+            return false;
+        }
+
+        int64_t pts = av_rescale_q(packet->pts, ctx->time_base,
+                                   SC_BENCH_TIME_BASE_US);
+        bool key_frame = packet->flags & AV_PKT_FLAG_KEY;
+        bool ok = sc_bench_stream_push(stream, packet->data, packet->size,
+                                       pts, key_frame);
+        av_packet_unref(packet);
+        if (!ok) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void
+sc_bench_stream_normalize_pts(struct sc_bench_stream *stream) {
+    // Some encoders (e.g. Opus) produce negative PTS for the first packets
+    // (priming samples), but the PTS sent by the server are never negative
+    int64_t min_pts = 0;
+    for (size_t i = 0; i < stream->packets.size; ++i) {
+        int64_t pts = stream->packets.data[i].pts;
+        if (pts != AV_NOPTS_VALUE && pts < min_pts) {
+            min_pts = pts;
+        }
+    }
+
+    if (min_pts < 0) {
+        for (size_t i = 0; i < stream->packets.size; ++i) {
+            struct sc_bench_packet *packet = &stream->packets.data[i];
+            if (packet->pts != AV_NOPTS_VALUE) {
+                packet->pts -= min_pts;
+            }
+        }
+    }
+}
+
+static void
+sc_bench_fill_picture(AVFrame *frame, unsigned index) {
+    // Moving gradients, so that every frame is different
+    for (int y = 0; y < frame->height; ++y) {
+        uint8_t *line = frame->data[0] + y * frame->linesize[0];
+        for (int x = 0; x < frame->width; ++x) {
+            line[x] = x + y + 4 * index;
+        }
+    }
+
+    for (int y = 0; y < frame->height / 2; ++y) {
+        uint8_t *u = frame->data[1] + y * frame->linesize[1];
+        uint8_t *v = frame->data[2] + y * frame->linesize[2];
+        for (int x = 0; x < frame->width / 2; ++x) {
+            u[x] = 128 + x - 2 * index;
+            v[x] = 64 + y + 3 * index;
+        }
+    }
+}
+
+static AVCodecContext *
+sc_bench_open_video_encoder(enum AVCodecID codec_id, uint32_t width,
+                            uint32_t height) {
+    const AVCodec *codec = avcodec_find_encoder(codec_id);
+    if (!codec) {
+        return NULL;
+    }
+
+    AVCodecContext *ctx = avcodec_alloc_context3(codec);
+    if (!ctx) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    ctx->width = width;
+    ctx->height = height;
+    ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+    ctx->time_base = (AVRational) {1, SC_BENCH_VIDEO_FPS};
+    ctx->framerate = (AVRational) {SC_BENCH_VIDEO_FPS, 1};
+    ctx->gop_size = SC_BENCH_VIDEO_FPS;
+    ctx->max_b_frames = 0;
+    ctx->bit_rate = SC_BENCH_VIDEO_BIT_RATE;
+    // Like MediaCodec, provide the codec config in a separate packet
+    ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    ctx->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
+
+    if (ctx->priv_data) {
+        // Favor encoding speed (the options are ignored by the encoders which
+        // do not support them)
+        av_opt_set(ctx->priv_data, "preset", "ultrafast", 0);
+        av_opt_set(ctx->priv_data, "tune", "zerolatency", 0);
+        av_opt_set(ctx->priv_data, "usage", "realtime", 0);
+        av_opt_set(ctx->priv_data, "cpu-used", "8", 0);
+    }
+
+    if (avcodec_open2(ctx, codec, NULL) < 0) {
+        avcodec_free_context(&ctx);
+        return NULL;
+    }
+
+    return ctx;
+}
+
+bool
+sc_bench_stream_init_video(struct sc_bench_stream *stream,
+                           enum AVCodecID codec_id, uint32_t raw_codec_id,
+                           uint32_t width, uint32_t height, unsigned frames) {
+    stream->codec_id = raw_codec_id;
+    stream->video = true;
+    stream->width = width;
+    stream->height = height;
+    sc_vector_init(&stream->packets);
+
+    AVCodecContext *ctx = sc_bench_open_video_encoder(codec_id, width, height);
+    if (!ctx) {
+        return false;
+    }
+
+    AVFrame *frame = av_frame_alloc();
+    if (!frame) {
+        LOG_OOM();
+        goto error_free_context;
+    }
+
+    AVPacket *packet = av_packet_alloc();
+    if (!packet) {
+        LOG_OOM();
+        goto error_free_frame;
+    }
+
+    frame->format = ctx->pix_fmt;
+    frame->width = width;
+    frame->height = height;
+    if (av_frame_get_buffer(frame, 0)) {
+        LOG_OOM();
+        goto error_free_packet;
+    }
+
+    if (!sc_bench_stream_push_config(stream, ctx)) {
+        goto error_free_packet;
+    }
+
+    for (unsigned i = 0; i < frames; ++i) {
+        // The encoder may still reference the previous frame
+        if (av_frame_make_writable(frame)) {
+            LOG_OOM();
+            goto error_free_packet;
+        }
+
+        sc_bench_fill_picture(frame, i);
+        frame->pts = i;
+
+        if (!sc_bench_stream_encode(stream, ctx, frame, packet)) {
+            goto error_free_packet;
+        }
+    }
+
+    if (!sc_bench_stream_encode(stream, ctx, NULL, packet)) {
+        goto error_free_packet;
+    }
+
+    sc_bench_stream_normalize_pts(stream);
+
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+    avcodec_free_context(&ctx);
+
+    return true;
+
+error_free_packet:
+    av_packet_free(&packet);
+error_free_frame:
+    av_frame_free(&frame);
+error_free_context:
+    avcodec_free_context(&ctx);
+    sc_bench_stream_destroy(stream);
+
+    return false;
+}
+
+static AVCodecContext *
+sc_bench_open_audio_encoder(enum AVCodecID codec_id) {
+    const AVCodec *codec = avcodec_find_encoder(codec_id);
+    if (!codec) {
+        return NULL;
+    }
+
+    // Use the first sample format supported by the encoder
+    static const enum AVSampleFormat formats[] = {
+        AV_SAMPLE_FMT_FLTP,
+        AV_SAMPLE_FMT_FLT,
+        AV_SAMPLE_FMT_S16,
+        AV_SAMPLE_FMT_S32,
+    };
+
+    for (size_t i = 0; i < ARRAY_LEN(formats); ++i) {
+        AVCodecContext *ctx = avcodec_alloc_context3(codec);
+        if (!ctx) {
+            LOG_OOM();
+            return NULL;
+        }
+
+        ctx->sample_fmt = formats[i];
+        ctx->sample_rate = SC_BENCH_AUDIO_SAMPLE_RATE;
+#ifdef SCRCPY_LAVU_HAS_CHLAYOUT
+        ctx->ch_layout = (AVChannelLayout) AV_CHANNEL_LAYOUT_STEREO;
+#else
+        ctx->channel_layout = AV_CH_LAYOUT_STEREO;
+        ctx->channels = 2;
+#endif
+        ctx->bit_rate = SC_BENCH_AUDIO_BIT_RATE;
+        ctx->time_base = (AVRational) {1, SC_BENCH_AUDIO_SAMPLE_RATE};
+        ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        ctx->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
+
+        if (avcodec_open2(ctx, codec, NULL) >= 0) {
+            return ctx;
+        }
+
+        avcodec_free_context(&ctx);
+    }
+
+    return NULL;
+}
+
+static void
+sc_bench_fill_audio(AVFrame *frame, uint64_t first_sample) {
+    enum AVSampleFormat fmt = frame->format;
+    bool planar = av_sample_fmt_is_planar(fmt);
+
+    // 375 Hz triangle wave (exactly 128 samples per period at 48 kHz)
+    for (int i = 0; i < frame->nb_samples; ++i) {
+        unsigned phase = (first_sample + i) % 128;
+        float value = (phase < 64 ? phase : 128 - phase) / 64.f - .5f;
+
+        for (int c = 0; c < 2; ++c) {
+            uint8_t *data = planar ? frame->data[c] : frame->data[0];
+            int index = planar ? i : i * 2 + c;
+
+            switch (av_get_packed_sample_fmt(fmt)) {
+                case AV_SAMPLE_FMT_FLT:
+                    ((float *) data)[index] = value;
+                    break;
+                case AV_SAMPLE_FMT_S16:
+                    ((int16_t *) data)[index] = value * INT16_MAX;
+                    break;
+                case AV_SAMPLE_FMT_S32:
+                    ((int32_t *) data)[index] = value * INT32_MAX;
+                    break;
+                default:
+                    assert(!"Unexpected sample format");
+            }
+        }
+    }
+}
+
+bool
+sc_bench_stream_init_audio(struct sc_bench_stream *stream,
+                           enum AVCodecID codec_id, uint32_t raw_codec_id,
+                           sc_tick duration) {
+    stream->codec_id = raw_codec_id;
+    stream->video = false;
+    stream->width = 0;
+    stream->height = 0;
+    sc_vector_init(&stream->packets);
+
+    AVCodecContext *ctx = sc_bench_open_audio_encoder(codec_id);
+    if (!ctx) {
+        return false;
+    }
+
+    AVFrame *frame = av_frame_alloc();
+    if (!frame) {
+        LOG_OOM();
+        goto error_free_context;
+    }
+
+    AVPacket *packet = av_packet_alloc();
+    if (!packet) {
+        LOG_OOM();
+        goto error_free_frame;
+    }
+
+    // Encoders with a variable frame size accept any number of samples
+    frame->nb_samples = ctx->frame_size ? ctx->frame_size
+                                        : SC_BENCH_AUDIO_SAMPLE_RATE / 50;
+    frame->format = ctx->sample_fmt;
+#ifdef SCRCPY_LAVU_HAS_CHLAYOUT
+    if (av_channel_layout_copy(&frame->ch_layout, &ctx->ch_layout)) {
+        LOG_OOM();
+        goto error_free_packet;
+    }
+#else
+    frame->channel_layout = ctx->channel_layout;
+#endif
+    if (av_frame_get_buffer(frame, 0)) {
+        LOG_OOM();
+        goto error_free_packet;
+    }
+
+    if (!sc_bench_stream_push_config(stream, ctx)) {
+        goto error_free_packet;
+    }
+
+    uint64_t total_samples =
+        duration * SC_BENCH_AUDIO_SAMPLE_RATE / SC_TICK_FREQ;
+    for (uint64_t n = 0; n < total_samples; n += frame->nb_samples) {
+        if (av_frame_make_writable(frame)) {
+            LOG_OOM();
+            goto error_free_packet;
+        }
+
+        sc_bench_fill_audio(frame, n);
+        frame->pts = n;
+
+        if (!sc_bench_stream_encode(stream, ctx, frame, packet)) {
+            goto error_free_packet;
+        }
+    }
+
+    if (!sc_bench_stream_encode(stream, ctx, NULL, packet)) {
+        goto error_free_packet;
+    }
+
+    sc_bench_stream_normalize_pts(stream);
+
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+    avcodec_free_context(&ctx);
+
+    return true;
+
+error_free_packet:
+    av_packet_free(&packet);
+error_free_frame:
+    av_frame_free(&frame);
+error_free_context:
+    avcodec_free_context(&ctx);
+    sc_bench_stream_destroy(stream);
+
+    return false;
+}
+
+void
+sc_bench_stream_destroy(struct sc_bench_stream *stream) {
+    for (size_t i = 0; i < stream->packets.size; ++i) {
+        free(stream->packets.data[i].data);
+    }
+    sc_vector_destroy(&stream->packets);
+}
+
+size_t
+sc_bench_stream_count_media_packets(const struct sc_bench_stream *stream) {
+    size_t count = 0;
+    for (size_t i = 0; i < stream->packets.size; ++i) {
+        if (stream->packets.data[i].pts != AV_NOPTS_VALUE) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void
+sc_bench_probe_init(struct sc_bench_probe *probe) {
+    sc_vector_init(&probe->points);
+}
+
+void
+sc_bench_probe_destroy(struct sc_bench_probe *probe) {
+    sc_vector_destroy(&probe->points);
+}
+
+bool
+sc_bench_probe_mark(struct sc_bench_probe *probe, int64_t pts) {
+    struct sc_bench_point point = {
+        .pts = pts,
+        .date = sc_tick_now(),
+    };
+
+    bool ok = sc_vector_push(&probe->points, point);
+    if (!ok) {
+        LOG_OOM();
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_bench_durations_init(struct sc_bench_durations *durations) {
+    sc_vector_init(&durations->values);
+}
+
+void
+sc_bench_durations_destroy(struct sc_bench_durations *durations) {
+    sc_vector_destroy(&durations->values);
+}
+
+bool
+sc_bench_durations_add(struct sc_bench_durations *durations, sc_tick value) {
+    bool ok = sc_vector_push(&durations->values, value);
+    if (!ok) {
+        LOG_OOM();
+        return false;
+    }
+
+    return true;
+}
+
+bool
+sc_bench_durations_add_latencies(struct sc_bench_durations *durations,
+                                 const struct sc_bench_probe *from,
+                                 const struct sc_bench_probe *to,
+                                 sc_tick offset) {
+    // The PTS are increasing in both probes (there are no B-frames), but some
+    // of them may be missing in "to" (e.g. dropped frames)
+    size_t i = 0;
+    for (size_t j = 0; j < to->points.size; ++j) {
+        const struct sc_bench_point *point = &to->points.data[j];
+        while (i < from->points.size && from->points.data[i].pts < point->pts) {
+            ++i;
+        }
+
+        if (i == from->points.size) {
+            break;
+        }
+
+        if (from->points.data[i].pts == point->pts) {
+            sc_tick latency = point->date - from->points.data[i].date - offset;
+            if (!sc_bench_durations_add(durations, latency)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static int
+sc_bench_compare_ticks(const void *a, const void *b) {
+    sc_tick ta = *(const sc_tick *) a;
+    sc_tick tb = *(const sc_tick *) b;
+    return (ta > tb) - (ta < tb);
+}
+
+void
+sc_bench_durations_report(struct sc_bench_durations *durations,
+                          const char *prefix, const char *name) {
+    size_t count = durations->values.size;
+    if (!count) {
+        printf("[%s] %s: no samples\n", prefix, name);
+        return;
+    }
+
+    sc_tick *values = durations->values.data;
+    qsort(values, count, sizeof(*values), sc_bench_compare_ticks);
+
+    sc_tick p50 = values[(count - 1) * 50 / 100];
+    sc_tick p99 = values[(count - 1) * 99 / 100];
+    sc_tick max = values[count - 1];
+
+    printf("[%s] %s: p50=%.3f ms, p99=%.3f ms, max=%.3f ms (%" SC_PRIsizet
+           " samples)\n", prefix, name, p50 / 1000., p99 / 1000., max / 1000.,
+           count);
+}
+
+/** Downcast packet_sink to sc_bench_packet_probe */
+#define DOWNCAST_PP(SINK) \
+    container_of(SINK, struct sc_bench_packet_probe, packet_sink)
+
+static bool
+sc_bench_packet_probe_packet_sink_open(struct sc_packet_sink *sink,
+                                       AVCodecContext *ctx) {
+    struct sc_bench_packet_probe *pp = DOWNCAST_PP(sink);
+    return pp->next->ops->open(pp->next, ctx);
+}
+
+static void
+sc_bench_packet_probe_packet_sink_close(struct sc_packet_sink *sink) {
+    struct sc_bench_packet_probe *pp = DOWNCAST_PP(sink);
+    pp->next->ops->close(pp->next);
+}
+
+static bool
+sc_bench_packet_probe_packet_sink_push(struct sc_packet_sink *sink,
+                                       const AVPacket *packet) {
+    struct sc_bench_packet_probe *pp = DOWNCAST_PP(sink);
+
+    if (packet->pts != AV_NOPTS_VALUE) {
+        if (!sc_bench_probe_mark(&pp->probe, packet->pts)) {
+            return false;
+        }
+        ++pp->count;
+    }
+
+    return pp->next->ops->push(pp->next, packet);
+}
+
+void
+sc_bench_packet_probe_init(struct sc_bench_packet_probe *pp,
+                           struct sc_packet_sink *next) {
+    pp->next = next;
+    sc_bench_probe_init(&pp->probe);
+    pp->count = 0;
+
+    static const struct sc_packet_sink_ops ops = {
+        .open = sc_bench_packet_probe_packet_sink_open,
+        .close = sc_bench_packet_probe_packet_sink_close,
+        .push = sc_bench_packet_probe_packet_sink_push,
+    };
+
+    pp->packet_sink.ops = &ops;
+}
+
+void
+sc_bench_packet_probe_destroy(struct sc_bench_packet_probe *pp) {
+    sc_bench_probe_destroy(&pp->probe);
+}
+
+/** Downcast frame_sink to sc_bench_frame_probe */
+#define DOWNCAST_FP(SINK) \
+    container_of(SINK, struct sc_bench_frame_probe, frame_sink)
+
+static bool
+sc_bench_frame_probe_frame_sink_open(struct sc_frame_sink *sink,
+                                     const AVCodecContext *ctx) {
+    struct sc_bench_frame_probe *fp = DOWNCAST_FP(sink);
+    return sc_frame_source_sinks_open(&fp->frame_source, ctx);
+}
+
+static void
+sc_bench_frame_probe_frame_sink_close(struct sc_frame_sink *sink) {
+    struct sc_bench_frame_probe *fp = DOWNCAST_FP(sink);
+    sc_frame_source_sinks_close(&fp->frame_source);
+}
+
+static bool
+sc_bench_frame_probe_frame_sink_push(struct sc_frame_sink *sink,
+                                     const AVFrame *frame) {
+    struct sc_bench_frame_probe *fp = DOWNCAST_FP(sink);
+
+    if (!sc_bench_probe_mark(&fp->probe, frame->pts)) {
+        return false;
+    }
+    ++fp->count;
+
+    return sc_frame_source_sinks_push(&fp->frame_source, frame);
+}
+
+void
+sc_bench_frame_probe_init(struct sc_bench_frame_probe *fp) {
+    sc_frame_source_init(&fp->frame_source);
+    sc_bench_probe_init(&fp->probe);
+    fp->count = 0;
+
+    static const struct sc_frame_sink_ops ops = {
+        .open = sc_bench_frame_probe_frame_sink_open,
+        .close = sc_bench_frame_probe_frame_sink_close,
+        .push = sc_bench_frame_probe_frame_sink_push,
+    };
+
+    fp->frame_sink.ops = &ops;
+}
+
+void
+sc_bench_frame_probe_destroy(struct sc_bench_frame_probe *fp) {
+    sc_bench_probe_destroy(&fp->probe);
+}
+
+bool
+sc_bench_socket_pair(sc_socket *writer, sc_socket *reader) {
+    sc_socket server_socket = net_socket();
+    if (server_socket == SC_SOCKET_NONE) {
+        return false;
+    }
+
+    uint16_t port = SC_BENCH_PORT_FIRST;
+    while (!net_listen(server_socket, IPV4_LOCALHOST, port, 1)) {
+        if (port == SC_BENCH_PORT_LAST) {
+            LOGE("Could not listen on any port in range [%d; %d]",
+                 SC_BENCH_PORT_FIRST, SC_BENCH_PORT_LAST);
+            net_close(server_socket);
+            return false;
+        }
+        ++port;
+    }
+
+    sc_socket client_socket = net_socket();
+    if (client_socket == SC_SOCKET_NONE) {
+        net_close(server_socket);
+        return false;
+    }
+
+    if (!net_connect(client_socket, IPV4_LOCALHOST, port)) {
+        net_close(client_socket);
+        net_close(server_socket);
+        return false;
+    }
+
+    sc_socket accepted_socket = net_accept(server_socket);
+    net_close(server_socket);
+    if (accepted_socket == SC_SOCKET_NONE) {
+        net_close(client_socket);
+        return false;
+    }
+
+    // Like the server, send the packets immediately
+    bool ok = net_set_tcp_nodelay(accepted_socket, true);
+    (void) ok; // error already logged
+
+    *writer = accepted_socket;
+    *reader = client_socket;
+    return true;
+}
+
+static void
+sc_bench_writer_wait(struct sc_bench_writer *writer, sc_tick deadline) {
+    sc_mutex_lock(&writer->mutex);
+    while (sc_cond_timedwait(&writer->cond, &writer->mutex, deadline)) {
+        // spurious wake-up
+    }
+    sc_mutex_unlock(&writer->mutex);
+}
+
+static bool
+sc_bench_writer_send(struct sc_bench_writer *writer, const uint8_t *data,
+                     size_t len) {
+    ssize_t w = net_send_all(writer->socket, data, len);
+    return w >= 0 && (size_t) w == len;
+}
+
+static int
+run_writer(void *data) {
+    struct sc_bench_writer *writer = data;
+    const struct sc_bench_stream *stream = writer->stream;
+
+    uint8_t header[SC_BENCH_PACKET_HEADER_SIZE];
+
+    sc_write32be(header, stream->codec_id);
+    if (!sc_bench_writer_send(writer, header, 4)) {
+        goto end;
+    }
+
+    if (stream->video) {
+        sc_write32be(header, stream->width);
+        sc_write32be(&header[4], stream->height);
+        if (!sc_bench_writer_send(writer, header, 8)) {
+            goto end;
+        }
+    }
+
+    writer->start = sc_tick_now();
+    int64_t first_pts = AV_NOPTS_VALUE;
+
+    for (size_t i = 0; i < stream->packets.size; ++i) {
+        const struct sc_bench_packet *packet = &stream->packets.data[i];
+
+        uint64_t pts_flags;
+        if (packet->pts == AV_NOPTS_VALUE) {
+            pts_flags = SC_BENCH_PACKET_FLAG_CONFIG;
+        } else {
+            if (writer->realtime) {
+                if (first_pts == AV_NOPTS_VALUE) {
+                    first_pts = packet->pts;
+                } else {
+                    sc_tick deadline = writer->start
+                                     + SC_TICK_FROM_US(packet->pts - first_pts);
+                    sc_bench_writer_wait(writer, deadline);
+                }
+            }
+
+            pts_flags = packet->pts;
+            if (packet->key_frame) {
+                pts_flags |= SC_BENCH_PACKET_FLAG_KEY_FRAME;
+            }
+
+            if (!sc_bench_probe_mark(&writer->probe, packet->pts)) {
+                goto end;
+            }
+        }
+
+        assert(packet->size <= UINT32_MAX);
+        sc_write64be(header, pts_flags);
+        sc_write32be(&header[8], packet->size);
+
+        if (!sc_bench_writer_send(writer, header, sizeof(header))
+                || !sc_bench_writer_send(writer, packet->data, packet->size)) {
+            LOGE("Could not send packet");
+            goto end;
+        }
+    }
+
+end:
+    writer->end = sc_tick_now();
+
+    // End-of-stream for the demuxer
+    net_interrupt(writer->socket);
+
+    return 0;
+}
+
+bool
+sc_bench_writer_start(struct sc_bench_writer *writer,
+                      const struct sc_bench_stream *stream, sc_socket socket,
+                      bool realtime) {
+    writer->stream = stream;
+    writer->socket = socket;
+    writer->realtime = realtime;
+    writer->start = 0;
+    writer->end = 0;
+
+    bool ok = sc_mutex_init(&writer->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&writer->cond);
+    if (!ok) {
+        sc_mutex_destroy(&writer->mutex);
+        return false;
+    }
+
+    sc_bench_probe_init(&writer->probe);
+
+    ok = sc_thread_create(&writer->thread, run_writer, "scrcpy-bench-w",
+                          writer);
+    if (!ok) {
+        LOGE("Could not start writer thread");
+        sc_bench_probe_destroy(&writer->probe);
+        sc_cond_destroy(&writer->cond);
+        sc_mutex_destroy(&writer->mutex);
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_bench_writer_join(struct sc_bench_writer *writer) {
+    sc_thread_join(&writer->thread, NULL);
+}
+
+void
+sc_bench_writer_destroy(struct sc_bench_writer *writer) {
+    sc_bench_probe_destroy(&writer->probe);
+    sc_cond_destroy(&writer->cond);
+    sc_mutex_destroy(&writer->mutex);
+}
+
+uint64_t
+sc_bench_get_peak_rss(void) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        return 0;
+    }
+    return pmc.PeakWorkingSetSize / 1024;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage)) {
+        return 0;
+    }
+# ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // in bytes on macOS
+# else
+    return usage.ru_maxrss; // in KiB on Linux
+# endif
+#endif
+}
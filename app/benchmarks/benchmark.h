@@ -0,0 +1,201 @@
+#ifndef SC_BENCHMARK_H
+#define SC_BENCHMARK_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <libavcodec/avcodec.h>
+
+#include "trait/frame_sink.h"
+#include "trait/frame_source.h"
+#include "trait/packet_sink.h"
+#include "util/net.h"
+#include "util/thread.h"
+#include "util/tick.h"
+#include "util/vector.h"
+
+struct sc_bench_packet {
+    int64_t pts; // in microseconds, AV_NOPTS_VALUE for config packets
+    bool key_frame;
+    uint8_t *data;
+    size_t size;
+};
+
+/**
+ * Synthetic stream, generated locally with libavcodec, to be sent to the
+ * demuxer exactly like the server would
+ */
+struct sc_bench_stream {
+    uint32_t codec_id; // as sent by the server
+    bool video;
+    uint32_t width;
+    uint32_t height;
+    struct SC_VECTOR(struct sc_bench_packet) packets;
+};
+
+/**
+ * Generate `frames` frames of a synthetic moving pattern
+ *
+ * Return false if the codec is not supported by the local libavcodec encoders.
+ */
+bool
+sc_bench_stream_init_video(struct sc_bench_stream *stream,
+                           enum AVCodecID codec_id, uint32_t raw_codec_id,
+                           uint32_t width, uint32_t height, unsigned frames);
+
+/**
+ * Generate `duration` of a synthetic 48kHz stereo triangle wave
+ *
+ * Return false if the codec is not supported by the local libavcodec encoders.
+ */
+bool
+sc_bench_stream_init_audio(struct sc_bench_stream *stream,
+                           enum AVCodecID codec_id, uint32_t raw_codec_id,
+                           sc_tick duration);
+
+void
+sc_bench_stream_destroy(struct sc_bench_stream *stream);
+
+// Number of non-config packets
+size_t
+sc_bench_stream_count_media_packets(const struct sc_bench_stream *stream);
+
+struct sc_bench_point {
+    int64_t pts;
+    sc_tick date;
+};
+
+/**
+ * Dates at which the packets or frames (identified by their PTS) pass through
+ * a given point of the pipeline.
+ *
+ * A probe must be written by a single thread, and only read once this thread
+ * is joined.
+ */
+struct sc_bench_probe {
+    struct SC_VECTOR(struct sc_bench_point) points;
+};
+
+void
+sc_bench_probe_init(struct sc_bench_probe *probe);
+
+void
+sc_bench_probe_destroy(struct sc_bench_probe *probe);
+
+bool
+sc_bench_probe_mark(struct sc_bench_probe *probe, int64_t pts);
+
+struct sc_bench_durations {
+    struct SC_VECTOR(sc_tick) values;
+};
+
+void
+sc_bench_durations_init(struct sc_bench_durations *durations);
+
+void
+sc_bench_durations_destroy(struct sc_bench_durations *durations);
+
+bool
+sc_bench_durations_add(struct sc_bench_durations *durations, sc_tick value);
+
+/**
+ * Add the latencies between the two probes (minus `offset`) for all the PTS
+ * present in both
+ */
+bool
+sc_bench_durations_add_latencies(struct sc_bench_durations *durations,
+                                 const struct sc_bench_probe *from,
+                                 const struct sc_bench_probe *to,
+                                 sc_tick offset);
+
+/**
+ * Print p50, p99 and max (the durations are sorted in place)
+ */
+void
+sc_bench_durations_report(struct sc_bench_durations *durations,
+                          const char *prefix, const char *name);
+
+/**
+ * Packet sink which marks the packets in a probe, then forwards them to
+ * another packet sink
+ */
+struct sc_bench_packet_probe {
+    struct sc_packet_sink packet_sink; // packet sink trait
+
+    struct sc_packet_sink *next;
+    struct sc_bench_probe probe;
+    uint64_t count; // non-config packets
+};
+
+void
+sc_bench_packet_probe_init(struct sc_bench_packet_probe *pp,
+                           struct sc_packet_sink *next);
+
+void
+sc_bench_packet_probe_destroy(struct sc_bench_packet_probe *pp);
+
+/**
+ * Frame sink which marks the frames in a probe, then forwards them to its own
+ * sinks
+ */
+struct sc_bench_frame_probe {
+    struct sc_frame_sink frame_sink; // frame sink trait
+    struct sc_frame_source frame_source; // frame source trait
+
+    struct sc_bench_probe probe;
+    uint64_t count;
+};
+
+void
+sc_bench_frame_probe_init(struct sc_bench_frame_probe *fp);
+
+void
+sc_bench_frame_probe_destroy(struct sc_bench_frame_probe *fp);
+
+/**
+ * Connected pair of localhost sockets, to feed the demuxer
+ */
+bool
+sc_bench_socket_pair(sc_socket *writer, sc_socket *reader);
+
+/**
+ * Thread sending a stream to a socket, with the same framing as the server
+ *
+ * If `realtime` is set, the packets are sent according to their PTS,
+ * otherwise as fast as possible.
+ *
+ * The socket is shut down at the end of the stream, so that the demuxer
+ * detects end-of-stream.
+ */
+struct sc_bench_writer {
+    const struct sc_bench_stream *stream;
+    sc_socket socket;
+    bool realtime;
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond; // never signaled, only used to wait until a deadline
+
+    struct sc_bench_probe probe; // send dates
+    sc_tick start;
+    sc_tick end;
+};
+
+bool
+sc_bench_writer_start(struct sc_bench_writer *writer,
+                      const struct sc_bench_stream *stream, sc_socket socket,
+                      bool realtime);
+
+void
+sc_bench_writer_join(struct sc_bench_writer *writer);
+
+void
+sc_bench_writer_destroy(struct sc_bench_writer *writer);
+
+// Peak resident set size of the process, in KiB (0 if unknown)
+uint64_t
+sc_bench_get_peak_rss(void);
+
+#endif
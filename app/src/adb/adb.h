@@ -12,6 +12,8 @@
 #define SC_ADB_NO_STDOUT (1 << 0)
 #define SC_ADB_NO_STDERR (1 << 1)
 #define SC_ADB_NO_LOGERR (1 << 2)
+// Redirect the adb stdout to stderr (if stdout is reserved for a data stream)
+#define SC_ADB_STDOUT_TO_STDERR (1 << 3)
 
 #define SC_ADB_SILENT (SC_ADB_NO_STDOUT | SC_ADB_NO_STDERR | SC_ADB_NO_LOGERR)
 
@@ -0,0 +1,168 @@
+#include "audio_buffer_adapter.h"
+
+#include <assert.h>
+#include <inttypes.h>
+
+#include "util/log.h"
+
+// Additional buffering above the measured requirement
+#define SC_AUDIO_BUFFER_ADAPTER_MARGIN SC_TICK_FROM_MS(10)
+// Only decrease the target buffering after this number of periods without
+// underflow
+#define SC_AUDIO_BUFFER_ADAPTER_STABLE_PERIODS 10
+// Forget the target buffering which caused the last underflow after this
+// number of periods without underflow (so that it may be probed again)
+#define SC_AUDIO_BUFFER_ADAPTER_UNDERFLOW_PERIODS 300
+// Log the statistics every this number of periods
+#define SC_AUDIO_BUFFER_ADAPTER_REPORT_PERIODS 10
+
+static uint32_t
+to_samples(struct sc_audio_buffer_adapter *adapter, sc_tick duration) {
+    return duration * adapter->sample_rate / SC_TICK_FREQ;
+}
+
+static uint32_t
+to_ms(struct sc_audio_buffer_adapter *adapter, uint32_t samples) {
+    return (uint64_t) samples * 1000 / adapter->sample_rate;
+}
+
+void
+sc_audio_buffer_adapter_init(struct sc_audio_buffer_adapter *adapter,
+                             uint32_t sample_rate, uint32_t target,
+                             uint32_t min_target, uint32_t max_target) {
+    assert(sample_rate);
+    assert(min_target <= max_target);
+
+    adapter->sample_rate = sample_rate;
+    adapter->min_target = min_target;
+    adapter->max_target = max_target;
+    adapter->target = CLAMP(target, min_target, max_target);
+
+    adapter->has_transit = false;
+    adapter->max_block = 0;
+
+    for (unsigned i = 0; i < SC_AUDIO_BUFFER_ADAPTER_WINDOW; ++i) {
+        adapter->jitter[i] = 0;
+    }
+    adapter->jitter_head = 0;
+
+    adapter->periods_since_underflow = 0;
+    adapter->underflow_target = 0;
+
+    adapter->report_periods = 0;
+    adapter->report_samples = 0;
+    adapter->report_underflow = 0;
+}
+
+void
+sc_audio_buffer_adapter_push(struct sc_audio_buffer_adapter *adapter,
+                             sc_tick date, int64_t pts, uint32_t samples) {
+    // The PTS are expressed in microseconds
+    sc_tick transit = date - SC_TICK_FROM_US(pts);
+
+    if (!adapter->has_transit) {
+        adapter->min_transit = transit;
+        adapter->max_transit = transit;
+        adapter->has_transit = true;
+    } else if (transit < adapter->min_transit) {
+        adapter->min_transit = transit;
+    } else if (transit > adapter->max_transit) {
+        adapter->max_transit = transit;
+    }
+
+    if (samples > adapter->max_block) {
+        adapter->max_block = samples;
+    }
+}
+
+static sc_tick
+sc_audio_buffer_adapter_get_jitter(struct sc_audio_buffer_adapter *adapter) {
+    sc_tick max = 0;
+    for (unsigned i = 0; i < SC_AUDIO_BUFFER_ADAPTER_WINDOW; ++i) {
+        if (adapter->jitter[i] > max) {
+            max = adapter->jitter[i];
+        }
+    }
+    return max;
+}
+
+static void
+sc_audio_buffer_adapter_report(struct sc_audio_buffer_adapter *adapter,
+                               uint32_t samples, uint32_t underflow,
+                               sc_tick jitter) {
+    adapter->report_samples += samples;
+    adapter->report_underflow += underflow;
+
+    if (++adapter->report_periods < SC_AUDIO_BUFFER_ADAPTER_REPORT_PERIODS) {
+        return;
+    }
+
+    float underflow_rate = adapter->report_samples
+        ? (float) adapter->report_underflow * 100 / adapter->report_samples
+        : 0;
+    LOGD("[Audio] Adaptive buffering: target=%" PRIu32 "ms jitter=%" PRItick
+         "ms underflow=%.2f%%", to_ms(adapter, adapter->target),
+         SC_TICK_TO_MS(jitter), underflow_rate);
+
+    adapter->report_periods = 0;
+    adapter->report_samples = 0;
+    adapter->report_underflow = 0;
+}
+
+uint32_t
+sc_audio_buffer_adapter_update(struct sc_audio_buffer_adapter *adapter,
+                               uint32_t samples, uint32_t underflow) {
+    adapter->jitter[adapter->jitter_head] = adapter->has_transit
+                                ? adapter->max_transit - adapter->min_transit
+                                : 0;
+    adapter->jitter_head =
+        (adapter->jitter_head + 1) % SC_AUDIO_BUFFER_ADAPTER_WINDOW;
+    adapter->has_transit = false;
+
+    sc_tick jitter = sc_audio_buffer_adapter_get_jitter(adapter);
+    uint32_t margin = to_samples(adapter, SC_AUDIO_BUFFER_ADAPTER_MARGIN);
+
+    // The buffering is measured when a block is received, so it must contain
+    // at least the samples to play until the next block is received (late)
+    uint32_t required = adapter->max_block + to_samples(adapter, jitter)
+                      + margin;
+
+    uint32_t target = adapter->target;
+    if (underflow) {
+        adapter->periods_since_underflow = 0;
+        adapter->underflow_target = target;
+
+        // Increase the target buffering by 25% (at least by the margin)
+        uint32_t step = MAX(target / 4, margin);
+        target = MAX(target + step, required);
+    } else {
+        ++adapter->periods_since_underflow;
+        if (adapter->periods_since_underflow
+                >= SC_AUDIO_BUFFER_ADAPTER_UNDERFLOW_PERIODS) {
+            adapter->underflow_target = 0;
+        }
+
+        if (required > target) {
+            target = required;
+        } else if (adapter->periods_since_underflow
+                >= SC_AUDIO_BUFFER_ADAPTER_STABLE_PERIODS) {
+            uint32_t lower = required;
+            if (adapter->underflow_target) {
+                // Do not decrease back to the value which caused an underflow
+                lower = MAX(lower, adapter->underflow_target + margin);
+            }
+
+            if (target > lower) {
+                // Decrease slowly (2% per period, at least 1ms)
+                uint32_t step = MAX(target / 50, adapter->sample_rate / 1000);
+                target = target - lower > step ? target - step : lower;
+            }
+        }
+    }
+
+    adapter->target = CLAMP(target, adapter->min_target, adapter->max_target);
+
+    sc_audio_buffer_adapter_report(adapter, samples, underflow, jitter);
+
+    return adapter->target;
+}
@@ -0,0 +1,86 @@
+#ifndef SC_AUDIO_BUFFER_ADAPTER_H
+#define SC_AUDIO_BUFFER_ADAPTER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/tick.h"
+
+// Number of periods (of 1 second) to keep to estimate the jitter
+#define SC_AUDIO_BUFFER_ADAPTER_WINDOW 10
+
+/**
+ * Adapt the audio target buffering to the network conditions
+ *
+ * The target buffering must be large enough to absorb the jitter of the
+ * packets arrival (and the size of the blocks of samples), but any additional
+ * buffering increases the latency.
+ *
+ * The adapter measures the packet inter-arrival jitter and the buffer
+ * underflows, and moves the target buffering within the configured bounds:
+ *  - it increases immediately if the measured jitter requires it or on buffer
+ *    underflow;
+ *  - it decreases slowly towards the value required by the measured jitter
+ *    once no underflow occurred for some time, but never back to a value
+ *    which recently caused an underflow.
+ *
+ * All values are expressed in samples.
+ */
+struct sc_audio_buffer_adapter {
+    uint32_t sample_rate;
+    uint32_t min_target;
+    uint32_t max_target;
+
+    uint32_t target;
+
+    // Min and max transit time (arrival date minus PTS) of the packets
+    // received during the current period
+    sc_tick min_transit;
+    sc_tick max_transit;
+    bool has_transit;
+    // Largest block of samples received
+    uint32_t max_block;
+
+    // Jitter (max transit minus min transit) of the last periods
+    sc_tick jitter[SC_AUDIO_BUFFER_ADAPTER_WINDOW];
+    unsigned jitter_head;
+
+    // Number of periods since the last underflow
+    unsigned periods_since_underflow;
+    // Target buffering when the last underflow occurred (0 if forgotten)
+    uint32_t underflow_target;
+
+    // Statistics for periodic logging
+    unsigned report_periods;
+    uint64_t report_samples;
+    uint64_t report_underflow;
+};
+
+void
+sc_audio_buffer_adapter_init(struct sc_audio_buffer_adapter *adapter,
+                             uint32_t sample_rate, uint32_t target,
+                             uint32_t min_target, uint32_t max_target);
+
+/**
+ * Register a packet of the given number of samples, received at the given
+ * date
+ *
+ * The PTS is expressed in microseconds.
+ */
+void
+sc_audio_buffer_adapter_push(struct sc_audio_buffer_adapter *adapter,
+                             sc_tick date, int64_t pts, uint32_t samples);
+
+/**
+ * Terminate the current period, during which `samples` samples were received
+ * and `underflow` silence samples were inserted
+ *
+ * Return the new target buffering.
+ */
+uint32_t
+sc_audio_buffer_adapter_update(struct sc_audio_buffer_adapter *adapter,
+                               uint32_t samples, uint32_t underflow);
+
+#endif
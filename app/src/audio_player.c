@@ -17,7 +17,12 @@ sc_audio_player_sdl_callback(void *userdata, uint8_t *stream, int len_int) {
     assert(len % ap->audioreg.sample_size == 0);
     uint32_t out_samples = len / ap->audioreg.sample_size;
 
-    sc_audio_regulator_pull(&ap->audioreg, stream, out_samples);
+    int64_t pts = sc_audio_regulator_pull(&ap->audioreg, stream, out_samples);
+    if (ap->av_sync && pts != -1) {
+        // The samples will be played once the current SDL buffer is consumed
+        sc_av_sync_report_audio(ap->av_sync, pts,
+                                sc_tick_now() + ap->output_latency);
+    }
 }
 
 static bool
@@ -49,10 +54,16 @@ sc_audio_player_frame_sink_open(struct sc_frame_sink *sink,
 
     uint32_t target_buffering_samples =
         ap->target_buffering_delay * ctx->sample_rate / SC_TICK_FREQ;
+    uint32_t min_target_buffering_samples =
+        ap->min_target_buffering_delay * ctx->sample_rate / SC_TICK_FREQ;
+    uint32_t max_target_buffering_samples =
+        ap->max_target_buffering_delay * ctx->sample_rate / SC_TICK_FREQ;
 
     size_t sample_size = nb_channels * out_bytes_per_sample;
     bool ok = sc_audio_regulator_init(&ap->audioreg, sample_size, ctx,
-                                      target_buffering_samples);
+                                      target_buffering_samples,
+                                      min_target_buffering_samples,
+                                      max_target_buffering_samples);
     if (!ok) {
         return false;
     }
@@ -78,6 +89,9 @@ sc_audio_player_frame_sink_open(struct sc_frame_sink *sink,
         return false;
     }
 
+    ap->output_latency = (sc_tick) obtained.samples * SC_TICK_FREQ
+                       / obtained.freq;
+
     // The thread calling open() is the thread calling push(), which fills the
     // audio buffer consumed by the SDL audio thread.
     ok = sc_thread_set_priority(SC_THREAD_PRIORITY_TIME_CRITICAL);
@@ -104,9 +118,19 @@ sc_audio_player_frame_sink_close(struct sc_frame_sink *sink) {
 
 void
 sc_audio_player_init(struct sc_audio_player *ap, sc_tick target_buffering,
-                     sc_tick output_buffer_duration) {
+                     sc_tick min_target_buffering,
+                     sc_tick max_target_buffering,
+                     sc_tick output_buffer_duration,
+                     struct sc_av_sync *av_sync) {
+    assert(min_target_buffering <= target_buffering);
+    assert(target_buffering <= max_target_buffering);
+
     ap->target_buffering_delay = target_buffering;
+    ap->min_target_buffering_delay = min_target_buffering;
+    ap->max_target_buffering_delay = max_target_buffering;
     ap->output_buffer_duration = output_buffer_duration;
+    ap->output_latency = 0;
+    ap->av_sync = av_sync;
 
     static const struct sc_frame_sink_ops ops = {
         .open = sc_audio_player_frame_sink_open,
@@ -7,7 +7,9 @@
 #include <libavcodec/avcodec.h>
 #include <libavutil/opt.h>
 
+#include "util/audio_convert.h"
 #include "util/log.h"
+#include "util/tick.h"
 
 //#define SC_AUDIO_REGULATOR_DEBUG // uncomment to debug
 
@@ -27,7 +29,9 @@
  * of samples present in the buffer) around a target value. If this target
  * buffering is too low, then buffer underrun will occur frequently. If it is
  * too high, then latency will become unacceptable. This target value is
- * configured using the scrcpy option --audio-buffer.
+ * configured using the scrcpy option --audio-buffer. With --audio-buffer=auto,
+ * it is adapted to the measured jitter and underflows (see
+ * sc_audio_buffer_adapter).
  *
  * The regulator cannot adjust the sample input rate (it receives samples
  * produced in real-time) or the sample output rate (it must provide samples as
@@ -38,6 +42,10 @@
  * configured using swr_set_compensation(). An important work for the regulator
  * is to estimate the compensation value regularly and apply it.
  *
+ * Most of the time, no compensation is applied. In that case, libswresample is
+ * bypassed: the input samples are converted (if necessary) directly into the
+ * audio buffer, without intermediate copy.
+ *
  * The estimated buffering level is the result of averaging the "natural"
  * buffering (samples are produced and consumed by blocks, so it must be
  * smoothed), and making instant adjustments resulting of its own actions
@@ -59,23 +67,38 @@
 #define TO_BYTES(SAMPLES) sc_audiobuf_to_bytes(&ar->buf, (SAMPLES))
 #define TO_SAMPLES(BYTES) sc_audiobuf_to_samples(&ar->buf, (BYTES))
 
-void
+// Return the number of buffered samples, excluding the samples to be dropped
+static uint32_t
+sc_audio_regulator_get_buffering(struct sc_audio_regulator *ar) {
+    uint32_t drop = atomic_load_explicit(&ar->drop_request,
+                                         memory_order_relaxed);
+    uint32_t can_read = sc_audiobuf_can_read(&ar->buf);
+    return can_read > drop ? can_read - drop : 0;
+}
+
+int64_t
 sc_audio_regulator_pull(struct sc_audio_regulator *ar, uint8_t *out,
                         uint32_t out_samples) {
 #ifdef SC_AUDIO_REGULATOR_DEBUG
     LOGD("[Audio] Audio regulator pulls %" PRIu32 " samples", out_samples);
 #endif
 
-    // A lock is necessary in the rare case where the producer needs to drop
-    // samples already pushed (when the buffer is full)
-    sc_mutex_lock(&ar->mutex);
+    // This function is called from the real-time audio callback, it must never
+    // wait for the producer: there is no lock, the samples to drop are
+    // requested by the producer and dropped here
+    uint32_t drop = atomic_exchange_explicit(&ar->drop_request, 0,
+                                             memory_order_relaxed);
+    if (drop) {
+        uint32_t r = sc_audiobuf_read(&ar->buf, NULL, drop);
+        (void) r; // it may be lower if they have been consumed meanwhile
+    }
 
     bool played = atomic_load_explicit(&ar->played, memory_order_relaxed);
     if (!played) {
         uint32_t buffered_samples = sc_audiobuf_can_read(&ar->buf);
         // Wait until the buffer is filled up to at least target_buffering
         // before playing
-        if (buffered_samples < ar->target_buffering) {
+        if (buffered_samples < ar->start_buffering) {
 #ifdef SC_AUDIO_REGULATOR_DEBUG
             LOGD("[Audio] Inserting initial buffering silence: %" PRIu32
                  " samples", out_samples);
@@ -84,14 +107,19 @@ sc_audio_regulator_pull(struct sc_audio_regulator *ar, uint8_t *out,
             // whole buffer with silence (len is small compared to the
             // arbitrary margin value).
             memset(out, 0, out_samples * ar->sample_size);
-            sc_mutex_unlock(&ar->mutex);
-            return;
+            return -1;
         }
     }
 
+    // Load the PTS before the buffering level: if the producer writes new
+    // samples in between, the computed PTS will be too early (it is never too
+    // late)
+    int64_t end_pts = atomic_load_explicit(&ar->end_pts, memory_order_acquire);
+    uint32_t buffered_samples = sc_audiobuf_can_read(&ar->buf);
+
     uint32_t read = sc_audiobuf_read(&ar->buf, out, out_samples);
 
-    sc_mutex_unlock(&ar->mutex);
+    int64_t pts = -1;
 
     if (read < out_samples) {
         uint32_t silence = out_samples - read;
@@ -113,9 +141,110 @@ sc_audio_regulator_pull(struct sc_audio_regulator *ar, uint8_t *out,
             atomic_fetch_add_explicit(&ar->underflow, silence,
                                       memory_order_relaxed);
         }
+    } else if (end_pts != -1) {
+        pts = end_pts - (int64_t) buffered_samples * 1000000 / ar->sample_rate;
     }
 
     atomic_store_explicit(&ar->played, true, memory_order_relaxed);
+
+    return pts;
+}
+
+static void
+sc_audio_regulator_convert_flt(uint8_t *to, const AVFrame *frame,
+                               unsigned channels, uint32_t offset,
+                               uint32_t samples) {
+    const float *src = (const float *) frame->data[0] + offset * channels;
+    memcpy(to, src, samples * channels * sizeof(float));
+}
+
+static void
+sc_audio_regulator_convert_fltp(uint8_t *to, const AVFrame *frame,
+                                unsigned channels, uint32_t offset,
+                                uint32_t samples) {
+    // extended_data contains all the planes (data only contains the first 8)
+    const float *const *src = (const float *const *) frame->extended_data;
+    sc_audio_interleave_flt((float *) to, src, channels, offset, samples);
+}
+
+static void
+sc_audio_regulator_convert_s16(uint8_t *to, const AVFrame *frame,
+                               unsigned channels, uint32_t offset,
+                               uint32_t samples) {
+    const int16_t *src = (const int16_t *) frame->data[0] + offset * channels;
+    sc_audio_convert_s16((float *) to, src, samples * channels);
+}
+
+static void
+sc_audio_regulator_convert_s32(uint8_t *to, const AVFrame *frame,
+                               unsigned channels, uint32_t offset,
+                               uint32_t samples) {
+    const int32_t *src = (const int32_t *) frame->data[0] + offset * channels;
+    sc_audio_convert_s32((float *) to, src, samples * channels);
+}
+
+static sc_audio_regulator_convert_fn
+sc_audio_regulator_get_convert_fn(enum AVSampleFormat fmt) {
+    static_assert(SC_AV_SAMPLE_FMT == AV_SAMPLE_FMT_FLT,
+                  "The conversion kernels produce float samples");
+
+    switch (fmt) {
+        case AV_SAMPLE_FMT_FLT:
+            return sc_audio_regulator_convert_flt;
+        case AV_SAMPLE_FMT_FLTP:
+            return sc_audio_regulator_convert_fltp;
+        case AV_SAMPLE_FMT_S16:
+            return sc_audio_regulator_convert_s16;
+        case AV_SAMPLE_FMT_S32:
+            return sc_audio_regulator_convert_s32;
+        default:
+            // Use libswresample
+            return NULL;
+    }
+}
+
+// The buffering level is sampled once per received packet. Smooth it over the
+// same duration (128 packets of 20ms) whatever the packet size, so that small
+// packets (low-latency frame durations) do not make the average more noisy.
+#define SC_AUDIO_REGULATOR_AVG_RANGE 128
+#define SC_AUDIO_REGULATOR_AVG_PACKET_SAMPLES 960
+#define SC_AUDIO_REGULATOR_AVG_MAX_RANGE 1024
+
+static unsigned
+sc_audio_regulator_avg_range(uint32_t packet_samples) {
+    assert(packet_samples);
+    uint32_t range = SC_AUDIO_REGULATOR_AVG_RANGE
+                   * SC_AUDIO_REGULATOR_AVG_PACKET_SAMPLES / packet_samples;
+    return CLAMP(range, SC_AUDIO_REGULATOR_AVG_RANGE,
+                 SC_AUDIO_REGULATOR_AVG_MAX_RANGE);
+}
+
+struct sc_audio_regulator_direct_write {
+    struct sc_audio_regulator *ar;
+    const AVFrame *frame;
+};
+
+static void
+sc_audio_regulator_write_direct_cb(uint8_t *to, uint32_t offset,
+                                   uint32_t samples, void *userdata) {
+    struct sc_audio_regulator_direct_write *dw = userdata;
+    struct sc_audio_regulator *ar = dw->ar;
+    ar->convert(to, dw->frame, ar->channels, offset, samples);
+}
+
+// Write the frame samples directly into the audio buffer (no compensation)
+static uint32_t
+sc_audio_regulator_write_direct(struct sc_audio_regulator *ar,
+                                const AVFrame *frame) {
+    assert(ar->convert);
+    assert(!ar->compensation_active);
+
+    struct sc_audio_regulator_direct_write dw = {
+        .ar = ar,
+        .frame = frame,
+    };
+    return sc_audiobuf_write_with(&ar->buf, frame->nb_samples,
+                                  sc_audio_regulator_write_direct_cb, &dw);
 }
 
 static uint8_t *
@@ -137,39 +266,62 @@ sc_audio_regulator_get_swr_buf(struct sc_audio_regulator *ar,
     return ar->swr_buf;
 }
 
-bool
-sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
+// Disable compensation. If the direct conversion is supported, the samples
+// still buffered in the resampler are written to the audio buffer, so that it
+// may be bypassed. Return the number of samples written (or -1 on error).
+static int
+sc_audio_regulator_stop_compensation(struct sc_audio_regulator *ar) {
+    assert(ar->compensation_active);
+
     SwrContext *swr_ctx = ar->swr_ctx;
+    ar->compensation_active = false;
 
-    uint32_t input_samples = frame->nb_samples;
+    int ret = swr_set_compensation(swr_ctx, 0, 0);
+    (void) ret;
+    assert(!ret); // disabling compensation should never fail
 
-    assert(frame->pts >= 0);
-    int64_t pts = frame->pts;
-    if (ar->next_expected_pts && pts - ar->next_expected_pts > 100000) {
-        LOGV("[Audio] Discontinuity detected: %" PRIi64 "µs",
-             pts - ar->next_expected_pts);
-        // More than 100ms: consider it as a discontinuity
-        // (typically because silence packets were not captured)
-        uint32_t can_read = sc_audiobuf_can_read(&ar->buf);
-        if (input_samples + can_read < ar->target_buffering) {
-            // Adjust buffering to the target value directly
-            uint32_t silence = ar->target_buffering - can_read - input_samples;
-            sc_audiobuf_write_silence(&ar->buf, silence);
+    if (!ar->convert) {
+        // The resampler is always used
+        return 0;
+    }
+
+    uint32_t written = 0;
+
+    int64_t swr_delay = swr_get_delay(swr_ctx, ar->sample_rate);
+    if (swr_delay > 0) {
+        int dst_nb_samples = swr_delay + 256;
+        uint8_t *swr_buf = sc_audio_regulator_get_swr_buf(ar, dst_nb_samples);
+        if (!swr_buf) {
+            return -1;
         }
 
-        // Reset state
-        ar->avg_buffering.avg = ar->target_buffering;
-        int ret = swr_set_compensation(swr_ctx, 0, 0);
-        (void) ret;
-        assert(!ret); // disabling compensation should never fail
-        ar->compensation_active = false;
-        ar->samples_since_resync = 0;
-        atomic_store_explicit(&ar->underflow, 0, memory_order_relaxed);
+        // Flush the resampler
+        ret = swr_convert(swr_ctx, &swr_buf, dst_nb_samples, NULL, 0);
+        if (ret < 0) {
+            LOGE("Resampling failed: %d", ret);
+            return -1;
+        }
+
+        uint32_t samples = MIN(ret, dst_nb_samples);
+        written = sc_audiobuf_write(&ar->buf, swr_buf, samples);
     }
 
-    int64_t packet_duration = input_samples * INT64_C(1000000)
-                            / ar->sample_rate;
-    ar->next_expected_pts = pts + packet_duration;
+    // Once flushed, the resampler must be reset before being used again
+    ret = swr_init(swr_ctx);
+    if (ret) {
+        LOGE("Failed to reinitialize the resampling context");
+        return -1;
+    }
+
+    return written;
+}
+
+// Resample the frame samples (to apply compensation) and write them to the
+// audio buffer. Return the number of samples written (or -1 on error).
+static int
+sc_audio_regulator_write_resampled(struct sc_audio_regulator *ar,
+                                   const AVFrame *frame, uint32_t *samples) {
+    SwrContext *swr_ctx = ar->swr_ctx;
 
     int64_t swr_delay = swr_get_delay(swr_ctx, ar->sample_rate);
     // No need to av_rescale_rnd(), input and output sample rates are the same.
@@ -178,63 +330,100 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
 
     uint8_t *swr_buf = sc_audio_regulator_get_swr_buf(ar, dst_nb_samples);
     if (!swr_buf) {
-        return false;
+        return -1;
     }
 
     int ret = swr_convert(swr_ctx, &swr_buf, dst_nb_samples,
                           (const uint8_t **) frame->data, frame->nb_samples);
     if (ret < 0) {
         LOGE("Resampling failed: %d", ret);
-        return false;
+        return -1;
     }
 
     // swr_convert() returns the number of samples which would have been
     // written if the buffer was big enough.
-    uint32_t samples = MIN(ret, dst_nb_samples);
+    uint32_t count = MIN(ret, dst_nb_samples);
 #ifdef SC_AUDIO_REGULATOR_DEBUG
-    LOGD("[Audio] %" PRIu32 " samples written to buffer", samples);
+    LOGD("[Audio] %" PRIu32 " samples written to buffer", count);
 #endif
 
     uint32_t cap = sc_audiobuf_capacity(&ar->buf);
-    if (samples > cap) {
+    if (count > cap) {
         // Very very unlikely: a single resampled frame should never
         // exceed the audio buffer size (or something is very wrong).
         // Ignore the first bytes in swr_buf to avoid memory corruption anyway.
-        swr_buf += TO_BYTES(samples - cap);
-        samples = cap;
+        swr_buf += TO_BYTES(count - cap);
+        count = cap;
     }
 
-    uint32_t skipped_samples = 0;
+    *samples = count;
+    return sc_audiobuf_write(&ar->buf, swr_buf, count);
+}
 
-    uint32_t written = sc_audiobuf_write(&ar->buf, swr_buf, samples);
-    if (written < samples) {
-        uint32_t remaining = samples - written;
-
-        // All samples that could be written without locking have been written,
-        // now we need to lock to drop/consume old samples
-        sc_mutex_lock(&ar->mutex);
-
-        // Retry with the lock
-        written += sc_audiobuf_write(&ar->buf,
-                                     swr_buf + TO_BYTES(written),
-                                     remaining);
-        if (written < samples) {
-            remaining = samples - written;
-            // Still insufficient, drop old samples to make space
-            skipped_samples = sc_audiobuf_read(&ar->buf, NULL, remaining);
-            assert(skipped_samples == remaining);
+bool
+sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
+    uint32_t input_samples = frame->nb_samples;
+
+    assert(frame->pts >= 0);
+    int64_t pts = frame->pts;
+    if (ar->next_expected_pts && pts - ar->next_expected_pts > 100000) {
+        LOGV("[Audio] Discontinuity detected: %" PRIi64 "µs",
+             pts - ar->next_expected_pts);
+        // More than 100ms: consider it as a discontinuity
+        // (typically because silence packets were not captured)
+        // Reset compensation (before inserting silence, to write the
+        // samples still buffered in the resampler first)
+        if (ar->compensation_active
+                && sc_audio_regulator_stop_compensation(ar) < 0) {
+            return false;
+        }
+
+        uint32_t can_read = sc_audio_regulator_get_buffering(ar);
+        if (input_samples + can_read < ar->target_buffering) {
+            // Adjust buffering to the target value directly
+            uint32_t silence = ar->target_buffering - can_read - input_samples;
+            sc_audiobuf_write_silence(&ar->buf, silence);
         }
 
-        sc_mutex_unlock(&ar->mutex);
+        // Reset state
+        ar->avg_buffering.avg = ar->target_buffering;
+        ar->samples_since_resync = 0;
+        atomic_store_explicit(&ar->underflow, 0, memory_order_relaxed);
+    }
+
+    if (ar->adaptive) {
+        sc_audio_buffer_adapter_push(&ar->adapter, sc_tick_now(), pts,
+                                     input_samples);
+    }
+
+    int64_t packet_duration = input_samples * INT64_C(1000000)
+                            / ar->sample_rate;
+    ar->next_expected_pts = pts + packet_duration;
 
-        if (written < samples) {
-            // Now there is enough space
-            uint32_t w = sc_audiobuf_write(&ar->buf,
-                                           swr_buf + TO_BYTES(written),
-                                           remaining);
-            assert(w == remaining);
-            (void) w;
+    uint32_t samples;
+    uint32_t written;
+    if (ar->convert && !ar->compensation_active) {
+        // Fast path: no compensation, no resampling
+        samples = input_samples;
+        written = sc_audio_regulator_write_direct(ar, frame);
+    } else {
+        int r = sc_audio_regulator_write_resampled(ar, frame, &samples);
+        if (r < 0) {
+            return false;
         }
+        written = r;
+    }
+
+    uint32_t skipped_samples = 0;
+
+    if (written < samples) {
+        // The buffer is full (its capacity is 1 second above the target
+        // buffering), so the consumer does not consume the samples. Only the
+        // consumer may drop old samples (to never block the audio callback),
+        // so drop the new samples which do not fit. The written samples are
+        // accounted for below (instant compensation).
+        LOGD("[Audio] Buffer full, dropping %" PRIu32 " samples",
+             samples - written);
     }
 
     uint32_t underflow = 0;
@@ -255,34 +444,30 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
                              + 10 * ar->sample_rate / 1000 /* 10 ms */;
     }
 
-    uint32_t can_read = sc_audiobuf_can_read(&ar->buf);
+    uint32_t can_read = sc_audio_regulator_get_buffering(ar);
     if (can_read > max_buffered_samples) {
-        uint32_t skip_samples = 0;
-
-        sc_mutex_lock(&ar->mutex);
-        can_read = sc_audiobuf_can_read(&ar->buf);
-        if (can_read > max_buffered_samples) {
-            skip_samples = can_read - max_buffered_samples;
-            uint32_t r = sc_audiobuf_read(&ar->buf, NULL, skip_samples);
-            assert(r == skip_samples);
-            (void) r;
-            skipped_samples += skip_samples;
-        }
-        sc_mutex_unlock(&ar->mutex);
-
-        if (skip_samples) {
-            if (played) {
-                LOGD("[Audio] Buffering threshold exceeded, skipping %" PRIu32
-                     " samples", skip_samples);
+        uint32_t skip_samples = can_read - max_buffered_samples;
+        // The oldest samples will be dropped by the consumer on the next pull
+        atomic_fetch_add_explicit(&ar->drop_request, skip_samples,
+                                  memory_order_relaxed);
+        skipped_samples += skip_samples;
+
+        if (played) {
+            LOGD("[Audio] Buffering threshold exceeded, skipping %" PRIu32
+                 " samples", skip_samples);
 #ifdef SC_AUDIO_REGULATOR_DEBUG
-            } else {
-                LOGD("[Audio] Playback not started, skipping %" PRIu32
-                     " samples", skip_samples);
+        } else {
+            LOGD("[Audio] Playback not started, skipping %" PRIu32
+                 " samples", skip_samples);
 #endif
-            }
         }
     }
 
+    // The samples of this frame are in the buffer (they may have been resampled
+    // for compensation, so this is an approximation)
+    atomic_store_explicit(&ar->end_pts, ar->next_expected_pts,
+                          memory_order_release);
+
     atomic_store_explicit(&ar->received, true, memory_order_relaxed);
     if (!played) {
         // Nothing more to do
@@ -309,6 +494,11 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
         ar->avg_buffering.avg = 0;
     }
 
+    if (!ar->avg_buffering.count) {
+        // First value: adapt the smoothing to the packet size
+        ar->avg_buffering.range = sc_audio_regulator_avg_range(input_samples);
+    }
+
     // However, the buffering level must be smoothed
     sc_average_push(&ar->avg_buffering, can_read);
 
@@ -320,8 +510,15 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
     ar->samples_since_resync += written;
     if (ar->samples_since_resync >= ar->sample_rate) {
         // Recompute compensation every second
+        uint32_t period_samples = ar->samples_since_resync;
         ar->samples_since_resync = 0;
 
+        if (ar->adaptive) {
+            ar->target_buffering =
+                sc_audio_buffer_adapter_update(&ar->adapter, period_samples,
+                                               ar->underflow_report);
+        }
+
         float avg = sc_average_get(&ar->avg_buffering);
         int diff = ar->target_buffering - avg;
 
@@ -350,12 +547,22 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
              ar->target_buffering, avg, can_read, diff, ar->underflow_report);
         ar->underflow_report = 0;
 
-        int ret = swr_set_compensation(swr_ctx, diff, distance);
-        if (ret < 0) {
-            LOGW("Resampling compensation failed: %d", ret);
-            // not fatal
-        } else {
-            ar->compensation_active = diff != 0;
+        if (diff) {
+            int ret = swr_set_compensation(ar->swr_ctx, diff, distance);
+            if (ret < 0) {
+                LOGW("Resampling compensation failed: %d", ret);
+                // not fatal
+            } else {
+                ar->compensation_active = true;
+            }
+        } else if (ar->compensation_active) {
+            int flushed = sc_audio_regulator_stop_compensation(ar);
+            if (flushed < 0) {
+                return false;
+            }
+            // The samples flushed from the resampler instantly increase
+            // buffering
+            ar->avg_buffering.avg += flushed;
         }
     }
 
@@ -364,7 +571,12 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
 
 bool
 sc_audio_regulator_init(struct sc_audio_regulator *ar, size_t sample_size,
-                        const AVCodecContext *ctx, uint32_t target_buffering) {
+                        const AVCodecContext *ctx, uint32_t target_buffering,
+                        uint32_t min_target_buffering,
+                        uint32_t max_target_buffering) {
+    assert(min_target_buffering <= target_buffering);
+    assert(target_buffering <= max_target_buffering);
+
     SwrContext *swr_ctx = swr_alloc();
     if (!swr_ctx) {
         LOG_OOM();
@@ -394,24 +606,36 @@ sc_audio_regulator_init(struct sc_audio_regulator *ar, size_t sample_size,
         goto error_free_swr_ctx;
     }
 
-    bool ok = sc_mutex_init(&ar->mutex);
-    if (!ok) {
-        goto error_free_swr_ctx;
-    }
+    ar->convert = sc_audio_regulator_get_convert_fn(ctx->sample_fmt);
+#ifdef SCRCPY_LAVU_HAS_CHLAYOUT
+    ar->channels = ctx->ch_layout.nb_channels;
+#else
+    ar->channels = av_get_channel_layout_nb_channels(ctx->channel_layout);
+#endif
+    assert(ar->channels * av_get_bytes_per_sample(SC_AV_SAMPLE_FMT)
+            == sample_size);
 
     ar->target_buffering = target_buffering;
+    ar->start_buffering = target_buffering;
     ar->sample_size = sample_size;
     ar->sample_rate = ctx->sample_rate;
 
-    // Use a ring-buffer of the target buffering size plus 1 second between the
-    // producer and the consumer. It's too big on purpose, to guarantee that
-    // the producer and the consumer will be able to access it in parallel
-    // without locking.
-    uint32_t audiobuf_samples = target_buffering + ar->sample_rate;
+    ar->adaptive = min_target_buffering < max_target_buffering;
+    if (ar->adaptive) {
+        sc_audio_buffer_adapter_init(&ar->adapter, ar->sample_rate,
+                                     target_buffering, min_target_buffering,
+                                     max_target_buffering);
+    }
+
+    // Use a ring-buffer of the (max) target buffering size plus 1 second
+    // between the producer and the consumer. It's too big on purpose, to
+    // guarantee that the producer and the consumer will be able to access it
+    // in parallel without locking.
+    uint32_t audiobuf_samples = max_target_buffering + ar->sample_rate;
 
-    ok = sc_audiobuf_init(&ar->buf, sample_size, audiobuf_samples);
+    bool ok = sc_audiobuf_init(&ar->buf, sample_size, audiobuf_samples);
     if (!ok) {
-        goto error_destroy_mutex;
+        goto error_free_swr_ctx;
     }
 
     size_t initial_swr_buf_size = TO_BYTES(4096);
@@ -424,13 +648,16 @@ sc_audio_regulator_init(struct sc_audio_regulator *ar, size_t sample_size,
 
     // Samples are produced and consumed by blocks, so the buffering must be
     // smoothed to get a relatively stable value.
-    sc_average_init(&ar->avg_buffering, 128);
+    // The range is adapted to the packet size on the first packet.
+    sc_average_init(&ar->avg_buffering, SC_AUDIO_REGULATOR_AVG_RANGE);
     ar->samples_since_resync = 0;
 
     ar->received = false;
     atomic_init(&ar->played, false);
     atomic_init(&ar->received, false);
     atomic_init(&ar->underflow, 0);
+    atomic_init(&ar->drop_request, 0);
+    atomic_init(&ar->end_pts, -1);
     ar->underflow_report = 0;
     ar->compensation_active = false;
     ar->next_expected_pts = 0;
@@ -439,8 +666,6 @@ sc_audio_regulator_init(struct sc_audio_regulator *ar, size_t sample_size,
 
 error_destroy_audiobuf:
     sc_audiobuf_destroy(&ar->buf);
-error_destroy_mutex:
-    sc_mutex_destroy(&ar->mutex);
 error_free_swr_ctx:
     swr_free(&ar->swr_ctx);
 
@@ -451,6 +676,5 @@ void
 sc_audio_regulator_destroy(struct sc_audio_regulator *ar) {
     free(ar->swr_buf);
     sc_audiobuf_destroy(&ar->buf);
-    sc_mutex_destroy(&ar->mutex);
     swr_free(&ar->swr_ctx);
 }
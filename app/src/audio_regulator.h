@@ -9,17 +9,31 @@
 #include <stdint.h>
 #include <libavcodec/avcodec.h>
 #include <libswresample/swresample.h>
+#include "audio_buffer_adapter.h"
 #include "util/audiobuf.h"
 #include "util/average.h"
-#include "util/thread.h"
 
 #define SC_AV_SAMPLE_FMT AV_SAMPLE_FMT_FLT
 
-struct sc_audio_regulator {
-    sc_mutex mutex;
+/**
+ * Convert `samples` input samples (starting at `offset`) to SC_AV_SAMPLE_FMT
+ */
+typedef void (*sc_audio_regulator_convert_fn)(uint8_t *to, const AVFrame *frame,
+                                              unsigned channels,
+                                              uint32_t offset,
+                                              uint32_t samples);
 
+struct sc_audio_regulator {
     // Target buffering between the producer and the consumer (in samples)
+    // (only used by the receiver thread)
     uint32_t target_buffering;
+    // Buffering to reach before starting the playback (in samples)
+    uint32_t start_buffering;
+
+    // Adapt the target buffering to the network conditions (only used by the
+    // receiver thread)
+    bool adaptive;
+    struct sc_audio_buffer_adapter adapter;
 
     // Audio buffer to communicate between the receiver and the player
     struct sc_audiobuf buf;
@@ -27,6 +41,12 @@ struct sc_audio_regulator {
     // Resampler (only used from the receiver thread)
     struct SwrContext *swr_ctx;
 
+    // Convert the input samples directly into the audio buffer while no
+    // compensation is applied, without libswresample (NULL if the input
+    // format is not supported)
+    sc_audio_regulator_convert_fn convert;
+    unsigned channels;
+
     // The sample rate is the same for input and output
     uint32_t sample_rate;
     // The number of bytes per sample (for all channels)
@@ -46,6 +66,11 @@ struct sc_audio_regulator {
     // Number of silence samples inserted since the last received packet
     atomic_uint_least32_t underflow;
 
+    // Number of old samples to drop, requested by the producer to reduce the
+    // buffering. Only the consumer moves the read cursor, so that the
+    // consumer (the real-time audio callback) never waits for the producer.
+    atomic_uint_least32_t drop_request;
+
     // Number of silence samples inserted since the last log
     uint32_t underflow_report;
 
@@ -60,11 +85,23 @@ struct sc_audio_regulator {
 
     // PTS of the next expected packet (useful to detect discontinuities)
     int64_t next_expected_pts;
+
+    // PTS at the end of the samples written to the audio buffer (-1 if none),
+    // to compute the PTS of the samples pulled by the player
+    atomic_int_least64_t end_pts;
 };
 
+/**
+ * Initialize the audio regulator
+ *
+ * If min_target_buffering < max_target_buffering, then the target buffering
+ * is adapted within these bounds (target_buffering is the initial value).
+ */
 bool
 sc_audio_regulator_init(struct sc_audio_regulator *ar, size_t sample_size,
-                        const AVCodecContext *ctx, uint32_t target_buffering);
+                        const AVCodecContext *ctx, uint32_t target_buffering,
+                        uint32_t min_target_buffering,
+                        uint32_t max_target_buffering);
 
 void
 sc_audio_regulator_destroy(struct sc_audio_regulator *ar);
@@ -72,7 +109,13 @@ sc_audio_regulator_destroy(struct sc_audio_regulator *ar);
 bool
 sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame);
 
-void
+/**
+ * Pull samples to be played
+ *
+ * Return the PTS of the first sample pulled, or -1 if the samples pulled
+ * contain silence (on start or on underflow).
+ */
+int64_t
 sc_audio_regulator_pull(struct sc_audio_regulator *ar, uint8_t *out,
                         uint32_t samples);
 
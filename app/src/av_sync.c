@@ -0,0 +1,155 @@
+#include "av_sync.h"
+
+#include <assert.h>
+#include <inttypes.h>
+
+#include "util/log.h"
+
+// If no audio point has been received for this duration, then the audio is
+// not playing anymore
+#define SC_AV_SYNC_AUDIO_TIMEOUT SC_TICK_FROM_MS(200)
+
+bool
+sc_av_sync_init(struct sc_av_sync *sync) {
+    bool ok = sc_mutex_init(&sync->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    atomic_init(&sync->audio.seq, 0);
+    atomic_init(&sync->audio.pts, 0);
+    atomic_init(&sync->audio.date, 0);
+
+    sc_clock_init(&sync->clock);
+    sync->last_seq = 0;
+    sync->last_audio_date = 0;
+
+    sync->stats.count = 0;
+    sync->stats.total_offset = 0;
+    sync->stats.min_offset = 0;
+    sync->stats.max_offset = 0;
+
+    return true;
+}
+
+void
+sc_av_sync_destroy(struct sc_av_sync *sync) {
+    sc_mutex_destroy(&sync->mutex);
+}
+
+void
+sc_av_sync_report_audio(struct sc_av_sync *sync, int64_t pts, sc_tick date) {
+    // Single writer: an odd sequence number means that a write is in progress
+    unsigned seq = atomic_load_explicit(&sync->audio.seq, memory_order_relaxed);
+    atomic_store_explicit(&sync->audio.seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&sync->audio.pts, pts, memory_order_relaxed);
+    atomic_store_explicit(&sync->audio.date, date, memory_order_relaxed);
+
+    atomic_store_explicit(&sync->audio.seq, seq + 2, memory_order_release);
+}
+
+// Add the last audio point to the clock, if any
+static void
+sc_av_sync_update_clock(struct sc_av_sync *sync) {
+    unsigned seq;
+    int64_t pts;
+    sc_tick date;
+
+    for (;;) {
+        seq = atomic_load_explicit(&sync->audio.seq, memory_order_acquire);
+        if (seq & 1) {
+            // Write in progress (it cannot last long, the writer never blocks)
+            continue;
+        }
+
+        pts = atomic_load_explicit(&sync->audio.pts, memory_order_relaxed);
+        date = atomic_load_explicit(&sync->audio.date, memory_order_relaxed);
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&sync->audio.seq, memory_order_relaxed)
+                == seq) {
+            break;
+        }
+    }
+
+    if (seq == sync->last_seq) {
+        // No new point
+        return;
+    }
+
+    sync->last_seq = seq;
+    sync->last_audio_date = date;
+
+    // PTS (written by the server) are expressed in microseconds
+    sc_clock_update(&sync->clock, date, SC_TICK_FROM_US(pts));
+}
+
+// Must be called with the mutex locked
+static bool
+sc_av_sync_to_audio_time(struct sc_av_sync *sync, int64_t pts,
+                         sc_tick *date) {
+    sc_av_sync_update_clock(sync);
+
+    if (!sync->last_audio_date
+            || sc_tick_now() > sync->last_audio_date
+                                    + SC_AV_SYNC_AUDIO_TIMEOUT) {
+        // The audio is not playing
+        return false;
+    }
+
+    *date = sc_clock_to_system_time(&sync->clock, SC_TICK_FROM_US(pts));
+    return true;
+}
+
+bool
+sc_av_sync_get_video_date(struct sc_av_sync *sync, int64_t pts,
+                          sc_tick *date) {
+    sc_mutex_lock(&sync->mutex);
+    bool ok = sc_av_sync_to_audio_time(sync, pts, date);
+    sc_mutex_unlock(&sync->mutex);
+
+    return ok;
+}
+
+void
+sc_av_sync_report_video(struct sc_av_sync *sync, int64_t pts, sc_tick date) {
+    sc_mutex_lock(&sync->mutex);
+
+    sc_tick audio_date;
+    bool ok = sc_av_sync_to_audio_time(sync, pts, &audio_date);
+    if (ok) {
+        sc_tick offset = date - audio_date;
+
+        struct sc_av_sync_stats *stats = &sync->stats;
+        if (!stats->count || offset < stats->min_offset) {
+            stats->min_offset = offset;
+        }
+        if (!stats->count || offset > stats->max_offset) {
+            stats->max_offset = offset;
+        }
+        stats->total_offset += offset;
+        ++stats->count;
+    }
+
+    sc_mutex_unlock(&sync->mutex);
+}
+
+void
+sc_av_sync_log_stats(struct sc_av_sync *sync) {
+    sc_mutex_lock(&sync->mutex);
+    struct sc_av_sync_stats stats = sync->stats;
+    sc_mutex_unlock(&sync->mutex);
+
+    if (!stats.count) {
+        return;
+    }
+
+    LOGI("A/V sync: video offset avg=%.1f ms min=%.1f ms max=%.1f ms "
+         "(%" PRIu64 " frames)",
+         (double) stats.total_offset / stats.count / 1000,
+         (double) stats.min_offset / 1000,
+         (double) stats.max_offset / 1000,
+         stats.count);
+}
@@ -0,0 +1,96 @@
+#ifndef SC_AV_SYNC_H
+#define SC_AV_SYNC_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "clock.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+struct sc_av_sync_stats {
+    uint64_t count;
+    // Delay of the video presentation relative to the audio playback (negative
+    // if the video is presented early)
+    sc_tick total_offset;
+    sc_tick min_offset;
+    sc_tick max_offset;
+};
+
+/**
+ * Presentation clock shared between the audio and video playback.
+ *
+ * The audio player reports the date at which the samples it outputs will be
+ * audible, from the SDL audio callback. This gives the audio output clock
+ * (the relation between the device time and the system time, see sc_clock).
+ *
+ * The video delay buffer may schedule the frames against this clock, so that
+ * each frame is presented at the same time as the audio samples having the
+ * same PTS (both streams are timestamped by the device monotonic clock).
+ *
+ * The screen reports the actual presentation date of the frames, to measure
+ * the A/V offset.
+ */
+struct sc_av_sync {
+    // Last audio point, written from the SDL audio callback (without locking,
+    // so that the audio callback never blocks), protected by a sequence lock
+    struct {
+        atomic_uint seq;
+        atomic_int_least64_t pts;
+        atomic_int_least64_t date;
+    } audio;
+
+    sc_mutex mutex;
+    // The audio output clock
+    struct sc_clock clock;
+    // The sequence number of the last audio point added to the clock
+    unsigned last_seq;
+    // The date of the last audio point added to the clock (0 if none)
+    sc_tick last_audio_date;
+
+    struct sc_av_sync_stats stats;
+};
+
+bool
+sc_av_sync_init(struct sc_av_sync *sync);
+
+void
+sc_av_sync_destroy(struct sc_av_sync *sync);
+
+/**
+ * Report that the audio sample having the given PTS will be audible at the
+ * given date
+ *
+ * This function must be called from a single thread (the audio thread). It
+ * never blocks.
+ */
+void
+sc_av_sync_report_audio(struct sc_av_sync *sync, int64_t pts, sc_tick date);
+
+/**
+ * Get the date at which the frame having the given PTS should be presented
+ *
+ * Return false if the audio output clock is unknown (the audio is not playing
+ * yet, or not anymore).
+ */
+bool
+sc_av_sync_get_video_date(struct sc_av_sync *sync, int64_t pts,
+                          sc_tick *date);
+
+/**
+ * Report that the frame having the given PTS has been presented at the given
+ * date
+ */
+void
+sc_av_sync_report_video(struct sc_av_sync *sync, int64_t pts, sc_tick date);
+
+/**
+ * Log the A/V offset statistics
+ */
+void
+sc_av_sync_log_stats(struct sc_av_sync *sync);
+
+#endif
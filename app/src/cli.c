@@ -2,6 +2,7 @@
 
 #include <assert.h>
 #include <getopt.h>
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -114,6 +115,23 @@ enum {
     OPT_NO_VD_SYSTEM_DECORATIONS,
     OPT_NO_VD_DESTROY_CONTENT,
     OPT_DISPLAY_IME_POLICY,
+    OPT_DUMP_STREAM,
+    OPT_MULTIPLEX,
+    OPT_VIDEO_DECODER_THREADS,
+    OPT_VIDEO_DECODER_THREAD_TYPE,
+    OPT_SHM_SINK,
+    OPT_NO_PBO,
+    OPT_VSYNC,
+    OPT_TEXTURE_DOWNSCALE,
+    OPT_RENDER_THREAD,
+    OPT_VIDEO_BUFFER_MODE,
+    OPT_AV_SYNC,
+    OPT_AUDIO_BUFFER_RANGE,
+    OPT_AUDIO_FRAME_DURATION,
+    OPT_PCM_SINK,
+    OPT_RECORD_SEGMENT_DURATION,
+    OPT_RECORD_SEGMENT_SIZE,
+    OPT_FRAME_QUEUE_POLICY,
 };
 
 struct sc_option {
@@ -177,8 +195,19 @@ static const struct sc_option options[] = {
         .text = "Configure the audio buffering delay (in milliseconds).\n"
                 "Lower values decrease the latency, but increase the "
                 "likelihood of buffer underrun (causing audio glitches).\n"
+                "If set to 'auto', the buffering delay is adapted to the "
+                "measured network jitter and buffer underruns, within the "
+                "bounds configured by --audio-buffer-range.\n"
                 "Default is 50.",
     },
+    {
+        .longopt_id = OPT_AUDIO_BUFFER_RANGE,
+        .longopt = "audio-buffer-range",
+        .argdesc = "min:max",
+        .text = "Configure the bounds (in milliseconds) of the audio "
+                "buffering delay when --audio-buffer=auto.\n"
+                "Default is 20:500.",
+    },
     {
         .longopt_id = OPT_AUDIO_CODEC,
         .longopt = "audio-codec",
@@ -213,6 +242,24 @@ static const struct sc_option options[] = {
                 "codec provided by --audio-codec).\n"
                 "The available encoders can be listed by --list-encoders.",
     },
+    {
+        .longopt_id = OPT_AUDIO_FRAME_DURATION,
+        .longopt = "audio-frame-duration",
+        .argdesc = "ms",
+        .text = "Set the duration of the audio chunks captured on the "
+                "device (2.5, 5, 10 or 20 ms).\n"
+                "With the raw audio codec, the captured chunks are sent as "
+                "is, so this is the duration of the audio packets, and the "
+                "default audio buffer is reduced accordingly.\n"
+                "With opus and aac, only the capture chunk size and the "
+                "encoder input buffer size change: the duration of the "
+                "encoded frames is still chosen by the encoder (typically "
+                "20 ms for opus), unless it is configured by encoder-specific "
+                "--audio-codec-options.\n"
+                "With flac, it does not reduce the latency.\n"
+                "Smaller chunks increase the bandwidth overhead.\n"
+                "By default, the device default is used.",
+    },
     {
         .longopt_id = OPT_AUDIO_SOURCE,
         .longopt = "audio-source",
@@ -254,6 +301,14 @@ static const struct sc_option options[] = {
                 "a higher value (10). Do not change this setting otherwise.\n"
                 "Default is 5.",
     },
+    {
+        .longopt_id = OPT_AV_SYNC,
+        .longopt = "av-sync",
+        .text = "Present the video frames in sync with the audio playback.\n"
+                "This requires --video-buffer, which is then the maximum "
+                "delay applied to the video frames (it should be larger than "
+                "--audio-buffer).",
+    },
     {
         .shortopt = 'b',
         .longopt = "video-bit-rate",
@@ -409,6 +464,15 @@ static const struct sc_option options[] = {
                 "before the rotation.\n"
                 "Default is 0.",
     },
+    {
+        .longopt_id = OPT_DUMP_STREAM,
+        .longopt = "dump-stream",
+        .argdesc = "file",
+        .text = "Dump the raw bytes received on the video and audio sockets, "
+                "with their arrival time, to the given file.\n"
+                "The dump may be served to the client without any device by "
+                "the scrcpy-replay development tool.",
+    },
     {
         .shortopt = 'e',
         .longopt = "select-tcpip",
@@ -437,6 +501,20 @@ static const struct sc_option options[] = {
         .longopt_id = OPT_FORWARD_ALL_CLICKS,
         .longopt = "forward-all-clicks",
     },
+    {
+        .longopt_id = OPT_FRAME_QUEUE_POLICY,
+        .longopt = "frame-queue-policy",
+        .argdesc = "value",
+        .text = "Select the behavior when a V4L2 or shm sink does not keep up "
+                "with the video decoder (while it shares the decoded frames "
+                "with another sink).\n"
+                "With \"keep-latest\", the oldest pending frame is dropped, "
+                "so that the other sinks are never delayed.\n"
+                "With \"block\", no frame is dropped, but the other sinks "
+                "(e.g. the display) may be delayed.\n"
+                "Possible values are \"keep-latest\" and \"block\".\n"
+                "Default is keep-latest.",
+    },
     {
         .shortopt = 'G',
         .text = "Same as --gamepad=uhid, or --gamepad=aoa if --otg is set.",
@@ -607,6 +685,15 @@ static const struct sc_option options[] = {
                 "Default is 'bhsn:++++' for SDK mouse, and '++++:bhsn' for AOA "
                 "and UHID.",
     },
+    {
+        .longopt_id = OPT_MULTIPLEX,
+        .longopt = "multiplex",
+        .text = "Transmit the video, audio and control streams over a single "
+                "socket, instead of one socket per stream.\n"
+                "This reduces the connection setup time (especially over "
+                "wireless), and shares the bandwidth fairly between the "
+                "streams.",
+    },
     {
         .shortopt = 'n',
         .longopt = "no-control",
@@ -689,6 +776,14 @@ static const struct sc_option options[] = {
         .text = "Do not forward mouse hover (mouse motion without any clicks) "
                 "events.",
     },
+    {
+        .longopt_id = OPT_NO_PBO,
+        .longopt = "no-pbo",
+        .text = "If the renderer is OpenGL 3.0+ or OpenGL ES 3.0+, then "
+                "the video frames are uploaded to the GPU asynchronously, "
+                "through pixel buffer objects. This option disables it (the "
+                "frames are uploaded synchronously by SDL).",
+    },
     {
         .longopt_id = OPT_NO_POWER_ON,
         .longopt = "no-power-on",
@@ -767,6 +862,20 @@ static const struct sc_option options[] = {
                 "Passing the option without argument is equivalent to passing "
                 "\"true\".",
     },
+    {
+        .longopt_id = OPT_PCM_SINK,
+        .longopt = "pcm-sink",
+        .argdesc = "target",
+        .text = "Write the decoded audio as raw interleaved PCM (preceded by "
+                "a header describing the format) to the target, for live "
+                "processing by another program (see doc/audio.md).\n"
+                "The target is either \"-\" (stdout, logs are then written "
+                "to stderr), a file or FIFO path, or \"unix:path\" to "
+                "connect to a listening Unix socket.\n"
+                "If the reader is too slow, the oldest samples are dropped.\n"
+                "It may be combined with --no-audio-playback.\n"
+                "This feature is not available on Windows.",
+    },
     {
         .longopt_id = OPT_POWER_OFF_ON_CLOSE,
         .longopt = "power-off-on-close",
@@ -824,6 +933,28 @@ static const struct sc_option options[] = {
                 "the clockwise rotation in degrees.\n"
                 "Default is 0.",
     },
+    {
+        .longopt_id = OPT_RECORD_SEGMENT_DURATION,
+        .longopt = "record-segment-duration",
+        .argdesc = "seconds",
+        .text = "Split the recording into files of (approximately) the given "
+                "duration.\n"
+                "A new file is started only on a video key frame, so each "
+                "file is playable independently.\n"
+                "The record filename is then a strftime() pattern, expanded "
+                "when each file is started (e.g. "
+                "\"rec-%Y%m%d-%H%M%S.mkv\"). If it expands to the same name "
+                "as the previous file, the file number is inserted before "
+                "the extension.",
+    },
+    {
+        .longopt_id = OPT_RECORD_SEGMENT_SIZE,
+        .longopt = "record-segment-size",
+        .argdesc = "megabytes",
+        .text = "Split the recording into files of (approximately) the given "
+                "size.\n"
+                "See --record-segment-duration.",
+    },
     {
         .longopt_id = OPT_RENDER_DRIVER,
         .longopt = "render-driver",
@@ -834,6 +965,15 @@ static const struct sc_option options[] = {
                 "\"opengles2\", \"opengles\", \"metal\" and \"software\".\n"
                 "<https://wiki.libsdl.org/SDL_HINT_RENDER_DRIVER>",
     },
+    {
+        .longopt_id = OPT_RENDER_THREAD,
+        .longopt = "render-thread",
+        .text = "Upload and render the video frames from a dedicated thread, "
+                "so that a slow rendering (for example waiting for the "
+                "vertical blanking) does not delay the input events "
+                "processing.\n"
+                "Only supported on Linux, with an OpenGL render driver.",
+    },
     {
         .longopt_id = OPT_REQUIRE_AUDIO,
         .longopt = "require-audio",
@@ -866,6 +1006,15 @@ static const struct sc_option options[] = {
         .text = "Set the screen off timeout while scrcpy is running (restore "
                 "the initial value on exit).",
     },
+    {
+        .longopt_id = OPT_SHM_SINK,
+        .longopt = "shm-sink",
+        .argdesc = "name",
+        .text = "Publish the decoded video frames to a POSIX shared memory "
+                "object, so that local programs can read them without "
+                "copy (see doc/video.md).\n"
+                "This feature is not available on Windows.",
+    },
     {
         .longopt_id = OPT_SHORTCUT_MOD,
         .longopt = "shortcut-mod",
@@ -915,6 +1064,15 @@ static const struct sc_option options[] = {
                 "this address before starting.\n"
                 "Prefix the address with a '+' to force a reconnection.",
     },
+    {
+        .longopt_id = OPT_TEXTURE_DOWNSCALE,
+        .longopt = "texture-downscale",
+        .text = "Downscale the video frames (on the CPU, outside of the main "
+                "thread) before uploading them to the GPU, when the window is "
+                "much smaller than the video size.\n"
+                "This reduces the upload bandwidth and the GPU work, for "
+                "example when many devices are mirrored in small windows.",
+    },
     {
         .longopt_id = OPT_TIME_LIMIT,
         .longopt = "time-limit",
@@ -983,6 +1141,16 @@ static const struct sc_option options[] = {
                 "This increases latency to compensate for jitter.\n"
                 "Default is 0 (no buffering).",
     },
+    {
+        .longopt_id = OPT_VIDEO_BUFFER_MODE,
+        .longopt = "video-buffer-mode",
+        .argdesc = "mode",
+        .text = "Select what is buffered by --video-buffer (decoded or "
+                "encoded).\n"
+                "In encoded mode, the packets are buffered before decoding, "
+                "which requires much less memory for large buffering delays.\n"
+                "Default is decoded.",
+    },
     {
         .longopt_id = OPT_VIDEO_CODEC,
         .longopt = "video-codec",
@@ -1002,6 +1170,27 @@ static const struct sc_option options[] = {
                 "Android documentation: "
                 "<https://d.android.com/reference/android/media/MediaFormat>",
     },
+    {
+        .longopt_id = OPT_VIDEO_DECODER_THREAD_TYPE,
+        .longopt = "video-decoder-thread-type",
+        .argdesc = "type",
+        .text = "Select the threading method of the client video decoder "
+                "(slice or frame).\n"
+                "Slice threading adds no latency, but is only effective if "
+                "the stream is encoded with several slices (or with "
+                "wavefront parallel processing for H.265).\n"
+                "Frame threading is effective on any stream, but delays the "
+                "output by one frame per additional thread.\n"
+                "Default is slice.",
+    },
+    {
+        .longopt_id = OPT_VIDEO_DECODER_THREADS,
+        .longopt = "video-decoder-threads",
+        .argdesc = "value",
+        .text = "Set the number of threads of the client video decoder.\n"
+                "Default is 0 (automatic, depending on the number of CPU "
+                "cores).",
+    },
     {
         .longopt_id = OPT_VIDEO_ENCODER,
         .longopt = "video-encoder",
@@ -1018,6 +1207,13 @@ static const struct sc_option options[] = {
                 "Camera mirroring requires Android 12+.\n"
                 "Default is display.",
     },
+    {
+        .longopt_id = OPT_VSYNC,
+        .longopt = "vsync",
+        .text = "Present the video frames in sync with the display refresh, "
+                "according to their timestamps, for a smoother playback.\n"
+                "This adds at most one refresh interval of latency.",
+    },
     {
         .shortopt = 'w',
         .longopt = "stay-awake",
@@ -1223,6 +1419,11 @@ static const struct sc_envvar envvars[] = {
         .name = "SCRCPY_ICON_PATH",
         .text = "Path to the program icon",
     },
+    {
+        .name = "SCRCPY_REPLAY_PORT",
+        .text = "Connect to a local scrcpy-replay server on this port "
+                "instead of a device (for development)",
+    },
     {
         .name = "SCRCPY_SERVER_PATH",
         .text = "Path to the server binary",
@@ -1633,6 +1834,107 @@ parse_buffering_time(const char *s, sc_tick *tick) {
     return true;
 }
 
+static bool
+parse_decoder_threads(const char *s, uint16_t *threads) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 0, 64, "decoder threads");
+    if (!ok) {
+        return false;
+    }
+
+    *threads = (uint16_t) value;
+    return true;
+}
+
+static bool
+parse_decoder_thread_type(const char *s, enum sc_decoder_thread_type *type) {
+    if (!strcmp(s, "slice")) {
+        *type = SC_DECODER_THREAD_TYPE_SLICE;
+        return true;
+    }
+
+    if (!strcmp(s, "frame")) {
+        *type = SC_DECODER_THREAD_TYPE_FRAME;
+        return true;
+    }
+
+    LOGE("Unsupported decoder thread type: %s (expected slice or frame)", s);
+    return false;
+}
+
+static bool
+parse_video_buffer_mode(const char *s, enum sc_video_buffer_mode *mode) {
+    if (!strcmp(s, "decoded")) {
+        *mode = SC_VIDEO_BUFFER_MODE_DECODED;
+        return true;
+    }
+
+    if (!strcmp(s, "encoded")) {
+        *mode = SC_VIDEO_BUFFER_MODE_ENCODED;
+        return true;
+    }
+
+    LOGE("Unsupported video buffer mode: %s (expected decoded or encoded)", s);
+    return false;
+}
+
+static bool
+parse_audio_buffer(const char *s, struct scrcpy_options *opts) {
+    if (!strcmp(s, "auto")) {
+        opts->audio_buffer_auto = true;
+        return true;
+    }
+
+    opts->audio_buffer_auto = false;
+    return parse_buffering_time(s, &opts->audio_buffer);
+}
+
+static bool
+parse_audio_frame_duration(const char *s, sc_tick *duration) {
+    if (!strcmp(s, "2.5")) {
+        *duration = SC_TICK_FROM_US(2500);
+        return true;
+    }
+
+    if (!strcmp(s, "5")) {
+        *duration = SC_TICK_FROM_MS(5);
+        return true;
+    }
+
+    if (!strcmp(s, "10")) {
+        *duration = SC_TICK_FROM_MS(10);
+        return true;
+    }
+
+    if (!strcmp(s, "20")) {
+        *duration = SC_TICK_FROM_MS(20);
+        return true;
+    }
+
+    LOGE("Unsupported audio frame duration: %s (expected 2.5, 5, 10 or 20)",
+         s);
+    return false;
+}
+
+static bool
+parse_audio_buffer_range(const char *s, sc_tick *min, sc_tick *max) {
+    long values[2];
+    size_t count = parse_integers_arg(s, ':', 2, values, 0, 60 * 60 * 1000,
+                                      "audio buffer range");
+    if (!count) {
+        return false;
+    }
+
+    if (count != 2 || values[0] > values[1]) {
+        LOGE("Invalid audio buffer range (expected min:max): %s", s);
+        return false;
+    }
+
+    *min = SC_TICK_FROM_MS(values[0]);
+    *max = SC_TICK_FROM_MS(values[1]);
+    return true;
+}
+
 static bool
 parse_audio_output_buffer(const char *s, sc_tick *tick) {
     long value;
@@ -2021,6 +2323,24 @@ parse_audio_codec(const char *optarg, enum sc_codec *codec) {
     return false;
 }
 
+static bool
+parse_frame_queue_policy(const char *optarg,
+                         enum sc_frame_queue_policy *policy) {
+    if (!strcmp(optarg, "keep-latest")) {
+        *policy = SC_FRAME_QUEUE_POLICY_KEEP_LATEST;
+        return true;
+    }
+
+    if (!strcmp(optarg, "block")) {
+        *policy = SC_FRAME_QUEUE_POLICY_BLOCK;
+        return true;
+    }
+
+    LOGE("Unsupported frame queue policy: %s (expected keep-latest or block)",
+         optarg);
+    return false;
+}
+
 static bool
 parse_video_source(const char *optarg, enum sc_video_source *source) {
     if (!strcmp(optarg, "display")) {
@@ -2242,6 +2562,32 @@ parse_time_limit(const char *s, sc_tick *tick) {
     return true;
 }
 
+static bool
+parse_record_segment_duration(const char *s, sc_tick *tick) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 1, 0x7FFFFFFF,
+                                "record segment duration");
+    if (!ok) {
+        return false;
+    }
+
+    *tick = SC_TICK_FROM_SEC(value);
+    return true;
+}
+
+static bool
+parse_record_segment_size(const char *s, uint64_t *size) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 1, 0x7FFFFFFF,
+                                "record segment size");
+    if (!ok) {
+        return false;
+    }
+
+    *size = (uint64_t) value * 1000000;
+    return true;
+}
+
 static bool
 parse_screen_off_timeout(const char *s, sc_tick *tick) {
     long value;
@@ -2360,6 +2706,10 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
 
     optind = 0; // reset to start from the first argument in tests
 
+    // Only used with --audio-buffer=auto, whose position is not known yet
+    bool audio_buffer_range = false;
+    bool frame_queue_policy = false;
+
     int c;
     while ((c = getopt_long(argc, argv, optstring, longopts, NULL)) != -1) {
         switch (c) {
@@ -2571,6 +2921,18 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                     return false;
                 }
                 break;
+            case OPT_RECORD_SEGMENT_DURATION:
+                if (!parse_record_segment_duration(optarg,
+                                            &opts->record_segment_duration)) {
+                    return false;
+                }
+                break;
+            case OPT_RECORD_SEGMENT_SIZE:
+                if (!parse_record_segment_size(optarg,
+                                               &opts->record_segment_size)) {
+                    return false;
+                }
+                break;
             case OPT_ORIENTATION: {
                 enum sc_orientation orientation;
                 if (!parse_orientation(optarg, &orientation)) {
@@ -2583,9 +2945,26 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             case OPT_RENDER_DRIVER:
                 opts->render_driver = optarg;
                 break;
+            case OPT_RENDER_THREAD:
+#if !defined(__APPLE__) && !defined(_WIN32)
+                opts->render_thread = true;
+                break;
+#else
+                // SDL2 only supports rendering from the main thread on these
+                // platforms
+                LOGE("The render thread (--render-thread) is only supported "
+                     "on Linux.");
+                return false;
+#endif
             case OPT_NO_MIPMAPS:
                 opts->mipmaps = false;
                 break;
+            case OPT_NO_PBO:
+                opts->pbo = false;
+                break;
+            case OPT_TEXTURE_DOWNSCALE:
+                opts->texture_downscale = true;
+                break;
             case OPT_NO_KEY_REPEAT:
                 opts->forward_key_repeat = false;
                 break;
@@ -2639,6 +3018,30 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                     return false;
                 }
                 break;
+            case OPT_VIDEO_BUFFER_MODE:
+                if (!parse_video_buffer_mode(optarg,
+                                             &opts->video_buffer_mode)) {
+                    return false;
+                }
+                break;
+            case OPT_VSYNC:
+                opts->vsync = true;
+                break;
+            case OPT_AV_SYNC:
+                opts->av_sync = true;
+                break;
+            case OPT_VIDEO_DECODER_THREADS:
+                if (!parse_decoder_threads(optarg,
+                                           &opts->video_decoder_threads)) {
+                    return false;
+                }
+                break;
+            case OPT_VIDEO_DECODER_THREAD_TYPE:
+                if (!parse_decoder_thread_type(optarg,
+                                            &opts->video_decoder_thread_type)) {
+                    return false;
+                }
+                break;
             case OPT_NO_CLIPBOARD_AUTOSYNC:
                 opts->clipboard_autosync = false;
                 break;
@@ -2694,6 +3097,32 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                 LOGE("V4L2 (--v4l2-sink) is disabled (or unsupported on this "
                      "platform).");
                 return false;
+#endif
+            case OPT_PCM_SINK:
+#ifdef HAVE_PCM_SINK
+                if (!*optarg) {
+                    LOGE("Invalid PCM sink target: %s", optarg);
+                    return false;
+                }
+                opts->pcm_sink = optarg;
+                break;
+#else
+                LOGE("PCM sink (--pcm-sink) is not supported on this "
+                     "platform.");
+                return false;
+#endif
+            case OPT_SHM_SINK:
+#ifdef HAVE_SHM
+                if (!*optarg || strchr(optarg + 1, '/')) {
+                    LOGE("Invalid shared memory name: %s", optarg);
+                    return false;
+                }
+                opts->shm_sink_name = optarg;
+                break;
+#else
+                LOGE("Shared memory sink (--shm-sink) is not supported on "
+                     "this platform.");
+                return false;
 #endif
             case OPT_V4L2_BUFFER:
 #ifdef HAVE_V4L2
@@ -2725,7 +3154,20 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                 opts->require_audio = true;
                 break;
             case OPT_AUDIO_BUFFER:
-                if (!parse_buffering_time(optarg, &opts->audio_buffer)) {
+                if (!parse_audio_buffer(optarg, opts)) {
+                    return false;
+                }
+                break;
+            case OPT_AUDIO_BUFFER_RANGE:
+                if (!parse_audio_buffer_range(optarg, &opts->audio_buffer_min,
+                                              &opts->audio_buffer_max)) {
+                    return false;
+                }
+                audio_buffer_range = true;
+                break;
+            case OPT_AUDIO_FRAME_DURATION:
+                if (!parse_audio_frame_duration(optarg,
+                                                &opts->audio_frame_duration)) {
                     return false;
                 }
                 break;
@@ -2735,6 +3177,13 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                     return false;
                 }
                 break;
+            case OPT_FRAME_QUEUE_POLICY:
+                if (!parse_frame_queue_policy(optarg,
+                                              &opts->frame_queue_policy)) {
+                    return false;
+                }
+                frame_queue_policy = true;
+                break;
             case OPT_VIDEO_SOURCE:
                 if (!parse_video_source(optarg, &opts->video_source)) {
                     return false;
@@ -2821,6 +3270,12 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                     return false;
                 }
                 break;
+            case OPT_DUMP_STREAM:
+                opts->dump_stream_filename = optarg;
+                break;
+            case OPT_MULTIPLEX:
+                opts->multiplex = true;
+                break;
             default:
                 // getopt prints the error message on stderr
                 return false;
@@ -2851,12 +3306,20 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
 
     bool otg = false;
     bool v4l2 = false;
+    bool shm = false;
+    bool pcm = false;
 #ifdef HAVE_USB
     otg = opts->otg;
 #endif
 #ifdef HAVE_V4L2
     v4l2 = !!opts->v4l2_device;
 #endif
+#ifdef HAVE_SHM
+    shm = !!opts->shm_sink_name;
+#endif
+#ifdef HAVE_PCM_SINK
+    pcm = !!opts->pcm_sink;
+#endif
 
     if (!opts->window) {
         // Without window, there cannot be any video playback
@@ -2875,17 +3338,28 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
         opts->audio_playback = false;
     }
 
+    if (frame_queue_policy && !v4l2 && !shm) {
+        LOGW("--frame-queue-policy has no effect without a V4L2 or shm sink");
+    }
+
     if (opts->video && !opts->video_playback && !opts->record_filename
-            && !v4l2) {
-        LOGI("No video playback, no recording, no V4L2 sink: video disabled");
+            && !opts->dump_stream_filename && !v4l2 && !shm) {
+        LOGI("No video playback, no recording, no V4L2 or shm sink: video "
+             "disabled");
         opts->video = false;
     }
 
-    if (opts->audio && !opts->audio_playback && !opts->record_filename) {
-        LOGI("No audio playback, no recording: audio disabled");
+    if (opts->audio && !opts->audio_playback && !opts->record_filename
+            && !opts->dump_stream_filename && !pcm) {
+        LOGI("No audio playback, no recording, no PCM sink: audio disabled");
         opts->audio = false;
     }
 
+    if (pcm && !opts->audio) {
+        LOGE("PCM sink (--pcm-sink) requires audio, but audio is disabled");
+        return false;
+    }
+
     if (!opts->video && !opts->audio && !opts->control && !otg) {
         LOGE("No video, no audio, no control, no OTG: nothing to do");
         return false;
@@ -2901,14 +3375,43 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             // Use 50 ms audio buffer by default, but use a higher value for
             // FLAC, which is not low latency (the default encoder produces
             // blocks of 4096 samples, which represent ~85.333ms).
-            LOGI("FLAC audio: audio buffer increased to 120 ms (use "
-                 "--audio-buffer to set a custom value)");
+            if (!opts->audio_buffer_auto) {
+                LOGI("FLAC audio: audio buffer increased to 120 ms (use "
+                     "--audio-buffer to set a custom value)");
+            }
             opts->audio_buffer = SC_TICK_FROM_MS(120);
+        } else if (opts->audio_frame_duration
+                && opts->audio_codec == SC_CODEC_RAW) {
+            // Smaller packets arrive more regularly, so a few frames are
+            // sufficient to absorb the jitter. Only RAW packets are known to
+            // match the requested duration: the encoders may still produce
+            // their own (larger) frames.
+            opts->audio_buffer = CLAMP(4 * opts->audio_frame_duration,
+                                       SC_TICK_FROM_MS(20),
+                                       SC_TICK_FROM_MS(50));
+            if (!opts->audio_buffer_auto) {
+                LOGI("Audio frame duration: audio buffer set to %" PRItick
+                     " ms (use --audio-buffer to set a custom value)",
+                     SC_TICK_TO_MS(opts->audio_buffer));
+            }
         } else {
             opts->audio_buffer = SC_TICK_FROM_MS(50);
         }
     }
 
+    if (audio_buffer_range && !opts->audio_buffer_auto) {
+        LOGW("--audio-buffer-range has no effect without --audio-buffer=auto");
+    }
+
+    if (opts->audio_buffer_auto) {
+        // The initial value is the default (or explicit) audio buffer
+        opts->audio_buffer = CLAMP(opts->audio_buffer, opts->audio_buffer_min,
+                                   opts->audio_buffer_max);
+    } else {
+        opts->audio_buffer_min = opts->audio_buffer;
+        opts->audio_buffer_max = opts->audio_buffer;
+    }
+
 #ifdef HAVE_V4L2
     if (v4l2) {
         if (!opts->video) {
@@ -2928,6 +3431,17 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
     }
 #endif
 
+    if (shm) {
+        if (!opts->video) {
+            LOGE("Shared memory sink requires video capture, but --no-video "
+                 "was set.");
+            return false;
+        }
+
+        // The shm slots are sized on start, larger frames would be skipped
+        opts->downsize_on_error = false;
+    }
+
     if (opts->control) {
         if (opts->keyboard_input_mode == SC_KEYBOARD_INPUT_MODE_AUTO) {
             opts->keyboard_input_mode = otg ? SC_KEYBOARD_INPUT_MODE_AOA
@@ -3163,6 +3677,12 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
         return false;
     }
 
+    if ((opts->record_segment_duration || opts->record_segment_size)
+            && !opts->record_filename) {
+        LOGE("Record segments specified without recording");
+        return false;
+    }
+
     if (opts->record_filename) {
         if (!opts->video && !opts->audio) {
             LOGE("Video and audio disabled, nothing to record");
@@ -3233,6 +3753,17 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
         LOGW("--audio-bit-rate is ignored for FLAC audio codec");
     }
 
+    if (opts->audio_codec == SC_CODEC_FLAC && opts->audio_frame_duration) {
+        LOGW("--audio-frame-duration does not reduce the latency of FLAC "
+             "audio codec");
+    } else if (opts->audio_codec != SC_CODEC_RAW
+            && opts->audio_frame_duration) {
+        LOGW("--audio-frame-duration does not configure the encoder frame "
+             "duration (the default audio buffer is unchanged): pass "
+             "encoder-specific keys via --audio-codec-options, or use "
+             "--audio-codec=raw");
+    }
+
     if (opts->audio_codec == SC_CODEC_RAW) {
         if (opts->audio_bit_rate) {
             LOGW("--audio-bit-rate is ignored for raw audio codec");
@@ -3284,6 +3815,51 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
         opts->start_fps_counter = false;
     }
 
+    if (opts->vsync && !opts->video_playback) {
+        LOGW("--vsync has no effect without video playback");
+        opts->vsync = false;
+    }
+
+    if (opts->render_thread && !opts->video_playback) {
+        LOGW("--render-thread has no effect without video playback");
+        opts->render_thread = false;
+    }
+
+    if (opts->render_thread && opts->render_driver
+            && strncmp(opts->render_driver, "opengl", 6)) {
+        // Only the OpenGL renderers may be used from a non-main thread
+        LOGE("--render-thread requires an OpenGL render driver (opengl, "
+             "opengles2 or opengles)");
+        return false;
+    }
+
+    if (opts->av_sync) {
+        if (!opts->video_playback || !opts->audio_playback) {
+            LOGW("--av-sync has no effect without video and audio playback");
+            opts->av_sync = false;
+        } else if (!opts->video_buffer) {
+            LOGE("--av-sync requires a video buffer (--video-buffer)");
+            return false;
+        } else if (opts->video_buffer_mode == SC_VIDEO_BUFFER_MODE_ENCODED) {
+            LOGE("--av-sync is not supported with "
+                 "--video-buffer-mode=encoded");
+            return false;
+        }
+    }
+
+    if (opts->video_buffer_mode == SC_VIDEO_BUFFER_MODE_ENCODED) {
+        if (!opts->video_buffer || !opts->video_playback) {
+            LOGW("--video-buffer-mode has no effect without --video-buffer");
+            opts->video_buffer_mode = SC_VIDEO_BUFFER_MODE_DECODED;
+        } else if (v4l2 || shm) {
+            // The encoded packets are buffered before the decoder, so the
+            // V4L2 and shm sinks would also be delayed
+            LOGE("--video-buffer-mode=encoded is not supported with a V4L2 or "
+                 "shm sink");
+            return false;
+        }
+    }
+
     if (otg) {
         // OTG mode is compatible with only very few options.
         // Only report obvious errors.
@@ -3315,6 +3891,10 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             LOGE("OTG mode: could not sink to V4L2 device");
             return false;
         }
+        if (shm) {
+            LOGE("OTG mode: could not sink to shared memory");
+            return false;
+        }
     }
 
     return true;
@@ -1,17 +1,183 @@
 #include "clock.h"
 
 #include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
 
 #include "util/log.h"
 
 //#define SC_CLOCK_DEBUG // uncomment to debug
 
-#define SC_CLOCK_RANGE 32
+// Duration of a drift bucket (in stream time)
+#define SC_CLOCK_DRIFT_BUCKET SC_TICK_FROM_SEC(1)
+// Minimum number of buckets to estimate the drift
+#define SC_CLOCK_DRIFT_MIN_RANGE 8
+// Any drift above is considered as an estimation error
+#define SC_CLOCK_MAX_DRIFT 0.0005 // 500 ppm
+
+// A point is rejected if it is received later than expected by more than
+// this factor of the mean absolute deviation (plus a margin)
+#define SC_CLOCK_OUTLIER_FACTOR 4
+#define SC_CLOCK_OUTLIER_MARGIN SC_TICK_FROM_MS(2)
+// If the points are received late for longer than this duration (in stream
+// time), then the latency has changed: accept them
+#define SC_CLOCK_OUTLIER_TIMEOUT SC_TICK_FROM_SEC(1)
 
 void
 sc_clock_init(struct sc_clock *clock) {
     clock->range = 0;
+    clock->head = 0;
+    clock->count = 0;
+    clock->drift_head = 0;
+    clock->drift_count = 0;
+    clock->bucket.count = 0;
+    clock->origin = 0;
     clock->offset = 0;
+    clock->drift = 0;
+    clock->deviation = 0;
+    clock->rejected_since = -1;
+}
+
+static sc_tick
+sc_clock_estimate_offset(struct sc_clock *clock, sc_tick stream) {
+    return clock->offset + (sc_tick) (clock->drift * (stream - clock->origin));
+}
+
+static void
+sc_clock_estimate_drift(struct sc_clock *clock) {
+    if (clock->drift_count < SC_CLOCK_DRIFT_MIN_RANGE) {
+        // Not enough data, keep the current estimation
+        return;
+    }
+
+    // Least squares over the buckets, relative to the last bucket to keep the
+    // values small
+    unsigned last = (clock->drift_head + clock->drift_count - 1)
+                  % SC_CLOCK_DRIFT_RANGE;
+    struct sc_clock_point *ref = &clock->drift_points[last];
+    sc_tick ref_offset = ref->system - ref->stream;
+
+    double sum_x = 0;
+    double sum_y = 0;
+    for (unsigned i = 0; i < clock->drift_count; ++i) {
+        unsigned index = (clock->drift_head + i) % SC_CLOCK_DRIFT_RANGE;
+        struct sc_clock_point *p = &clock->drift_points[index];
+        sum_x += p->stream - ref->stream;
+        sum_y += p->system - p->stream - ref_offset;
+    }
+
+    double mean_x = sum_x / clock->drift_count;
+    double mean_y = sum_y / clock->drift_count;
+
+    double sxx = 0;
+    double sxy = 0;
+    for (unsigned i = 0; i < clock->drift_count; ++i) {
+        unsigned index = (clock->drift_head + i) % SC_CLOCK_DRIFT_RANGE;
+        struct sc_clock_point *p = &clock->drift_points[index];
+        double dx = p->stream - ref->stream - mean_x;
+        double dy = p->system - p->stream - ref_offset - mean_y;
+        sxx += dx * dx;
+        sxy += dx * dy;
+    }
+
+    if (sxx <= 0) {
+        return;
+    }
+
+    double drift = sxy / sxx;
+    if (drift > SC_CLOCK_MAX_DRIFT) {
+        drift = SC_CLOCK_MAX_DRIFT;
+    } else if (drift < -SC_CLOCK_MAX_DRIFT) {
+        drift = -SC_CLOCK_MAX_DRIFT;
+    }
+
+    clock->drift = drift;
+}
+
+static void
+sc_clock_push_drift_point(struct sc_clock *clock, sc_tick system,
+                          sc_tick stream) {
+    if (clock->bucket.count
+            && stream - clock->bucket.start >= SC_CLOCK_DRIFT_BUCKET) {
+        // Close the current bucket
+        sc_tick mean_stream = clock->bucket.start
+                + clock->bucket.stream_sum / clock->bucket.count;
+        sc_tick mean_offset = clock->bucket.offset_sum / clock->bucket.count;
+
+        unsigned index;
+        if (clock->drift_count < SC_CLOCK_DRIFT_RANGE) {
+            index = (clock->drift_head + clock->drift_count)
+                  % SC_CLOCK_DRIFT_RANGE;
+            ++clock->drift_count;
+        } else {
+            // Overwrite the oldest bucket
+            index = clock->drift_head;
+            clock->drift_head = (clock->drift_head + 1) % SC_CLOCK_DRIFT_RANGE;
+        }
+
+        clock->drift_points[index].stream = mean_stream;
+        clock->drift_points[index].system = mean_stream + mean_offset;
+        clock->bucket.count = 0;
+
+        sc_clock_estimate_drift(clock);
+    }
+
+    if (!clock->bucket.count) {
+        clock->bucket.start = stream;
+        clock->bucket.stream_sum = 0;
+        clock->bucket.offset_sum = 0;
+    }
+
+    clock->bucket.stream_sum += stream - clock->bucket.start;
+    clock->bucket.offset_sum += system - stream;
+    ++clock->bucket.count;
+}
+
+static void
+sc_clock_reset_window(struct sc_clock *clock) {
+    clock->head = 0;
+    clock->count = 0;
+    clock->drift_head = 0;
+    clock->drift_count = 0;
+    clock->bucket.count = 0;
+    clock->deviation = 0;
+    // Keep the drift estimation, it does not depend on the latency
+}
+
+// Return true if the point must be ignored
+static bool
+sc_clock_reject(struct sc_clock *clock, sc_tick system, sc_tick stream) {
+    if (clock->count < SC_CLOCK_RANGE) {
+        // Not enough data to estimate the deviation
+        return false;
+    }
+
+    sc_tick residual = system - stream
+                     - sc_clock_estimate_offset(clock, stream);
+    sc_tick threshold = SC_CLOCK_OUTLIER_FACTOR * clock->deviation
+                      + SC_CLOCK_OUTLIER_MARGIN;
+    if (residual <= threshold) {
+        // Received on time (or earlier than expected)
+        clock->rejected_since = -1;
+        // Exponential moving average (1/16) of the absolute deviation
+        clock->deviation += (llabs(residual) - clock->deviation) / 16;
+        return false;
+    }
+
+    if (clock->rejected_since == -1) {
+        clock->rejected_since = stream;
+    } else if (stream - clock->rejected_since >= SC_CLOCK_OUTLIER_TIMEOUT) {
+        // Not a burst, the latency has increased
+#ifdef SC_CLOCK_DEBUG
+        LOGD("Clock: latency increased by %" PRItick " ms",
+             SC_TICK_TO_MS(residual));
+#endif
+        clock->rejected_since = -1;
+        sc_clock_reset_window(clock);
+        return false;
+    }
+
+    return true;
 }
 
 void
@@ -20,19 +186,47 @@ sc_clock_update(struct sc_clock *clock, sc_tick system, sc_tick stream) {
         ++clock->range;
     }
 
-    sc_tick offset = system - stream;
-    unsigned clock_weight = clock->range - 1;
-    unsigned value_weight = SC_CLOCK_RANGE - clock->range + 1;
-    clock->offset = (clock->offset * clock_weight + offset * value_weight)
-                  / SC_CLOCK_RANGE;
+    if (sc_clock_reject(clock, system, stream)) {
+#ifdef SC_CLOCK_DEBUG
+        LOGD("Clock: point rejected (pts=%" PRItick ")", stream);
+#endif
+        return;
+    }
+
+    unsigned index;
+    if (clock->count < SC_CLOCK_RANGE) {
+        index = (clock->head + clock->count) % SC_CLOCK_RANGE;
+        ++clock->count;
+    } else {
+        // Overwrite the oldest point
+        index = clock->head;
+        clock->head = (clock->head + 1) % SC_CLOCK_RANGE;
+    }
+    clock->points[index].system = system;
+    clock->points[index].stream = stream;
+
+    sc_clock_push_drift_point(clock, system, stream);
+
+    // Given the drift, the offset at origin minimizing the squared error is
+    // the average of the offsets projected to the origin
+    sc_tick sum = 0;
+    for (unsigned i = 0; i < clock->count; ++i) {
+        struct sc_clock_point *p = &clock->points[i];
+        sc_tick offset = p->system - p->stream;
+        sum += offset - (sc_tick) (clock->drift * (p->stream - stream));
+    }
+
+    clock->origin = stream;
+    clock->offset = sum / clock->count;
 
 #ifdef SC_CLOCK_DEBUG
-    LOGD("Clock estimation: pts + %" PRItick, clock->offset);
+    LOGD("Clock estimation: pts + %" PRItick " (drift: %.1f ppm)",
+         clock->offset, clock->drift * 1e6);
 #endif
 }
 
 sc_tick
 sc_clock_to_system_time(struct sc_clock *clock, sc_tick stream) {
     assert(clock->range); // sc_clock_update() must have been called
-    return stream + clock->offset;
+    return stream + sc_clock_estimate_offset(clock, stream);
 }
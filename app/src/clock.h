@@ -5,6 +5,9 @@
 
 #include "util/tick.h"
 
+#define SC_CLOCK_RANGE 32
+#define SC_CLOCK_DRIFT_RANGE 64
+
 struct sc_clock_point {
     sc_tick system;
     sc_tick stream;
@@ -16,19 +19,54 @@ struct sc_clock_point {
  *
  *     f(stream) = slope * stream + offset
  *
- * Theoretically, the slope encodes the drift between the device clock and the
- * computer clock. It is expected to be very close to 1.
+ * The slope encodes the drift between the device clock and the computer
+ * clock. It is very close to 1 (typically within 100 ppm), so the estimation
+ * is written relative to the last point:
+ *
+ *     f(stream) = stream + offset + drift * (stream - origin)
  *
- * Since the clock is used to estimate very close points in the future (which
- * are reestimated on every clock update, see delay_buffer), the error caused
- * by clock drift is totally negligible, so it is better to assume that the
- * slope is 1 than to estimate it (the estimation error would be larger).
+ * The drift is too small to be estimated from a few consecutive points (the
+ * network jitter would dominate), so it is estimated by least squares over
+ * the average offsets of "buckets" of one second (of stream time), over the
+ * last SC_CLOCK_DRIFT_RANGE seconds.
  *
- * Therefore, only the offset is estimated.
+ * Given the drift, the offset is estimated over the last SC_CLOCK_RANGE
+ * points, so that it quickly follows any change of the network latency.
+ *
+ * The points received much later than expected (typically on network bursts)
+ * are rejected, unless the latency remains higher for a long time.
  */
 struct sc_clock {
+    // Number of points (saturated to SC_CLOCK_RANGE)
     unsigned range;
+
+    // Points used to estimate the offset (circular buffer)
+    struct sc_clock_point points[SC_CLOCK_RANGE];
+    unsigned head; // index of the oldest point
+    unsigned count;
+
+    // Points used to estimate the drift, each one is the average of the points
+    // of a bucket (circular buffer)
+    struct sc_clock_point drift_points[SC_CLOCK_DRIFT_RANGE];
+    unsigned drift_head;
+    unsigned drift_count;
+
+    // The current bucket
+    struct {
+        sc_tick start; // stream time
+        sc_tick offset_sum;
+        sc_tick stream_sum;
+        unsigned count;
+    } bucket;
+
+    sc_tick origin;
     sc_tick offset;
+    double drift;
+
+    // Mean absolute deviation of the accepted points from the estimation
+    sc_tick deviation;
+    // Stream time of the first of the consecutive rejected points (or -1)
+    sc_tick rejected_since;
 };
 
 void
@@ -6,6 +6,7 @@
 #include <libavcodec/version.h>
 #include <libavformat/version.h>
 #include <libavutil/version.h>
+#include <libswscale/version.h>
 #include <SDL2/SDL_version.h>
 
 #ifndef _WIN32
@@ -61,6 +62,19 @@
 # define SCRCPY_LAVC_HAS_CODECPAR_CODEC_SIDEDATA
 #endif
 
+// Since the major bump of lavu 57 (FFmpeg 5.0), buffer sizes are size_t
+// instead of int, including the size passed to the allocation callback of
+// av_buffer_pool_init2().
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 0, 100)
+# define SCRCPY_LAVU_HAS_BUFFER_SIZE_T
+#endif
+
+// The AVFrame-based scaling API (sws_scale_frame()), which supports slice
+// threading, has been added in lsws 6.1.100 (FFmpeg 5.0).
+#if LIBSWSCALE_VERSION_INT >= AV_VERSION_INT(6, 1, 100)
+# define SCRCPY_LSWS_HAS_SCALE_FRAME
+#endif
+
 #if SDL_VERSION_ATLEAST(2, 0, 6)
 // <https://github.com/libsdl-org/SDL/commit/d7a318de563125e5bb465b1000d6bc9576fbc6fc>
 # define SCRCPY_SDL_HAS_HINT_TOUCH_MOUSE_EVENTS
@@ -73,6 +87,8 @@
 
 #if SDL_VERSION_ATLEAST(2, 0, 16)
 # define SCRCPY_SDL_HAS_THREAD_PRIORITY_TIME_CRITICAL
+// SDL_UpdateNVTexture()
+# define SCRCPY_SDL_HAS_UPDATE_NV_TEXTURE
 #endif
 
 #if SDL_VERSION_ATLEAST(2, 0, 18)
@@ -184,6 +184,7 @@ sc_control_msg_serialize(const struct sc_control_msg *msg, uint8_t *buf) {
         case SC_CONTROL_MSG_TYPE_ROTATE_DEVICE:
         case SC_CONTROL_MSG_TYPE_OPEN_HARD_KEYBOARD_SETTINGS:
         case SC_CONTROL_MSG_TYPE_RESET_VIDEO:
+        case SC_CONTROL_MSG_TYPE_REQUEST_KEYFRAME:
             // no additional data
             return 1;
         default:
@@ -314,6 +315,9 @@ sc_control_msg_log(const struct sc_control_msg *msg) {
         case SC_CONTROL_MSG_TYPE_RESET_VIDEO:
             LOG_CMSG("reset video");
             break;
+        case SC_CONTROL_MSG_TYPE_REQUEST_KEYFRAME:
+            LOG_CMSG("request keyframe");
+            break;
         default:
             LOG_CMSG("unknown type: %u", (unsigned) msg->type);
             break;
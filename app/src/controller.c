@@ -74,6 +74,12 @@ sc_controller_configure(struct sc_controller *controller,
     controller->receiver.uhid_devices = uhid_devices;
 }
 
+void
+sc_controller_set_mux_stream(struct sc_controller *controller,
+                             struct sc_mux_stream *stream) {
+    sc_receiver_set_mux_stream(&controller->receiver, stream);
+}
+
 void
 sc_controller_destroy(struct sc_controller *controller) {
     sc_cond_destroy(&controller->msg_cond);
@@ -42,6 +42,14 @@ sc_controller_configure(struct sc_controller *controller,
                         struct sc_acksync *acksync,
                         struct sc_uhid_devices *uhid_devices);
 
+// If multiplexed, the control socket is the device socket, and the device
+// messages are read from the mux stream
+//
+// Must be called before sc_controller_start()
+void
+sc_controller_set_mux_stream(struct sc_controller *controller,
+                             struct sc_mux_stream *stream);
+
 void
 sc_controller_destroy(struct sc_controller *controller);
 
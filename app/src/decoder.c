@@ -1,6 +1,8 @@
 #include "decoder.h"
 
+#include <assert.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <libavcodec/packet.h>
 #include <libavutil/avutil.h>
 
@@ -9,6 +11,10 @@
 /** Downcast packet_sink to decoder */
 #define DOWNCAST(SINK) container_of(SINK, struct sc_decoder, packet_sink)
 
+// Request a key frame again if none is received within this delay (the
+// previous request may have been ignored, for example during an encoder reset)
+#define SC_DECODER_KEYFRAME_REQUEST_INTERVAL SC_TICK_FROM_MS(1000)
+
 static bool
 sc_decoder_open(struct sc_decoder *decoder, AVCodecContext *ctx) {
     decoder->frame = av_frame_alloc();
@@ -23,16 +29,52 @@ sc_decoder_open(struct sc_decoder *decoder, AVCodecContext *ctx) {
     }
 
     decoder->ctx = ctx;
+    decoder->wait_keyframe = false;
+
+    decoder->stats.packets = 0;
+    decoder->stats.total_time = 0;
+    decoder->stats.max_time = 0;
 
     return true;
 }
 
 static void
 sc_decoder_close(struct sc_decoder *decoder) {
+    const struct sc_decoder_stats *stats = &decoder->stats;
+    if (stats->packets) {
+        LOGD("Decoder '%s': %" PRIu64 " packets, decode time avg=%.3f ms "
+             "max=%.3f ms", decoder->name, stats->packets,
+             (double) stats->total_time / stats->packets / 1000,
+             (double) stats->max_time / 1000);
+    }
+
     sc_frame_source_sinks_close(&decoder->frame_source);
     av_frame_free(&decoder->frame);
 }
 
+static void
+sc_decoder_request_keyframe(struct sc_decoder *decoder) {
+    assert(decoder->cbs);
+
+    decoder->last_keyframe_request = sc_tick_now();
+    decoder->cbs->on_error(decoder, decoder->cbs_userdata);
+}
+
+static bool
+sc_decoder_on_error(struct sc_decoder *decoder) {
+    if (!decoder->cbs) {
+        // No recovery
+        return false;
+    }
+
+    // The next frames depend on missing or corrupted references, drop them
+    // until the next key frame
+    LOGW("Decoder '%s': waiting for a key frame", decoder->name);
+    decoder->wait_keyframe = true;
+    sc_decoder_request_keyframe(decoder);
+    return true;
+}
+
 static bool
 sc_decoder_push(struct sc_decoder *decoder, const AVPacket *packet) {
     bool is_config = packet->pts == AV_NOPTS_VALUE;
@@ -41,15 +83,45 @@ sc_decoder_push(struct sc_decoder *decoder, const AVPacket *packet) {
         return true;
     }
 
+    if (decoder->wait_keyframe) {
+        if (!(packet->flags & AV_PKT_FLAG_KEY)) {
+            sc_tick now = sc_tick_now();
+            if (now - decoder->last_keyframe_request
+                    >= SC_DECODER_KEYFRAME_REQUEST_INTERVAL) {
+                sc_decoder_request_keyframe(decoder);
+            }
+            return true;
+        }
+
+        LOGI("Decoder '%s': key frame received, decoding resumed",
+             decoder->name);
+        decoder->wait_keyframe = false;
+    }
+
+    bool skip_nonref = atomic_load_explicit(&decoder->skip_nonref,
+                                            memory_order_relaxed);
+    enum AVDiscard discard = skip_nonref ? AVDISCARD_NONREF
+                                         : AVDISCARD_DEFAULT;
+    if (decoder->ctx->skip_frame != discard) {
+        LOGD("Decoder '%s': %s non-reference frames", decoder->name,
+             skip_nonref ? "skip" : "decode");
+        decoder->ctx->skip_frame = discard;
+    }
+
+    // Only measure the time spent in the decoder, not in the sinks
+    sc_tick start = sc_tick_now();
     int ret = avcodec_send_packet(decoder->ctx, packet);
+    sc_tick decode_time = sc_tick_now() - start;
     if (ret < 0 && ret != AVERROR(EAGAIN)) {
         LOGE("Decoder '%s': could not send video packet: %d",
              decoder->name, ret);
-        return false;
+        return ret != AVERROR(ENOMEM) && sc_decoder_on_error(decoder);
     }
 
     for (;;) {
+        start = sc_tick_now();
         ret = avcodec_receive_frame(decoder->ctx, decoder->frame);
+        decode_time += sc_tick_now() - start;
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
             break;
         }
@@ -57,7 +129,7 @@ sc_decoder_push(struct sc_decoder *decoder, const AVPacket *packet) {
         if (ret) {
             LOGE("Decoder '%s', could not receive video frame: %d",
                  decoder->name, ret);
-            return false;
+            return ret != AVERROR(ENOMEM) && sc_decoder_on_error(decoder);
         }
 
         // a frame was received
@@ -70,6 +142,13 @@ sc_decoder_push(struct sc_decoder *decoder, const AVPacket *packet) {
         }
     }
 
+    struct sc_decoder_stats *stats = &decoder->stats;
+    ++stats->packets;
+    stats->total_time += decode_time;
+    if (decode_time > stats->max_time) {
+        stats->max_time = decode_time;
+    }
+
     return true;
 }
 
@@ -93,8 +172,16 @@ sc_decoder_packet_sink_push(struct sc_packet_sink *sink,
 }
 
 void
-sc_decoder_init(struct sc_decoder *decoder, const char *name) {
+sc_decoder_init(struct sc_decoder *decoder, const char *name,
+                const struct sc_decoder_callbacks *cbs, void *cbs_userdata) {
     decoder->name = name; // statically allocated
+    decoder->wait_keyframe = false;
+    decoder->last_keyframe_request = 0;
+    atomic_init(&decoder->skip_nonref, false);
+
+    assert(!cbs || cbs->on_error);
+    decoder->cbs = cbs;
+    decoder->cbs_userdata = cbs_userdata;
     sc_frame_source_init(&decoder->frame_source);
 
     static const struct sc_packet_sink_ops ops = {
@@ -105,3 +192,8 @@ sc_decoder_init(struct sc_decoder *decoder, const char *name) {
 
     decoder->packet_sink.ops = &ops;
 }
+
+void
+sc_decoder_set_skip_nonref(struct sc_decoder *decoder, bool skip) {
+    atomic_store_explicit(&decoder->skip_nonref, skip, memory_order_relaxed);
+}
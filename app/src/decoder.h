@@ -3,10 +3,21 @@
 
 #include "common.h"
 
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <libavcodec/avcodec.h>
 
 #include "trait/frame_source.h"
 #include "trait/packet_sink.h"
+#include "util/tick.h"
+
+// Time spent in the decoder, per decoded packet
+struct sc_decoder_stats {
+    uint64_t packets;
+    sc_tick total_time;
+    sc_tick max_time;
+};
 
 struct sc_decoder {
     struct sc_packet_sink packet_sink; // packet sink trait
@@ -16,10 +27,46 @@ struct sc_decoder {
 
     AVCodecContext *ctx;
     AVFrame *frame;
+
+    struct sc_decoder_stats stats;
+
+    // Requested from any thread, applied on the next packet
+    atomic_bool skip_nonref;
+
+    // Set on decoding error, until the next key frame is received
+    bool wait_keyframe;
+    sc_tick last_keyframe_request;
+
+    const struct sc_decoder_callbacks *cbs;
+    void *cbs_userdata;
+};
+
+struct sc_decoder_callbacks {
+    // Called from the decoder (packet source) thread when a packet could not
+    // be decoded, to request a new key frame. While no key frame is received,
+    // it is called again periodically.
+    void (*on_error)(struct sc_decoder *decoder, void *userdata);
 };
 
 // The name must be statically allocated (e.g. a string literal)
+//
+// If cbs is NULL, any decoding error is fatal. Otherwise, the decoder recovers
+// from errors by dropping the packets until the next key frame.
+void
+sc_decoder_init(struct sc_decoder *decoder, const char *name,
+                const struct sc_decoder_callbacks *cbs, void *cbs_userdata);
+
+/**
+ * Request the decoder to skip the non-reference frames (or to stop skipping
+ * them)
+ *
+ * This reduces the decoding cost when the frames are not consumed (for
+ * example when the window is minimized). The reference frames are still
+ * decoded, so that the decoding can resume without artifacts.
+ *
+ * This function may be called from any thread.
+ */
 void
-sc_decoder_init(struct sc_decoder *decoder, const char *name);
+sc_decoder_set_skip_nonref(struct sc_decoder *decoder, bool skip);
 
 #endif
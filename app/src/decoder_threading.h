@@ -0,0 +1,14 @@
+#ifndef SC_DECODER_THREADING_H
+#define SC_DECODER_THREADING_H
+
+#include "common.h"
+
+enum sc_decoder_thread_type {
+    SC_DECODER_THREAD_TYPE_SLICE,
+    SC_DECODER_THREAD_TYPE_FRAME,
+};
+
+// Number of decoder threads selected by FFmpeg
+#define SC_DECODER_THREADS_AUTO 0
+
+#endif
@@ -58,8 +58,13 @@ run_buffering(void *data) {
 
         bool timed_out = false;
         while (!db->stopped && !timed_out) {
-            sc_tick deadline = sc_clock_to_system_time(&db->clock, pts)
-                             + db->delay;
+            sc_tick deadline;
+            if (!db->av_sync || !sc_av_sync_get_video_date(db->av_sync,
+                                                           dframe.frame->pts,
+                                                           &deadline)) {
+                deadline = sc_clock_to_system_time(&db->clock, pts)
+                         + db->delay;
+            }
             if (deadline > max_deadline) {
                 deadline = max_deadline;
             }
@@ -223,11 +228,12 @@ sc_delay_buffer_frame_sink_push(struct sc_frame_sink *sink,
 
 void
 sc_delay_buffer_init(struct sc_delay_buffer *db, sc_tick delay,
-                     bool first_frame_asap) {
+                     bool first_frame_asap, struct sc_av_sync *av_sync) {
     assert(delay > 0);
 
     db->delay = delay;
     db->first_frame_asap = first_frame_asap;
+    db->av_sync = av_sync;
 
     sc_frame_source_init(&db->frame_source);
 
@@ -6,6 +6,7 @@
 #include <stdbool.h>
 #include <libavutil/frame.h>
 
+#include "av_sync.h"
 #include "clock.h"
 #include "trait/frame_source.h"
 #include "trait/frame_sink.h"
@@ -33,6 +34,8 @@ struct sc_delay_buffer {
 
     sc_tick delay;
     bool first_frame_asap;
+    // If set, the frames are scheduled against the audio playback
+    struct sc_av_sync *av_sync;
 
     sc_thread thread;
     sc_mutex mutex;
@@ -55,9 +58,12 @@ struct sc_delay_buffer_callbacks {
  * \param delay a (strictly) positive delay
  * \param first_frame_asap if true, do not delay the first frame (useful for
                            a video stream).
+ * \param av_sync if not NULL, present the frames at the same time as the
+ *                audio samples having the same PTS (the delay is then the
+ *                maximum delay, used when the audio is not playing)
  */
 void
 sc_delay_buffer_init(struct sc_delay_buffer *db, sc_tick delay,
-                     bool first_frame_asap);
+                     bool first_frame_asap, struct sc_av_sync *av_sync);
 
 #endif
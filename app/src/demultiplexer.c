@@ -0,0 +1,348 @@
+#include "demultiplexer.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/binary.h"
+#include "util/log.h"
+
+#define SC_MUX_HEADER_SIZE 5
+// Must match the server (Multiplexer.MAX_CHUNK_LENGTH)
+#define SC_MUX_MAX_CHUNK_SIZE (1 << 14)
+
+// Maximum number of bytes queued for each stream before the demultiplexer
+// stops reading the socket
+#define SC_MUX_STREAM_CAPACITY (4 * 1024 * 1024)
+
+static bool
+sc_mux_stream_init(struct sc_mux_stream *stream) {
+    bool ok = sc_mutex_init(&stream->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&stream->cond);
+    if (!ok) {
+        sc_mutex_destroy(&stream->mutex);
+        return false;
+    }
+
+    ok = sc_cond_init(&stream->not_full_cond);
+    if (!ok) {
+        sc_cond_destroy(&stream->cond);
+        sc_mutex_destroy(&stream->mutex);
+        return false;
+    }
+
+    sc_vecdeque_init(&stream->queue);
+    stream->size = 0;
+    stream->offset = 0;
+    stream->eos = false;
+    stream->interrupted = false;
+    stream->released = false;
+
+    return true;
+}
+
+static void
+sc_mux_stream_destroy(struct sc_mux_stream *stream) {
+    while (!sc_vecdeque_is_empty(&stream->queue)) {
+        struct sc_mux_chunk chunk = sc_vecdeque_pop(&stream->queue);
+        free(chunk.data);
+    }
+    sc_vecdeque_destroy(&stream->queue);
+    sc_cond_destroy(&stream->not_full_cond);
+    sc_cond_destroy(&stream->cond);
+    sc_mutex_destroy(&stream->mutex);
+}
+
+// Wait until the stream may accept a new chunk
+//
+// Return false if interrupted.
+static bool
+sc_mux_stream_wait_not_full(struct sc_mux_stream *stream) {
+    sc_mutex_lock(&stream->mutex);
+    while (!stream->interrupted && !stream->released
+            && stream->size >= SC_MUX_STREAM_CAPACITY) {
+        sc_cond_wait(&stream->not_full_cond, &stream->mutex);
+    }
+    bool interrupted = stream->interrupted;
+    sc_mutex_unlock(&stream->mutex);
+
+    return !interrupted;
+}
+
+// On success, the stream takes ownership of data
+static bool
+sc_mux_stream_push(struct sc_mux_stream *stream, uint8_t *data, size_t size) {
+    struct sc_mux_chunk chunk = {
+        .data = data,
+        .size = size,
+    };
+
+    sc_mutex_lock(&stream->mutex);
+    if (stream->released) {
+        // Nobody will read it
+        sc_mutex_unlock(&stream->mutex);
+        free(data);
+        return true;
+    }
+
+    bool ok = sc_vecdeque_push(&stream->queue, chunk);
+    if (ok) {
+        stream->size += size;
+        sc_cond_signal(&stream->cond);
+    }
+    sc_mutex_unlock(&stream->mutex);
+
+    if (!ok) {
+        LOG_OOM();
+    }
+
+    return ok;
+}
+
+static void
+sc_mux_stream_end(struct sc_mux_stream *stream, bool interrupted) {
+    sc_mutex_lock(&stream->mutex);
+    stream->eos = true;
+    if (interrupted) {
+        stream->interrupted = true;
+        // Also wake up the demultiplexer, if it is waiting for this stream
+        sc_cond_signal(&stream->not_full_cond);
+    }
+    sc_cond_signal(&stream->cond);
+    sc_mutex_unlock(&stream->mutex);
+}
+
+void
+sc_mux_stream_release(struct sc_mux_stream *stream) {
+    sc_mutex_lock(&stream->mutex);
+    stream->released = true;
+    while (!sc_vecdeque_is_empty(&stream->queue)) {
+        struct sc_mux_chunk *chunk = sc_vecdeque_popref(&stream->queue);
+        free(chunk->data);
+    }
+    stream->size = 0;
+    stream->offset = 0;
+    sc_cond_signal(&stream->not_full_cond);
+    sc_mutex_unlock(&stream->mutex);
+}
+
+ssize_t
+sc_mux_stream_recv(struct sc_mux_stream *stream, void *buf, size_t len) {
+    assert(len);
+
+    sc_mutex_lock(&stream->mutex);
+    while (!stream->interrupted && !stream->eos
+            && sc_vecdeque_is_empty(&stream->queue)) {
+        sc_cond_wait(&stream->cond, &stream->mutex);
+    }
+
+    if (stream->interrupted) {
+        sc_mutex_unlock(&stream->mutex);
+        return -1;
+    }
+
+    // Copy as many bytes as available, possibly from several chunks
+    size_t total = 0;
+    while (total < len && !sc_vecdeque_is_empty(&stream->queue)) {
+        struct sc_mux_chunk *chunk = sc_vecdeque_peekref(&stream->queue);
+        assert(stream->offset < chunk->size);
+
+        size_t n = MIN(len - total, chunk->size - stream->offset);
+        memcpy((uint8_t *) buf + total, chunk->data + stream->offset, n);
+        total += n;
+        stream->offset += n;
+
+        if (stream->offset == chunk->size) {
+            chunk = sc_vecdeque_popref(&stream->queue);
+            assert(stream->size >= chunk->size);
+            stream->size -= chunk->size;
+            free(chunk->data);
+            stream->offset = 0;
+        }
+    }
+
+    if (total && stream->size < SC_MUX_STREAM_CAPACITY) {
+        sc_cond_signal(&stream->not_full_cond);
+    }
+
+    // total == 0 on end of stream
+    sc_mutex_unlock(&stream->mutex);
+
+    return total;
+}
+
+ssize_t
+sc_mux_stream_recv_all(struct sc_mux_stream *stream, void *buf, size_t len) {
+    size_t total = 0;
+    while (total < len) {
+        ssize_t r = sc_mux_stream_recv(stream, (uint8_t *) buf + total,
+                                       len - total);
+        if (r <= 0) {
+            return total ? (ssize_t) total : r;
+        }
+        total += r;
+    }
+
+    return total;
+}
+
+static int
+run_demultiplexer(void *data) {
+    struct sc_demultiplexer *demultiplexer = data;
+    sc_socket socket = demultiplexer->device_socket;
+
+    // The socket is read directly (without an intermediate buffer), so that
+    // the payload is received directly into its chunk, without any copy
+    for (;;) {
+        uint8_t header[SC_MUX_HEADER_SIZE];
+        ssize_t r = net_recv_all(socket, header, SC_MUX_HEADER_SIZE);
+        if (r < SC_MUX_HEADER_SIZE) {
+            LOGD("Demultiplexer: end of stream");
+            break;
+        }
+
+        uint8_t id = header[0];
+        uint32_t len = sc_read32be(&header[1]);
+
+        if (id >= SC_MUX_STREAM_COUNT || !demultiplexer->enabled[id]
+                || len > SC_MUX_MAX_CHUNK_SIZE) {
+            LOGE("Demultiplexer: unexpected chunk (stream=%" PRIu8
+                 ", length=%" PRIu32 ")", id, len);
+            break;
+        }
+
+        struct sc_mux_stream *stream = &demultiplexer->streams[id];
+
+        if (!len) {
+            // The device closed this stream, notify the consumer once all the
+            // pending data is read
+            sc_mux_stream_end(stream, false);
+            continue;
+        }
+
+        // Do not read further from the socket until the consumer catches up
+        if (!sc_mux_stream_wait_not_full(stream)) {
+            LOGD("Demultiplexer: interrupted");
+            break;
+        }
+
+        // Read the payload directly into the chunk, consumed (and freed) by
+        // the stream reader
+        uint8_t *payload = malloc(len);
+        if (!payload) {
+            LOG_OOM();
+            break;
+        }
+
+        r = net_recv_all(socket, payload, len);
+        if (r < 0 || (uint32_t) r < len) {
+            LOGD("Demultiplexer: end of stream");
+            free(payload);
+            break;
+        }
+
+        bool ok = sc_mux_stream_push(stream, payload, len);
+        if (!ok) {
+            free(payload);
+            break;
+        }
+    }
+
+    // Notify end-of-stream to all the consumers (the pending data may still be
+    // read)
+    for (unsigned i = 0; i < SC_MUX_STREAM_COUNT; ++i) {
+        if (demultiplexer->enabled[i]) {
+            sc_mux_stream_end(&demultiplexer->streams[i], false);
+        }
+    }
+
+    return 0;
+}
+
+bool
+sc_demultiplexer_init(struct sc_demultiplexer *demultiplexer,
+                      sc_socket device_socket, bool video, bool audio,
+                      bool control) {
+    demultiplexer->enabled[SC_MUX_STREAM_VIDEO] = video;
+    demultiplexer->enabled[SC_MUX_STREAM_AUDIO] = audio;
+    demultiplexer->enabled[SC_MUX_STREAM_CONTROL] = control;
+
+    for (unsigned i = 0; i < SC_MUX_STREAM_COUNT; ++i) {
+        if (!demultiplexer->enabled[i]) {
+            continue;
+        }
+
+        bool ok = sc_mux_stream_init(&demultiplexer->streams[i]);
+        if (!ok) {
+            while (i--) {
+                if (demultiplexer->enabled[i]) {
+                    sc_mux_stream_destroy(&demultiplexer->streams[i]);
+                }
+            }
+            return false;
+        }
+    }
+
+    if (control) {
+        // Disable Nagle's algorithm for the control messages
+        bool ok = net_set_tcp_nodelay(device_socket, true);
+        (void) ok; // error already logged
+    }
+
+    demultiplexer->device_socket = device_socket;
+
+    return true;
+}
+
+void
+sc_demultiplexer_destroy(struct sc_demultiplexer *demultiplexer) {
+    for (unsigned i = 0; i < SC_MUX_STREAM_COUNT; ++i) {
+        if (demultiplexer->enabled[i]) {
+            sc_mux_stream_destroy(&demultiplexer->streams[i]);
+        }
+    }
+
+    net_close(demultiplexer->device_socket);
+}
+
+bool
+sc_demultiplexer_start(struct sc_demultiplexer *demultiplexer) {
+    LOGD("Demultiplexer: starting thread");
+
+    bool ok = sc_thread_create(&demultiplexer->thread, run_demultiplexer,
+                               "scrcpy-mux", demultiplexer);
+    if (!ok) {
+        LOGE("Could not start demultiplexer thread");
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_demultiplexer_interrupt(struct sc_demultiplexer *demultiplexer) {
+    net_interrupt(demultiplexer->device_socket);
+
+    for (unsigned i = 0; i < SC_MUX_STREAM_COUNT; ++i) {
+        if (demultiplexer->enabled[i]) {
+            sc_mux_stream_end(&demultiplexer->streams[i], true);
+        }
+    }
+}
+
+void
+sc_demultiplexer_join(struct sc_demultiplexer *demultiplexer) {
+    sc_thread_join(&demultiplexer->thread, NULL);
+}
+
+struct sc_mux_stream *
+sc_demultiplexer_get_stream(struct sc_demultiplexer *demultiplexer,
+                            enum sc_mux_stream_id id) {
+    assert(id < SC_MUX_STREAM_COUNT);
+    return demultiplexer->enabled[id] ? &demultiplexer->streams[id] : NULL;
+}
@@ -0,0 +1,122 @@
+#ifndef SC_DEMULTIPLEXER_H
+#define SC_DEMULTIPLEXER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "util/net.h"
+#include "util/thread.h"
+#include "util/vecdeque.h"
+
+enum sc_mux_stream_id {
+    SC_MUX_STREAM_VIDEO,
+    SC_MUX_STREAM_AUDIO,
+    SC_MUX_STREAM_CONTROL,
+};
+
+#define SC_MUX_STREAM_COUNT 3
+
+struct sc_mux_chunk {
+    uint8_t *data;
+    size_t size;
+};
+
+struct sc_mux_chunk_queue SC_VECDEQUE(struct sc_mux_chunk);
+
+/**
+ * In-memory stream of the payload received for one multiplexed stream
+ *
+ * The queue is bounded (SC_MUX_STREAM_CAPACITY): if a consumer falls behind,
+ * the demultiplexer stops reading the socket until some data is consumed, so
+ * that the device is slowed down by TCP backpressure.
+ */
+struct sc_mux_stream {
+    sc_mutex mutex;
+    sc_cond cond; // signaled when a chunk is pushed or the stream is ended
+    sc_cond not_full_cond; // signaled when a chunk is consumed
+    struct sc_mux_chunk_queue queue;
+    size_t size; // total size of the queued chunks, in bytes
+    size_t offset; // number of bytes already read from the first chunk
+    bool eos; // the device ended the stream, no more chunks will be pushed
+    bool interrupted;
+    bool released; // the consumer does not read anymore
+};
+
+/**
+ * In multiplexed mode, the video, audio and control streams share a single
+ * socket with the device.
+ *
+ * The device sends chunks:
+ *
+ *     [stream id: 1 byte][length: 4 bytes][<length> bytes of payload]
+ *
+ * (a chunk with a length of 0 means that the stream is ended), while the
+ * client only sends control messages (not framed), directly to the device
+ * socket.
+ *
+ * The demultiplexer pushes the payload of each stream to an in-memory stream,
+ * read by the consumers (demuxers and receiver) via sc_mux_stream_recv().
+ */
+struct sc_demultiplexer {
+    sc_socket device_socket;
+
+    bool enabled[SC_MUX_STREAM_COUNT];
+    struct sc_mux_stream streams[SC_MUX_STREAM_COUNT];
+
+    sc_thread thread;
+};
+
+/**
+ * Initialize the demultiplexer
+ *
+ * On success, the demultiplexer takes ownership of the device socket.
+ */
+bool
+sc_demultiplexer_init(struct sc_demultiplexer *demultiplexer,
+                      sc_socket device_socket, bool video, bool audio,
+                      bool control);
+
+void
+sc_demultiplexer_destroy(struct sc_demultiplexer *demultiplexer);
+
+bool
+sc_demultiplexer_start(struct sc_demultiplexer *demultiplexer);
+
+// Interrupt the device socket and wake up the consumers
+void
+sc_demultiplexer_interrupt(struct sc_demultiplexer *demultiplexer);
+
+void
+sc_demultiplexer_join(struct sc_demultiplexer *demultiplexer);
+
+// Return NULL if the stream is disabled
+struct sc_mux_stream *
+sc_demultiplexer_get_stream(struct sc_demultiplexer *demultiplexer,
+                            enum sc_mux_stream_id id);
+
+/**
+ * Like net_recv(): wait until some data is available, and read up to len bytes
+ *
+ * Return 0 on end of stream, -1 if interrupted.
+ */
+ssize_t
+sc_mux_stream_recv(struct sc_mux_stream *stream, void *buf, size_t len);
+
+// Like net_recv_all()
+ssize_t
+sc_mux_stream_recv_all(struct sc_mux_stream *stream, void *buf, size_t len);
+
+/**
+ * Notify that the consumer will not read the stream anymore
+ *
+ * The next chunks of this stream are discarded, so that they never block the
+ * demultiplexer (and the other streams).
+ */
+void
+sc_mux_stream_release(struct sc_mux_stream *stream);
+
+#endif
@@ -6,11 +6,16 @@
 #include <libavutil/channel_layout.h>
 
 #include "packet_merger.h"
+#include "packet_pool.h"
 #include "util/binary.h"
 #include "util/log.h"
 
 #define SC_PACKET_HEADER_SIZE 12
 
+// Most packets (audio packets and video P-frames) fit in the reader buffer, so
+// that their header and payload are received by a single recv() call
+#define SC_DEMUXER_READER_CAPACITY (128 * 1024)
+
 #define SC_PACKET_FLAG_CONFIG    (UINT64_C(1) << 63)
 #define SC_PACKET_FLAG_KEY_FRAME (UINT64_C(1) << 62)
 
@@ -18,13 +23,6 @@
 
 static enum AVCodecID
 sc_demuxer_to_avcodec_id(uint32_t codec_id) {
-#define SC_CODEC_ID_H264 UINT32_C(0x68323634) // "h264" in ASCII
-#define SC_CODEC_ID_H265 UINT32_C(0x68323635) // "h265" in ASCII
-#define SC_CODEC_ID_AV1 UINT32_C(0x00617631) // "av1" in ASCII
-#define SC_CODEC_ID_OPUS UINT32_C(0x6f707573) // "opus" in ASCII
-#define SC_CODEC_ID_AAC UINT32_C(0x00616163) // "aac" in ASCII
-#define SC_CODEC_ID_FLAC UINT32_C(0x666c6163) // "flac" in ASCII
-#define SC_CODEC_ID_RAW UINT32_C(0x00726177) // "raw" in ASCII
     switch (codec_id) {
         case SC_CODEC_ID_H264:
             return AV_CODEC_ID_H264;
@@ -51,34 +49,62 @@ sc_demuxer_to_avcodec_id(uint32_t codec_id) {
     }
 }
 
+static void
+sc_demuxer_dump(struct sc_demuxer *demuxer, const uint8_t *data, size_t len) {
+    if (demuxer->dump) {
+        sc_stream_dump_write(demuxer->dump, demuxer->dump_stream, data, len);
+    }
+}
+
+// Read from the mux stream if multiplexed, from the socket otherwise
+static ssize_t
+sc_demuxer_recv_all(struct sc_demuxer *demuxer, struct sc_net_reader *reader,
+                    void *buf, size_t len) {
+    if (demuxer->mux_stream) {
+        return sc_mux_stream_recv_all(demuxer->mux_stream, buf, len);
+    }
+
+    return sc_net_reader_recv_all(reader, buf, len);
+}
+
 static bool
-sc_demuxer_recv_codec_id(struct sc_demuxer *demuxer, uint32_t *codec_id) {
+sc_demuxer_recv_codec_id(struct sc_demuxer *demuxer,
+                         struct sc_net_reader *reader, uint32_t *codec_id) {
     uint8_t data[4];
-    ssize_t r = net_recv_all(demuxer->socket, data, 4);
+    ssize_t r = sc_demuxer_recv_all(demuxer, reader, data, 4);
     if (r < 4) {
         return false;
     }
 
+    sc_demuxer_dump(demuxer, data, 4);
+
     *codec_id = sc_read32be(data);
     return true;
 }
 
 static bool
-sc_demuxer_recv_video_size(struct sc_demuxer *demuxer, uint32_t *width,
+sc_demuxer_recv_video_size(struct sc_demuxer *demuxer,
+                           struct sc_net_reader *reader, uint32_t *width,
                            uint32_t *height) {
     uint8_t data[8];
-    ssize_t r = net_recv_all(demuxer->socket, data, 8);
+    ssize_t r = sc_demuxer_recv_all(demuxer, reader, data, 8);
     if (r < 8) {
         return false;
     }
 
+    sc_demuxer_dump(demuxer, data, 8);
+
     *width = sc_read32be(data);
     *height = sc_read32be(data + 4);
     return true;
 }
 
+// Receive the next packet, with `headroom` bytes available in its buffer in
+// front of its data
 static bool
-sc_demuxer_recv_packet(struct sc_demuxer *demuxer, AVPacket *packet) {
+sc_demuxer_recv_packet(struct sc_demuxer *demuxer, struct sc_net_reader *reader,
+                       struct sc_packet_pool *pool, size_t headroom,
+                       AVPacket *packet) {
     // The video and audio streams contain a sequence of raw packets (as
     // provided by MediaCodec), each prefixed with a "meta" header.
     //
@@ -100,7 +126,8 @@ sc_demuxer_recv_packet(struct sc_demuxer *demuxer, AVPacket *packet) {
     //  `-- config packet
 
     uint8_t header[SC_PACKET_HEADER_SIZE];
-    ssize_t r = net_recv_all(demuxer->socket, header, SC_PACKET_HEADER_SIZE);
+    ssize_t r = sc_demuxer_recv_all(demuxer, reader, header,
+                                    SC_PACKET_HEADER_SIZE);
     if (r < SC_PACKET_HEADER_SIZE) {
         return false;
     }
@@ -109,17 +136,22 @@ sc_demuxer_recv_packet(struct sc_demuxer *demuxer, AVPacket *packet) {
     uint32_t len = sc_read32be(&header[8]);
     assert(len);
 
-    if (av_new_packet(packet, len)) {
-        LOG_OOM();
+    if (!sc_packet_pool_new_packet(pool, packet, headroom + len)) {
         return false;
     }
 
-    r = net_recv_all(demuxer->socket, packet->data, len);
+    packet->data += headroom;
+    packet->size = len;
+
+    r = sc_demuxer_recv_all(demuxer, reader, packet->data, len);
     if (r < 0 || ((uint32_t) r) < len) {
         av_packet_unref(packet);
         return false;
     }
 
+    sc_demuxer_dump(demuxer, header, SC_PACKET_HEADER_SIZE);
+    sc_demuxer_dump(demuxer, packet->data, len);
+
     if (pts_flags & SC_PACKET_FLAG_CONFIG) {
         packet->pts = AV_NOPTS_VALUE;
     } else {
@@ -141,12 +173,22 @@ run_demuxer(void *data) {
     // Flag to report end-of-stream (i.e. device disconnected)
     enum sc_demuxer_status status = SC_DEMUXER_STATUS_ERROR;
 
+    // Unused if multiplexed (the mux stream is already in memory)
+    struct sc_net_reader reader = {0};
+    if (!demuxer->mux_stream) {
+        bool ok = sc_net_reader_init(&reader, demuxer->socket,
+                                     SC_DEMUXER_READER_CAPACITY);
+        if (!ok) {
+            goto end;
+        }
+    }
+
     uint32_t raw_codec_id;
-    bool ok = sc_demuxer_recv_codec_id(demuxer, &raw_codec_id);
+    bool ok = sc_demuxer_recv_codec_id(demuxer, &reader, &raw_codec_id);
     if (!ok) {
         LOGE("Demuxer '%s': stream disabled due to connection error",
              demuxer->name);
-        goto end;
+        goto finally_destroy_reader;
     }
 
     if (raw_codec_id == 0) {
@@ -154,13 +196,13 @@ run_demuxer(void *data) {
              demuxer->name);
         sc_packet_source_sinks_disable(&demuxer->packet_source);
         status = SC_DEMUXER_STATUS_DISABLED;
-        goto end;
+        goto finally_destroy_reader;
     }
 
     if (raw_codec_id == 1) {
         LOGE("Demuxer '%s': stream configuration error on the device",
              demuxer->name);
-        goto end;
+        goto finally_destroy_reader;
     }
 
     enum AVCodecID codec_id = sc_demuxer_to_avcodec_id(raw_codec_id);
@@ -168,7 +210,7 @@ run_demuxer(void *data) {
         LOGE("Demuxer '%s': stream disabled due to unsupported codec",
              demuxer->name);
         sc_packet_source_sinks_disable(&demuxer->packet_source);
-        goto end;
+        goto finally_destroy_reader;
     }
 
     const AVCodec *codec = avcodec_find_decoder(codec_id);
@@ -176,13 +218,13 @@ run_demuxer(void *data) {
         LOGE("Demuxer '%s': stream disabled due to missing decoder",
              demuxer->name);
         sc_packet_source_sinks_disable(&demuxer->packet_source);
-        goto end;
+        goto finally_destroy_reader;
     }
 
     AVCodecContext *codec_ctx = avcodec_alloc_context3(codec);
     if (!codec_ctx) {
         LOG_OOM();
-        goto end;
+        goto finally_destroy_reader;
     }
 
     codec_ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
@@ -190,7 +232,7 @@ run_demuxer(void *data) {
     if (codec->type == AVMEDIA_TYPE_VIDEO) {
         uint32_t width;
         uint32_t height;
-        ok = sc_demuxer_recv_video_size(demuxer, &width, &height);
+        ok = sc_demuxer_recv_video_size(demuxer, &reader, &width, &height);
         if (!ok) {
             goto finally_free_context;
         }
@@ -198,6 +240,17 @@ run_demuxer(void *data) {
         codec_ctx->width = width;
         codec_ctx->height = height;
         codec_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+
+        codec_ctx->thread_count = demuxer->decoder_threads;
+        if (demuxer->decoder_thread_type == SC_DECODER_THREAD_TYPE_FRAME) {
+            // Frame threading is disabled by FFmpeg in low delay mode. It
+            // delays the output by (thread_count - 1) frames.
+            codec_ctx->flags &= ~AV_CODEC_FLAG_LOW_DELAY;
+            codec_ctx->thread_type = FF_THREAD_FRAME;
+        } else {
+            // Slice threading does not add any delay
+            codec_ctx->thread_type = FF_THREAD_SLICE;
+        }
     } else {
         // Hardcoded audio properties
 #ifdef SCRCPY_LAVU_HAS_CHLAYOUT
@@ -219,6 +272,15 @@ run_demuxer(void *data) {
         goto finally_free_context;
     }
 
+    if (codec->type == AVMEDIA_TYPE_VIDEO) {
+        const char *thread_type =
+            codec_ctx->active_thread_type == FF_THREAD_FRAME ? "frame"
+          : codec_ctx->active_thread_type == FF_THREAD_SLICE ? "slice"
+          : "none";
+        LOGD("Demuxer '%s': decoder threads: %d (%s)", demuxer->name,
+             codec_ctx->thread_count, thread_type);
+    }
+
     if (!sc_packet_source_sinks_open(&demuxer->packet_source, codec_ctx)) {
         goto finally_free_context;
     }
@@ -240,8 +302,19 @@ run_demuxer(void *data) {
         goto finally_close_sinks;
     }
 
+    // Packet buffers are reused once released by all the sinks
+    struct sc_packet_pool pool;
+    sc_packet_pool_init(&pool);
+
     for (;;) {
-        bool ok = sc_demuxer_recv_packet(demuxer, packet);
+        // If a config packet is pending, reserve space to prepend it to the
+        // next media packet without moving its payload
+        size_t headroom = must_merge_config_packet
+                        ? sc_packet_merger_get_headroom(&merger)
+                        : 0;
+
+        bool ok = sc_demuxer_recv_packet(demuxer, &reader, &pool, headroom,
+                                         packet);
         if (!ok) {
             // end of stream
             status = SC_DEMUXER_STATUS_EOS;
@@ -266,6 +339,14 @@ run_demuxer(void *data) {
     }
 
     LOGD("Demuxer '%s': end of frames", demuxer->name);
+    LOGD("Demuxer '%s': packet pool hits=%" PRIu64 " misses=%" PRIu64,
+         demuxer->name, pool.hits, pool.misses);
+    if (!demuxer->mux_stream) {
+        LOGD("Demuxer '%s': recv() calls=%" PRIu64, demuxer->name,
+             reader.recv_count);
+    }
+
+    sc_packet_pool_destroy(&pool);
 
     if (must_merge_config_packet) {
         sc_packet_merger_destroy(&merger);
@@ -276,7 +357,16 @@ finally_close_sinks:
     sc_packet_source_sinks_close(&demuxer->packet_source);
 finally_free_context:
     avcodec_free_context(&codec_ctx);
+finally_destroy_reader:
+    if (!demuxer->mux_stream) {
+        sc_net_reader_destroy(&reader);
+    }
 end:
+    if (demuxer->mux_stream) {
+        // The next chunks must not block the demultiplexer
+        sc_mux_stream_release(demuxer->mux_stream);
+    }
+
     demuxer->cbs->on_ended(demuxer, status, demuxer->cbs_userdata);
 
     return 0;
@@ -285,20 +375,51 @@ end:
 void
 sc_demuxer_init(struct sc_demuxer *demuxer, const char *name, sc_socket socket,
                 const struct sc_demuxer_callbacks *cbs, void *cbs_userdata) {
-    assert(socket != SC_SOCKET_NONE);
-
     demuxer->name = name; // statically allocated
     demuxer->socket = socket;
+    demuxer->mux_stream = NULL;
     sc_packet_source_init(&demuxer->packet_source);
 
+    demuxer->dump = NULL;
+
+    // Same defaults as the command line options
+    demuxer->decoder_threads = SC_DECODER_THREADS_AUTO;
+    demuxer->decoder_thread_type = SC_DECODER_THREAD_TYPE_SLICE;
+
     assert(cbs && cbs->on_ended);
 
     demuxer->cbs = cbs;
     demuxer->cbs_userdata = cbs_userdata;
 }
 
+void
+sc_demuxer_set_dump(struct sc_demuxer *demuxer, struct sc_stream_dump *dump,
+                    enum sc_stream_dump_stream stream) {
+    assert(dump);
+    demuxer->dump = dump;
+    demuxer->dump_stream = stream;
+}
+
+void
+sc_demuxer_set_mux_stream(struct sc_demuxer *demuxer,
+                          struct sc_mux_stream *stream) {
+    assert(stream);
+    assert(demuxer->socket == SC_SOCKET_NONE);
+    demuxer->mux_stream = stream;
+}
+
+void
+sc_demuxer_set_decoder_threading(struct sc_demuxer *demuxer, unsigned threads,
+                                 enum sc_decoder_thread_type type) {
+    demuxer->decoder_threads = threads;
+    demuxer->decoder_thread_type = type;
+}
+
 bool
 sc_demuxer_start(struct sc_demuxer *demuxer) {
+    // Exactly one of the socket and the mux stream must be set
+    assert((demuxer->socket != SC_SOCKET_NONE) != !!demuxer->mux_stream);
+
     LOGD("Demuxer '%s': starting thread", demuxer->name);
 
     bool ok = sc_thread_create(&demuxer->thread, run_demuxer, "scrcpy-demuxer",
@@ -4,19 +4,42 @@
 #include "common.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 
+#include "decoder_threading.h"
+#include "demultiplexer.h"
+#include "stream_dump.h"
 #include "trait/packet_source.h"
 #include "util/net.h"
 #include "util/thread.h"
 
+// Codec ids, as sent by the server
+#define SC_CODEC_ID_H264 UINT32_C(0x68323634) // "h264" in ASCII
+#define SC_CODEC_ID_H265 UINT32_C(0x68323635) // "h265" in ASCII
+#define SC_CODEC_ID_AV1 UINT32_C(0x00617631) // "av1" in ASCII
+#define SC_CODEC_ID_OPUS UINT32_C(0x6f707573) // "opus" in ASCII
+#define SC_CODEC_ID_AAC UINT32_C(0x00616163) // "aac" in ASCII
+#define SC_CODEC_ID_FLAC UINT32_C(0x666c6163) // "flac" in ASCII
+#define SC_CODEC_ID_RAW UINT32_C(0x00726177) // "raw" in ASCII
+
 struct sc_demuxer {
     struct sc_packet_source packet_source; // packet source trait
 
     const char *name; // must be statically allocated (e.g. a string literal)
 
+    // Exactly one of them is set
     sc_socket socket;
+    struct sc_mux_stream *mux_stream; // if multiplexed
     sc_thread thread;
 
+    // Optional, to dump the raw received bytes (NULL if disabled)
+    struct sc_stream_dump *dump;
+    enum sc_stream_dump_stream dump_stream;
+
+    // Decoder threading, only applied to video streams
+    unsigned decoder_threads; // SC_DECODER_THREADS_AUTO for auto
+    enum sc_decoder_thread_type decoder_thread_type;
+
     const struct sc_demuxer_callbacks *cbs;
     void *cbs_userdata;
 };
@@ -33,10 +56,28 @@ struct sc_demuxer_callbacks {
 };
 
 // The name must be statically allocated (e.g. a string literal)
+//
+// The socket is SC_SOCKET_NONE if the stream is read from a mux stream (see
+// sc_demuxer_set_mux_stream())
 void
 sc_demuxer_init(struct sc_demuxer *demuxer, const char *name, sc_socket socket,
                 const struct sc_demuxer_callbacks *cbs, void *cbs_userdata);
 
+// Must be called before sc_demuxer_start()
+void
+sc_demuxer_set_dump(struct sc_demuxer *demuxer, struct sc_stream_dump *dump,
+                    enum sc_stream_dump_stream stream);
+
+// Must be called before sc_demuxer_start()
+void
+sc_demuxer_set_mux_stream(struct sc_demuxer *demuxer,
+                          struct sc_mux_stream *stream);
+
+// Must be called before sc_demuxer_start()
+void
+sc_demuxer_set_decoder_threading(struct sc_demuxer *demuxer, unsigned threads,
+                                 enum sc_decoder_thread_type type);
+
 bool
 sc_demuxer_start(struct sc_demuxer *demuxer);
 
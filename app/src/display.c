@@ -28,11 +28,27 @@ sc_display_init_novideo_icon(struct sc_display *display,
     return true;
 }
 
+static bool
+sc_display_renderer_supports(const SDL_RendererInfo *info, Uint32 format) {
+    for (Uint32 i = 0; i < info->num_texture_formats; ++i) {
+        if (info->texture_formats[i] == format) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool
 sc_display_init(struct sc_display *display, SDL_Window *window,
-                SDL_Surface *icon_novideo, bool mipmaps) {
-    display->renderer =
-        SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+                SDL_Surface *icon_novideo, bool mipmaps, bool pbo,
+                bool vsync) {
+    uint32_t flags = SDL_RENDERER_ACCELERATED;
+    if (vsync) {
+        // SDL_RenderPresent() waits for the vertical blanking
+        flags |= SDL_RENDERER_PRESENTVSYNC;
+    }
+
+    display->renderer = SDL_CreateRenderer(window, -1, flags);
     if (!display->renderer) {
         LOGE("Could not create renderer: %s", SDL_GetError());
         return false;
@@ -43,7 +59,20 @@ sc_display_init(struct sc_display *display, SDL_Window *window,
     const char *renderer_name = r ? NULL : renderer_info.name;
     LOGI("Renderer: %s", renderer_name ? renderer_name : "(unknown)");
 
+    display->supports_nv12 = false;
+    display->supports_nv21 = false;
+#ifdef SCRCPY_SDL_HAS_UPDATE_NV_TEXTURE
+    if (!r) {
+        // Otherwise, SDL would convert the frames on the main thread
+        display->supports_nv12 =
+            sc_display_renderer_supports(&renderer_info, SDL_PIXELFORMAT_NV12);
+        display->supports_nv21 =
+            sc_display_renderer_supports(&renderer_info, SDL_PIXELFORMAT_NV21);
+    }
+#endif
+
     display->mipmaps = false;
+    display->pbo = false;
 
 #ifdef SC_DISPLAY_FORCE_OPENGL_CORE_PROFILE
     display->gl_context = NULL;
@@ -87,11 +116,35 @@ sc_display_init(struct sc_display *display, SDL_Window *window,
         } else {
             LOGI("Trilinear filtering disabled");
         }
+
+        if (pbo) {
+#ifdef SC_DISPLAY_FORCE_OPENGL_CORE_PROFILE
+            // The renderer does not use the Core Profile context created
+            // above, so its OpenGL version is unknown
+            LOGD("PBO texture upload disabled (unsupported on this platform)");
+#else
+            if (sc_pbo_uploader_is_supported(gl, display->renderer)) {
+                LOGD("PBO texture upload enabled");
+                display->pbo = true;
+            } else {
+                LOGD("PBO texture upload disabled "
+                     "(OpenGL 3.0+ or ES 3.0+ with YUV textures required)");
+            }
+#endif
+        }
     } else if (mipmaps) {
         LOGD("Trilinear filtering disabled (not an OpenGL renderer)");
     }
 
+    display->pbo_uploader_initialized = false;
+    display->upload_stats.frames = 0;
+    display->upload_stats.total_time = 0;
+    display->upload_stats.max_time = 0;
+
     display->texture = NULL;
+    display->texture_size = (struct sc_size) {0, 0};
+    // The actual format is known on first frame
+    display->texture_format = SDL_PIXELFORMAT_YV12;
     display->pending.flags = 0;
     display->pending.frame = NULL;
     display->has_frame = false;
@@ -111,8 +164,33 @@ sc_display_init(struct sc_display *display, SDL_Window *window,
     return true;
 }
 
+static const char *
+sc_display_get_upload_mode(struct sc_display *display) {
+    if (!display->pbo) {
+        return "sdl";
+    }
+    return display->pbo_uploader.persistent ? "pbo-persistent" : "pbo";
+}
+
+static void
+sc_display_destroy_pbo_uploader(struct sc_display *display) {
+    if (display->pbo_uploader_initialized) {
+        sc_pbo_uploader_destroy(&display->pbo_uploader);
+        display->pbo_uploader_initialized = false;
+    }
+}
+
 void
 sc_display_destroy(struct sc_display *display) {
+    const struct sc_display_upload_stats *stats = &display->upload_stats;
+    if (stats->frames) {
+        LOGD("Texture upload (%s): %" PRIu64 " frames, avg=%.3f ms "
+             "max=%.3f ms", sc_display_get_upload_mode(display),
+             stats->frames, (double) stats->total_time / stats->frames / 1000,
+             (double) stats->max_time / 1000);
+    }
+
+    sc_display_destroy_pbo_uploader(display);
     if (display->pending.frame) {
         av_frame_free(&display->pending.frame);
     }
@@ -125,11 +203,36 @@ sc_display_destroy(struct sc_display *display) {
     SDL_DestroyRenderer(display->renderer);
 }
 
+static Uint32
+sc_display_get_texture_format(const struct sc_display *display,
+                              enum AVPixelFormat format) {
+    switch (format) {
+        case AV_PIX_FMT_YUV420P:
+        case AV_PIX_FMT_YUVJ420P:
+            return SDL_PIXELFORMAT_YV12;
+        case AV_PIX_FMT_NV12:
+            return display->supports_nv12 ? SDL_PIXELFORMAT_NV12
+                                           : SDL_PIXELFORMAT_UNKNOWN;
+        case AV_PIX_FMT_NV21:
+            return display->supports_nv21 ? SDL_PIXELFORMAT_NV21
+                                           : SDL_PIXELFORMAT_UNKNOWN;
+        default:
+            return SDL_PIXELFORMAT_UNKNOWN;
+    }
+}
+
+bool
+sc_display_supports_format(const struct sc_display *display,
+                           enum AVPixelFormat format) {
+    return sc_display_get_texture_format(display, format)
+        != SDL_PIXELFORMAT_UNKNOWN;
+}
+
 static SDL_Texture *
 sc_display_create_texture(struct sc_display *display,
                           struct sc_size size) {
     SDL_Renderer *renderer = display->renderer;
-    SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_YV12,
+    SDL_Texture *texture = SDL_CreateTexture(renderer, display->texture_format,
                                              SDL_TEXTUREACCESS_STREAMING,
                                              size.width, size.height);
     if (!texture) {
@@ -150,6 +253,21 @@ sc_display_create_texture(struct sc_display *display,
         SDL_GL_UnbindTexture(texture);
     }
 
+    // The PBO uploader only supports planar YUV 4:2:0 textures
+    if (display->pbo && display->texture_format == SDL_PIXELFORMAT_YV12) {
+        assert(!display->pbo_uploader_initialized);
+        bool ok = sc_pbo_uploader_init(&display->pbo_uploader, &display->gl,
+                                       size);
+        if (ok) {
+            display->pbo_uploader_initialized = true;
+        } else {
+            LOGW("Could not initialize PBO texture upload, disabled");
+            display->pbo = false;
+        }
+    }
+
+    display->texture_size = size;
+
     return texture;
 }
 
@@ -181,6 +299,10 @@ sc_display_set_pending_frame(struct sc_display *display, const AVFrame *frame) {
     return true;
 }
 
+static bool
+sc_display_update_texture_internal(struct sc_display *display,
+                                   const AVFrame *frame);
+
 static bool
 sc_display_apply_pending(struct sc_display *display) {
     if (display->pending.flags & SC_DISPLAY_PENDING_FLAG_SIZE) {
@@ -196,7 +318,8 @@ sc_display_apply_pending(struct sc_display *display) {
 
     if (display->pending.flags & SC_DISPLAY_PENDING_FLAG_FRAME) {
         assert(display->pending.frame);
-        bool ok = sc_display_update_texture(display, display->pending.frame);
+        bool ok = sc_display_update_texture_internal(display,
+                                                     display->pending.frame);
         if (!ok) {
             return false;
         }
@@ -213,8 +336,10 @@ sc_display_set_texture_size_internal(struct sc_display *display,
                                      struct sc_size size) {
     assert(size.width && size.height);
 
+    sc_display_destroy_pbo_uploader(display);
     if (display->texture) {
         SDL_DestroyTexture(display->texture);
+        display->texture = NULL;
     }
 
     display->texture = sc_display_create_texture(display, size);
@@ -239,9 +364,60 @@ sc_display_set_texture_size(struct sc_display *display, struct sc_size size) {
 }
 
 static SDL_YUV_CONVERSION_MODE
-sc_display_to_sdl_color_range(enum AVColorRange color_range) {
-    return color_range == AVCOL_RANGE_JPEG ? SDL_YUV_CONVERSION_JPEG
-                                           : SDL_YUV_CONVERSION_AUTOMATIC;
+sc_display_to_sdl_color_range(const AVFrame *frame) {
+    bool full_range = frame->color_range == AVCOL_RANGE_JPEG
+                   || frame->format == AV_PIX_FMT_YUVJ420P;
+    return full_range ? SDL_YUV_CONVERSION_JPEG
+                      : SDL_YUV_CONVERSION_AUTOMATIC;
+}
+
+static bool
+sc_display_update_yuv_texture(struct sc_display *display,
+                              const AVFrame *frame) {
+    if (display->pbo_uploader_initialized) {
+        struct sc_pbo_uploader *uploader = &display->pbo_uploader;
+        if (frame->width == uploader->size.width
+                && frame->height == uploader->size.height) {
+            bool ok =
+                sc_pbo_uploader_upload(uploader, display->texture, frame);
+            if (ok) {
+                return true;
+            }
+            // On error, fallback to a synchronous update
+        }
+    }
+
+    int ret = SDL_UpdateYUVTexture(display->texture, NULL,
+                                   frame->data[0], frame->linesize[0],
+                                   frame->data[1], frame->linesize[1],
+                                   frame->data[2], frame->linesize[2]);
+    if (ret) {
+        LOGD("Could not update texture: %s", SDL_GetError());
+        return false;
+    }
+
+    return true;
+}
+
+static bool
+sc_display_update_nv_texture(struct sc_display *display, const AVFrame *frame) {
+#ifdef SCRCPY_SDL_HAS_UPDATE_NV_TEXTURE
+    int ret = SDL_UpdateNVTexture(display->texture, NULL,
+                                  frame->data[0], frame->linesize[0],
+                                  frame->data[1], frame->linesize[1]);
+    if (ret) {
+        LOGD("Could not update texture: %s", SDL_GetError());
+        return false;
+    }
+
+    return true;
+#else
+    (void) display;
+    (void) frame;
+    // Semi-planar formats are never reported as supported
+    assert(!"unreachable");
+    return false;
+#endif
 }
 
 static bool
@@ -253,16 +429,33 @@ sc_display_update_texture_internal(struct sc_display *display,
 
         // Configure YUV color range conversion
         SDL_YUV_CONVERSION_MODE sdl_color_range =
-            sc_display_to_sdl_color_range(frame->color_range);
+            sc_display_to_sdl_color_range(frame);
         SDL_SetYUVConversionMode(sdl_color_range);
     }
 
-    int ret = SDL_UpdateYUVTexture(display->texture, NULL,
-                                   frame->data[0], frame->linesize[0],
-                                   frame->data[1], frame->linesize[1],
-                                   frame->data[2], frame->linesize[2]);
-    if (ret) {
-        LOGD("Could not update texture: %s", SDL_GetError());
+    Uint32 texture_format =
+        sc_display_get_texture_format(display, frame->format);
+    // Unsupported frames must have been converted by the caller
+    assert(texture_format != SDL_PIXELFORMAT_UNKNOWN);
+
+    if (texture_format != display->texture_format || !display->texture) {
+        // The decoder output format changed (or the texture could not be
+        // recreated previously)
+        LOGD("Texture format: %s", SDL_GetPixelFormatName(texture_format));
+        display->texture_format = texture_format;
+        bool ok = sc_display_set_texture_size_internal(display,
+                                                       display->texture_size);
+        if (!ok) {
+            return false;
+        }
+    }
+
+    sc_tick start = sc_tick_now();
+
+    bool ok = texture_format == SDL_PIXELFORMAT_YV12
+            ? sc_display_update_yuv_texture(display, frame)
+            : sc_display_update_nv_texture(display, frame);
+    if (!ok) {
         return false;
     }
 
@@ -272,6 +465,15 @@ sc_display_update_texture_internal(struct sc_display *display,
         SDL_GL_UnbindTexture(display->texture);
     }
 
+    sc_tick upload_time = sc_tick_now() - start;
+
+    struct sc_display_upload_stats *stats = &display->upload_stats;
+    ++stats->frames;
+    stats->total_time += upload_time;
+    if (upload_time > stats->max_time) {
+        stats->max_time = upload_time;
+    }
+
     return true;
 }
 
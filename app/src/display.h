@@ -6,19 +6,36 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
 #include <SDL2/SDL.h>
 
 #include "coords.h"
 #include "opengl.h"
 #include "options.h"
+#include "pbo_uploader.h"
+#include "util/tick.h"
 
 #ifdef __APPLE__
 # define SC_DISPLAY_FORCE_OPENGL_CORE_PROFILE
 #endif
 
+// Time spent to update the texture (including mipmaps generation), per frame
+struct sc_display_upload_stats {
+    uint64_t frames;
+    sc_tick total_time;
+    sc_tick max_time;
+};
+
 struct sc_display {
     SDL_Renderer *renderer;
     SDL_Texture *texture;
+    struct sc_size texture_size;
+    Uint32 texture_format; // SDL pixel format, depends on the frame format
+
+    // Semi-planar formats uploaded without conversion (natively supported by
+    // the renderer)
+    bool supports_nv12;
+    bool supports_nv21;
 
     struct sc_opengl gl;
 #ifdef SC_DISPLAY_FORCE_OPENGL_CORE_PROFILE
@@ -27,6 +44,13 @@ struct sc_display {
 
     bool mipmaps;
 
+    // Upload the frames through pixel buffer objects if supported
+    bool pbo;
+    struct sc_pbo_uploader pbo_uploader;
+    bool pbo_uploader_initialized;
+
+    struct sc_display_upload_stats upload_stats;
+
     struct {
 #define SC_DISPLAY_PENDING_FLAG_SIZE 1
 #define SC_DISPLAY_PENDING_FLAG_FRAME 2
@@ -46,11 +70,24 @@ enum sc_display_result {
 
 bool
 sc_display_init(struct sc_display *display, SDL_Window *window,
-                SDL_Surface *icon_novideo, bool mipmaps);
+                SDL_Surface *icon_novideo, bool mipmaps, bool pbo,
+                bool vsync);
 
 void
 sc_display_destroy(struct sc_display *display);
 
+/**
+ * Indicate whether frames of the given pixel format may be displayed directly
+ *
+ * Frames in other formats must be converted (to AV_PIX_FMT_YUV420P) before
+ * being passed to sc_display_update_texture().
+ *
+ * This function may be called from any thread.
+ */
+bool
+sc_display_supports_format(const struct sc_display *display,
+                           enum AVPixelFormat format);
+
 enum sc_display_result
 sc_display_set_texture_size(struct sc_display *display, struct sc_size size);
 
@@ -16,7 +16,7 @@ sc_file_pusher_request_destroy(struct sc_file_pusher_request *req) {
 
 bool
 sc_file_pusher_init(struct sc_file_pusher *fp, const char *serial,
-                    const char *push_target) {
+                    const char *push_target, bool stdout_reserved) {
     assert(serial);
 
     sc_vecdeque_init(&fp->queue);
@@ -54,6 +54,7 @@ sc_file_pusher_init(struct sc_file_pusher *fp, const char *serial,
     fp->stopped = false;
 
     fp->push_target = push_target ? push_target : DEFAULT_PUSH_TARGET;
+    fp->adb_flags = stdout_reserved ? SC_ADB_STDOUT_TO_STDERR : 0;
 
     return true;
 }
@@ -136,7 +137,7 @@ run_file_pusher(void *data) {
 
         if (req.action == SC_FILE_PUSHER_ACTION_INSTALL_APK) {
             LOGI("Installing %s...", req.file);
-            bool ok = sc_adb_install(intr, serial, req.file, 0);
+            bool ok = sc_adb_install(intr, serial, req.file, fp->adb_flags);
             if (ok) {
                 LOGI("%s successfully installed", req.file);
             } else {
@@ -144,7 +145,8 @@ run_file_pusher(void *data) {
             }
         } else {
             LOGI("Pushing %s...", req.file);
-            bool ok = sc_adb_push(intr, serial, req.file, push_target, 0);
+            bool ok = sc_adb_push(intr, serial, req.file, push_target,
+                                  fp->adb_flags);
             if (ok) {
                 LOGI("%s successfully pushed to %s", req.file, push_target);
             } else {
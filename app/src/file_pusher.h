@@ -24,6 +24,7 @@ struct sc_file_pusher_request_queue SC_VECDEQUE(struct sc_file_pusher_request);
 struct sc_file_pusher {
     char *serial;
     const char *push_target;
+    unsigned adb_flags;
     sc_thread thread;
     sc_mutex mutex;
     sc_cond event_cond;
@@ -34,9 +35,10 @@ struct sc_file_pusher {
     struct sc_intr intr;
 };
 
+// If stdout_reserved is set, the adb output is redirected to stderr
 bool
 sc_file_pusher_init(struct sc_file_pusher *fp, const char *serial,
-                    const char *push_target);
+                    const char *push_target, bool stdout_reserved);
 
 void
 sc_file_pusher_destroy(struct sc_file_pusher *fp);
@@ -0,0 +1,179 @@
+#include "frame_converter.h"
+
+#include <assert.h>
+#include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+
+#include "util/log.h"
+
+static bool
+sc_frame_converter_is_full_range(const AVFrame *frame) {
+    enum AVPixelFormat format = frame->format;
+    return frame->color_range == AVCOL_RANGE_JPEG
+        || format == AV_PIX_FMT_YUVJ420P
+        || format == AV_PIX_FMT_YUVJ422P
+        || format == AV_PIX_FMT_YUVJ444P;
+}
+
+static struct SwsContext *
+sc_frame_converter_create_sws_context(struct sc_frame_converter *fc,
+                                      const AVFrame *frame, int width,
+                                      int height) {
+    struct SwsContext *ctx = sws_alloc_context();
+    if (!ctx) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    bool downscale = width < frame->width || height < frame->height;
+    // The area filter averages all the source pixels (like a box filter),
+    // which avoids aliasing on large downscaling ratios
+    int flags = downscale ? SWS_AREA : SWS_BILINEAR;
+
+    av_opt_set_int(ctx, "srcw", frame->width, 0);
+    av_opt_set_int(ctx, "srch", frame->height, 0);
+    av_opt_set_int(ctx, "src_format", frame->format, 0);
+    av_opt_set_int(ctx, "dstw", width, 0);
+    av_opt_set_int(ctx, "dsth", height, 0);
+    av_opt_set_int(ctx, "dst_format", fc->format, 0);
+    av_opt_set_int(ctx, "sws_flags", flags, 0);
+
+#ifdef SCRCPY_LSWS_HAS_SCALE_FRAME
+    // 0 means one thread per CPU core
+    if (av_opt_set_int(ctx, "threads", 0, 0) < 0) {
+        LOGD("Could not enable threaded frame conversion");
+    }
+#endif
+
+    if (sws_init_context(ctx, NULL, NULL) < 0) {
+        LOGE("Could not initialize frame conversion from %s to %s",
+             av_get_pix_fmt_name(frame->format),
+             av_get_pix_fmt_name(fc->format));
+        sws_freeContext(ctx);
+        return NULL;
+    }
+
+    // Preserve the color range (the converted frame has the same properties
+    // as the source frame)
+    int range = fc->full_range ? 1 : 0;
+    const int *coefs = sws_getCoefficients(SWS_CS_DEFAULT);
+    sws_setColorspaceDetails(ctx, coefs, range, coefs, range, 0, 1 << 16,
+                             1 << 16);
+
+    return ctx;
+}
+
+bool
+sc_frame_converter_init(struct sc_frame_converter *fc,
+                        enum AVPixelFormat format) {
+    fc->frame = av_frame_alloc();
+    if (!fc->frame) {
+        LOG_OOM();
+        return false;
+    }
+
+    fc->format = format;
+    fc->sws_ctx = NULL;
+    fc->input_format = AV_PIX_FMT_NONE;
+    fc->width = 0;
+    fc->height = 0;
+    fc->output_width = 0;
+    fc->output_height = 0;
+    fc->full_range = false;
+
+    return true;
+}
+
+void
+sc_frame_converter_destroy(struct sc_frame_converter *fc) {
+    sws_freeContext(fc->sws_ctx);
+    av_frame_free(&fc->frame);
+}
+
+const AVFrame *
+sc_frame_converter_convert(struct sc_frame_converter *fc,
+                           const AVFrame *frame) {
+    assert(frame->format != fc->format);
+    return sc_frame_converter_scale(fc, frame, frame->width, frame->height);
+}
+
+const AVFrame *
+sc_frame_converter_scale(struct sc_frame_converter *fc, const AVFrame *frame,
+                         int width, int height) {
+    assert(width > 0 && height > 0);
+
+    bool full_range = sc_frame_converter_is_full_range(frame);
+    if (!fc->sws_ctx
+            || frame->format != fc->input_format
+            || frame->width != fc->width
+            || frame->height != fc->height
+            || width != fc->output_width
+            || height != fc->output_height
+            || full_range != fc->full_range) {
+        bool format_changed = frame->format != fc->input_format;
+
+        fc->full_range = full_range;
+        sws_freeContext(fc->sws_ctx);
+        fc->sws_ctx =
+            sc_frame_converter_create_sws_context(fc, frame, width, height);
+        if (!fc->sws_ctx) {
+            return NULL;
+        }
+
+        fc->input_format = frame->format;
+        fc->width = frame->width;
+        fc->height = frame->height;
+        fc->output_width = width;
+        fc->output_height = height;
+
+        if (format_changed && frame->format != fc->format) {
+            LOGI("Converting video frames from %s to %s",
+                 av_get_pix_fmt_name(frame->format),
+                 av_get_pix_fmt_name(fc->format));
+        }
+        if (width != frame->width || height != frame->height) {
+            LOGD("Scaling video frames from %dx%d to %dx%d", frame->width,
+                 frame->height, width, height);
+        }
+    }
+
+    // The previous frame may still be referenced by the consumer, so a new
+    // buffer is allocated for each frame
+    AVFrame *out = fc->frame;
+    av_frame_unref(out);
+    out->format = fc->format;
+    out->width = width;
+    out->height = height;
+
+    int r = av_frame_get_buffer(out, 0);
+    if (r < 0) {
+        LOG_OOM();
+        return NULL;
+    }
+
+#ifdef SCRCPY_LSWS_HAS_SCALE_FRAME
+    r = sws_scale_frame(fc->sws_ctx, out, frame);
+#else
+    r = sws_scale(fc->sws_ctx, (const uint8_t *const *) frame->data,
+                  frame->linesize, 0, frame->height, out->data, out->linesize);
+#endif
+    if (r < 0) {
+        LOGE("Could not convert frame: %d", r);
+        av_frame_unref(out);
+        return NULL;
+    }
+
+    r = av_frame_copy_props(out, frame);
+    if (r < 0) {
+        LOGE("Could not copy frame properties: %d", r);
+        av_frame_unref(out);
+        return NULL;
+    }
+
+    if (full_range) {
+        out->color_range = AVCOL_RANGE_JPEG;
+    }
+
+    return out;
+}
@@ -0,0 +1,67 @@
+#ifndef SC_FRAME_CONVERTER_H
+#define SC_FRAME_CONVERTER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+
+// forward declarations
+struct SwsContext;
+
+/**
+ * A frame converter converts video frames to a given pixel format, for the
+ * frame sinks which do not support the pixel format produced by the decoder.
+ *
+ * It may also scale the frames, for example to avoid uploading a frame much
+ * larger than the area where it is rendered.
+ *
+ * The conversion is executed by libswscale (on several threads if
+ * supported), from the thread calling sc_frame_converter_convert().
+ */
+struct sc_frame_converter {
+    enum AVPixelFormat format; // the output pixel format
+
+    struct SwsContext *sws_ctx;
+    // The properties sws_ctx has been initialized for
+    enum AVPixelFormat input_format;
+    int width;
+    int height;
+    int output_width;
+    int output_height;
+    bool full_range;
+
+    AVFrame *frame; // the last converted frame
+};
+
+bool
+sc_frame_converter_init(struct sc_frame_converter *fc,
+                        enum AVPixelFormat format);
+
+void
+sc_frame_converter_destroy(struct sc_frame_converter *fc);
+
+/**
+ * Convert a frame to the output pixel format
+ *
+ * The returned frame is owned by the converter, it is valid until the next
+ * call. The caller may reference it (av_frame_ref()).
+ *
+ * Return NULL on error.
+ */
+const AVFrame *
+sc_frame_converter_convert(struct sc_frame_converter *fc,
+                           const AVFrame *frame);
+
+/**
+ * Convert a frame to the output pixel format, and scale it to the given size
+ *
+ * Same as sc_frame_converter_convert(), except that the input pixel format may
+ * be the same as the output pixel format.
+ */
+const AVFrame *
+sc_frame_converter_scale(struct sc_frame_converter *fc, const AVFrame *frame,
+                         int width, int height);
+
+#endif
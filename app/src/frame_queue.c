@@ -0,0 +1,226 @@
+#include "frame_queue.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <libavutil/frame.h>
+
+#include "util/log.h"
+
+/** Downcast frame_sink to sc_frame_queue */
+#define DOWNCAST(SINK) container_of(SINK, struct sc_frame_queue, frame_sink)
+
+static void
+sc_frame_queue_drop_frame(struct sc_frame_queue *fq) {
+    // The mutex must be locked
+    assert(!sc_vecdeque_is_empty(&fq->queue));
+
+    AVFrame *frame = sc_vecdeque_pop(&fq->queue);
+    av_frame_free(&frame);
+    ++fq->stats.dropped;
+}
+
+static int
+run_frame_queue(void *data) {
+    struct sc_frame_queue *fq = data;
+
+    for (;;) {
+        sc_mutex_lock(&fq->mutex);
+
+        while (!fq->stopped && sc_vecdeque_is_empty(&fq->queue)) {
+            sc_cond_wait(&fq->queue_cond, &fq->mutex);
+        }
+
+        if (fq->stopped) {
+            sc_mutex_unlock(&fq->mutex);
+            break;
+        }
+
+        AVFrame *frame = sc_vecdeque_pop(&fq->queue);
+        sc_cond_signal(&fq->space_cond);
+        sc_mutex_unlock(&fq->mutex);
+
+        bool ok = sc_frame_source_sinks_push(&fq->frame_source, frame);
+        av_frame_free(&frame);
+        if (!ok) {
+            LOGE("Frame queue '%s': frame could not be pushed, stopping",
+                 fq->name);
+            sc_mutex_lock(&fq->mutex);
+            // Prevent to push any new frame
+            fq->stopped = true;
+            sc_cond_signal(&fq->space_cond);
+            sc_mutex_unlock(&fq->mutex);
+            break;
+        }
+    }
+
+    LOGD("Frame queue '%s': thread ended", fq->name);
+
+    return 0;
+}
+
+static bool
+sc_frame_queue_frame_sink_open(struct sc_frame_sink *sink,
+                               const AVCodecContext *ctx) {
+    struct sc_frame_queue *fq = DOWNCAST(sink);
+
+    bool ok = sc_mutex_init(&fq->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&fq->queue_cond);
+    if (!ok) {
+        goto error_destroy_mutex;
+    }
+
+    ok = sc_cond_init(&fq->space_cond);
+    if (!ok) {
+        goto error_destroy_queue_cond;
+    }
+
+    sc_vecdeque_init(&fq->queue);
+    // Allocate the whole capacity once, the queue never grows
+    ok = sc_vecdeque_reserve(&fq->queue, fq->capacity);
+    if (!ok) {
+        LOG_OOM();
+        goto error_destroy_space_cond;
+    }
+
+    fq->stopped = false;
+    fq->stats.depth = 0;
+    fq->stats.max_depth = 0;
+    fq->stats.pushed = 0;
+    fq->stats.dropped = 0;
+
+    if (!sc_frame_source_sinks_open(&fq->frame_source, ctx)) {
+        goto error_destroy_queue;
+    }
+
+    ok = sc_thread_create(&fq->thread, run_frame_queue, "scrcpy-fqueue", fq);
+    if (!ok) {
+        LOGE("Frame queue '%s': could not start thread", fq->name);
+        goto error_close_sinks;
+    }
+
+    return true;
+
+error_close_sinks:
+    sc_frame_source_sinks_close(&fq->frame_source);
+error_destroy_queue:
+    sc_vecdeque_destroy(&fq->queue);
+error_destroy_space_cond:
+    sc_cond_destroy(&fq->space_cond);
+error_destroy_queue_cond:
+    sc_cond_destroy(&fq->queue_cond);
+error_destroy_mutex:
+    sc_mutex_destroy(&fq->mutex);
+
+    return false;
+}
+
+static void
+sc_frame_queue_frame_sink_close(struct sc_frame_sink *sink) {
+    struct sc_frame_queue *fq = DOWNCAST(sink);
+
+    sc_mutex_lock(&fq->mutex);
+    fq->stopped = true;
+    sc_cond_signal(&fq->queue_cond);
+    sc_cond_signal(&fq->space_cond);
+    sc_mutex_unlock(&fq->mutex);
+
+    sc_thread_join(&fq->thread, NULL);
+
+    sc_frame_source_sinks_close(&fq->frame_source);
+
+    // Drop the frames not consumed by the sinks
+    while (!sc_vecdeque_is_empty(&fq->queue)) {
+        AVFrame *frame = sc_vecdeque_pop(&fq->queue);
+        av_frame_free(&frame);
+    }
+
+    LOGI("Frame queue '%s': %" PRIu64 " frames pushed, %" PRIu64 " dropped"
+         " (max depth %" SC_PRIsizet ")", fq->name, fq->stats.pushed,
+         fq->stats.dropped, fq->stats.max_depth);
+
+    sc_vecdeque_destroy(&fq->queue);
+    sc_cond_destroy(&fq->space_cond);
+    sc_cond_destroy(&fq->queue_cond);
+    sc_mutex_destroy(&fq->mutex);
+}
+
+static bool
+sc_frame_queue_frame_sink_push(struct sc_frame_sink *sink,
+                               const AVFrame *frame) {
+    struct sc_frame_queue *fq = DOWNCAST(sink);
+
+    // Reference the frame before locking
+    AVFrame *ref = av_frame_clone(frame);
+    if (!ref) {
+        LOG_OOM();
+        return false;
+    }
+
+    sc_mutex_lock(&fq->mutex);
+
+    if (fq->policy == SC_FRAME_QUEUE_POLICY_BLOCK) {
+        while (!fq->stopped
+                && sc_vecdeque_size(&fq->queue) >= fq->capacity) {
+            sc_cond_wait(&fq->space_cond, &fq->mutex);
+        }
+    }
+
+    if (fq->stopped) {
+        sc_mutex_unlock(&fq->mutex);
+        av_frame_free(&ref);
+        return false;
+    }
+
+    if (sc_vecdeque_size(&fq->queue) >= fq->capacity) {
+        assert(fq->policy == SC_FRAME_QUEUE_POLICY_KEEP_LATEST);
+        sc_frame_queue_drop_frame(fq);
+    }
+
+    // The capacity has been reserved on open
+    sc_vecdeque_push_noresize(&fq->queue, ref);
+    ++fq->stats.pushed;
+
+    size_t depth = sc_vecdeque_size(&fq->queue);
+    if (depth > fq->stats.max_depth) {
+        fq->stats.max_depth = depth;
+    }
+
+    sc_cond_signal(&fq->queue_cond);
+
+    sc_mutex_unlock(&fq->mutex);
+
+    return true;
+}
+
+void
+sc_frame_queue_init(struct sc_frame_queue *fq, const char *name,
+                    size_t capacity, enum sc_frame_queue_policy policy) {
+    assert(capacity > 0);
+
+    fq->name = name; // statically allocated
+    fq->capacity = capacity;
+    fq->policy = policy;
+
+    sc_frame_source_init(&fq->frame_source);
+
+    static const struct sc_frame_sink_ops ops = {
+        .open = sc_frame_queue_frame_sink_open,
+        .close = sc_frame_queue_frame_sink_close,
+        .push = sc_frame_queue_frame_sink_push,
+    };
+
+    fq->frame_sink.ops = &ops;
+}
+
+void
+sc_frame_queue_get_stats(struct sc_frame_queue *fq,
+                         struct sc_frame_queue_stats *stats) {
+    sc_mutex_lock(&fq->mutex);
+    *stats = fq->stats;
+    stats->depth = sc_vecdeque_size(&fq->queue);
+    sc_mutex_unlock(&fq->mutex);
+}
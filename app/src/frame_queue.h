@@ -0,0 +1,73 @@
+#ifndef SC_FRAME_QUEUE_H
+#define SC_FRAME_QUEUE_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frame_queue_policy.h"
+#include "trait/frame_source.h"
+#include "trait/frame_sink.h"
+#include "util/thread.h"
+#include "util/vecdeque.h"
+
+// forward declarations
+typedef struct AVFrame AVFrame;
+
+struct sc_frame_queue_stats {
+    size_t depth; // number of frames currently queued
+    size_t max_depth;
+    uint64_t pushed;
+    uint64_t dropped;
+};
+
+struct sc_queued_frame_queue SC_VECDEQUE(AVFrame *);
+
+/**
+ * A frame queue forwards the frames to its sinks from a separate thread.
+ *
+ * It decouples the sinks from the frame source thread (typically the
+ * decoder): a slow sink does not delay the other sinks of the same source.
+ */
+struct sc_frame_queue {
+    struct sc_frame_source frame_source; // frame source trait
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    const char *name; // must be statically allocated (e.g. a string literal)
+    size_t capacity;
+    enum sc_frame_queue_policy policy;
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond queue_cond; // signaled when a frame is queued
+    sc_cond space_cond; // signaled when a frame is dequeued
+
+    struct sc_queued_frame_queue queue;
+    bool stopped;
+
+    struct sc_frame_queue_stats stats;
+};
+
+/**
+ * Initialize a frame queue.
+ *
+ * \param name a statically allocated name, for logging
+ * \param capacity the maximum number of queued frames (strictly positive)
+ * \param policy the behavior when the queue is full
+ */
+void
+sc_frame_queue_init(struct sc_frame_queue *fq, const char *name,
+                    size_t capacity, enum sc_frame_queue_policy policy);
+
+/**
+ * Get the current statistics
+ *
+ * This function may be called from any thread while the frame queue is open.
+ */
+void
+sc_frame_queue_get_stats(struct sc_frame_queue *fq,
+                         struct sc_frame_queue_stats *stats);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef SC_FRAME_QUEUE_POLICY_H
+#define SC_FRAME_QUEUE_POLICY_H
+
+#include "common.h"
+
+enum sc_frame_queue_policy {
+    // If the queue is full, drop the oldest frame (only the latest frames are
+    // kept)
+    SC_FRAME_QUEUE_POLICY_KEEP_LATEST,
+    // If the queue is full, wait until the sinks consume a frame
+    SC_FRAME_QUEUE_POLICY_BLOCK,
+};
+
+#endif
@@ -0,0 +1,476 @@
+#include "frame_scheduler.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <libavcodec/avcodec.h>
+
+#include "util/log.h"
+
+/** Downcast frame_sink to sc_frame_scheduler */
+#define DOWNCAST(SINK) container_of(SINK, struct sc_frame_scheduler, frame_sink)
+
+#define SC_FRAME_SCHEDULER_DEFAULT_REFRESH_RATE 60
+
+static bool
+sc_scheduled_frame_init(struct sc_scheduled_frame *sframe,
+                        const AVFrame *frame) {
+    sframe->frame = av_frame_alloc();
+    if (!sframe->frame) {
+        LOG_OOM();
+        return false;
+    }
+
+    if (av_frame_ref(sframe->frame, frame)) {
+        LOG_OOM();
+        av_frame_free(&sframe->frame);
+        return false;
+    }
+
+    return true;
+}
+
+static void
+sc_scheduled_frame_destroy(struct sc_scheduled_frame *sframe) {
+    av_frame_unref(sframe->frame);
+    av_frame_free(&sframe->frame);
+}
+
+// Return the next vsync for which a frame may still be rendered in time
+static sc_tick
+sc_frame_scheduler_next_vsync(struct sc_frame_scheduler *fs, sc_tick now) {
+    sc_tick interval = fs->refresh_interval;
+
+    // Leave half a refresh interval to upload and render the frame
+    sc_tick min_vsync = now + interval / 2;
+
+    sc_tick vsync;
+    if (fs->vsync_date) {
+        // Align on the refresh cycle
+        sc_tick elapsed = min_vsync - fs->vsync_date;
+        sc_tick count = elapsed > 0 ? (elapsed + interval - 1) / interval : 0;
+        vsync = fs->vsync_date + count * interval;
+    } else {
+        // The phase is unknown until the first presentation
+        vsync = min_vsync;
+    }
+
+    if (vsync <= fs->last_vsync) {
+        vsync = fs->last_vsync + interval;
+    }
+
+    return vsync;
+}
+
+// Return the date from which the frame may be presented
+static sc_tick
+sc_frame_scheduler_get_ready_date(struct sc_frame_scheduler *fs,
+                                  const struct sc_scheduled_frame *sframe) {
+    sc_tick interval = fs->refresh_interval;
+
+    // PTS (written by the server) are expressed in microseconds
+    sc_tick pts = SC_TICK_FROM_US(sframe->frame->pts);
+    sc_tick expected = sc_clock_to_system_time(&fs->clock, pts);
+
+    // The frames are presented at the pace of their PTS rather than at the
+    // pace of the network jitter: a frame is scheduled for the first vsync
+    // following its expected date, so it is presented at most one refresh
+    // interval after its expected date.
+    sc_tick date = expected;
+
+    if (fs->anchor.valid) {
+        // The clock estimation fluctuates slightly, so a frame expected close
+        // to a vsync boundary could alternate between two vsyncs. To keep a
+        // steady cadence, schedule the frame relative to the vsync of the
+        // previous frame, as long as it does not deviate from its expected
+        // date by more than half a refresh interval.
+        sc_tick cadence_date = fs->anchor.vsync + pts - fs->anchor.pts;
+        if (cadence_date >= date - interval / 2
+                && cadence_date <= date + interval / 2) {
+            // Keep a margin for the vsync dates inaccuracy
+            date = cadence_date - interval / 4;
+        }
+    }
+
+    return date;
+}
+
+// Queue a frame received at the given date
+//
+// The mutex must be locked.
+static bool
+sc_frame_scheduler_enqueue(struct sc_frame_scheduler *fs,
+                           struct sc_scheduled_frame *sframe, sc_tick date) {
+    sframe->push_date = date;
+
+    sc_tick pts = SC_TICK_FROM_US(sframe->frame->pts);
+    sc_clock_update(&fs->clock, date, pts);
+
+    if (sc_vecdeque_size(&fs->queue) >= SC_FRAME_SCHEDULER_QUEUE_CAPACITY) {
+        // The frames are not consumed, drop the oldest one
+        struct sc_scheduled_frame *oldest = sc_vecdeque_popref(&fs->queue);
+        sc_scheduled_frame_destroy(oldest);
+        ++fs->stats.dropped;
+    }
+
+    bool ok = sc_vecdeque_push(&fs->queue, *sframe);
+    if (!ok) {
+        LOG_OOM();
+        return false;
+    }
+
+    return true;
+}
+
+// Select the most recent frame ready for the vsync
+//
+// The mutex must be locked.
+static bool
+sc_frame_scheduler_select(struct sc_frame_scheduler *fs, sc_tick vsync,
+                          struct sc_scheduled_frame *selected) {
+    fs->last_vsync = vsync;
+
+    bool has_selected = false;
+    while (!sc_vecdeque_is_empty(&fs->queue)) {
+        struct sc_scheduled_frame *sframe = sc_vecdeque_peekref(&fs->queue);
+        if (sc_frame_scheduler_get_ready_date(fs, sframe) > vsync) {
+            break;
+        }
+
+        if (has_selected) {
+            // Superseded by a more recent frame
+            sc_scheduled_frame_destroy(selected);
+            ++fs->stats.dropped;
+        }
+        *selected = sc_vecdeque_pop(&fs->queue);
+        has_selected = true;
+    }
+
+    if (!has_selected) {
+        return false;
+    }
+
+    if (fs->forwarded.pending) {
+        // The previous frame has never been presented
+        ++fs->stats.missed_vsyncs;
+    }
+    fs->forwarded.pending = true;
+    fs->forwarded.pts = selected->frame->pts;
+    fs->forwarded.push_date = selected->push_date;
+    fs->forwarded.vsync = vsync;
+
+    fs->anchor.valid = true;
+    fs->anchor.pts = SC_TICK_FROM_US(selected->frame->pts);
+    fs->anchor.vsync = vsync;
+
+    return true;
+}
+
+static void
+sc_frame_scheduler_flush(struct sc_frame_scheduler *fs) {
+    while (!sc_vecdeque_is_empty(&fs->queue)) {
+        struct sc_scheduled_frame *sframe = sc_vecdeque_popref(&fs->queue);
+        sc_scheduled_frame_destroy(sframe);
+    }
+}
+
+static int
+run_frame_scheduler(void *data) {
+    struct sc_frame_scheduler *fs = data;
+
+    for (;;) {
+        sc_mutex_lock(&fs->mutex);
+
+        while (!fs->stopped && sc_vecdeque_is_empty(&fs->queue)) {
+            sc_cond_wait(&fs->queue_cond, &fs->mutex);
+        }
+
+        if (fs->stopped) {
+            sc_mutex_unlock(&fs->mutex);
+            goto stopped;
+        }
+
+        sc_tick vsync = sc_frame_scheduler_next_vsync(fs, sc_tick_now());
+        sc_tick deadline = vsync - fs->refresh_interval / 2;
+
+        bool timed_out = false;
+        while (!fs->stopped && !timed_out) {
+            timed_out =
+                !sc_cond_timedwait(&fs->wait_cond, &fs->mutex, deadline);
+        }
+
+        if (fs->stopped) {
+            sc_mutex_unlock(&fs->mutex);
+            goto stopped;
+        }
+
+        struct sc_scheduled_frame selected;
+        bool has_selected = sc_frame_scheduler_select(fs, vsync, &selected);
+
+        sc_mutex_unlock(&fs->mutex);
+
+        if (!has_selected) {
+            continue;
+        }
+
+        bool ok = sc_frame_source_sinks_push(&fs->frame_source,
+                                             selected.frame);
+        sc_scheduled_frame_destroy(&selected);
+        if (!ok) {
+            LOGE("Scheduled frame could not be pushed, stopping");
+            sc_mutex_lock(&fs->mutex);
+            // Prevent to push any new frame
+            fs->stopped = true;
+            sc_mutex_unlock(&fs->mutex);
+            goto stopped;
+        }
+    }
+
+stopped:
+    assert(fs->stopped);
+
+    sc_mutex_lock(&fs->mutex);
+    sc_frame_scheduler_flush(fs);
+    sc_mutex_unlock(&fs->mutex);
+
+    LOGD("Frame scheduler thread ended");
+
+    return 0;
+}
+
+static void
+sc_frame_scheduler_log_stats(struct sc_frame_scheduler *fs) {
+    sc_mutex_lock(&fs->mutex);
+    struct sc_frame_scheduler_stats stats = fs->stats;
+    sc_mutex_unlock(&fs->mutex);
+
+    if (!stats.presented) {
+        return;
+    }
+
+    LOGI("Frame scheduler: %" PRIu64 " frames presented, %" PRIu64 " dropped, "
+         "%" PRIu64 " missed vsyncs, latency avg=%.1f ms max=%.1f ms",
+         stats.presented, stats.dropped, stats.missed_vsyncs,
+         (double) stats.total_latency / stats.presented / 1000,
+         (double) stats.max_latency / 1000);
+}
+
+static bool
+sc_frame_scheduler_frame_sink_open(struct sc_frame_sink *sink,
+                                   const AVCodecContext *ctx) {
+    struct sc_frame_scheduler *fs = DOWNCAST(sink);
+
+    if (!sc_frame_source_sinks_open(&fs->frame_source, ctx)) {
+        return false;
+    }
+
+    bool ok = sc_thread_create(&fs->thread, run_frame_scheduler,
+                               "scrcpy-sched", fs);
+    if (!ok) {
+        LOGE("Could not start frame scheduler thread");
+        sc_frame_source_sinks_close(&fs->frame_source);
+        return false;
+    }
+
+    return true;
+}
+
+static void
+sc_frame_scheduler_frame_sink_close(struct sc_frame_sink *sink) {
+    struct sc_frame_scheduler *fs = DOWNCAST(sink);
+
+    sc_mutex_lock(&fs->mutex);
+    fs->stopped = true;
+    sc_cond_signal(&fs->queue_cond);
+    sc_cond_signal(&fs->wait_cond);
+    sc_mutex_unlock(&fs->mutex);
+
+    sc_thread_join(&fs->thread, NULL);
+
+    sc_frame_source_sinks_close(&fs->frame_source);
+
+    sc_frame_scheduler_log_stats(fs);
+}
+
+static bool
+sc_frame_scheduler_frame_sink_push(struct sc_frame_sink *sink,
+                                   const AVFrame *frame) {
+    struct sc_frame_scheduler *fs = DOWNCAST(sink);
+
+    struct sc_scheduled_frame sframe;
+    bool ok = sc_scheduled_frame_init(&sframe, frame);
+    if (!ok) {
+        return false;
+    }
+
+    sc_mutex_lock(&fs->mutex);
+
+    if (fs->stopped) {
+        sc_mutex_unlock(&fs->mutex);
+        sc_scheduled_frame_destroy(&sframe);
+        return false;
+    }
+
+    ok = sc_frame_scheduler_enqueue(fs, &sframe, sc_tick_now());
+    if (!ok) {
+        sc_mutex_unlock(&fs->mutex);
+        sc_scheduled_frame_destroy(&sframe);
+        return false;
+    }
+
+    sc_cond_signal(&fs->queue_cond);
+
+    sc_mutex_unlock(&fs->mutex);
+
+    return true;
+}
+
+bool
+sc_frame_scheduler_init(struct sc_frame_scheduler *fs) {
+    // The mutex is initialized here rather than on open, because the screen
+    // may report the refresh rate before the stream starts
+    bool ok = sc_mutex_init(&fs->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&fs->queue_cond);
+    if (!ok) {
+        goto error_destroy_mutex;
+    }
+
+    ok = sc_cond_init(&fs->wait_cond);
+    if (!ok) {
+        goto error_destroy_queue_cond;
+    }
+
+    fs->refresh_interval =
+        SC_TICK_FREQ / SC_FRAME_SCHEDULER_DEFAULT_REFRESH_RATE;
+    fs->vsync_date = 0;
+    fs->last_vsync = 0;
+    fs->forwarded.pending = false;
+    fs->anchor.valid = false;
+
+    sc_clock_init(&fs->clock);
+    sc_vecdeque_init(&fs->queue);
+    fs->stopped = false;
+
+    fs->stats.presented = 0;
+    fs->stats.dropped = 0;
+    fs->stats.missed_vsyncs = 0;
+    fs->stats.total_latency = 0;
+    fs->stats.max_latency = 0;
+
+    sc_frame_source_init(&fs->frame_source);
+
+    static const struct sc_frame_sink_ops ops = {
+        .open = sc_frame_scheduler_frame_sink_open,
+        .close = sc_frame_scheduler_frame_sink_close,
+        .push = sc_frame_scheduler_frame_sink_push,
+    };
+
+    fs->frame_sink.ops = &ops;
+
+    return true;
+
+error_destroy_queue_cond:
+    sc_cond_destroy(&fs->queue_cond);
+error_destroy_mutex:
+    sc_mutex_destroy(&fs->mutex);
+
+    return false;
+}
+
+void
+sc_frame_scheduler_destroy(struct sc_frame_scheduler *fs) {
+    // Already flushed by the thread if the frame sink has been open
+    sc_frame_scheduler_flush(fs);
+    sc_vecdeque_destroy(&fs->queue);
+    sc_cond_destroy(&fs->wait_cond);
+    sc_cond_destroy(&fs->queue_cond);
+    sc_mutex_destroy(&fs->mutex);
+}
+
+void
+sc_frame_scheduler_set_refresh_rate(struct sc_frame_scheduler *fs,
+                                    int refresh_rate) {
+    if (refresh_rate <= 0) {
+        refresh_rate = SC_FRAME_SCHEDULER_DEFAULT_REFRESH_RATE;
+    }
+
+    sc_mutex_lock(&fs->mutex);
+    sc_tick interval = SC_TICK_FREQ / refresh_rate;
+    if (interval != fs->refresh_interval) {
+        LOGD("Frame scheduler: refresh rate %d Hz", refresh_rate);
+        fs->refresh_interval = interval;
+    }
+    sc_mutex_unlock(&fs->mutex);
+}
+
+void
+sc_frame_scheduler_on_present(struct sc_frame_scheduler *fs, int64_t pts,
+                              sc_tick date) {
+    sc_mutex_lock(&fs->mutex);
+
+    // With vsync enabled, the presentation completes on a vsync
+    fs->vsync_date = date;
+
+    if (fs->forwarded.pending && fs->forwarded.pts == pts) {
+        fs->forwarded.pending = false;
+
+        struct sc_frame_scheduler_stats *stats = &fs->stats;
+        ++stats->presented;
+
+        sc_tick latency = date - fs->forwarded.push_date;
+        stats->total_latency += latency;
+        if (latency > stats->max_latency) {
+            stats->max_latency = latency;
+        }
+
+        if (date > fs->forwarded.vsync + fs->refresh_interval / 2) {
+            // Presented on a later vsync than scheduled
+            ++stats->missed_vsyncs;
+        }
+    }
+
+    sc_mutex_unlock(&fs->mutex);
+}
+
+#ifdef SC_TEST
+bool
+sc_frame_scheduler_push_at(struct sc_frame_scheduler *fs, const AVFrame *frame,
+                           sc_tick date) {
+    struct sc_scheduled_frame sframe;
+    bool ok = sc_scheduled_frame_init(&sframe, frame);
+    if (!ok) {
+        return false;
+    }
+
+    sc_mutex_lock(&fs->mutex);
+    ok = sc_frame_scheduler_enqueue(fs, &sframe, date);
+    sc_mutex_unlock(&fs->mutex);
+
+    if (!ok) {
+        sc_scheduled_frame_destroy(&sframe);
+    }
+
+    return ok;
+}
+
+sc_tick
+sc_frame_scheduler_next_vsync_at(struct sc_frame_scheduler *fs, sc_tick now) {
+    sc_mutex_lock(&fs->mutex);
+    sc_tick vsync = sc_frame_scheduler_next_vsync(fs, now);
+    sc_mutex_unlock(&fs->mutex);
+    return vsync;
+}
+
+AVFrame *
+sc_frame_scheduler_select_at(struct sc_frame_scheduler *fs, sc_tick vsync) {
+    sc_mutex_lock(&fs->mutex);
+    struct sc_scheduled_frame selected;
+    bool has_selected = sc_frame_scheduler_select(fs, vsync, &selected);
+    sc_mutex_unlock(&fs->mutex);
+
+    return has_selected ? selected.frame : NULL;
+}
+#endif
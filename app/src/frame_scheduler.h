@@ -0,0 +1,130 @@
+#ifndef SC_FRAME_SCHEDULER_H
+#define SC_FRAME_SCHEDULER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "clock.h"
+#include "trait/frame_source.h"
+#include "trait/frame_sink.h"
+#include "util/thread.h"
+#include "util/tick.h"
+#include "util/vecdeque.h"
+
+// forward declarations
+typedef struct AVFrame AVFrame;
+
+struct sc_scheduled_frame {
+    AVFrame *frame;
+    sc_tick push_date;
+};
+
+struct sc_scheduled_frame_queue SC_VECDEQUE(struct sc_scheduled_frame);
+
+// Maximum number of frames waiting for their vsync (the oldest frame is
+// dropped if the queue is full)
+#define SC_FRAME_SCHEDULER_QUEUE_CAPACITY 16
+
+struct sc_frame_scheduler_stats {
+    uint64_t presented;
+    // superseded by a more recent frame before a vsync (or dropped because
+    // the queue was full)
+    uint64_t dropped;
+    uint64_t missed_vsyncs; // presented after the vsync they were scheduled for
+    // Delay between the reception of a frame and its presentation
+    sc_tick total_latency;
+    sc_tick max_latency;
+};
+
+/**
+ * A frame scheduler forwards the frames to its sinks in sync with the display
+ * refresh.
+ *
+ * Without scheduling, a frame is presented as soon as it is received, so the
+ * frame pacing follows the network jitter.
+ *
+ * Instead, the scheduler estimates the reception date of each frame from its
+ * PTS (see sc_clock), and forwards the most recent frame expected before each
+ * vsync, slightly ahead of the vsync so that it can be rendered in time. A
+ * frame is presented at most one refresh interval after its expected date.
+ *
+ * The sink (the screen) reports the refresh rate of the display, and the date
+ * of each presentation (with vsync enabled, a presentation completes on a
+ * vsync, which gives the phase of the refresh cycle).
+ */
+struct sc_frame_scheduler {
+    struct sc_frame_source frame_source; // frame source trait
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond queue_cond;
+    sc_cond wait_cond;
+
+    struct sc_clock clock;
+    struct sc_scheduled_frame_queue queue;
+    bool stopped;
+
+    sc_tick refresh_interval;
+    sc_tick vsync_date; // the date of a past vsync (0 if unknown)
+    sc_tick last_vsync; // the last vsync a frame was scheduled for
+
+    // The last frame forwarded, until its presentation is reported
+    struct {
+        bool pending;
+        int64_t pts;
+        sc_tick push_date;
+        sc_tick vsync; // the vsync it has been scheduled for
+    } forwarded;
+
+    // The last frame scheduled, to keep a steady cadence
+    struct {
+        bool valid;
+        sc_tick pts;
+        sc_tick vsync;
+    } anchor;
+
+    struct sc_frame_scheduler_stats stats;
+};
+
+bool
+sc_frame_scheduler_init(struct sc_frame_scheduler *fs);
+
+void
+sc_frame_scheduler_destroy(struct sc_frame_scheduler *fs);
+
+/**
+ * Set the refresh rate of the display (in Hz)
+ *
+ * If the value is unknown (0), a refresh rate of 60 Hz is assumed.
+ */
+void
+sc_frame_scheduler_set_refresh_rate(struct sc_frame_scheduler *fs,
+                                    int refresh_rate);
+
+/**
+ * Report that the frame having the given PTS has been presented at the given
+ * date
+ */
+void
+sc_frame_scheduler_on_present(struct sc_frame_scheduler *fs, int64_t pts,
+                              sc_tick date);
+
+#ifdef SC_TEST
+// expose the scheduling steps to unit-tests, with explicit dates (the frame
+// sink must not be open)
+bool
+sc_frame_scheduler_push_at(struct sc_frame_scheduler *fs, const AVFrame *frame,
+                           sc_tick date);
+
+sc_tick
+sc_frame_scheduler_next_vsync_at(struct sc_frame_scheduler *fs, sc_tick now);
+
+// Return the frame selected for the vsync (to be freed by the caller), or NULL
+AVFrame *
+sc_frame_scheduler_select_at(struct sc_frame_scheduler *fs, sc_tick vsync);
+#endif
+
+#endif
@@ -0,0 +1,84 @@
+#include "frame_slot.h"
+
+#include <assert.h>
+
+#include "util/log.h"
+
+#define SC_FRAME_SLOT_FLAG_NEW 4
+
+bool
+sc_frame_slot_init(struct sc_frame_slot *slot) {
+    for (unsigned i = 0; i < 3; ++i) {
+        slot->frames[i] = av_frame_alloc();
+        if (!slot->frames[i]) {
+            LOG_OOM();
+            while (i--) {
+                av_frame_free(&slot->frames[i]);
+            }
+            return false;
+        }
+    }
+
+    slot->back = 0;
+    slot->front = 1;
+    // there is initially no frame, so consider it has already been consumed
+    atomic_init(&slot->middle, 2);
+
+    return true;
+}
+
+void
+sc_frame_slot_destroy(struct sc_frame_slot *slot) {
+    for (unsigned i = 0; i < 3; ++i) {
+        av_frame_free(&slot->frames[i]);
+    }
+}
+
+bool
+sc_frame_slot_push(struct sc_frame_slot *slot, const AVFrame *frame,
+                   bool *previous_frame_skipped) {
+    AVFrame *back = slot->frames[slot->back];
+    // The back frame may contain a frame which has been skipped
+    av_frame_unref(back);
+
+    int r = av_frame_ref(back, frame);
+    if (r) {
+        LOGE("Could not ref frame: %d", r);
+        return false;
+    }
+
+    // Publish the back frame (the release ordering makes the frame content
+    // visible to the consumer), and retrieve the previous middle frame
+    unsigned prev = atomic_exchange_explicit(&slot->middle,
+                                             slot->back | SC_FRAME_SLOT_FLAG_NEW,
+                                             memory_order_acq_rel);
+    slot->back = prev & ~SC_FRAME_SLOT_FLAG_NEW;
+
+    if (previous_frame_skipped) {
+        *previous_frame_skipped = prev & SC_FRAME_SLOT_FLAG_NEW;
+    }
+
+    return true;
+}
+
+const AVFrame *
+sc_frame_slot_consume(struct sc_frame_slot *slot) {
+    if (!sc_frame_slot_has_new_frame(slot)) {
+        return NULL;
+    }
+
+    // Only the consumer may reset the flag, so the middle frame is still new
+    unsigned prev = atomic_exchange_explicit(&slot->middle, slot->front,
+                                             memory_order_acq_rel);
+    assert(prev & SC_FRAME_SLOT_FLAG_NEW);
+    slot->front = prev & ~SC_FRAME_SLOT_FLAG_NEW;
+
+    return slot->frames[slot->front];
+}
+
+bool
+sc_frame_slot_has_new_frame(struct sc_frame_slot *slot) {
+    unsigned middle = atomic_load_explicit(&slot->middle,
+                                           memory_order_acquire);
+    return middle & SC_FRAME_SLOT_FLAG_NEW;
+}
@@ -0,0 +1,66 @@
+#ifndef SC_FRAME_SLOT_H
+#define SC_FRAME_SLOT_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <libavutil/frame.h>
+
+// forward declarations
+typedef struct AVFrame AVFrame;
+
+/**
+ * A frame slot holds the last frame received from a producer thread, until it
+ * is consumed by a consumer thread (like sc_frame_buffer).
+ *
+ * It is lock-free: the producer and the consumer never wait for each other.
+ *
+ * It is implemented as a triple buffer: the producer writes to its own frame,
+ * the consumer reads its own frame, and the third frame (the "middle" frame)
+ * is exchanged atomically by either side.
+ */
+struct sc_frame_slot {
+    AVFrame *frames[3];
+
+    unsigned back; // index of the producer frame (producer only)
+    unsigned front; // index of the consumer frame (consumer only)
+
+    // index of the middle frame, with SC_FRAME_SLOT_FLAG_NEW if it has not been
+    // consumed yet
+    atomic_uint middle;
+};
+
+bool
+sc_frame_slot_init(struct sc_frame_slot *slot);
+
+void
+sc_frame_slot_destroy(struct sc_frame_slot *slot);
+
+/**
+ * Push a new frame (called from the producer thread)
+ *
+ * If the previous frame has not been consumed, it is replaced, and
+ * previous_frame_skipped is set to true.
+ */
+bool
+sc_frame_slot_push(struct sc_frame_slot *slot, const AVFrame *frame,
+                   bool *previous_frame_skipped);
+
+/**
+ * Consume the last frame pushed (called from the consumer thread)
+ *
+ * Return NULL if no new frame has been pushed since the last call. Otherwise,
+ * the returned frame is owned by the slot, and it remains valid until the next
+ * call to sc_frame_slot_consume().
+ */
+const AVFrame *
+sc_frame_slot_consume(struct sc_frame_slot *slot);
+
+/**
+ * Indicate whether a new frame is available (may be called from any thread)
+ */
+bool
+sc_frame_slot_has_new_frame(struct sc_frame_slot *slot);
+
+#endif
@@ -1,6 +1,8 @@
 #include "common.h"
 
 #include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
 #ifdef HAVE_V4L2
 # include <libavdevice/avdevice.h>
 #endif
@@ -9,6 +11,9 @@
 
 #include "cli.h"
 #include "options.h"
+#ifdef HAVE_PCM_SINK
+# include "pcm_sink.h"
+#endif
 #include "scrcpy.h"
 #include "usb/scrcpy_otg.h"
 #include "util/log.h"
@@ -21,6 +26,30 @@
 #include "util/str.h"
 #endif
 
+#ifdef HAVE_PCM_SINK
+// Quickly detect whether stdout is reserved for the PCM stream, before the
+// arguments are parsed (so that the banner is not written to stdout)
+static bool
+is_pcm_sink_stdout_requested(int argc, char *argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (!strcmp(arg, "--")) {
+            // End of options
+            break;
+        }
+        if (!strcmp(arg, "--pcm-sink=" SC_PCM_SINK_STDOUT)) {
+            return true;
+        }
+        if (!strcmp(arg, "--pcm-sink") && i + 1 < argc
+                && !strcmp(argv[i + 1], SC_PCM_SINK_STDOUT)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+#endif
+
 static int
 main_scrcpy(int argc, char *argv[]) {
 #ifdef _WIN32
@@ -30,8 +59,16 @@ main_scrcpy(int argc, char *argv[]) {
     setbuf(stderr, NULL);
 #endif
 
-    printf("scrcpy " SCRCPY_VERSION
-           " <https://github.com/Genymobile/scrcpy>\n");
+    // The banner is printed first (even on parsing errors), but not to stdout
+    // if it is reserved for the PCM stream
+    bool pcm_stdout = false;
+#ifdef HAVE_PCM_SINK
+    pcm_stdout = is_pcm_sink_stdout_requested(argc, argv);
+#endif
+
+    fprintf(pcm_stdout ? stderr : stdout,
+            "scrcpy " SCRCPY_VERSION
+            " <https://github.com/Genymobile/scrcpy>\n");
 
     struct scrcpy_cli_args args = {
         .opts = scrcpy_options_default,
@@ -51,6 +88,13 @@ main_scrcpy(int argc, char *argv[]) {
         goto end;
     }
 
+    // stdout may be reserved for the PCM stream
+    bool stdout_reserved = false;
+#ifdef HAVE_PCM_SINK
+    stdout_reserved = args.opts.pcm_sink
+                   && !strcmp(args.opts.pcm_sink, SC_PCM_SINK_STDOUT);
+#endif
+
     sc_set_log_level(args.opts.log_level);
 
     if (args.help) {
@@ -83,7 +127,7 @@ main_scrcpy(int argc, char *argv[]) {
         goto end;
     }
 
-    sc_log_configure();
+    sc_log_configure(stdout_reserved);
 
 #ifdef HAVE_USB
     ret = args.opts.otg ? scrcpy_otg(&args.opts) : scrcpy(&args.opts);
@@ -95,7 +139,7 @@ end:
     if (args.pause_on_exit == SC_PAUSE_ON_EXIT_TRUE ||
             (args.pause_on_exit == SC_PAUSE_ON_EXIT_IF_ERROR &&
                 ret != SCRCPY_EXIT_SUCCESS)) {
-        printf("Press Enter to continue...\n");
+        fprintf(pcm_stdout ? stderr : stdout, "Press Enter to continue...\n");
         getchar();
     }
 
@@ -16,8 +16,25 @@ sc_opengl_init(struct sc_opengl *gl) {
     gl->TexParameteri = SDL_GL_GetProcAddress("glTexParameteri");
     assert(gl->TexParameteri);
 
+    gl->PixelStorei = SDL_GL_GetProcAddress("glPixelStorei");
+    assert(gl->PixelStorei);
+
+    gl->TexSubImage2D = SDL_GL_GetProcAddress("glTexSubImage2D");
+    assert(gl->TexSubImage2D);
+
     // optional
     gl->GenerateMipmap = SDL_GL_GetProcAddress("glGenerateMipmap");
+    gl->ActiveTexture = SDL_GL_GetProcAddress("glActiveTexture");
+    gl->GenBuffers = SDL_GL_GetProcAddress("glGenBuffers");
+    gl->DeleteBuffers = SDL_GL_GetProcAddress("glDeleteBuffers");
+    gl->BindBuffer = SDL_GL_GetProcAddress("glBindBuffer");
+    gl->BufferData = SDL_GL_GetProcAddress("glBufferData");
+    gl->BufferStorage = SDL_GL_GetProcAddress("glBufferStorage");
+    gl->MapBufferRange = SDL_GL_GetProcAddress("glMapBufferRange");
+    gl->UnmapBuffer = SDL_GL_GetProcAddress("glUnmapBuffer");
+    gl->FenceSync = SDL_GL_GetProcAddress("glFenceSync");
+    gl->ClientWaitSync = SDL_GL_GetProcAddress("glClientWaitSync");
+    gl->DeleteSync = SDL_GL_GetProcAddress("glDeleteSync");
 
     const char *version = (const char *) gl->GetString(GL_VERSION);
     assert(version);
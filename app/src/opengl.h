@@ -23,6 +23,53 @@ struct sc_opengl {
 
     void
     (*GenerateMipmap)(GLenum target);
+
+    void
+    (*PixelStorei)(GLenum pname, GLint param);
+
+    void
+    (*TexSubImage2D)(GLenum target, GLint level, GLint xoffset, GLint yoffset,
+                     GLsizei width, GLsizei height, GLenum format, GLenum type,
+                     const void *pixels);
+
+    // The following functions are optional (NULL if not available), they are
+    // used for asynchronous texture uploads (see pbo_uploader.h)
+
+    void
+    (*ActiveTexture)(GLenum texture);
+
+    void
+    (*GenBuffers)(GLsizei n, GLuint *buffers);
+
+    void
+    (*DeleteBuffers)(GLsizei n, const GLuint *buffers);
+
+    void
+    (*BindBuffer)(GLenum target, GLuint buffer);
+
+    void
+    (*BufferData)(GLenum target, GLsizeiptr size, const void *data,
+                  GLenum usage);
+
+    void
+    (*BufferStorage)(GLenum target, GLsizeiptr size, const void *data,
+                     GLbitfield flags);
+
+    void *
+    (*MapBufferRange)(GLenum target, GLintptr offset, GLsizeiptr length,
+                      GLbitfield access);
+
+    GLboolean
+    (*UnmapBuffer)(GLenum target);
+
+    GLsync
+    (*FenceSync)(GLenum condition, GLbitfield flags);
+
+    GLenum
+    (*ClientWaitSync)(GLsync sync, GLbitfield flags, GLuint64 timeout);
+
+    void
+    (*DeleteSync)(GLsync sync);
 };
 
 void
@@ -6,6 +6,7 @@ const struct scrcpy_options scrcpy_options_default = {
     .serial = NULL,
     .crop = NULL,
     .record_filename = NULL,
+    .dump_stream_filename = NULL,
     .window_title = NULL,
     .push_target = NULL,
     .render_driver = NULL,
@@ -63,14 +64,29 @@ const struct scrcpy_options scrcpy_options_default = {
     .window_height = 0,
     .display_id = 0,
     .video_buffer = 0,
+    .video_buffer_mode = SC_VIDEO_BUFFER_MODE_DECODED,
+    .video_decoder_threads = SC_DECODER_THREADS_AUTO,
+    .video_decoder_thread_type = SC_DECODER_THREAD_TYPE_SLICE,
     .audio_buffer = -1, // depends on the audio format,
+    .audio_buffer_min = SC_TICK_FROM_MS(20),
+    .audio_buffer_max = SC_TICK_FROM_MS(500),
     .audio_output_buffer = SC_TICK_FROM_MS(5),
+    .audio_frame_duration = 0,
     .time_limit = 0,
+    .record_segment_duration = 0,
+    .record_segment_size = 0,
     .screen_off_timeout = -1,
 #ifdef HAVE_V4L2
     .v4l2_device = NULL,
     .v4l2_buffer = 0,
 #endif
+#ifdef HAVE_SHM
+    .shm_sink_name = NULL,
+#endif
+    .frame_queue_policy = SC_FRAME_QUEUE_POLICY_KEEP_LATEST,
+#ifdef HAVE_PCM_SINK
+    .pcm_sink = NULL,
+#endif
 #ifdef HAVE_USB
     .otg = false,
 #endif
@@ -84,8 +100,15 @@ const struct scrcpy_options scrcpy_options_default = {
     .key_inject_mode = SC_KEY_INJECT_MODE_MIXED,
     .window_borderless = false,
     .mipmaps = true,
+    .pbo = true,
+    .texture_downscale = false,
+    .render_thread = false,
+    .av_sync = false,
+    .audio_buffer_auto = false,
+    .vsync = false,
     .stay_awake = false,
     .force_adb_forward = false,
+    .multiplex = false,
     .disable_screensaver = false,
     .forward_key_repeat = true,
     .legacy_paste = false,
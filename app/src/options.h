@@ -7,6 +7,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "decoder_threading.h"
+#include "frame_queue_policy.h"
 #include "util/tick.h"
 
 enum sc_log_level {
@@ -54,6 +56,11 @@ enum sc_video_source {
     SC_VIDEO_SOURCE_CAMERA,
 };
 
+enum sc_video_buffer_mode {
+    SC_VIDEO_BUFFER_MODE_DECODED, // buffer the decoded frames
+    SC_VIDEO_BUFFER_MODE_ENCODED, // buffer the packets, before decoding
+};
+
 enum sc_audio_source {
     SC_AUDIO_SOURCE_AUTO, // OUTPUT for video DISPLAY, MIC for video CAMERA
     SC_AUDIO_SOURCE_OUTPUT,
@@ -231,6 +238,7 @@ struct scrcpy_options {
     const char *serial;
     const char *crop;
     const char *record_filename;
+    const char *dump_stream_filename;
     const char *window_title;
     const char *push_target;
     const char *render_driver;
@@ -273,14 +281,32 @@ struct scrcpy_options {
     uint16_t window_height;
     uint32_t display_id;
     sc_tick video_buffer;
+    enum sc_video_buffer_mode video_buffer_mode;
+    uint16_t video_decoder_threads; // 0 for auto
+    enum sc_decoder_thread_type video_decoder_thread_type;
     sc_tick audio_buffer;
+    // Bounds of the audio buffer (equal to audio_buffer unless
+    // audio_buffer_auto is set)
+    sc_tick audio_buffer_min;
+    sc_tick audio_buffer_max;
     sc_tick audio_output_buffer;
+    sc_tick audio_frame_duration; // 0 for the device default
     sc_tick time_limit;
+    sc_tick record_segment_duration; // 0 for no time-based segments
+    uint64_t record_segment_size; // in bytes, 0 for no size-based segments
     sc_tick screen_off_timeout;
 #ifdef HAVE_V4L2
     const char *v4l2_device;
     sc_tick v4l2_buffer;
 #endif
+#ifdef HAVE_SHM
+    const char *shm_sink_name;
+#endif
+    // for the queues forwarding the frames to the V4L2 and shm sinks
+    enum sc_frame_queue_policy frame_queue_policy;
+#ifdef HAVE_PCM_SINK
+    const char *pcm_sink;
+#endif
 #ifdef HAVE_USB
     bool otg;
 #endif
@@ -294,8 +320,15 @@ struct scrcpy_options {
     enum sc_key_inject_mode key_inject_mode;
     bool window_borderless;
     bool mipmaps;
+    bool pbo;
+    bool texture_downscale;
+    bool render_thread;
+    bool vsync;
+    bool av_sync;
+    bool audio_buffer_auto;
     bool stay_awake;
     bool force_adb_forward;
+    bool multiplex;
     bool disable_screensaver;
     bool forward_key_repeat;
     bool legacy_paste;
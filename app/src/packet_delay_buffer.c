@@ -0,0 +1,260 @@
+#include "packet_delay_buffer.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <libavcodec/avcodec.h>
+
+#include "util/log.h"
+
+/** Downcast packet_sink to sc_packet_delay_buffer */
+#define DOWNCAST(SINK) \
+    container_of(SINK, struct sc_packet_delay_buffer, packet_sink)
+
+static bool
+sc_delayed_packet_init(struct sc_delayed_packet *dpacket,
+                       const AVPacket *packet, bool asap) {
+    dpacket->packet = av_packet_alloc();
+    if (!dpacket->packet) {
+        LOG_OOM();
+        return false;
+    }
+
+    // The packet buffers are reference-counted, this does not copy the data
+    if (av_packet_ref(dpacket->packet, packet)) {
+        LOG_OOM();
+        av_packet_free(&dpacket->packet);
+        return false;
+    }
+
+    dpacket->asap = asap;
+    return true;
+}
+
+static void
+sc_delayed_packet_destroy(struct sc_delayed_packet *dpacket) {
+    av_packet_free(&dpacket->packet);
+}
+
+static int
+run_packet_buffering(void *data) {
+    struct sc_packet_delay_buffer *pdb = data;
+
+    assert(pdb->delay > 0);
+
+    for (;;) {
+        sc_mutex_lock(&pdb->mutex);
+
+        while (!pdb->stopped && sc_vecdeque_is_empty(&pdb->queue)) {
+            sc_cond_wait(&pdb->queue_cond, &pdb->mutex);
+        }
+
+        if (pdb->stopped) {
+            sc_mutex_unlock(&pdb->mutex);
+            goto stopped;
+        }
+
+        struct sc_delayed_packet dpacket = sc_vecdeque_pop(&pdb->queue);
+        assert(pdb->queue_size >= (size_t) dpacket.packet->size);
+        pdb->queue_size -= dpacket.packet->size;
+
+        if (!dpacket.asap) {
+            sc_tick max_deadline = sc_tick_now() + pdb->delay;
+            // PTS (written by the server) are expressed in microseconds
+            sc_tick pts = SC_TICK_FROM_US(dpacket.packet->pts);
+
+            bool timed_out = false;
+            while (!pdb->stopped && !timed_out) {
+                sc_tick deadline = sc_clock_to_system_time(&pdb->clock, pts)
+                                 + pdb->delay;
+                if (deadline > max_deadline) {
+                    deadline = max_deadline;
+                }
+
+                timed_out =
+                    !sc_cond_timedwait(&pdb->wait_cond, &pdb->mutex, deadline);
+            }
+        }
+
+        bool stopped = pdb->stopped;
+        sc_mutex_unlock(&pdb->mutex);
+
+        if (stopped) {
+            sc_delayed_packet_destroy(&dpacket);
+            goto stopped;
+        }
+
+        bool ok = sc_packet_source_sinks_push(&pdb->packet_source,
+                                              dpacket.packet);
+        sc_delayed_packet_destroy(&dpacket);
+        if (!ok) {
+            LOGE("Delayed packet could not be pushed, stopping");
+            sc_mutex_lock(&pdb->mutex);
+            // Prevent to push any new packet
+            pdb->stopped = true;
+            sc_mutex_unlock(&pdb->mutex);
+            goto stopped;
+        }
+    }
+
+stopped:
+    assert(pdb->stopped);
+
+    // Flush queue
+    while (!sc_vecdeque_is_empty(&pdb->queue)) {
+        struct sc_delayed_packet *dpacket = sc_vecdeque_popref(&pdb->queue);
+        sc_delayed_packet_destroy(dpacket);
+    }
+
+    LOGD("Packet buffering thread ended (max buffered: %" PRIu64 " bytes)",
+         (uint64_t) pdb->max_queue_size);
+
+    return 0;
+}
+
+static bool
+sc_packet_delay_buffer_packet_sink_open(struct sc_packet_sink *sink,
+                                        AVCodecContext *ctx) {
+    struct sc_packet_delay_buffer *pdb = DOWNCAST(sink);
+
+    bool ok = sc_mutex_init(&pdb->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&pdb->queue_cond);
+    if (!ok) {
+        goto error_destroy_mutex;
+    }
+
+    ok = sc_cond_init(&pdb->wait_cond);
+    if (!ok) {
+        goto error_destroy_queue_cond;
+    }
+
+    sc_clock_init(&pdb->clock);
+    sc_vecdeque_init(&pdb->queue);
+    pdb->stopped = false;
+    pdb->queue_size = 0;
+    pdb->max_queue_size = 0;
+
+    if (!sc_packet_source_sinks_open(&pdb->packet_source, ctx)) {
+        goto error_destroy_wait_cond;
+    }
+
+    ok = sc_thread_create(&pdb->thread, run_packet_buffering, "scrcpy-pbuf",
+                          pdb);
+    if (!ok) {
+        LOGE("Could not start packet buffering thread");
+        goto error_close_sinks;
+    }
+
+    return true;
+
+error_close_sinks:
+    sc_packet_source_sinks_close(&pdb->packet_source);
+error_destroy_wait_cond:
+    sc_cond_destroy(&pdb->wait_cond);
+error_destroy_queue_cond:
+    sc_cond_destroy(&pdb->queue_cond);
+error_destroy_mutex:
+    sc_mutex_destroy(&pdb->mutex);
+
+    return false;
+}
+
+static void
+sc_packet_delay_buffer_packet_sink_close(struct sc_packet_sink *sink) {
+    struct sc_packet_delay_buffer *pdb = DOWNCAST(sink);
+
+    sc_mutex_lock(&pdb->mutex);
+    pdb->stopped = true;
+    sc_cond_signal(&pdb->queue_cond);
+    sc_cond_signal(&pdb->wait_cond);
+    sc_mutex_unlock(&pdb->mutex);
+
+    sc_thread_join(&pdb->thread, NULL);
+
+    sc_packet_source_sinks_close(&pdb->packet_source);
+
+    sc_cond_destroy(&pdb->wait_cond);
+    sc_cond_destroy(&pdb->queue_cond);
+    sc_mutex_destroy(&pdb->mutex);
+}
+
+static bool
+sc_packet_delay_buffer_packet_sink_push(struct sc_packet_sink *sink,
+                                        const AVPacket *packet) {
+    struct sc_packet_delay_buffer *pdb = DOWNCAST(sink);
+
+    sc_mutex_lock(&pdb->mutex);
+
+    if (pdb->stopped) {
+        sc_mutex_unlock(&pdb->mutex);
+        return false;
+    }
+
+    // Config packets have no PTS, they are forwarded without delay (but still
+    // in order, so that they are decoded before the next media packet)
+    bool asap = packet->pts == AV_NOPTS_VALUE;
+    if (!asap) {
+        sc_tick pts = SC_TICK_FROM_US(packet->pts);
+        sc_clock_update(&pdb->clock, sc_tick_now(), pts);
+        sc_cond_signal(&pdb->wait_cond);
+
+        asap = pdb->first_packet_asap && pdb->clock.range == 1;
+    }
+
+    struct sc_delayed_packet dpacket;
+    bool ok = sc_delayed_packet_init(&dpacket, packet, asap);
+    if (!ok) {
+        sc_mutex_unlock(&pdb->mutex);
+        return false;
+    }
+
+    ok = sc_vecdeque_push(&pdb->queue, dpacket);
+    if (!ok) {
+        sc_mutex_unlock(&pdb->mutex);
+        sc_delayed_packet_destroy(&dpacket);
+        LOG_OOM();
+        return false;
+    }
+
+    pdb->queue_size += packet->size;
+    if (pdb->queue_size > pdb->max_queue_size) {
+        pdb->max_queue_size = pdb->queue_size;
+    }
+
+    sc_cond_signal(&pdb->queue_cond);
+
+    sc_mutex_unlock(&pdb->mutex);
+
+    return true;
+}
+
+static void
+sc_packet_delay_buffer_packet_sink_disable(struct sc_packet_sink *sink) {
+    struct sc_packet_delay_buffer *pdb = DOWNCAST(sink);
+
+    sc_packet_source_sinks_disable(&pdb->packet_source);
+}
+
+void
+sc_packet_delay_buffer_init(struct sc_packet_delay_buffer *pdb, sc_tick delay,
+                            bool first_packet_asap) {
+    assert(delay > 0);
+
+    pdb->delay = delay;
+    pdb->first_packet_asap = first_packet_asap;
+
+    sc_packet_source_init(&pdb->packet_source);
+
+    static const struct sc_packet_sink_ops ops = {
+        .open = sc_packet_delay_buffer_packet_sink_open,
+        .close = sc_packet_delay_buffer_packet_sink_close,
+        .push = sc_packet_delay_buffer_packet_sink_push,
+        .disable = sc_packet_delay_buffer_packet_sink_disable,
+    };
+
+    pdb->packet_sink.ops = &ops;
+}
@@ -0,0 +1,70 @@
+#ifndef SC_PACKET_DELAY_BUFFER_H
+#define SC_PACKET_DELAY_BUFFER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "clock.h"
+#include "trait/packet_source.h"
+#include "trait/packet_sink.h"
+#include "util/thread.h"
+#include "util/tick.h"
+#include "util/vecdeque.h"
+
+// forward declarations
+typedef struct AVPacket AVPacket;
+
+struct sc_delayed_packet {
+    AVPacket *packet;
+    // If set, the packet is forwarded as soon as possible
+    bool asap;
+};
+
+struct sc_delayed_packet_queue SC_VECDEQUE(struct sc_delayed_packet);
+
+/**
+ * A packet delay buffer delays the encoded packets before they are decoded.
+ *
+ * It releases the packets on the same schedule as sc_delay_buffer (based on
+ * sc_clock), but since encoded packets are typically two orders of magnitude
+ * smaller than decoded frames, buffering a long delay requires far less
+ * memory.
+ *
+ * Since it is placed before the decoder, all the consumers of the decoded
+ * frames are delayed.
+ */
+struct sc_packet_delay_buffer {
+    struct sc_packet_source packet_source; // packet source trait
+    struct sc_packet_sink packet_sink; // packet sink trait
+
+    sc_tick delay;
+    bool first_packet_asap;
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond queue_cond;
+    sc_cond wait_cond;
+
+    struct sc_clock clock;
+    struct sc_delayed_packet_queue queue;
+    bool stopped;
+
+    // Total size of the packets in the queue, in bytes
+    size_t queue_size;
+    size_t max_queue_size;
+};
+
+/**
+ * Initialize a packet delay buffer.
+ *
+ * \param delay a (strictly) positive delay
+ * \param first_packet_asap if true, do not delay the first media packet
+ *                          (useful for a video stream).
+ */
+void
+sc_packet_delay_buffer_init(struct sc_packet_delay_buffer *pdb, sc_tick delay,
+                            bool first_packet_asap);
+
+#endif
@@ -1,6 +1,6 @@
 #include "packet_merger.h"
 
-#include <stdlib.h>
+#include <assert.h>
 #include <string.h>
 #include <libavutil/avutil.h>
 
@@ -8,12 +8,28 @@
 
 void
 sc_packet_merger_init(struct sc_packet_merger *merger) {
+    merger->config_buf = NULL;
     merger->config = NULL;
 }
 
 void
 sc_packet_merger_destroy(struct sc_packet_merger *merger) {
-    free(merger->config);
+    av_buffer_unref(&merger->config_buf);
+}
+
+size_t
+sc_packet_merger_get_headroom(const struct sc_packet_merger *merger) {
+    return merger->config_buf ? merger->config_size : 0;
+}
+
+static bool
+sc_packet_merger_has_headroom(const AVPacket *packet, size_t size) {
+    if (!packet->buf || !av_buffer_is_writable(packet->buf)) {
+        return false;
+    }
+
+    assert(packet->data >= packet->buf->data);
+    return (size_t) (packet->data - packet->buf->data) >= size;
 }
 
 bool
@@ -21,31 +37,42 @@ sc_packet_merger_merge(struct sc_packet_merger *merger, AVPacket *packet) {
     bool is_config = packet->pts == AV_NOPTS_VALUE;
 
     if (is_config) {
-        free(merger->config);
+        assert(packet->buf);
 
-        merger->config = malloc(packet->size);
-        if (!merger->config) {
+        // Keep a reference to the config packet data, instead of a copy
+        AVBufferRef *config_buf = av_buffer_ref(packet->buf);
+        if (!config_buf) {
             LOG_OOM();
             return false;
         }
 
-        memcpy(merger->config, packet->data, packet->size);
+        av_buffer_unref(&merger->config_buf);
+        merger->config_buf = config_buf;
+        merger->config = packet->data;
         merger->config_size = packet->size;
-    } else if (merger->config) {
+    } else if (merger->config_buf) {
         size_t config_size = merger->config_size;
-        size_t media_size = packet->size;
 
-        if (av_grow_packet(packet, config_size)) {
-            LOG_OOM();
-            return false;
+        if (sc_packet_merger_has_headroom(packet, config_size)) {
+            // The config packet fits in front of the payload
+            packet->data -= config_size;
+            packet->size += config_size;
+        } else {
+            size_t media_size = packet->size;
+
+            if (av_grow_packet(packet, config_size)) {
+                LOG_OOM();
+                return false;
+            }
+
+            memmove(packet->data + config_size, packet->data, media_size);
         }
 
-        memmove(packet->data + config_size, packet->data, media_size);
         memcpy(packet->data, merger->config, config_size);
 
-        free(merger->config);
+        av_buffer_unref(&merger->config_buf);
         merger->config = NULL;
-        // merger->size is meaningless when merger->config is NULL
+        // merger->config_size is meaningless when merger->config_buf is NULL
     }
 
     return true;
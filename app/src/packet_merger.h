@@ -4,8 +4,10 @@
 #include "common.h"
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <libavcodec/packet.h>
+#include <libavutil/buffer.h>
 
 /**
  * Config packets (containing the SPS/PPS) are sent in-band. A new config
@@ -18,10 +20,16 @@
  *
  * This helper reads every input packet and modifies each media packet which
  * immediately follows a config packet to prepend the config packet payload.
+ *
+ * To avoid moving the whole media packet payload, the caller may reserve
+ * headroom (see sc_packet_merger_get_headroom()) in front of the media packet
+ * data, so that the config packet payload can be written in place.
  */
 
 struct sc_packet_merger {
-    uint8_t *config;
+    // Reference to the pending config packet buffer (NULL if none)
+    AVBufferRef *config_buf;
+    const uint8_t *config;
     size_t config_size;
 };
 
@@ -32,10 +40,23 @@ void
 sc_packet_merger_destroy(struct sc_packet_merger *merger);
 
 /**
- * If the packet is a config packet, then keep its data for later.
+ * Return the number of bytes to reserve in front of the next packet data, so
+ * that a pending config packet may be prepended without moving the payload
+ * (0 if no config packet is pending)
+ */
+size_t
+sc_packet_merger_get_headroom(const struct sc_packet_merger *merger);
+
+/**
+ * If the packet is a config packet, then keep a reference to its data for
+ * later (the packet must be reference-counted).
  * Otherwise (if the packet is a media packet), then if a config packet is
  * pending, prepend the config packet to this packet (so the packet is
  * modified!).
+ *
+ * If the packet is writable and enough headroom is available in its buffer
+ * in front of its data, then the config packet is written in place. Otherwise,
+ * the packet is grown and its payload is moved.
  */
 bool
 sc_packet_merger_merge(struct sc_packet_merger *merger, AVPacket *packet);
@@ -0,0 +1,114 @@
+#include "packet_pool.h"
+
+#include <assert.h>
+#include <string.h>
+#include <libavcodec/avcodec.h>
+
+#include "util/log.h"
+
+#ifdef SCRCPY_LAVU_HAS_BUFFER_SIZE_T
+typedef size_t sc_av_buffer_size;
+#else
+typedef int sc_av_buffer_size;
+#endif
+
+void
+sc_packet_pool_init(struct sc_packet_pool *pool) {
+    for (unsigned i = 0; i < SC_PACKET_POOL_CLASS_COUNT; ++i) {
+        pool->pools[i] = NULL;
+    }
+    pool->hits = 0;
+    pool->misses = 0;
+}
+
+void
+sc_packet_pool_destroy(struct sc_packet_pool *pool) {
+    for (unsigned i = 0; i < SC_PACKET_POOL_CLASS_COUNT; ++i) {
+        // The pool is actually freed once all its buffers are released, so it
+        // is safe even if some sinks still hold packet references
+        av_buffer_pool_uninit(&pool->pools[i]);
+    }
+}
+
+static AVBufferRef *
+sc_packet_pool_alloc(void *opaque, sc_av_buffer_size size) {
+    struct sc_packet_pool *pool = opaque;
+
+    // Only called from av_buffer_pool_get() when no buffer is available for
+    // reuse, i.e. from the thread using the pool
+    ++pool->misses;
+
+    return av_buffer_alloc(size);
+}
+
+static unsigned
+sc_packet_pool_get_class(size_t size) {
+    unsigned shift = SC_PACKET_POOL_MIN_SHIFT;
+    while (((size_t) 1 << shift) < size) {
+        ++shift;
+    }
+    return shift - SC_PACKET_POOL_MIN_SHIFT;
+}
+
+static AVBufferPool *
+sc_packet_pool_get_pool(struct sc_packet_pool *pool, unsigned cls) {
+    assert(cls < SC_PACKET_POOL_CLASS_COUNT);
+
+    if (!pool->pools[cls]) {
+        size_t class_size = (size_t) 1 << (SC_PACKET_POOL_MIN_SHIFT + cls);
+        size_t buf_size = class_size + AV_INPUT_BUFFER_PADDING_SIZE;
+        pool->pools[cls] = av_buffer_pool_init2(buf_size, pool,
+                                                sc_packet_pool_alloc, NULL);
+        if (!pool->pools[cls]) {
+            LOG_OOM();
+            return NULL;
+        }
+    }
+
+    return pool->pools[cls];
+}
+
+bool
+sc_packet_pool_new_packet(struct sc_packet_pool *pool, AVPacket *packet,
+                          size_t size) {
+    assert(!packet->buf); // the packet must not hold any reference
+    assert(size <= INT32_MAX - AV_INPUT_BUFFER_PADDING_SIZE);
+
+    if (size > ((size_t) 1 << SC_PACKET_POOL_MAX_SHIFT)) {
+        // Too big for the pools, allocate it directly
+        ++pool->misses;
+        if (av_new_packet(packet, size)) {
+            LOG_OOM();
+            return false;
+        }
+        return true;
+    }
+
+    unsigned cls = sc_packet_pool_get_class(size);
+    AVBufferPool *buffer_pool = sc_packet_pool_get_pool(pool, cls);
+    if (!buffer_pool) {
+        return false;
+    }
+
+    uint64_t misses = pool->misses;
+    AVBufferRef *buf = av_buffer_pool_get(buffer_pool);
+    if (!buf) {
+        LOG_OOM();
+        return false;
+    }
+
+    if (pool->misses == misses) {
+        // No new allocation
+        ++pool->hits;
+    }
+
+    // Reused buffers are not zeroed, but the padding must be (like
+    // av_new_packet() does)
+    memset(buf->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+    packet->buf = buf;
+    packet->data = buf->data;
+    packet->size = size;
+
+    return true;
+}
@@ -0,0 +1,65 @@
+#ifndef SC_PACKET_POOL_H
+#define SC_PACKET_POOL_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <libavcodec/packet.h>
+#include <libavutil/buffer.h>
+
+/**
+ * Packet buffers are allocated from pools of power-of-two size classes,
+ * from 2^SC_PACKET_POOL_MIN_SHIFT to 2^SC_PACKET_POOL_MAX_SHIFT bytes.
+ *
+ * Larger packets (which should never happen in practice) are allocated
+ * directly.
+ */
+#define SC_PACKET_POOL_MIN_SHIFT 9 // 512 bytes
+#define SC_PACKET_POOL_MAX_SHIFT 24 // 16 MiB
+#define SC_PACKET_POOL_CLASS_COUNT \
+    (SC_PACKET_POOL_MAX_SHIFT - SC_PACKET_POOL_MIN_SHIFT + 1)
+
+/**
+ * Pool of reference-counted packet buffers.
+ *
+ * The demuxer receives a new packet for every video frame and every audio
+ * block. Instead of allocating a new buffer for each packet (like
+ * av_new_packet() does), the buffers are taken from an AVBufferPool, and
+ * automatically returned to the pool once the last reference is released.
+ *
+ * Since the buffers are reference-counted, the sinks may keep references
+ * (via av_packet_ref()) as long as they want, even after the pool is
+ * destroyed.
+ *
+ * The pool must be used from a single thread (the buffers may be released
+ * from any thread).
+ */
+struct sc_packet_pool {
+    // Lazily initialized, NULL until a packet of the size class is requested
+    AVBufferPool *pools[SC_PACKET_POOL_CLASS_COUNT];
+
+    // Number of packets whose buffer has been reused from a pool
+    uint64_t hits;
+    // Number of packets for which a new buffer has been allocated
+    uint64_t misses;
+};
+
+void
+sc_packet_pool_init(struct sc_packet_pool *pool);
+
+void
+sc_packet_pool_destroy(struct sc_packet_pool *pool);
+
+/**
+ * Initialize the payload of `packet` with a buffer of (at least) `size`
+ * bytes, followed by AV_INPUT_BUFFER_PADDING_SIZE zeroed bytes.
+ *
+ * This is a replacement for av_new_packet().
+ */
+bool
+sc_packet_pool_new_packet(struct sc_packet_pool *pool, AVPacket *packet,
+                          size_t size);
+
+#endif
@@ -0,0 +1,252 @@
+#include "pbo_uploader.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "util/log.h"
+
+// The fence of a buffer was inserted SC_PBO_UPLOADER_BUFFER_COUNT frames ago,
+// so it is normally already signaled
+#define SC_PBO_UPLOADER_FENCE_TIMEOUT_NS UINT64_C(1000000000) // 1 second
+
+bool
+sc_pbo_uploader_is_supported(struct sc_opengl *gl, SDL_Renderer *renderer) {
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info)) {
+        return false;
+    }
+
+    // If the renderer does not support YUV textures natively, SDL converts
+    // the frames in software to an RGB texture
+    bool native_yuv = false;
+    for (Uint32 i = 0; i < info.num_texture_formats; ++i) {
+        if (info.texture_formats[i] == SDL_PIXELFORMAT_YV12) {
+            native_yuv = true;
+            break;
+        }
+    }
+    if (!native_yuv) {
+        return false;
+    }
+
+    bool supports_pbo =
+        sc_opengl_version_at_least(gl, 3, 0, /* OpenGL 3.0+ */
+                                       3, 0  /* OpenGL ES 3.0+ */);
+    return supports_pbo
+        && gl->ActiveTexture
+        && gl->GenBuffers
+        && gl->DeleteBuffers
+        && gl->BindBuffer
+        && gl->BufferData
+        && gl->MapBufferRange
+        && gl->UnmapBuffer;
+}
+
+static bool
+sc_pbo_uploader_supports_persistent(struct sc_opengl *gl) {
+    return !gl->is_opengles
+        && sc_opengl_version_at_least(gl, 4, 4, 0, 0) // OpenGL 4.4+
+        && gl->BufferStorage
+        && gl->FenceSync
+        && gl->ClientWaitSync
+        && gl->DeleteSync;
+}
+
+static void
+sc_pbo_uploader_delete_buffers(struct sc_pbo_uploader *uploader) {
+    struct sc_opengl *gl = uploader->gl;
+
+    for (unsigned i = 0; i < SC_PBO_UPLOADER_BUFFER_COUNT; ++i) {
+        if (uploader->fences[i]) {
+            gl->DeleteSync(uploader->fences[i]);
+        }
+        if (uploader->mapped[i]) {
+            gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, uploader->buffers[i]);
+            gl->UnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+    }
+    gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    gl->DeleteBuffers(SC_PBO_UPLOADER_BUFFER_COUNT, uploader->buffers);
+}
+
+bool
+sc_pbo_uploader_init(struct sc_pbo_uploader *uploader, struct sc_opengl *gl,
+                     struct sc_size size) {
+    assert(size.width && size.height);
+
+    uploader->gl = gl;
+    uploader->persistent = sc_pbo_uploader_supports_persistent(gl);
+    uploader->size = size;
+    uploader->index = 0;
+
+    size_t chroma_width = (size.width + 1) / 2;
+    size_t chroma_height = (size.height + 1) / 2;
+    uploader->plane_sizes[0] = (size_t) size.width * size.height;
+    uploader->plane_sizes[1] = chroma_width * chroma_height;
+    uploader->plane_sizes[2] = chroma_width * chroma_height;
+    uploader->buffer_size = uploader->plane_sizes[0]
+                          + uploader->plane_sizes[1]
+                          + uploader->plane_sizes[2];
+
+    for (unsigned i = 0; i < SC_PBO_UPLOADER_BUFFER_COUNT; ++i) {
+        uploader->mapped[i] = NULL;
+        uploader->fences[i] = NULL;
+    }
+
+    gl->GenBuffers(SC_PBO_UPLOADER_BUFFER_COUNT, uploader->buffers);
+
+    for (unsigned i = 0; i < SC_PBO_UPLOADER_BUFFER_COUNT; ++i) {
+        gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, uploader->buffers[i]);
+
+        if (uploader->persistent) {
+            GLbitfield flags = GL_MAP_WRITE_BIT
+                             | GL_MAP_PERSISTENT_BIT
+                             | GL_MAP_COHERENT_BIT;
+            gl->BufferStorage(GL_PIXEL_UNPACK_BUFFER, uploader->buffer_size,
+                              NULL, flags);
+            uploader->mapped[i] =
+                gl->MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+                                   uploader->buffer_size, flags);
+            if (!uploader->mapped[i]) {
+                LOGW("Could not map pixel buffer persistently");
+                goto error;
+            }
+        } else {
+            gl->BufferData(GL_PIXEL_UNPACK_BUFFER, uploader->buffer_size,
+                           NULL, GL_STREAM_DRAW);
+        }
+    }
+
+    gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    return true;
+
+error:
+    sc_pbo_uploader_delete_buffers(uploader);
+
+    return false;
+}
+
+void
+sc_pbo_uploader_destroy(struct sc_pbo_uploader *uploader) {
+    sc_pbo_uploader_delete_buffers(uploader);
+}
+
+static void
+sc_pbo_uploader_copy_plane(uint8_t *dst, const uint8_t *src, int linesize,
+                           size_t width, size_t height) {
+    if (linesize > 0 && (size_t) linesize == width) {
+        memcpy(dst, src, width * height);
+        return;
+    }
+
+    // The lines are stored contiguously in the buffer
+    for (size_t y = 0; y < height; ++y) {
+        memcpy(dst + y * width, src + (ptrdiff_t) y * linesize, width);
+    }
+}
+
+bool
+sc_pbo_uploader_upload(struct sc_pbo_uploader *uploader, SDL_Texture *texture,
+                       const AVFrame *frame) {
+    assert(frame->width == uploader->size.width);
+    assert(frame->height == uploader->size.height);
+
+    struct sc_opengl *gl = uploader->gl;
+    unsigned index = uploader->index;
+
+    if (uploader->fences[index]) {
+        // Do not overwrite the buffer until its previous transfer is complete
+        GLenum r = gl->ClientWaitSync(uploader->fences[index],
+                                      GL_SYNC_FLUSH_COMMANDS_BIT,
+                                      SC_PBO_UPLOADER_FENCE_TIMEOUT_NS);
+        gl->DeleteSync(uploader->fences[index]);
+        uploader->fences[index] = NULL;
+        if (r == GL_WAIT_FAILED || r == GL_TIMEOUT_EXPIRED) {
+            LOGD("Could not wait for pixel buffer");
+            return false;
+        }
+    }
+
+    // Bind the Y, U and V plane textures to the texture units 0, 1 and 2
+    if (SDL_GL_BindTexture(texture, NULL, NULL)) {
+        LOGD("Could not bind texture: %s", SDL_GetError());
+        return false;
+    }
+
+    gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, uploader->buffers[index]);
+
+    uint8_t *data = uploader->mapped[index];
+    if (!data) {
+        // Orphan the previous storage, so that the driver does not wait for
+        // its transfer to complete
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+        data = gl->MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+                                  uploader->buffer_size, flags);
+        if (!data) {
+            LOGD("Could not map pixel buffer");
+            goto error;
+        }
+    }
+
+    size_t width = uploader->size.width;
+    size_t height = uploader->size.height;
+    size_t chroma_width = (width + 1) / 2;
+    size_t chroma_height = (height + 1) / 2;
+
+    size_t widths[3] = {width, chroma_width, chroma_width};
+    size_t heights[3] = {height, chroma_height, chroma_height};
+
+    size_t offsets[3];
+    size_t offset = 0;
+    for (unsigned i = 0; i < 3; ++i) {
+        offsets[i] = offset;
+        sc_pbo_uploader_copy_plane(data + offset, frame->data[i],
+                                   frame->linesize[i], widths[i], heights[i]);
+        offset += uploader->plane_sizes[i];
+    }
+
+    if (!uploader->persistent) {
+        GLboolean ok = gl->UnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        if (!ok) {
+            // The buffer content has been lost
+            LOGD("Could not unmap pixel buffer");
+            goto error;
+        }
+    }
+
+    // The planes are tightly packed
+    gl->PixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    gl->PixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    // Start the transfers, they are executed asynchronously (the last
+    // parameter is an offset in the bound pixel buffer)
+    for (unsigned i = 0; i < 3; ++i) {
+        gl->ActiveTexture(GL_TEXTURE0 + i);
+        gl->TexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, widths[i], heights[i],
+                          GL_LUMINANCE, GL_UNSIGNED_BYTE,
+                          (const void *) (uintptr_t) offsets[i]);
+    }
+    gl->ActiveTexture(GL_TEXTURE0);
+
+    // Restore the state expected by SDL (client memory uploads)
+    gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (uploader->persistent) {
+        uploader->fences[index] =
+            gl->FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    SDL_GL_UnbindTexture(texture);
+
+    uploader->index = (index + 1) % SC_PBO_UPLOADER_BUFFER_COUNT;
+
+    return true;
+
+error:
+    gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    SDL_GL_UnbindTexture(texture);
+
+    return false;
+}
@@ -0,0 +1,75 @@
+#ifndef SC_PBO_UPLOADER_H
+#define SC_PBO_UPLOADER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <libavutil/frame.h>
+#include <SDL2/SDL.h>
+
+#include "coords.h"
+#include "opengl.h"
+
+#define SC_PBO_UPLOADER_BUFFER_COUNT 3
+
+/**
+ * Upload YUV 4:2:0 frames to an SDL texture through OpenGL pixel buffer
+ * objects (PBO).
+ *
+ * The frame is copied to the memory of a PBO, then the texture update from
+ * the PBO is executed asynchronously by the GPU: the caller does not wait for
+ * the transfer, and the next frame is copied to another PBO in the meantime.
+ *
+ * If the OpenGL version supports it (OpenGL 4.4+), the buffers are mapped
+ * persistently (once for all), and fences prevent to overwrite a buffer still
+ * in use. Otherwise, the buffers are mapped for each frame, and orphaned so
+ * that the driver does not wait for the previous transfer.
+ *
+ * All the functions must be called from the thread owning the renderer.
+ */
+struct sc_pbo_uploader {
+    struct sc_opengl *gl;
+    bool persistent;
+
+    struct sc_size size;
+    size_t plane_sizes[3];
+    size_t buffer_size;
+
+    GLuint buffers[SC_PBO_UPLOADER_BUFFER_COUNT];
+    // Only for persistent mapping
+    uint8_t *mapped[SC_PBO_UPLOADER_BUFFER_COUNT];
+    GLsync fences[SC_PBO_UPLOADER_BUFFER_COUNT];
+
+    unsigned index; // the next buffer to use
+};
+
+/**
+ * Indicate whether PBO uploads are supported by the current renderer
+ *
+ * The renderer must be an OpenGL renderer, and `gl` must be initialized.
+ */
+bool
+sc_pbo_uploader_is_supported(struct sc_opengl *gl, SDL_Renderer *renderer);
+
+/**
+ * Initialize the buffers to upload frames of the given size
+ */
+bool
+sc_pbo_uploader_init(struct sc_pbo_uploader *uploader, struct sc_opengl *gl,
+                     struct sc_size size);
+
+void
+sc_pbo_uploader_destroy(struct sc_pbo_uploader *uploader);
+
+/**
+ * Upload a YUV 4:2:0 frame to a texture created with SDL_PIXELFORMAT_YV12
+ *
+ * The frame size must match the size passed to sc_pbo_uploader_init().
+ */
+bool
+sc_pbo_uploader_upload(struct sc_pbo_uploader *uploader, SDL_Texture *texture,
+                       const AVFrame *frame);
+
+#endif
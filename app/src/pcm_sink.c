@@ -0,0 +1,618 @@
+#include "pcm_sink.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <libavutil/opt.h>
+
+#include "util/binary.h"
+#include "util/log.h"
+#include "util/tick.h"
+
+/** Downcast frame_sink to sc_pcm_sink */
+#define DOWNCAST(SINK) container_of(SINK, struct sc_pcm_sink, frame_sink)
+
+// Delay between attempts to open the target while there is no reader
+#define SC_PCM_SINK_RETRY_DELAY SC_TICK_FROM_MS(100)
+// Timeout to wait for the reader to consume data, to check for stop requests
+#define SC_PCM_SINK_POLL_TIMEOUT_MS 100
+
+// A write of at most PIPE_BUF bytes to a pipe never blocks once poll() reports
+// that it is writable
+#define SC_PCM_SINK_CHUNK_SIZE PIPE_BUF
+
+static bool
+sc_pcm_sink_get_output_format(enum AVSampleFormat fmt,
+                              enum AVSampleFormat *out_fmt,
+                              enum sc_pcm_sink_format *format) {
+    switch (av_get_packed_sample_fmt(fmt)) {
+        case AV_SAMPLE_FMT_S16:
+            *out_fmt = AV_SAMPLE_FMT_S16;
+            *format = SC_PCM_SINK_FORMAT_S16;
+            // The samples need conversion only if they are planar
+            return av_sample_fmt_is_planar(fmt);
+        case AV_SAMPLE_FMT_S32:
+            *out_fmt = AV_SAMPLE_FMT_S32;
+            *format = SC_PCM_SINK_FORMAT_S32;
+            return av_sample_fmt_is_planar(fmt);
+        case AV_SAMPLE_FMT_FLT:
+            *out_fmt = AV_SAMPLE_FMT_FLT;
+            *format = SC_PCM_SINK_FORMAT_F32;
+            return av_sample_fmt_is_planar(fmt);
+        default:
+            // Convert any other format to float
+            *out_fmt = AV_SAMPLE_FMT_FLT;
+            *format = SC_PCM_SINK_FORMAT_F32;
+            return true;
+    }
+}
+
+static const char *
+sc_pcm_sink_get_format_name(enum sc_pcm_sink_format format) {
+    switch (format) {
+        case SC_PCM_SINK_FORMAT_S16:
+            return "s16";
+        case SC_PCM_SINK_FORMAT_S32:
+            return "s32";
+        case SC_PCM_SINK_FORMAT_F32:
+            return "f32";
+        default:
+            assert(!"unexpected PCM format");
+            return NULL;
+    }
+}
+
+static bool
+sc_pcm_sink_is_unix_socket(const char *target) {
+    return !strncmp(target, SC_PCM_SINK_UNIX_PREFIX,
+                    sizeof(SC_PCM_SINK_UNIX_PREFIX) - 1);
+}
+
+static bool
+sc_pcm_sink_set_flags(int fd, bool nonblock) {
+    int flags = fcntl(fd, F_GETFD);
+    if (flags == -1 || fcntl(fd, F_SETFD, flags | FD_CLOEXEC) == -1) {
+        return false;
+    }
+
+    if (nonblock) {
+        flags = fcntl(fd, F_GETFL);
+        if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Open the target
+ *
+ * Return the file descriptor, or -1 on error. If there is no reader yet,
+ * `retry` is set to true.
+ */
+static int
+sc_pcm_sink_open_target(const char *target, bool *retry) {
+    *retry = false;
+
+    if (!strcmp(target, SC_PCM_SINK_STDOUT)) {
+        // Do not change the flags of the stdout file description, which may be
+        // shared with other processes: writes of at most PIPE_BUF bytes do not
+        // block anyway once poll() succeeds
+        int fd = dup(STDOUT_FILENO);
+        if (fd == -1 || !sc_pcm_sink_set_flags(fd, false)) {
+            LOGE("PCM sink: could not use stdout: %s", strerror(errno));
+            if (fd != -1) {
+                close(fd);
+            }
+            return -1;
+        }
+        return fd;
+    }
+
+    if (sc_pcm_sink_is_unix_socket(target)) {
+        const char *path = target + sizeof(SC_PCM_SINK_UNIX_PREFIX) - 1;
+
+        struct sockaddr_un addr = {
+            .sun_family = AF_UNIX,
+        };
+        // The length has been checked by sc_pcm_sink_init()
+        assert(strlen(path) < sizeof(addr.sun_path));
+        strcpy(addr.sun_path, path);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1) {
+            LOGE("PCM sink: could not create socket: %s", strerror(errno));
+            return -1;
+        }
+
+        if (connect(fd, (struct sockaddr *) &addr, sizeof(addr))) {
+            int err = errno;
+            close(fd);
+            if (err == ENOENT || err == ECONNREFUSED) {
+                // The reader is not listening yet
+                *retry = true;
+            } else {
+                LOGE("PCM sink: could not connect to %s: %s", path,
+                     strerror(err));
+            }
+            return -1;
+        }
+
+        if (!sc_pcm_sink_set_flags(fd, true)) {
+            LOGE("PCM sink: could not configure socket: %s", strerror(errno));
+            close(fd);
+            return -1;
+        }
+
+        return fd;
+    }
+
+    // A regular file or a FIFO. With O_NONBLOCK, opening a FIFO fails with
+    // ENXIO if there is no reader, instead of blocking.
+    int fd = open(target, O_WRONLY | O_CREAT | O_TRUNC | O_NONBLOCK, 0644);
+    if (fd == -1) {
+        if (errno == ENXIO) {
+            *retry = true;
+        } else {
+            LOGE("PCM sink: could not open %s: %s", target, strerror(errno));
+        }
+        return -1;
+    }
+
+    if (!sc_pcm_sink_set_flags(fd, false)) {
+        LOGE("PCM sink: could not configure %s: %s", target, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static bool
+sc_pcm_sink_is_stopped(struct sc_pcm_sink *ps) {
+    sc_mutex_lock(&ps->mutex);
+    bool stopped = ps->stopped;
+    sc_mutex_unlock(&ps->mutex);
+    return stopped;
+}
+
+/**
+ * Wait for a reader and open the target
+ *
+ * Return -1 on error or if the sink is stopped before a reader is available.
+ */
+static int
+sc_pcm_sink_connect(struct sc_pcm_sink *ps) {
+    bool waiting_logged = false;
+
+    for (;;) {
+        bool retry;
+        int fd = sc_pcm_sink_open_target(ps->target, &retry);
+        if (fd != -1 || !retry) {
+            return fd;
+        }
+
+        if (!waiting_logged) {
+            LOGI("PCM sink: waiting for a reader on %s", ps->target);
+            waiting_logged = true;
+        }
+
+        sc_tick deadline = sc_tick_now() + SC_PCM_SINK_RETRY_DELAY;
+
+        sc_mutex_lock(&ps->mutex);
+        bool timed_out = false;
+        while (!ps->stopped && !timed_out) {
+            timed_out = !sc_cond_timedwait(&ps->cond, &ps->mutex, deadline);
+        }
+        bool stopped = ps->stopped;
+        sc_mutex_unlock(&ps->mutex);
+
+        if (stopped) {
+            return -1;
+        }
+    }
+}
+
+/**
+ * Write `len` bytes (at most SC_PCM_SINK_CHUNK_SIZE)
+ *
+ * Return false if the reader is disconnected, or if the sink is stopped while
+ * the reader does not consume the data.
+ */
+static bool
+sc_pcm_sink_write(struct sc_pcm_sink *ps, int fd, const uint8_t *data,
+                  size_t len) {
+    assert(len <= SC_PCM_SINK_CHUNK_SIZE);
+
+    while (len) {
+        struct pollfd pfd = {
+            .fd = fd,
+            .events = POLLOUT,
+        };
+        int r = poll(&pfd, 1, SC_PCM_SINK_POLL_TIMEOUT_MS);
+        if (r == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOGE("PCM sink: poll() failed: %s", strerror(errno));
+            return false;
+        }
+
+        if (!r) {
+            if (sc_pcm_sink_is_stopped(ps)) {
+                // Do not wait for the reader forever on exit
+                return false;
+            }
+            continue;
+        }
+
+        ssize_t w = write(fd, data, len);
+        if (w == -1) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            if (errno == EPIPE || errno == ECONNRESET) {
+                LOGI("PCM sink: reader disconnected");
+            } else {
+                LOGE("PCM sink: could not write: %s", strerror(errno));
+            }
+            return false;
+        }
+
+        data += w;
+        len -= w;
+    }
+
+    return true;
+}
+
+// Must be called with the mutex locked
+static size_t
+sc_pcm_sink_take(struct sc_pcm_sink *ps, uint8_t *out, size_t max) {
+    size_t len = MIN(ps->size, max);
+    size_t first = MIN(len, ps->capacity - ps->head);
+    memcpy(out, ps->buf + ps->head, first);
+    memcpy(out + first, ps->buf, len - first);
+    ps->head = (ps->head + len) % ps->capacity;
+    ps->size -= len;
+    return len;
+}
+
+/**
+ * Stream the header and the buffered samples to the reader
+ *
+ * Return true if the sink has been stopped and all the samples have been
+ * written, false if the stream has been interrupted.
+ */
+static bool
+sc_pcm_sink_stream(struct sc_pcm_sink *ps, int fd) {
+    if (!sc_pcm_sink_write(ps, fd, ps->header, sizeof(ps->header))) {
+        return false;
+    }
+
+    // Only write whole samples, so that a new reader always receives aligned
+    // samples after its header
+    size_t max = SC_PCM_SINK_CHUNK_SIZE
+               - SC_PCM_SINK_CHUNK_SIZE % ps->sample_size;
+    uint8_t chunk[SC_PCM_SINK_CHUNK_SIZE];
+
+    for (;;) {
+        sc_mutex_lock(&ps->mutex);
+        while (!ps->stopped && !ps->size) {
+            sc_cond_wait(&ps->cond, &ps->mutex);
+        }
+        if (!ps->size) {
+            assert(ps->stopped);
+            sc_mutex_unlock(&ps->mutex);
+            return true;
+        }
+        size_t len = sc_pcm_sink_take(ps, chunk, max);
+        sc_mutex_unlock(&ps->mutex);
+
+        if (!sc_pcm_sink_write(ps, fd, chunk, len)) {
+            return false;
+        }
+    }
+}
+
+static int
+run_pcm_sink(void *data) {
+    struct sc_pcm_sink *ps = data;
+
+    for (;;) {
+        int fd = sc_pcm_sink_connect(ps);
+        if (fd == -1) {
+            break;
+        }
+
+        // Only a FIFO or a socket may be reopened by a new reader
+        struct stat st;
+        bool reopen = strcmp(ps->target, SC_PCM_SINK_STDOUT)
+                   && !fstat(fd, &st)
+                   && (S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode));
+
+        bool done = sc_pcm_sink_stream(ps, fd);
+        close(fd);
+
+        if (done || !reopen || sc_pcm_sink_is_stopped(ps)) {
+            break;
+        }
+    }
+
+    sc_mutex_lock(&ps->mutex);
+    // Do not buffer samples anymore
+    ps->failed = true;
+    sc_mutex_unlock(&ps->mutex);
+
+    return 0;
+}
+
+// Must be called with the mutex locked
+static void
+sc_pcm_sink_append(struct sc_pcm_sink *ps, const uint8_t *data, size_t len) {
+    assert(len % ps->sample_size == 0);
+
+    if (len > ps->capacity) {
+        // Only the most recent samples fit
+        size_t skip = len - ps->capacity;
+        ps->dropped += skip / ps->sample_size;
+        data += skip;
+        len = ps->capacity;
+    }
+
+    size_t free_space = ps->capacity - ps->size;
+    if (len > free_space) {
+        // Drop the oldest samples
+        size_t drop = len - free_space;
+        ps->head = (ps->head + drop) % ps->capacity;
+        ps->size -= drop;
+        ps->dropped += drop / ps->sample_size;
+    }
+
+    size_t tail = (ps->head + ps->size) % ps->capacity;
+    size_t first = MIN(len, ps->capacity - tail);
+    memcpy(ps->buf + tail, data, first);
+    memcpy(ps->buf, data + first, len - first);
+    ps->size += len;
+}
+
+static const uint8_t *
+sc_pcm_sink_convert(struct sc_pcm_sink *ps, const AVFrame *frame) {
+    size_t size = frame->nb_samples * ps->sample_size;
+    if (size > ps->swr_buf_alloc_size) {
+        uint8_t *buf = realloc(ps->swr_buf, size);
+        if (!buf) {
+            LOG_OOM();
+            return NULL;
+        }
+        ps->swr_buf = buf;
+        ps->swr_buf_alloc_size = size;
+    }
+
+    // The sample rate is not changed, so all the samples are converted
+    // immediately
+    int ret = swr_convert(ps->swr_ctx, &ps->swr_buf, frame->nb_samples,
+                          (const uint8_t **) frame->data, frame->nb_samples);
+    if (ret < 0) {
+        LOGE("PCM sink: resampling failed: %d", ret);
+        return NULL;
+    }
+    assert(ret == frame->nb_samples);
+
+    return ps->swr_buf;
+}
+
+static bool
+sc_pcm_sink_push(struct sc_pcm_sink *ps, const AVFrame *frame) {
+    const uint8_t *data = frame->data[0];
+    if (ps->swr_ctx) {
+        data = sc_pcm_sink_convert(ps, frame);
+        if (!data) {
+            return false;
+        }
+    }
+
+    sc_mutex_lock(&ps->mutex);
+    if (!ps->failed) {
+        sc_pcm_sink_append(ps, data, frame->nb_samples * ps->sample_size);
+        sc_cond_signal(&ps->cond);
+    }
+    sc_mutex_unlock(&ps->mutex);
+
+    // A writing error is not fatal for the other sinks
+    return true;
+}
+
+static bool
+sc_pcm_sink_open(struct sc_pcm_sink *ps, const AVCodecContext *ctx) {
+#ifdef SCRCPY_LAVU_HAS_CHLAYOUT
+    int channels = ctx->ch_layout.nb_channels;
+#else
+    int channels = av_get_channel_layout_nb_channels(ctx->channel_layout);
+#endif
+    if (channels <= 0 || channels > UINT8_MAX || ctx->sample_rate <= 0) {
+        LOGE("PCM sink: unsupported audio stream (%d channels, %d Hz)",
+             channels, ctx->sample_rate);
+        return false;
+    }
+
+    enum AVSampleFormat out_fmt;
+    enum sc_pcm_sink_format format;
+    bool convert = sc_pcm_sink_get_output_format(ctx->sample_fmt, &out_fmt,
+                                                 &format);
+
+    ps->swr_ctx = NULL;
+    ps->swr_buf = NULL;
+    ps->swr_buf_alloc_size = 0;
+
+    if (convert) {
+        SwrContext *swr_ctx = swr_alloc();
+        if (!swr_ctx) {
+            LOG_OOM();
+            return false;
+        }
+
+#ifdef SCRCPY_LAVU_HAS_CHLAYOUT
+        av_opt_set_chlayout(swr_ctx, "in_chlayout", &ctx->ch_layout, 0);
+        av_opt_set_chlayout(swr_ctx, "out_chlayout", &ctx->ch_layout, 0);
+#else
+        av_opt_set_channel_layout(swr_ctx, "in_channel_layout",
+                                  ctx->channel_layout, 0);
+        av_opt_set_channel_layout(swr_ctx, "out_channel_layout",
+                                  ctx->channel_layout, 0);
+#endif
+
+        av_opt_set_int(swr_ctx, "in_sample_rate", ctx->sample_rate, 0);
+        av_opt_set_int(swr_ctx, "out_sample_rate", ctx->sample_rate, 0);
+
+        av_opt_set_sample_fmt(swr_ctx, "in_sample_fmt", ctx->sample_fmt, 0);
+        av_opt_set_sample_fmt(swr_ctx, "out_sample_fmt", out_fmt, 0);
+
+        if (swr_init(swr_ctx)) {
+            LOGE("PCM sink: failed to initialize the conversion context");
+            swr_free(&swr_ctx);
+            return false;
+        }
+
+        ps->swr_ctx = swr_ctx;
+    }
+
+    ps->sample_size = channels * av_get_bytes_per_sample(out_fmt);
+
+    memcpy(ps->header, SC_PCM_SINK_MAGIC, SC_PCM_SINK_MAGIC_LENGTH);
+    ps->header[SC_PCM_SINK_MAGIC_LENGTH] = format;
+    ps->header[SC_PCM_SINK_MAGIC_LENGTH + 1] = channels;
+    sc_write32be(&ps->header[SC_PCM_SINK_MAGIC_LENGTH + 2], ctx->sample_rate);
+
+    size_t samples = (size_t) ctx->sample_rate * SC_PCM_SINK_BUFFER_MS / 1000;
+    ps->capacity = samples * ps->sample_size;
+    ps->buf = malloc(ps->capacity);
+    if (!ps->buf) {
+        LOG_OOM();
+        goto error_free_swr_ctx;
+    }
+
+    ps->head = 0;
+    ps->size = 0;
+    ps->stopped = false;
+    ps->failed = false;
+    ps->dropped = 0;
+
+    bool ok = sc_mutex_init(&ps->mutex);
+    if (!ok) {
+        goto error_free_buf;
+    }
+
+    ok = sc_cond_init(&ps->cond);
+    if (!ok) {
+        goto error_mutex_destroy;
+    }
+
+    ok = sc_thread_create(&ps->thread, run_pcm_sink, "scrcpy-pcm", ps);
+    if (!ok) {
+        LOGE("Could not start PCM sink thread");
+        goto error_cond_destroy;
+    }
+
+    LOGI("PCM sink started: %s (%s, %d channels, %d Hz)", ps->target,
+         sc_pcm_sink_get_format_name(format), channels, ctx->sample_rate);
+
+    return true;
+
+error_cond_destroy:
+    sc_cond_destroy(&ps->cond);
+error_mutex_destroy:
+    sc_mutex_destroy(&ps->mutex);
+error_free_buf:
+    free(ps->buf);
+error_free_swr_ctx:
+    swr_free(&ps->swr_ctx);
+
+    return false;
+}
+
+static void
+sc_pcm_sink_close(struct sc_pcm_sink *ps) {
+    sc_mutex_lock(&ps->mutex);
+    ps->stopped = true;
+    sc_cond_signal(&ps->cond);
+    sc_mutex_unlock(&ps->mutex);
+
+    sc_thread_join(&ps->thread, NULL);
+
+    if (ps->dropped) {
+        LOGD("PCM sink: %" PRIu64 " samples dropped", ps->dropped);
+    }
+
+    sc_cond_destroy(&ps->cond);
+    sc_mutex_destroy(&ps->mutex);
+    free(ps->buf);
+    free(ps->swr_buf);
+    swr_free(&ps->swr_ctx);
+}
+
+static bool
+sc_pcm_frame_sink_open(struct sc_frame_sink *sink, const AVCodecContext *ctx) {
+    struct sc_pcm_sink *ps = DOWNCAST(sink);
+    return sc_pcm_sink_open(ps, ctx);
+}
+
+static void
+sc_pcm_frame_sink_close(struct sc_frame_sink *sink) {
+    struct sc_pcm_sink *ps = DOWNCAST(sink);
+    sc_pcm_sink_close(ps);
+}
+
+static bool
+sc_pcm_frame_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
+    struct sc_pcm_sink *ps = DOWNCAST(sink);
+    return sc_pcm_sink_push(ps, frame);
+}
+
+bool
+sc_pcm_sink_init(struct sc_pcm_sink *ps, const char *target) {
+    if (sc_pcm_sink_is_unix_socket(target)) {
+        const char *path = target + sizeof(SC_PCM_SINK_UNIX_PREFIX) - 1;
+        struct sockaddr_un addr;
+        if (!*path || strlen(path) >= sizeof(addr.sun_path)) {
+            LOGE("Invalid Unix socket path for PCM sink: %s", path);
+            return false;
+        }
+    }
+
+    ps->target = strdup(target);
+    if (!ps->target) {
+        LOG_OOM();
+        return false;
+    }
+
+    // Writing to a pipe or a socket closed by the reader must fail with EPIPE
+    // rather than killing the process
+    signal(SIGPIPE, SIG_IGN);
+
+    static const struct sc_frame_sink_ops ops = {
+        .open = sc_pcm_frame_sink_open,
+        .close = sc_pcm_frame_sink_close,
+        .push = sc_pcm_frame_sink_push,
+    };
+
+    ps->frame_sink.ops = &ops;
+
+    return true;
+}
+
+void
+sc_pcm_sink_destroy(struct sc_pcm_sink *ps) {
+    free(ps->target);
+}
@@ -0,0 +1,92 @@
+#ifndef SC_PCM_SINK_H
+#define SC_PCM_SINK_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <libswresample/swresample.h>
+
+#include "trait/frame_sink.h"
+#include "util/thread.h"
+
+/**
+ * Frame sink writing the decoded audio as raw interleaved PCM to stdout, a
+ * file, a FIFO or a Unix socket, for live processing by another program.
+ *
+ * The stream starts with a header describing the samples:
+ *
+ * [. . . . . . . . . . . .|.|.|. . . .]. . . . . . . . . . . . . ...
+ *  <---------------------> ^ ^ <-----> <----------------------------...
+ *           magic          | | sample       interleaved samples
+ *                          | | rate (Hz)
+ *                          | `- channels
+ *                           `- format (SC_PCM_SINK_FORMAT_*)
+ *
+ * The sample rate is big-endian. The samples are in host byte order
+ * (little-endian on all the platforms supported by scrcpy).
+ *
+ * The samples are written by a separate thread, so that a slow consumer never
+ * blocks the decoder: they are buffered in a bounded buffer, and the oldest
+ * samples are dropped when it is full.
+ *
+ * For a FIFO or a Unix socket, the sink waits for a reader (the consumer must
+ * create the FIFO or listen on the socket), and a new header is written for
+ * each new reader.
+ */
+#define SC_PCM_SINK_MAGIC "scrcpy-pcm-1"
+#define SC_PCM_SINK_MAGIC_LENGTH (sizeof(SC_PCM_SINK_MAGIC) - 1)
+#define SC_PCM_SINK_HEADER_SIZE (SC_PCM_SINK_MAGIC_LENGTH + 6)
+
+// Target to write to stdout
+#define SC_PCM_SINK_STDOUT "-"
+// Prefix of a target to write to a Unix socket
+#define SC_PCM_SINK_UNIX_PREFIX "unix:"
+
+// Maximum duration of the samples buffered for a slow (or absent) reader
+#define SC_PCM_SINK_BUFFER_MS 1000
+
+enum sc_pcm_sink_format {
+    SC_PCM_SINK_FORMAT_S16 = 1,
+    SC_PCM_SINK_FORMAT_S32 = 2,
+    SC_PCM_SINK_FORMAT_F32 = 3,
+};
+
+struct sc_pcm_sink {
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    char *target;
+
+    // Conversion to an interleaved format, NULL if the decoded samples are
+    // already interleaved (only used by the decoder thread)
+    SwrContext *swr_ctx;
+    uint8_t *swr_buf;
+    size_t swr_buf_alloc_size;
+
+    size_t sample_size; // in bytes, for all channels
+    uint8_t header[SC_PCM_SINK_HEADER_SIZE];
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+
+    // Bounded ring buffer, protected by the mutex
+    uint8_t *buf;
+    size_t capacity; // in bytes, a multiple of sample_size
+    size_t head; // index of the oldest byte
+    size_t size; // number of buffered bytes
+
+    bool stopped;
+    bool failed; // the target could not be written anymore
+
+    uint64_t dropped; // number of samples dropped
+};
+
+bool
+sc_pcm_sink_init(struct sc_pcm_sink *ps, const char *target);
+
+void
+sc_pcm_sink_destroy(struct sc_pcm_sink *ps);
+
+#endif
@@ -26,6 +26,7 @@ sc_receiver_init(struct sc_receiver *receiver, sc_socket control_socket,
     }
 
     receiver->control_socket = control_socket;
+    receiver->mux_stream = NULL;
     receiver->acksync = NULL;
     receiver->uhid_devices = NULL;
 
@@ -36,6 +37,13 @@ sc_receiver_init(struct sc_receiver *receiver, sc_socket control_socket,
     return true;
 }
 
+void
+sc_receiver_set_mux_stream(struct sc_receiver *receiver,
+                           struct sc_mux_stream *stream) {
+    assert(stream);
+    receiver->mux_stream = stream;
+}
+
 void
 sc_receiver_destroy(struct sc_receiver *receiver) {
     sc_mutex_destroy(&receiver->mutex);
@@ -188,8 +196,10 @@ run_receiver(void *data) {
 
     for (;;) {
         assert(head < DEVICE_MSG_MAX_SIZE);
-        ssize_t r = net_recv(receiver->control_socket, buf + head,
-                             DEVICE_MSG_MAX_SIZE - head);
+        size_t len = DEVICE_MSG_MAX_SIZE - head;
+        ssize_t r = receiver->mux_stream
+                  ? sc_mux_stream_recv(receiver->mux_stream, buf + head, len)
+                  : net_recv(receiver->control_socket, buf + head, len);
         if (r <= 0) {
             LOGD("Receiver stopped");
             // device disconnected: keep error=false
@@ -211,6 +221,11 @@ run_receiver(void *data) {
         }
     }
 
+    if (receiver->mux_stream) {
+        // The next chunks must not block the demultiplexer
+        sc_mux_stream_release(receiver->mux_stream);
+    }
+
     receiver->cbs->on_ended(receiver, error, receiver->cbs_userdata);
 
     return 0;
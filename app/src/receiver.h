@@ -5,6 +5,7 @@
 
 #include <stdbool.h>
 
+#include "demultiplexer.h"
 #include "uhid/uhid_output.h"
 #include "util/acksync.h"
 #include "util/net.h"
@@ -14,6 +15,8 @@
 // managed by the controller
 struct sc_receiver {
     sc_socket control_socket;
+    // If set, device messages are read from this stream instead of the socket
+    struct sc_mux_stream *mux_stream;
     sc_thread thread;
     sc_mutex mutex;
 
@@ -35,6 +38,11 @@ sc_receiver_init(struct sc_receiver *receiver, sc_socket control_socket,
 void
 sc_receiver_destroy(struct sc_receiver *receiver);
 
+// Must be called before sc_receiver_start()
+void
+sc_receiver_set_mux_stream(struct sc_receiver *receiver,
+                           struct sc_mux_stream *stream);
+
 bool
 sc_receiver_start(struct sc_receiver *receiver);
 
@@ -0,0 +1,72 @@
+#include "record_filename.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/log.h"
+
+char *
+sc_record_filename_insert_index(const char *filename, unsigned index) {
+    const char *basename = strrchr(filename, '/');
+#ifdef _WIN32
+    const char *backslash = strrchr(filename, '\\');
+    if (backslash && (!basename || backslash > basename)) {
+        basename = backslash;
+    }
+#endif
+    basename = basename ? basename + 1 : filename;
+
+    const char *ext = strrchr(basename, '.');
+    if (!ext || ext == basename) {
+        // No extension (a leading dot is not an extension separator)
+        ext = filename + strlen(filename);
+    }
+
+    size_t prefix_len = ext - filename;
+    // "-" + up to 10 digits + '\0'
+    size_t len = prefix_len + 12 + strlen(ext);
+    char *result = malloc(len);
+    if (!result) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    snprintf(result, len, "%.*s-%u%s", (int) prefix_len, filename, index, ext);
+    return result;
+}
+
+char *
+sc_record_filename_expand(const char *pattern, const struct tm *tm) {
+    // Large enough for any reasonable pattern
+    size_t len = strlen(pattern) + 256;
+    char *expanded = malloc(len);
+    if (!expanded) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    if (!strftime(expanded, len, pattern, tm)) {
+        LOGE("Could not expand record filename: %s", pattern);
+        free(expanded);
+        return NULL;
+    }
+
+    return expanded;
+}
+
+char *
+sc_record_filename_get_segment(const char *expanded, const char *prev,
+                               unsigned index) {
+    // Never overwrite the previous segment (if the pattern contains no
+    // conversion, or if it expands to the same value)
+    if (prev && !strcmp(expanded, prev)) {
+        return sc_record_filename_insert_index(expanded, index);
+    }
+
+    char *filename = strdup(expanded);
+    if (!filename) {
+        LOG_OOM();
+    }
+    return filename;
+}
@@ -0,0 +1,33 @@
+#ifndef SC_RECORD_FILENAME_H
+#define SC_RECORD_FILENAME_H
+
+#include "common.h"
+
+#include <time.h>
+
+/**
+ * Insert "-<index>" before the file extension (if any)
+ *
+ * A leading dot in the file name (e.g. ".mkv") does not start an extension.
+ */
+char *
+sc_record_filename_insert_index(const char *filename, unsigned index);
+
+/**
+ * Expand the strftime() pattern of a segmented recording
+ */
+char *
+sc_record_filename_expand(const char *pattern, const struct tm *tm);
+
+/**
+ * Return the file name of a segment from the expansion of the pattern
+ *
+ * If the expansion is the same as the previous one (`prev`, possibly NULL),
+ * the segment index is inserted, so that the previous segment is never
+ * overwritten.
+ */
+char *
+sc_record_filename_get_segment(const char *expanded, const char *prev,
+                               unsigned index);
+
+#endif
@@ -2,13 +2,17 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 #include <libavutil/time.h>
 #include <libavutil/display.h>
 
+#include "record_filename.h"
+#include "util/file.h"
 #include "util/log.h"
 #include "util/str.h"
 
@@ -20,6 +24,9 @@
 
 static const AVRational SCRCPY_TIME_BASE = {1, 1000000}; // timestamps in us
 
+// Delay before retrying to start a new segment after a failure
+#define SC_RECORDER_SEGMENT_RETRY_DELAY SC_TICK_FROM_SEC(1)
+
 static const AVOutputFormat *
 find_muxer(const char *name) {
 #ifdef SCRCPY_LAVF_HAS_NEW_MUXER_ITERATOR_API
@@ -98,15 +105,54 @@ sc_recorder_set_extradata(AVStream *ostream, const AVPacket *packet) {
     return true;
 }
 
+static bool
+sc_recorder_set_orientation(AVStream *stream, enum sc_orientation orientation) {
+    assert(!sc_orientation_is_mirror(orientation));
+
+    uint8_t *raw_data;
+#ifdef SCRCPY_LAVC_HAS_CODECPAR_CODEC_SIDEDATA
+    AVPacketSideData *sd =
+        av_packet_side_data_new(&stream->codecpar->coded_side_data,
+                                &stream->codecpar->nb_coded_side_data,
+                                AV_PKT_DATA_DISPLAYMATRIX,
+                                sizeof(int32_t) * 9, 0);
+    if (!sd) {
+        LOG_OOM();
+        return false;
+    }
+
+    raw_data = sd->data;
+#else
+    raw_data = av_stream_new_side_data(stream, AV_PKT_DATA_DISPLAYMATRIX,
+                                      sizeof(int32_t) * 9);
+    if (!raw_data) {
+        LOG_OOM();
+        return false;
+    }
+#endif
+
+    int32_t *matrix = (int32_t *) raw_data;
+
+    unsigned rotation = orientation;
+    unsigned angle = rotation * 90;
+
+    av_display_rotation_set(matrix, angle);
+
+    return true;
+}
+
 static inline void
 sc_recorder_rescale_packet(AVStream *stream, AVPacket *packet) {
     av_packet_rescale_ts(packet, SCRCPY_TIME_BASE, stream->time_base);
 }
 
 static bool
-sc_recorder_write_stream(struct sc_recorder *recorder,
-                         struct sc_recorder_stream *st, AVPacket *packet) {
-    AVStream *stream = recorder->ctx->streams[st->index];
+sc_recorder_write_stream(AVFormatContext *ctx, struct sc_recorder_stream *st,
+                         int64_t origin, AVPacket *packet) {
+    AVStream *stream = ctx->streams[st->index];
+    // The timestamps are relative to the start of the segment
+    packet->pts -= origin;
+    packet->dts = packet->pts;
     sc_recorder_rescale_packet(stream, packet);
     if (st->last_pts != AV_NOPTS_VALUE && packet->pts <= st->last_pts) {
         LOGD("Fixing PTS non monotonically increasing in stream %d "
@@ -117,66 +163,112 @@ sc_recorder_write_stream(struct sc_recorder *recorder,
     } else {
         st->last_pts = packet->pts;
     }
-    return av_interleaved_write_frame(recorder->ctx, packet) >= 0;
+    return av_interleaved_write_frame(ctx, packet) >= 0;
 }
 
 static inline bool
 sc_recorder_write_video(struct sc_recorder *recorder, AVPacket *packet) {
-    return sc_recorder_write_stream(recorder, &recorder->video_stream, packet);
+    return sc_recorder_write_stream(recorder->ctx, &recorder->video_stream,
+                                    recorder->segment_origin, packet);
 }
 
 static inline bool
-sc_recorder_write_audio(struct sc_recorder *recorder, AVPacket *packet) {
-    return sc_recorder_write_stream(recorder, &recorder->audio_stream, packet);
+sc_recorder_is_segmented(struct sc_recorder *recorder) {
+    return recorder->segment_duration || recorder->segment_size;
 }
 
-static bool
-sc_recorder_open_output_file(struct sc_recorder *recorder) {
+// The expansion of the filename pattern is returned in *expanded, to be stored
+// in segment_expanded once the segment is started (NULL if not segmented)
+static char *
+sc_recorder_get_segment_filename(struct sc_recorder *recorder, unsigned index,
+                                 char **expanded) {
+    *expanded = NULL;
+
+    if (!sc_recorder_is_segmented(recorder)) {
+        // The filename is used as is
+        char *filename = strdup(recorder->filename);
+        if (!filename) {
+            LOG_OOM();
+        }
+        return filename;
+    }
+
+    time_t now = time(NULL);
+    struct tm tm;
+#ifdef _WIN32
+    bool ok = !localtime_s(&tm, &now);
+#else
+    bool ok = localtime_r(&now, &tm);
+#endif
+    if (!ok) {
+        LOGE("Could not get the local time");
+        return NULL;
+    }
+
+    char *expansion = sc_record_filename_expand(recorder->filename, &tm);
+    if (!expansion) {
+        return NULL;
+    }
+
+    char *filename = sc_record_filename_get_segment(
+            expansion, recorder->segment_expanded, index);
+    if (!filename) {
+        free(expansion);
+        return NULL;
+    }
+
+    *expanded = expansion;
+    return filename;
+}
+
+static AVFormatContext *
+sc_recorder_open_output_file(struct sc_recorder *recorder,
+                             const char *filename) {
     const char *format_name = sc_recorder_get_format_name(recorder->format);
     assert(format_name);
     const AVOutputFormat *format = find_muxer(format_name);
     if (!format) {
         LOGE("Could not find muxer");
-        return false;
+        return NULL;
     }
 
-    recorder->ctx = avformat_alloc_context();
-    if (!recorder->ctx) {
+    AVFormatContext *ctx = avformat_alloc_context();
+    if (!ctx) {
         LOG_OOM();
-        return false;
+        return NULL;
     }
 
-    char *file_url = sc_str_concat("file:", recorder->filename);
+    char *file_url = sc_str_concat("file:", filename);
     if (!file_url) {
-        avformat_free_context(recorder->ctx);
-        return false;
+        avformat_free_context(ctx);
+        return NULL;
     }
 
-    int ret = avio_open(&recorder->ctx->pb, file_url, AVIO_FLAG_WRITE);
+    int ret = avio_open(&ctx->pb, file_url, AVIO_FLAG_WRITE);
     free(file_url);
     if (ret < 0) {
-        LOGE("Failed to open output file: %s", recorder->filename);
-        avformat_free_context(recorder->ctx);
-        return false;
+        LOGE("Failed to open output file: %s", filename);
+        avformat_free_context(ctx);
+        return NULL;
     }
 
     // contrary to the deprecated API (av_oformat_next()), av_muxer_iterate()
     // returns (on purpose) a pointer-to-const, but AVFormatContext.oformat
     // still expects a pointer-to-non-const (it has not be updated accordingly)
     // <https://github.com/FFmpeg/FFmpeg/commit/0694d8702421e7aff1340038559c438b61bb30dd>
-    recorder->ctx->oformat = (AVOutputFormat *) format;
+    ctx->oformat = (AVOutputFormat *) format;
 
-    av_dict_set(&recorder->ctx->metadata, "comment",
+    av_dict_set(&ctx->metadata, "comment",
                 "Recorded by scrcpy " SCRCPY_VERSION, 0);
 
-    LOGI("Recording started to %s file: %s", format_name, recorder->filename);
-    return true;
+    LOGI("Recording started to %s file: %s", format_name, filename);
+    return ctx;
 }
 
 static void
-sc_recorder_close_output_file(struct sc_recorder *recorder) {
-    avio_close(recorder->ctx->pb);
-    avformat_free_context(recorder->ctx);
+sc_recorder_close_output_file(AVFormatContext *ctx) {
+    avio_close(ctx->pb);
+    avformat_free_context(ctx);
 }
 
 static inline bool
@@ -264,7 +356,7 @@ sc_recorder_process_header(struct sc_recorder *recorder) {
 
     bool ok = avformat_write_header(recorder->ctx, NULL) >= 0;
     if (!ok) {
-        LOGE("Failed to write header to %s", recorder->filename);
+        LOGE("Failed to write header to %s", recorder->segment_filename);
         goto end;
     }
 
@@ -281,6 +373,220 @@ end:
     return ret;
 }
 
+static bool
+sc_recorder_is_segment_complete(struct sc_recorder *recorder, int64_t pts) {
+    if (recorder->segment_duration && pts - recorder->segment_origin
+                >= SC_TICK_TO_US(recorder->segment_duration)) {
+        return true;
+    }
+
+    if (recorder->segment_size) {
+        int64_t size = avio_tell(recorder->ctx->pb);
+        if (size >= (int64_t) recorder->segment_size) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool
+sc_recorder_copy_streams(struct sc_recorder *recorder, AVFormatContext *ctx,
+                         const AVPacket *video_config) {
+    AVFormatContext *prev = recorder->ctx;
+    for (unsigned i = 0; i < prev->nb_streams; ++i) {
+        AVStream *stream = avformat_new_stream(ctx, NULL);
+        if (!stream) {
+            LOG_OOM();
+            return false;
+        }
+
+        // Also copies the extradata (and the display matrix, if it is stored
+        // in the codec parameters)
+        int r = avcodec_parameters_copy(stream->codecpar,
+                                        prev->streams[i]->codecpar);
+        if (r < 0) {
+            LOG_OOM();
+            return false;
+        }
+
+        // The tag selected by the previous muxer must not be reused as is
+        stream->codecpar->codec_tag = 0;
+    }
+
+    if (recorder->video) {
+        AVStream *stream = ctx->streams[recorder->video_stream.index];
+
+        if (video_config) {
+            // The video config changed (e.g. on device rotation) since the
+            // first segment started
+            av_freep(&stream->codecpar->extradata);
+            stream->codecpar->extradata_size = 0;
+            if (!sc_recorder_set_extradata(stream, video_config)) {
+                return false;
+            }
+        }
+
+#ifndef SCRCPY_LAVC_HAS_CODECPAR_CODEC_SIDEDATA
+        if (recorder->orientation != SC_ORIENTATION_0) {
+            if (!sc_recorder_set_orientation(stream, recorder->orientation)) {
+                return false;
+            }
+        }
+#endif
+    }
+
+    return true;
+}
+
+static void
+sc_recorder_finalize_segment(AVFormatContext *ctx, const char *filename) {
+    // The segment is complete: its failure must not stop the recording of the
+    // next ones
+    if (av_write_trailer(ctx) < 0) {
+        LOGE("Failed to write trailer to %s", filename);
+    }
+    sc_recorder_close_output_file(ctx);
+    LOGI("Recording segment complete: %s", filename);
+}
+
+static void
+sc_recorder_finalize_previous_segment(struct sc_recorder *recorder) {
+    assert(recorder->prev_ctx);
+    sc_recorder_finalize_segment(recorder->prev_ctx, recorder->prev_filename);
+    free(recorder->prev_filename);
+    recorder->prev_ctx = NULL;
+    recorder->prev_filename = NULL;
+}
+
+static bool
+sc_recorder_write_audio(struct sc_recorder *recorder, AVPacket *packet) {
+    if (recorder->prev_ctx) {
+        if (packet->pts < recorder->segment_origin) {
+            // The audio packet belongs to the previous segment
+            return sc_recorder_write_stream(recorder->prev_ctx,
+                                            &recorder->prev_audio_stream,
+                                            recorder->prev_origin, packet);
+        }
+
+        // The audio reached the current segment
+        sc_recorder_finalize_previous_segment(recorder);
+    }
+
+    if (packet->pts < recorder->segment_origin) {
+        // Never write negative timestamps
+        LOGW("Dropping audio packet older than the record segment "
+             "(%" PRIi64 " < %" PRIi64 ")", packet->pts,
+             recorder->segment_origin);
+        return true;
+    }
+
+    return sc_recorder_write_stream(recorder->ctx, &recorder->audio_stream,
+                                    recorder->segment_origin, packet);
+}
+
+// Start a new segment from the packet at pts, and finalize the current one
+// (possibly later, see prev_ctx)
+static bool
+sc_recorder_next_segment(struct sc_recorder *recorder, int64_t pts,
+                         const AVPacket *video_config) {
+    unsigned index = recorder->segment_index + 1;
+
+    char *expanded;
+    char *filename =
+        sc_recorder_get_segment_filename(recorder, index, &expanded);
+    if (!filename) {
+        return false;
+    }
+
+    AVFormatContext *ctx = sc_recorder_open_output_file(recorder, filename);
+    if (!ctx) {
+        free(expanded);
+        free(filename);
+        return false;
+    }
+
+    if (!sc_recorder_copy_streams(recorder, ctx, video_config)) {
+        goto error;
+    }
+
+    if (avformat_write_header(ctx, NULL) < 0) {
+        LOGE("Failed to write header to %s", filename);
+        goto error;
+    }
+
+    if (recorder->prev_ctx) {
+        // The audio never reached the start of the current segment
+        sc_recorder_finalize_previous_segment(recorder);
+    }
+
+    if (recorder->video && recorder->audio) {
+        // Audio packets older than the new segment may still be received
+        recorder->prev_ctx = recorder->ctx;
+        recorder->prev_filename = recorder->segment_filename;
+        recorder->prev_origin = recorder->segment_origin;
+        recorder->prev_audio_stream = recorder->audio_stream;
+    } else {
+        sc_recorder_finalize_segment(recorder->ctx,
+                                     recorder->segment_filename);
+        free(recorder->segment_filename);
+    }
+
+    recorder->segment_filename = filename;
+    recorder->ctx = ctx;
+
+    // The segment is started
+    recorder->segment_index = index;
+    if (expanded) {
+        free(recorder->segment_expanded);
+        recorder->segment_expanded = expanded;
+    }
+
+    recorder->segment_origin = pts;
+    recorder->video_stream.last_pts = AV_NOPTS_VALUE;
+    recorder->audio_stream.last_pts = AV_NOPTS_VALUE;
+
+    return true;
+
+error:
+    sc_recorder_close_output_file(ctx);
+    // Do not leave an invalid file behind
+    if (!sc_file_remove(filename)) {
+        LOGW("Could not delete %s", filename);
+    }
+    free(expanded);
+    free(filename);
+    return false;
+}
+
+// Start a new segment if the current one is complete
+//
+// On failure (e.g. disk full), the recording continues to the current segment,
+// and a new one is attempted later (on the next key frame for video).
+static void
+sc_recorder_rotate(struct sc_recorder *recorder, int64_t pts,
+                   const AVPacket *video_config) {
+    if (!sc_recorder_is_segment_complete(recorder, pts)) {
+        return;
+    }
+
+    if (recorder->segment_retry_pts != AV_NOPTS_VALUE
+            && pts < recorder->segment_retry_pts) {
+        return;
+    }
+
+    bool ok = sc_recorder_next_segment(recorder, pts, video_config);
+    if (!ok) {
+        LOGW("Could not start a new record segment, continuing to %s",
+             recorder->segment_filename);
+        recorder->segment_retry_pts =
+            pts + SC_TICK_TO_US(SC_RECORDER_SEGMENT_RETRY_DELAY);
+        return;
+    }
+
+    recorder->segment_retry_pts = AV_NOPTS_VALUE;
+}
+
 static bool
 sc_recorder_process_packets(struct sc_recorder *recorder) {
     int64_t pts_origin = AV_NOPTS_VALUE;
@@ -297,6 +603,10 @@ sc_recorder_process_packets(struct sc_recorder *recorder) {
     // we can set its duration (next_pts - current_pts)
     AVPacket *video_pkt_previous = NULL;
 
+    // The last video config packet received after the header, to initialize
+    // the next segments
+    AVPacket *video_config = NULL;
+
     bool error = false;
 
     for (;;) {
@@ -337,6 +647,10 @@ sc_recorder_process_packets(struct sc_recorder *recorder) {
             audio_pkt = sc_vecdeque_pop(&recorder->audio_queue);
         }
 
+        // No more video packets will be received
+        bool video_ended = recorder->stopped && !video_pkt
+                        && sc_vecdeque_is_empty(&recorder->video_queue);
+
         if (recorder->stopped && !video_pkt && !audio_pkt) {
             assert(sc_vecdeque_is_empty(&recorder->video_queue));
             assert(sc_vecdeque_is_empty(&recorder->audio_queue));
@@ -348,11 +662,18 @@ sc_recorder_process_packets(struct sc_recorder *recorder) {
 
         sc_mutex_unlock(&recorder->mutex);
 
-        // Ignore further config packets (e.g. on device orientation
+        // Do not write further config packets (e.g. on device orientation
         // change). The next non-config packet will have the config packet
-        // data prepended.
+        // data prepended. Keep the last one for the next segments.
         if (video_pkt && video_pkt->pts == AV_NOPTS_VALUE) {
-            av_packet_free(&video_pkt);
+            if (sc_recorder_is_segmented(recorder)) {
+                if (video_config) {
+                    av_packet_free(&video_config);
+                }
+                video_config = video_pkt;
+            } else {
+                av_packet_free(&video_pkt);
+            }
             video_pkt = NULL;
         }
 
@@ -397,6 +718,14 @@ sc_recorder_process_packets(struct sc_recorder *recorder) {
                 video_pkt_previous->duration = video_pkt->pts
                                              - video_pkt_previous->pts;
 
+                // Split only on a key frame, so that each segment is
+                // decodable independently
+                if (sc_recorder_is_segmented(recorder)
+                        && (video_pkt_previous->flags & AV_PKT_FLAG_KEY)) {
+                    sc_recorder_rotate(recorder, video_pkt_previous->pts,
+                                       video_config);
+                }
+
                 bool ok = sc_recorder_write_video(recorder, video_pkt_previous);
                 av_packet_free(&video_pkt_previous);
                 if (!ok) {
@@ -411,9 +740,26 @@ sc_recorder_process_packets(struct sc_recorder *recorder) {
         }
 
         if (audio_pkt) {
+            // The segment rotation on a video key frame is decided only once
+            // the next video packet is received. Until then, keep the audio
+            // packets not older than the key frame, which may belong to the
+            // next segment.
+            if (video_pkt_previous && !video_ended
+                    && sc_recorder_is_segmented(recorder)
+                    && (video_pkt_previous->flags & AV_PKT_FLAG_KEY)
+                    && audio_pkt->pts - pts_origin
+                        >= video_pkt_previous->pts) {
+                continue;
+            }
+
             audio_pkt->pts -= pts_origin;
             audio_pkt->dts = audio_pkt->pts;
 
+            // Without video, any audio packet may start a new segment
+            if (!recorder->video && sc_recorder_is_segmented(recorder)) {
+                sc_recorder_rotate(recorder, audio_pkt->pts, NULL);
+            }
+
             bool ok = sc_recorder_write_audio(recorder, audio_pkt);
             if (!ok) {
                 LOGE("Could not record audio packet");
@@ -443,7 +789,7 @@ sc_recorder_process_packets(struct sc_recorder *recorder) {
 
     int ret = av_write_trailer(recorder->ctx);
     if (ret < 0) {
-        LOGE("Failed to write trailer to %s", recorder->filename);
+        LOGE("Failed to write trailer to %s", recorder->segment_filename);
         error = false;
     }
 
@@ -454,19 +800,34 @@ end:
     if (audio_pkt) {
         av_packet_free(&audio_pkt);
     }
+    if (video_config) {
+        av_packet_free(&video_config);
+    }
+    if (recorder->prev_ctx) {
+        sc_recorder_finalize_previous_segment(recorder);
+    }
 
     return !error;
 }
 
 static bool
 sc_recorder_record(struct sc_recorder *recorder) {
-    bool ok = sc_recorder_open_output_file(recorder);
-    if (!ok) {
+    char *expanded;
+    recorder->segment_filename =
+        sc_recorder_get_segment_filename(recorder, 0, &expanded);
+    if (!recorder->segment_filename) {
+        return false;
+    }
+    recorder->segment_expanded = expanded;
+
+    recorder->ctx =
+        sc_recorder_open_output_file(recorder, recorder->segment_filename);
+    if (!recorder->ctx) {
         return false;
     }
 
-    ok = sc_recorder_process_packets(recorder);
-    sc_recorder_close_output_file(recorder);
+    bool ok = sc_recorder_process_packets(recorder);
+    sc_recorder_close_output_file(recorder->ctx);
     return ok;
 }
 
@@ -491,7 +852,7 @@ run_recorder(void *data) {
     if (success) {
         const char *format_name = sc_recorder_get_format_name(recorder->format);
         LOGI("Recording complete to %s file: %s", format_name,
-                                                  recorder->filename);
+                                                  recorder->segment_filename);
     } else {
         LOGE("Recording failed to %s", recorder->filename);
     }
@@ -503,42 +864,6 @@ run_recorder(void *data) {
     return 0;
 }
 
-static bool
-sc_recorder_set_orientation(AVStream *stream, enum sc_orientation orientation) {
-    assert(!sc_orientation_is_mirror(orientation));
-
-    uint8_t *raw_data;
-#ifdef SCRCPY_LAVC_HAS_CODECPAR_CODEC_SIDEDATA
-    AVPacketSideData *sd =
-        av_packet_side_data_new(&stream->codecpar->coded_side_data,
-                                &stream->codecpar->nb_coded_side_data,
-                                AV_PKT_DATA_DISPLAYMATRIX,
-                                sizeof(int32_t) * 9, 0);
-    if (!sd) {
-        LOG_OOM();
-        return false;
-    }
-
-    raw_data = sd->data;
-#else
-    raw_data = av_stream_new_side_data(stream, AV_PKT_DATA_DISPLAYMATRIX,
-                                      sizeof(int32_t) * 9);
-    if (!raw_data) {
-        LOG_OOM();
-        return false;
-    }
-#endif
-
-    int32_t *matrix = (int32_t *) raw_data;
-
-    unsigned rotation = orientation;
-    unsigned angle = rotation * 90;
-
-    av_display_rotation_set(matrix, angle);
-
-    return true;
-}
-
 static bool
 sc_recorder_video_packet_sink_open(struct sc_packet_sink *sink,
                                    AVCodecContext *ctx) {
@@ -745,7 +1070,8 @@ sc_recorder_stream_init(struct sc_recorder_stream *stream) {
 bool
 sc_recorder_init(struct sc_recorder *recorder, const char *filename,
                  enum sc_record_format format, bool video, bool audio,
-                 enum sc_orientation orientation,
+                 enum sc_orientation orientation, sc_tick segment_duration,
+                 uint64_t segment_size,
                  const struct sc_recorder_callbacks *cbs, void *cbs_userdata) {
     assert(!sc_orientation_is_mirror(orientation));
 
@@ -785,6 +1111,16 @@ sc_recorder_init(struct sc_recorder *recorder, const char *filename,
 
     recorder->format = format;
 
+    recorder->segment_duration = segment_duration;
+    recorder->segment_size = segment_size;
+    recorder->segment_index = 0;
+    recorder->segment_filename = NULL;
+    recorder->segment_expanded = NULL;
+    recorder->segment_origin = 0;
+    recorder->segment_retry_pts = AV_NOPTS_VALUE;
+    recorder->prev_ctx = NULL;
+    recorder->prev_filename = NULL;
+
     assert(cbs && cbs->on_ended);
     recorder->cbs = cbs;
     recorder->cbs_userdata = cbs_userdata;
@@ -849,5 +1185,7 @@ void
 sc_recorder_destroy(struct sc_recorder *recorder) {
     sc_cond_destroy(&recorder->cond);
     sc_mutex_destroy(&recorder->mutex);
+    free(recorder->segment_expanded);
+    free(recorder->segment_filename);
     free(recorder->filename);
 }
@@ -11,6 +11,7 @@
 #include "options.h"
 #include "trait/packet_sink.h"
 #include "util/thread.h"
+#include "util/tick.h"
 #include "util/vecdeque.h"
 
 struct sc_recorder_queue SC_VECDEQUE(AVPacket *);
@@ -58,6 +59,29 @@ struct sc_recorder {
     struct sc_recorder_stream video_stream;
     struct sc_recorder_stream audio_stream;
 
+    /* Segmented recording: a new file is started (on a video key frame) once
+     * the current one reaches the duration or the size limit. In that case,
+     * filename is a strftime() pattern.
+     *
+     * The segment state is only accessed by the recorder thread.
+     */
+    sc_tick segment_duration; // 0 for no duration limit
+    uint64_t segment_size; // in bytes, 0 for no size limit
+    unsigned segment_index;
+    char *segment_filename; // the current file name
+    char *segment_expanded; // the last expansion of the filename pattern
+    int64_t segment_origin; // pts (relative to the recording) of the segment
+    // after a failure to start a new segment, do not retry before this pts
+    int64_t segment_retry_pts;
+
+    // With video and audio, the previous segment is finalized only once the
+    // audio reaches the start of the current one, so that the late audio
+    // packets are written to the previous segment (NULL if none)
+    AVFormatContext *prev_ctx;
+    char *prev_filename;
+    int64_t prev_origin;
+    struct sc_recorder_stream prev_audio_stream;
+
     const struct sc_recorder_callbacks *cbs;
     void *cbs_userdata;
 };
@@ -70,7 +94,8 @@ struct sc_recorder_callbacks {
 bool
 sc_recorder_init(struct sc_recorder *recorder, const char *filename,
                  enum sc_record_format format, bool video, bool audio,
-                 enum sc_orientation orientation,
+                 enum sc_orientation orientation, sc_tick segment_duration,
+                 uint64_t segment_size,
                  const struct sc_recorder_callbacks *cbs, void *cbs_userdata);
 
 bool
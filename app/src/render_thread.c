@@ -0,0 +1,386 @@
+#include "render_thread.h"
+
+#include <assert.h>
+#include <string.h>
+#include <libavutil/frame.h>
+
+#include "util/log.h"
+
+// Delay before retrying to apply a pending texture or frame
+#define SC_RENDER_THREAD_RETRY_DELAY SC_TICK_FROM_MS(10)
+
+// Upload a new frame to the texture
+//
+// If the result is SC_DISPLAY_RESULT_PENDING, this is not an error, but the
+// frame could not be uploaded yet: the display keeps it, and it is uploaded by
+// the next successful sc_display_render().
+static enum sc_display_result
+sc_render_thread_upload(struct sc_render_thread *rt, const AVFrame *frame) {
+    struct sc_display *display = rt->display;
+
+    // The frame may be smaller than the video if it has been downscaled, so
+    // the texture size does not necessarily match the video size
+    struct sc_size size = {frame->width, frame->height};
+    if (display->texture_size.width != size.width
+            || display->texture_size.height != size.height) {
+        enum sc_display_result res =
+            sc_display_set_texture_size(display, size);
+        if (res == SC_DISPLAY_RESULT_ERROR) {
+            return res;
+        }
+    }
+
+    return sc_display_update_texture(display, frame);
+}
+
+static bool
+sc_render_thread_check_renderer(struct sc_render_thread *rt) {
+    // SDL2 only supports rendering from a non-main thread with the OpenGL
+    // renderers (whose context is made current on the calling thread)
+    SDL_RendererInfo renderer_info;
+    int r = SDL_GetRendererInfo(rt->display->renderer, &renderer_info);
+    if (r || strncmp(renderer_info.name, "opengl", 6)) {
+        LOGE("The render thread (--render-thread) requires an OpenGL "
+             "renderer (renderer: %s)", r ? "(unknown)" : renderer_info.name);
+        return false;
+    }
+
+    return true;
+}
+
+// The SDL renderer registers an event watch which updates its state on window
+// events (for example its viewport on SDL_WINDOWEVENT_SIZE_CHANGED). It is
+// executed by the thread which pushes the event (the main thread, which pumps
+// the window events), so it must not run while the renderer is used.
+//
+// The event watches are executed in the order they are added: the renderer
+// event watch is surrounded by these two event watches, which lock and unlock
+// the display mutex.
+//
+// The pointer events are not serialized, to never delay them: the renderer
+// event watch only adjusts them if a logical size is set, which is not the
+// case.
+static int SDLCALL
+sc_render_thread_lock_watch(void *userdata, SDL_Event *event) {
+    struct sc_render_thread *rt = userdata;
+
+    if (event->type == SDL_WINDOWEVENT) {
+        sc_mutex_lock(&rt->display_mutex);
+    }
+
+    return 0;
+}
+
+static int SDLCALL
+sc_render_thread_unlock_watch(void *userdata, SDL_Event *event) {
+    struct sc_render_thread *rt = userdata;
+
+    if (event->type == SDL_WINDOWEVENT) {
+        sc_mutex_unlock(&rt->display_mutex);
+    }
+
+    return 0;
+}
+
+static int
+run_render_thread(void *data) {
+    struct sc_render_thread *rt = data;
+
+    // The renderer must be created from the thread which uses it
+    bool ok = sc_display_init(rt->display, rt->window, NULL, rt->mipmaps,
+                              rt->pbo, rt->vsync);
+    if (ok) {
+        ok = sc_render_thread_check_renderer(rt);
+        if (!ok) {
+            sc_display_destroy(rt->display);
+        }
+    }
+
+    sc_mutex_lock(&rt->mutex);
+    rt->init_done = true;
+    rt->init_ok = ok;
+    sc_cond_signal(&rt->cond);
+    sc_mutex_unlock(&rt->mutex);
+
+    if (!ok) {
+        return 0;
+    }
+
+    bool has_frame = false;
+
+    // A frame received but not presented yet
+    bool pending = false;
+    int64_t pending_pts = 0;
+
+    // The display could not apply its pending texture or frame yet, the
+    // rendering must be retried periodically
+    bool must_retry = false;
+
+    bool error = false;
+
+    for (;;) {
+        sc_mutex_lock(&rt->mutex);
+
+        bool retry = false;
+        sc_tick deadline = sc_tick_now() + SC_RENDER_THREAD_RETRY_DELAY;
+        for (;;) {
+            if (rt->stopped || rt->render_requested) {
+                break;
+            }
+            if ((!rt->paused || rt->consume_once)
+                    && sc_frame_slot_has_new_frame(&rt->slot)) {
+                break;
+            }
+            if (must_retry) {
+                bool timed_out =
+                    !sc_cond_timedwait(&rt->cond, &rt->mutex, deadline);
+                if (timed_out) {
+                    retry = true;
+                    break;
+                }
+            } else {
+                sc_cond_wait(&rt->cond, &rt->mutex);
+            }
+        }
+
+        if (rt->stopped) {
+            sc_mutex_unlock(&rt->mutex);
+            break;
+        }
+
+        bool consume = !retry && (!rt->paused || rt->consume_once);
+        if (!retry) {
+            rt->consume_once = false;
+            rt->render_requested = false;
+        }
+        SDL_Rect rect = rt->rect;
+        enum sc_orientation orientation = rt->orientation;
+
+        sc_mutex_unlock(&rt->mutex);
+
+        if (consume) {
+            const AVFrame *frame = sc_frame_slot_consume(&rt->slot);
+            if (frame) {
+                sc_mutex_lock(&rt->display_mutex);
+                enum sc_display_result res = sc_render_thread_upload(rt, frame);
+                sc_mutex_unlock(&rt->display_mutex);
+                if (res == SC_DISPLAY_RESULT_ERROR) {
+                    LOGE("Frame update failed");
+                    rt->cbs->on_error(rt, rt->cbs_userdata);
+                    error = true;
+                    break;
+                }
+
+                // Even if pending, the frame is presented by the next
+                // successful render
+                has_frame = true;
+                pending = true;
+                pending_pts = frame->pts;
+            }
+        }
+
+        if (!has_frame || !rect.w || !rect.h) {
+            // Nothing to render yet (the window is shown on first frame)
+            continue;
+        }
+
+        sc_mutex_lock(&rt->display_mutex);
+        enum sc_display_result res =
+            sc_display_render(rt->display, &rect, orientation);
+        sc_mutex_unlock(&rt->display_mutex);
+        must_retry = res == SC_DISPLAY_RESULT_PENDING;
+        if (res != SC_DISPLAY_RESULT_OK) {
+            // Any error already logged
+            continue;
+        }
+
+        if (pending) {
+            pending = false;
+            sc_fps_counter_add_rendered_frame(rt->fps_counter);
+
+            sc_tick now = sc_tick_now();
+            if (rt->frame_scheduler) {
+                // With vsync, the presentation is complete
+                sc_frame_scheduler_on_present(rt->frame_scheduler, pending_pts,
+                                              now);
+            }
+            if (rt->av_sync) {
+                sc_av_sync_report_video(rt->av_sync, pending_pts, now);
+            }
+        }
+    }
+
+    if (error) {
+        // The renderer (and its event watch) must not be destroyed while the
+        // main thread pumps the events: SDL_DestroyRenderer() could not lock
+        // the display mutex without risking a deadlock with the SDL event
+        // watchers lock. Wait for the stop request.
+        sc_mutex_lock(&rt->mutex);
+        while (!rt->stopped) {
+            sc_cond_wait(&rt->cond, &rt->mutex);
+        }
+        sc_mutex_unlock(&rt->mutex);
+    }
+
+    sc_display_destroy(rt->display);
+
+    LOGD("Render thread ended");
+
+    return 0;
+}
+
+bool
+sc_render_thread_init(struct sc_render_thread *rt,
+                      const struct sc_render_thread_params *params) {
+    bool ok = sc_frame_slot_init(&rt->slot);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_mutex_init(&rt->mutex);
+    if (!ok) {
+        goto error_destroy_slot;
+    }
+
+    ok = sc_cond_init(&rt->cond);
+    if (!ok) {
+        goto error_destroy_mutex;
+    }
+
+    ok = sc_mutex_init(&rt->display_mutex);
+    if (!ok) {
+        goto error_destroy_cond;
+    }
+
+    rt->display = params->display;
+    rt->window = params->window;
+    rt->mipmaps = params->mipmaps;
+    rt->pbo = params->pbo;
+    rt->vsync = params->vsync;
+    rt->fps_counter = params->fps_counter;
+    rt->frame_scheduler = params->frame_scheduler;
+    rt->av_sync = params->av_sync;
+
+    rt->init_done = false;
+    rt->init_ok = false;
+    rt->stopped = false;
+    rt->render_requested = false;
+    rt->paused = false;
+    rt->consume_once = false;
+    rt->rect = (SDL_Rect) {0, 0, 0, 0};
+    rt->orientation = SC_ORIENTATION_0;
+
+    assert(params->cbs && params->cbs->on_error);
+    rt->cbs = params->cbs;
+    rt->cbs_userdata = params->cbs_userdata;
+
+    return true;
+
+error_destroy_cond:
+    sc_cond_destroy(&rt->cond);
+error_destroy_mutex:
+    sc_mutex_destroy(&rt->mutex);
+error_destroy_slot:
+    sc_frame_slot_destroy(&rt->slot);
+
+    return false;
+}
+
+bool
+sc_render_thread_start(struct sc_render_thread *rt) {
+    LOGD("Starting render thread");
+
+    // Must be added before the renderer event watch (added on renderer
+    // creation by the render thread)
+    SDL_AddEventWatch(sc_render_thread_lock_watch, rt);
+
+    bool ok = sc_thread_create(&rt->thread, run_render_thread, "scrcpy-render",
+                               rt);
+    if (!ok) {
+        LOGE("Could not start render thread");
+        SDL_DelEventWatch(sc_render_thread_lock_watch, rt);
+        return false;
+    }
+
+    sc_mutex_lock(&rt->mutex);
+    while (!rt->init_done) {
+        sc_cond_wait(&rt->cond, &rt->mutex);
+    }
+    ok = rt->init_ok;
+    sc_mutex_unlock(&rt->mutex);
+
+    if (!ok) {
+        sc_thread_join(&rt->thread, NULL);
+        SDL_DelEventWatch(sc_render_thread_lock_watch, rt);
+        return false;
+    }
+
+    // Must be added after the renderer event watch
+    SDL_AddEventWatch(sc_render_thread_unlock_watch, rt);
+
+    return true;
+}
+
+void
+sc_render_thread_stop(struct sc_render_thread *rt) {
+    sc_mutex_lock(&rt->mutex);
+    rt->stopped = true;
+    sc_cond_signal(&rt->cond);
+    sc_mutex_unlock(&rt->mutex);
+}
+
+void
+sc_render_thread_join(struct sc_render_thread *rt) {
+    sc_thread_join(&rt->thread, NULL);
+
+    SDL_DelEventWatch(sc_render_thread_unlock_watch, rt);
+    SDL_DelEventWatch(sc_render_thread_lock_watch, rt);
+}
+
+void
+sc_render_thread_destroy(struct sc_render_thread *rt) {
+    sc_mutex_destroy(&rt->display_mutex);
+    sc_cond_destroy(&rt->cond);
+    sc_mutex_destroy(&rt->mutex);
+    sc_frame_slot_destroy(&rt->slot);
+}
+
+bool
+sc_render_thread_push_frame(struct sc_render_thread *rt, const AVFrame *frame,
+                            bool *previous_frame_skipped) {
+    bool ok = sc_frame_slot_push(&rt->slot, frame, previous_frame_skipped);
+    if (!ok) {
+        return false;
+    }
+
+    // The frame is exchanged without lock, the mutex is only locked briefly to
+    // guarantee that the wakeup is not lost (it is never held while rendering)
+    sc_mutex_lock(&rt->mutex);
+    sc_cond_signal(&rt->cond);
+    sc_mutex_unlock(&rt->mutex);
+
+    return true;
+}
+
+void
+sc_render_thread_render(struct sc_render_thread *rt, const SDL_Rect *rect,
+                        enum sc_orientation orientation) {
+    sc_mutex_lock(&rt->mutex);
+    rt->rect = *rect;
+    rt->orientation = orientation;
+    rt->render_requested = true;
+    sc_cond_signal(&rt->cond);
+    sc_mutex_unlock(&rt->mutex);
+}
+
+void
+sc_render_thread_set_paused(struct sc_render_thread *rt, bool paused) {
+    sc_mutex_lock(&rt->mutex);
+    if (rt->paused) {
+        // Render the last received frame immediately
+        rt->consume_once = true;
+    }
+    rt->paused = paused;
+    sc_cond_signal(&rt->cond);
+    sc_mutex_unlock(&rt->mutex);
+}
@@ -0,0 +1,149 @@
+#ifndef SC_RENDER_THREAD_H
+#define SC_RENDER_THREAD_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+#include "av_sync.h"
+#include "display.h"
+#include "fps_counter.h"
+#include "frame_scheduler.h"
+#include "frame_slot.h"
+#include "options.h"
+#include "util/thread.h"
+
+// forward declarations
+typedef struct AVFrame AVFrame;
+
+/**
+ * A render thread uploads and renders the video frames, so that the main
+ * thread only handles the events (input, window events, etc.).
+ *
+ * Otherwise, a slow texture upload or SDL_RenderPresent() (which may wait for
+ * the vertical blanking) would delay the input events processing.
+ *
+ * The display (the renderer and its OpenGL context) is created, used and
+ * destroyed exclusively from the render thread. The only exception is the
+ * event watch registered by the SDL renderer, executed on window events by the
+ * thread which pumps the events (the main thread): it is serialized with the
+ * rendering by the display mutex.
+ *
+ * The frames are received from the frame producer thread through a lock-free
+ * frame slot: the frame is never copied while holding a lock. The producer
+ * only locks the mutex briefly to wake up the render thread (it is never held
+ * while rendering).
+ *
+ * The main thread only passes the content rectangle and orientation to render
+ * (computed from the window size).
+ */
+struct sc_render_thread {
+    struct sc_display *display;
+    struct sc_frame_slot slot;
+    struct sc_fps_counter *fps_counter;
+    struct sc_frame_scheduler *frame_scheduler; // may be NULL
+    struct sc_av_sync *av_sync; // may be NULL
+
+    // The parameters to initialize the display
+    SDL_Window *window;
+    bool mipmaps;
+    bool pbo;
+    bool vsync;
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+
+    // Held while the renderer is used by the render thread or by the SDL
+    // renderer event watch (on window events)
+    sc_mutex display_mutex;
+
+    // The following fields are protected by the mutex
+    bool init_done;
+    bool init_ok;
+    bool stopped;
+    bool render_requested;
+    bool paused;
+    bool consume_once; // consume a new frame even if paused
+    SDL_Rect rect; // empty until the window is shown
+    enum sc_orientation orientation;
+
+    const struct sc_render_thread_callbacks *cbs;
+    void *cbs_userdata;
+};
+
+struct sc_render_thread_callbacks {
+    // Called from the render thread on error (the thread stops rendering)
+    void (*on_error)(struct sc_render_thread *rt, void *userdata);
+};
+
+struct sc_render_thread_params {
+    struct sc_display *display; // initialized by the render thread
+    SDL_Window *window;
+    bool mipmaps;
+    bool pbo;
+    bool vsync;
+
+    struct sc_fps_counter *fps_counter;
+    struct sc_frame_scheduler *frame_scheduler; // may be NULL
+    struct sc_av_sync *av_sync; // may be NULL
+
+    const struct sc_render_thread_callbacks *cbs;
+    void *cbs_userdata;
+};
+
+bool
+sc_render_thread_init(struct sc_render_thread *rt,
+                      const struct sc_render_thread_params *params);
+
+/**
+ * Start the render thread, and wait for the display initialization
+ *
+ * Return false if the thread could not be started or if the display could not
+ * be initialized.
+ */
+bool
+sc_render_thread_start(struct sc_render_thread *rt);
+
+// Must be called once the main thread does not pump the events anymore
+void
+sc_render_thread_stop(struct sc_render_thread *rt);
+
+// The display is destroyed by the render thread before it terminates
+void
+sc_render_thread_join(struct sc_render_thread *rt);
+
+void
+sc_render_thread_destroy(struct sc_render_thread *rt);
+
+/**
+ * Push a new frame to upload and render (called from the frame producer)
+ *
+ * If the previous frame has not been rendered yet, it is replaced, and
+ * previous_frame_skipped is set to true.
+ *
+ * It never waits for the rendering: the frame is exchanged without lock, then
+ * the mutex is only locked to signal the render thread.
+ */
+bool
+sc_render_thread_push_frame(struct sc_render_thread *rt, const AVFrame *frame,
+                            bool *previous_frame_skipped);
+
+/**
+ * Request to render the current frame at the given position and orientation
+ */
+void
+sc_render_thread_render(struct sc_render_thread *rt, const SDL_Rect *rect,
+                        enum sc_orientation orientation);
+
+/**
+ * Pause or unpause the rendering of new frames
+ *
+ * If rendering was paused, the last received frame is rendered immediately,
+ * even if the new state is also paused (like sc_screen_set_paused()).
+ */
+void
+sc_render_thread_set_paused(struct sc_render_thread *rt, bool paused);
+
+#endif
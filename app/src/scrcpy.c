@@ -15,17 +15,22 @@
 #endif
 
 #include "audio_player.h"
+#include "av_sync.h"
 #include "controller.h"
 #include "decoder.h"
 #include "delay_buffer.h"
 #include "demuxer.h"
 #include "events.h"
 #include "file_pusher.h"
+#include "frame_queue.h"
+#include "frame_scheduler.h"
 #include "keyboard_sdk.h"
 #include "mouse_sdk.h"
+#include "packet_delay_buffer.h"
 #include "recorder.h"
 #include "screen.h"
 #include "server.h"
+#include "stream_dump.h"
 #include "uhid/gamepad_uhid.h"
 #include "uhid/keyboard_uhid.h"
 #include "uhid/mouse_uhid.h"
@@ -44,6 +49,24 @@
 #ifdef HAVE_V4L2
 # include "v4l2_sink.h"
 #endif
+#ifdef HAVE_SHM
+# include "shm_sink.h"
+#endif
+#ifdef HAVE_PCM_SINK
+# include "pcm_sink.h"
+#endif
+
+#ifdef HAVE_V4L2
+// Number of frames queued for the V4L2 sink when it shares the video frames
+// with the display
+# define SC_V4L2_FRAME_QUEUE_CAPACITY 4
+#endif
+
+#ifdef HAVE_SHM
+// Number of frames queued for the shm sink when it shares the video frames
+// with another sink
+# define SC_SHM_FRAME_QUEUE_CAPACITY 2
+#endif
 
 struct scrcpy {
     struct sc_server server;
@@ -51,13 +74,25 @@ struct scrcpy {
     struct sc_audio_player audio_player;
     struct sc_demuxer video_demuxer;
     struct sc_demuxer audio_demuxer;
+    struct sc_stream_dump stream_dump;
     struct sc_decoder video_decoder;
     struct sc_decoder audio_decoder;
     struct sc_recorder recorder;
     struct sc_delay_buffer video_buffer;
+    struct sc_packet_delay_buffer video_packet_buffer;
+    struct sc_frame_scheduler frame_scheduler;
+    struct sc_av_sync av_sync;
 #ifdef HAVE_V4L2
     struct sc_v4l2_sink v4l2_sink;
     struct sc_delay_buffer v4l2_buffer;
+    struct sc_frame_queue v4l2_queue;
+#endif
+#ifdef HAVE_SHM
+    struct sc_shm_sink shm_sink;
+    struct sc_frame_queue shm_queue;
+#endif
+#ifdef HAVE_PCM_SINK
+    struct sc_pcm_sink pcm_sink;
 #endif
     struct sc_controller controller;
     struct sc_file_pusher file_pusher;
@@ -304,6 +339,24 @@ sc_audio_demuxer_on_ended(struct sc_demuxer *demuxer,
     }
 }
 
+static void
+sc_video_decoder_on_error(struct sc_decoder *decoder, void *userdata) {
+    (void) decoder;
+
+    // NULL if control is disabled: wait for the next periodic key frame
+    struct sc_controller *controller = userdata;
+    if (!controller) {
+        return;
+    }
+
+    struct sc_control_msg msg;
+    msg.type = SC_CONTROL_MSG_TYPE_REQUEST_KEYFRAME;
+
+    if (!sc_controller_push_msg(controller, &msg)) {
+        LOGW("Could not request keyframe");
+    }
+}
+
 static void
 sc_controller_on_ended(struct sc_controller *controller, bool error,
                        void *userdata) {
@@ -403,6 +456,13 @@ scrcpy(struct scrcpy_options *options) {
 #ifdef HAVE_V4L2
     bool v4l2_sink_initialized = false;
 #endif
+#ifdef HAVE_SHM
+    bool shm_sink_initialized = false;
+#endif
+#ifdef HAVE_PCM_SINK
+    bool pcm_sink_initialized = false;
+#endif
+    bool stream_dump_initialized = false;
     bool video_demuxer_started = false;
     bool audio_demuxer_started = false;
 #ifdef HAVE_USB
@@ -413,6 +473,8 @@ scrcpy(struct scrcpy_options *options) {
 #endif
     bool controller_initialized = false;
     bool controller_started = false;
+    bool frame_scheduler_initialized = false;
+    bool av_sync_initialized = false;
     bool screen_initialized = false;
     bool timeout_initialized = false;
     bool timeout_started = false;
@@ -421,6 +483,14 @@ scrcpy(struct scrcpy_options *options) {
 
     uint32_t scid = scrcpy_generate_scid();
 
+    // stdout may be reserved for the PCM stream, so the output of the child
+    // processes (adb and the server) must not be written to stdout
+    bool stdout_reserved = false;
+#ifdef HAVE_PCM_SINK
+    stdout_reserved = options->pcm_sink
+                   && !strcmp(options->pcm_sink, SC_PCM_SINK_STDOUT);
+#endif
+
     struct sc_server_params params = {
         .scid = scid,
         .req_serial = options->serial,
@@ -439,6 +509,7 @@ scrcpy(struct scrcpy_options *options) {
         .max_size = options->max_size,
         .video_bit_rate = options->video_bit_rate,
         .audio_bit_rate = options->audio_bit_rate,
+        .audio_frame_duration = options->audio_frame_duration,
         .max_fps = options->max_fps,
         .angle = options->angle,
         .screen_off_timeout = options->screen_off_timeout,
@@ -462,6 +533,8 @@ scrcpy(struct scrcpy_options *options) {
         .camera_ar = options->camera_ar,
         .camera_fps = options->camera_fps,
         .force_adb_forward = options->force_adb_forward,
+        .multiplex = options->multiplex,
+        .stdout_reserved = stdout_reserved,
         .power_off_on_close = options->power_off_on_close,
         .clipboard_autosync = options->clipboard_autosync,
         .downsize_on_error = options->downsize_on_error,
@@ -566,7 +639,7 @@ scrcpy(struct scrcpy_options *options) {
 
     if (options->video_playback && options->control) {
         if (!sc_file_pusher_init(&s->file_pusher, serial,
-                                 options->push_target)) {
+                                 options->push_target, stdout_reserved)) {
             goto end;
         }
         fp = &s->file_pusher;
@@ -579,6 +652,12 @@ scrcpy(struct scrcpy_options *options) {
         };
         sc_demuxer_init(&s->video_demuxer, "video", s->server.video_socket,
                         &video_demuxer_cbs, NULL);
+        if (options->multiplex) {
+            struct sc_mux_stream *stream =
+                sc_demultiplexer_get_stream(&s->server.demultiplexer,
+                                            SC_MUX_STREAM_VIDEO);
+            sc_demuxer_set_mux_stream(&s->video_demuxer, stream);
+        }
     }
 
     if (options->audio) {
@@ -587,20 +666,69 @@ scrcpy(struct scrcpy_options *options) {
         };
         sc_demuxer_init(&s->audio_demuxer, "audio", s->server.audio_socket,
                         &audio_demuxer_cbs, options);
+        if (options->multiplex) {
+            struct sc_mux_stream *stream =
+                sc_demultiplexer_get_stream(&s->server.demultiplexer,
+                                            SC_MUX_STREAM_AUDIO);
+            sc_demuxer_set_mux_stream(&s->audio_demuxer, stream);
+        }
+    }
+
+    if (options->dump_stream_filename) {
+        if (!sc_stream_dump_init(&s->stream_dump,
+                                 options->dump_stream_filename)) {
+            goto end;
+        }
+        stream_dump_initialized = true;
+
+        if (options->video) {
+            sc_demuxer_set_dump(&s->video_demuxer, &s->stream_dump,
+                                SC_STREAM_DUMP_STREAM_VIDEO);
+        }
+        if (options->audio) {
+            sc_demuxer_set_dump(&s->audio_demuxer, &s->stream_dump,
+                                SC_STREAM_DUMP_STREAM_AUDIO);
+        }
     }
 
     bool needs_video_decoder = options->video_playback;
     bool needs_audio_decoder = options->audio_playback;
 #ifdef HAVE_V4L2
     needs_video_decoder |= !!options->v4l2_device;
+#endif
+#ifdef HAVE_SHM
+    needs_video_decoder |= !!options->shm_sink_name;
+#endif
+#ifdef HAVE_PCM_SINK
+    needs_audio_decoder |= !!options->pcm_sink;
 #endif
     if (needs_video_decoder) {
-        sc_decoder_init(&s->video_decoder, "video");
-        sc_packet_source_add_sink(&s->video_demuxer.packet_source,
-                                  &s->video_decoder.packet_sink);
+        sc_demuxer_set_decoder_threading(&s->video_demuxer,
+                                         options->video_decoder_threads,
+                                         options->video_decoder_thread_type);
+
+        static const struct sc_decoder_callbacks video_decoder_cbs = {
+            .on_error = sc_video_decoder_on_error,
+        };
+        // The controller is initialized below, before the demuxer is started
+        sc_decoder_init(&s->video_decoder, "video", &video_decoder_cbs,
+                        options->control ? &s->controller : NULL);
+
+        struct sc_packet_source *src = &s->video_demuxer.packet_source;
+        if (options->video_buffer
+                && options->video_buffer_mode == SC_VIDEO_BUFFER_MODE_ENCODED) {
+            // Delay the packets before decoding (the recorder is not delayed)
+            sc_packet_delay_buffer_init(&s->video_packet_buffer,
+                                        options->video_buffer, true);
+            sc_packet_source_add_sink(src,
+                                      &s->video_packet_buffer.packet_sink);
+            src = &s->video_packet_buffer.packet_source;
+        }
+
+        sc_packet_source_add_sink(src, &s->video_decoder.packet_sink);
     }
     if (needs_audio_decoder) {
-        sc_decoder_init(&s->audio_decoder, "audio");
+        sc_decoder_init(&s->audio_decoder, "audio", NULL, NULL);
         sc_packet_source_add_sink(&s->audio_demuxer.packet_source,
                                   &s->audio_decoder.packet_sink);
     }
@@ -612,6 +740,8 @@ scrcpy(struct scrcpy_options *options) {
         if (!sc_recorder_init(&s->recorder, options->record_filename,
                               options->record_format, options->video,
                               options->audio, options->record_orientation,
+                              options->record_segment_duration,
+                              options->record_segment_size,
                               &recorder_cbs, NULL)) {
             goto end;
         }
@@ -642,12 +772,25 @@ scrcpy(struct scrcpy_options *options) {
             .on_ended = sc_controller_on_ended,
         };
 
-        if (!sc_controller_init(&s->controller, s->server.control_socket,
+        sc_socket control_socket = s->server.control_socket;
+        if (options->multiplex) {
+            // The control messages are sent directly to the device socket
+            control_socket = s->server.demultiplexer.device_socket;
+        }
+
+        if (!sc_controller_init(&s->controller, control_socket,
             &controller_cbs, NULL)) {
             goto end;
         }
         controller_initialized = true;
 
+        if (options->multiplex) {
+            struct sc_mux_stream *stream =
+                sc_demultiplexer_get_stream(&s->server.demultiplexer,
+                                            SC_MUX_STREAM_CONTROL);
+            sc_controller_set_mux_stream(&s->controller, stream);
+        }
+
         controller = &s->controller;
 
 #ifdef HAVE_USB
@@ -822,10 +965,43 @@ aoa_complete:
             .window_borderless = options->window_borderless,
             .orientation = options->display_orientation,
             .mipmaps = options->mipmaps,
+            .pbo = options->pbo,
+            .downscale = options->texture_downscale,
+            .render_thread = options->render_thread,
             .fullscreen = options->fullscreen,
             .start_fps_counter = options->start_fps_counter,
         };
 
+        // The recorder does not consume decoded frames, but a V4L2 sink or a
+        // shm sink does
+        bool video_frames_shared = false;
+#ifdef HAVE_V4L2
+        video_frames_shared |= !!options->v4l2_device;
+#endif
+#ifdef HAVE_SHM
+        video_frames_shared |= !!options->shm_sink_name;
+#endif
+        if (options->video_playback && !video_frames_shared) {
+            screen_params.decoder = &s->video_decoder;
+        }
+
+        if (options->video_playback && options->vsync) {
+            if (!sc_frame_scheduler_init(&s->frame_scheduler)) {
+                goto end;
+            }
+            frame_scheduler_initialized = true;
+            screen_params.frame_scheduler = &s->frame_scheduler;
+        }
+
+        if (options->av_sync) {
+            assert(options->video_playback && options->audio_playback);
+            if (!sc_av_sync_init(&s->av_sync)) {
+                goto end;
+            }
+            av_sync_initialized = true;
+            screen_params.av_sync = &s->av_sync;
+        }
+
         if (!sc_screen_init(&s->screen, &screen_params)) {
             goto end;
         }
@@ -833,24 +1009,50 @@ aoa_complete:
 
         if (options->video_playback) {
             struct sc_frame_source *src = &s->video_decoder.frame_source;
-            if (options->video_buffer) {
-                sc_delay_buffer_init(&s->video_buffer,
-                                     options->video_buffer, true);
+            bool buffer_frames = options->video_buffer
+                && options->video_buffer_mode == SC_VIDEO_BUFFER_MODE_DECODED;
+            if (buffer_frames) {
+                sc_delay_buffer_init(&s->video_buffer, options->video_buffer,
+                                     true, screen_params.av_sync);
                 sc_frame_source_add_sink(src, &s->video_buffer.frame_sink);
                 src = &s->video_buffer.frame_source;
             }
 
+            if (frame_scheduler_initialized) {
+                sc_frame_source_add_sink(src,
+                                         &s->frame_scheduler.frame_sink);
+                src = &s->frame_scheduler.frame_source;
+            }
+
             sc_frame_source_add_sink(src, &s->screen.frame_sink);
         }
     }
 
     if (options->audio_playback) {
         sc_audio_player_init(&s->audio_player, options->audio_buffer,
-                             options->audio_output_buffer);
+                             options->audio_buffer_min,
+                             options->audio_buffer_max,
+                             options->audio_output_buffer,
+                             av_sync_initialized ? &s->av_sync : NULL);
         sc_frame_source_add_sink(&s->audio_decoder.frame_source,
                                  &s->audio_player.frame_sink);
     }
 
+#ifdef HAVE_PCM_SINK
+    if (options->pcm_sink) {
+        if (!sc_pcm_sink_init(&s->pcm_sink, options->pcm_sink)) {
+            goto end;
+        }
+
+        // The samples are written from a separate thread, the push() does
+        // not delay the audio player
+        sc_frame_source_add_sink(&s->audio_decoder.frame_source,
+                                 &s->pcm_sink.frame_sink);
+
+        pcm_sink_initialized = true;
+    }
+#endif
+
 #ifdef HAVE_V4L2
     if (options->v4l2_device) {
         if (!sc_v4l2_sink_init(&s->v4l2_sink, options->v4l2_device)) {
@@ -858,8 +1060,20 @@ aoa_complete:
         }
 
         struct sc_frame_source *src = &s->video_decoder.frame_source;
+        if (options->video_playback) {
+            // Do not let the V4L2 sink delay the display: forward the frames
+            // from a separate thread, keeping only the latest ones if it does
+            // not keep up (unless --frame-queue-policy=block)
+            sc_frame_queue_init(&s->v4l2_queue, "v4l2",
+                                SC_V4L2_FRAME_QUEUE_CAPACITY,
+                                options->frame_queue_policy);
+            sc_frame_source_add_sink(src, &s->v4l2_queue.frame_sink);
+            src = &s->v4l2_queue.frame_source;
+        }
+
         if (options->v4l2_buffer) {
-            sc_delay_buffer_init(&s->v4l2_buffer, options->v4l2_buffer, true);
+            sc_delay_buffer_init(&s->v4l2_buffer, options->v4l2_buffer, true,
+                                 NULL);
             sc_frame_source_add_sink(src, &s->v4l2_buffer.frame_sink);
             src = &s->v4l2_buffer.frame_source;
         }
@@ -870,6 +1084,33 @@ aoa_complete:
     }
 #endif
 
+#ifdef HAVE_SHM
+    if (options->shm_sink_name) {
+        if (!sc_shm_sink_init(&s->shm_sink, options->shm_sink_name)) {
+            goto end;
+        }
+
+        struct sc_frame_source *src = &s->video_decoder.frame_source;
+        bool shared = options->video_playback;
+# ifdef HAVE_V4L2
+        shared |= !!options->v4l2_device;
+# endif
+        if (shared) {
+            // The shm sink copies the frames synchronously, do not let it
+            // delay the other sinks (unless --frame-queue-policy=block)
+            sc_frame_queue_init(&s->shm_queue, "shm",
+                                SC_SHM_FRAME_QUEUE_CAPACITY,
+                                options->frame_queue_policy);
+            sc_frame_source_add_sink(src, &s->shm_queue.frame_sink);
+            src = &s->shm_queue.frame_source;
+        }
+
+        sc_frame_source_add_sink(src, &s->shm_sink.frame_sink);
+
+        shm_sink_initialized = true;
+    }
+#endif
+
     // Now that the header values have been consumed, the socket(s) will
     // receive the stream(s). Start the demuxer(s).
 
@@ -1015,12 +1256,28 @@ end:
         sc_demuxer_join(&s->audio_demuxer);
     }
 
+    if (stream_dump_initialized) {
+        sc_stream_dump_destroy(&s->stream_dump);
+    }
+
 #ifdef HAVE_V4L2
     if (v4l2_sink_initialized) {
         sc_v4l2_sink_destroy(&s->v4l2_sink);
     }
 #endif
 
+#ifdef HAVE_SHM
+    if (shm_sink_initialized) {
+        sc_shm_sink_destroy(&s->shm_sink);
+    }
+#endif
+
+#ifdef HAVE_PCM_SINK
+    if (pcm_sink_initialized) {
+        sc_pcm_sink_destroy(&s->pcm_sink);
+    }
+#endif
+
 #ifdef HAVE_USB
     if (aoa_hid_initialized) {
         sc_aoa_join(&s->aoa);
@@ -1039,6 +1296,15 @@ end:
         sc_screen_destroy(&s->screen);
     }
 
+    if (frame_scheduler_initialized) {
+        sc_frame_scheduler_destroy(&s->frame_scheduler);
+    }
+
+    if (av_sync_initialized) {
+        sc_av_sync_log_stats(&s->av_sync);
+        sc_av_sync_destroy(&s->av_sync);
+    }
+
     if (controller_started) {
         sc_controller_join(&s->controller);
     }
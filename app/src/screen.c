@@ -1,6 +1,7 @@
 #include "screen.h"
 
 #include <assert.h>
+#include <inttypes.h>
 #include <string.h>
 #include <SDL2/SDL.h>
 
@@ -162,6 +163,23 @@ sc_screen_is_relative_mode(struct sc_screen *screen) {
     return screen->im.mp && screen->im.mp->relative_mode;
 }
 
+static void
+sc_screen_update_downscale_target(struct sc_screen *screen) {
+    if (!screen->downscale) {
+        return;
+    }
+
+    // The frames are not rotated yet when they are downscaled
+    struct sc_size size = {screen->rect.w, screen->rect.h};
+    if (sc_orientation_is_swap(screen->orientation)) {
+        size = (struct sc_size) {size.height, size.width};
+    }
+
+    sc_mutex_lock(&screen->mutex);
+    screen->downscale_target_size = size;
+    sc_mutex_unlock(&screen->mutex);
+}
+
 static void
 sc_screen_update_content_rect(struct sc_screen *screen) {
     assert(screen->video);
@@ -181,6 +199,7 @@ sc_screen_update_content_rect(struct sc_screen *screen) {
         rect->y = 0;
         rect->w = drawable_size.width;
         rect->h = drawable_size.height;
+        sc_screen_update_downscale_target(screen);
         return;
     }
 
@@ -199,6 +218,8 @@ sc_screen_update_content_rect(struct sc_screen *screen) {
                                        / content_size.height;
         rect->x = (drawable_size.width - rect->w) / 2;
     }
+
+    sc_screen_update_downscale_target(screen);
 }
 
 // render the texture to the renderer
@@ -213,6 +234,12 @@ sc_screen_render(struct sc_screen *screen, bool update_content_rect) {
         sc_screen_update_content_rect(screen);
     }
 
+    if (screen->use_render_thread) {
+        sc_render_thread_render(&screen->render_thread, &screen->rect,
+                                screen->orientation);
+        return;
+    }
+
     enum sc_display_result res =
         sc_display_render(&screen->display, &screen->rect, screen->orientation);
     (void) res; // any error already logged
@@ -253,9 +280,6 @@ event_watcher(void *data, SDL_Event *event) {
 static bool
 sc_screen_frame_sink_open(struct sc_frame_sink *sink,
                           const AVCodecContext *ctx) {
-    assert(ctx->pix_fmt == AV_PIX_FMT_YUV420P);
-    (void) ctx;
-
     struct sc_screen *screen = DOWNCAST(sink);
 
     if (ctx->width <= 0 || ctx->width > 0xFFFF
@@ -264,6 +288,15 @@ sc_screen_frame_sink_open(struct sc_frame_sink *sink,
         return false;
     }
 
+    // The actual pixel format of the decoded frames may differ from the one
+    // of the codec context (known on first frame), so the frames are checked
+    // individually on push
+    bool ok = sc_frame_converter_init(&screen->frame_converter,
+                                      AV_PIX_FMT_YUV420P);
+    if (!ok) {
+        return false;
+    }
+
     assert(ctx->width > 0 && ctx->width <= 0xFFFF);
     assert(ctx->height > 0 && ctx->height <= 0xFFFF);
     // screen->frame_size is never used before the event is pushed, and the
@@ -272,8 +305,9 @@ sc_screen_frame_sink_open(struct sc_frame_sink *sink,
     screen->frame_size.height = ctx->height;
 
     // Post the event on the UI thread (the texture must be created from there)
-    bool ok = sc_push_event(SC_EVENT_SCREEN_INIT_SIZE);
+    ok = sc_push_event(SC_EVENT_SCREEN_INIT_SIZE);
     if (!ok) {
+        sc_frame_converter_destroy(&screen->frame_converter);
         return false;
     }
 
@@ -288,12 +322,70 @@ sc_screen_frame_sink_open(struct sc_frame_sink *sink,
 static void
 sc_screen_frame_sink_close(struct sc_frame_sink *sink) {
     struct sc_screen *screen = DOWNCAST(sink);
-    (void) screen;
 #ifndef NDEBUG
     screen->open = false;
 #endif
 
-    // nothing to do, the screen lifecycle is not managed by the frame producer
+    sc_frame_converter_destroy(&screen->frame_converter);
+
+    // the screen lifecycle is not managed by the frame producer
+}
+
+// Return the factor by which to downscale the frame (a power of 2) so that it
+// is not uploaded at more than twice the size of the target content rect
+static unsigned
+sc_screen_get_downscale_factor(struct sc_size frame_size,
+                               struct sc_size target_size) {
+    if (!target_size.width || !target_size.height) {
+        // unknown yet
+        return 1;
+    }
+
+    // Downscale by a power of 2, so that the texture is not recreated on every
+    // window resize (the GPU scales the remaining ratio, using mipmaps)
+    unsigned factor = 1;
+    while (frame_size.width >= target_size.width * factor * 2
+            && frame_size.height >= target_size.height * factor * 2) {
+        factor *= 2;
+    }
+
+    return factor;
+}
+
+static void
+sc_screen_on_frame_size(void *userdata);
+
+static bool
+sc_screen_push_to_render_thread(struct sc_screen *screen, const AVFrame *frame,
+                                struct sc_size frame_size) {
+    if (screen->last_frame_size.width != frame_size.width
+            || screen->last_frame_size.height != frame_size.height) {
+        // First frame or video size changed: the main thread must (re)size the
+        // window
+        screen->last_frame_size = frame_size;
+
+        sc_mutex_lock(&screen->mutex);
+        screen->pending_frame_size = frame_size;
+        sc_mutex_unlock(&screen->mutex);
+
+        bool ok = sc_post_to_main_thread(sc_screen_on_frame_size, screen);
+        if (!ok) {
+            return false;
+        }
+    }
+
+    bool previous_skipped;
+    bool ok = sc_render_thread_push_frame(&screen->render_thread, frame,
+                                          &previous_skipped);
+    if (!ok) {
+        return false;
+    }
+
+    if (previous_skipped) {
+        sc_fps_counter_add_skipped_frame(&screen->fps_counter);
+    }
+
+    return true;
 }
 
 static bool
@@ -301,8 +393,45 @@ sc_screen_frame_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
     struct sc_screen *screen = DOWNCAST(sink);
     assert(screen->video);
 
+    struct sc_size frame_size = {frame->width, frame->height};
+
+    unsigned factor = 1;
+    if (screen->downscale) {
+        sc_mutex_lock(&screen->mutex);
+        struct sc_size target_size = screen->downscale_target_size;
+        sc_mutex_unlock(&screen->mutex);
+
+        factor = sc_screen_get_downscale_factor(frame_size, target_size);
+    }
+
+    // Convert or downscale from the frame producer thread, to keep the UI
+    // thread responsive
+    if (factor > 1) {
+        int width = (frame->width + factor - 1) / factor;
+        int height = (frame->height + factor - 1) / factor;
+        frame = sc_frame_converter_scale(&screen->frame_converter, frame,
+                                         width, height);
+        if (!frame) {
+            return false;
+        }
+    } else if (!sc_display_supports_format(&screen->display, frame->format)) {
+        frame = sc_frame_converter_convert(&screen->frame_converter, frame);
+        if (!frame) {
+            return false;
+        }
+    }
+
+    if (screen->use_render_thread) {
+        return sc_screen_push_to_render_thread(screen, frame, frame_size);
+    }
+
+    sc_mutex_lock(&screen->mutex);
     bool previous_skipped;
     bool ok = sc_frame_buffer_push(&screen->fb, frame, &previous_skipped);
+    if (ok) {
+        screen->pending_frame_size = frame_size;
+    }
+    sc_mutex_unlock(&screen->mutex);
     if (!ok) {
         return false;
     }
@@ -322,6 +451,48 @@ sc_screen_frame_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
     return true;
 }
 
+static void
+sc_screen_on_render_error(struct sc_render_thread *rt, void *userdata) {
+    (void) rt;
+    (void) userdata;
+
+    sc_push_event(SC_EVENT_RENDER_ERROR);
+}
+
+static bool
+sc_screen_start_render_thread(struct sc_screen *screen, bool mipmaps, bool pbo,
+                              bool vsync) {
+    static const struct sc_render_thread_callbacks cbs = {
+        .on_error = sc_screen_on_render_error,
+    };
+
+    struct sc_render_thread_params params = {
+        .display = &screen->display,
+        .window = screen->window,
+        .mipmaps = mipmaps,
+        .pbo = pbo,
+        .vsync = vsync,
+        .fps_counter = &screen->fps_counter,
+        .frame_scheduler = screen->frame_scheduler,
+        .av_sync = screen->av_sync,
+        .cbs = &cbs,
+        .cbs_userdata = screen,
+    };
+
+    bool ok = sc_render_thread_init(&screen->render_thread, &params);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_render_thread_start(&screen->render_thread);
+    if (!ok) {
+        sc_render_thread_destroy(&screen->render_thread);
+        return false;
+    }
+
+    return true;
+}
+
 bool
 sc_screen_init(struct sc_screen *screen,
                const struct sc_screen_params *params) {
@@ -333,6 +504,16 @@ sc_screen_init(struct sc_screen *screen,
     screen->paused = false;
     screen->resume_frame = NULL;
     screen->orientation = SC_ORIENTATION_0;
+    screen->downscale = params->video && params->downscale;
+    screen->downscale_target_size = (struct sc_size) {0, 0};
+    screen->decoder = params->decoder;
+    screen->frame_scheduler = params->frame_scheduler;
+    screen->av_sync = params->av_sync;
+    screen->use_render_thread = params->video && params->render_thread;
+    screen->last_frame_size = (struct sc_size) {0, 0};
+    screen->input_delay.count = 0;
+    screen->input_delay.total = 0;
+    screen->input_delay.max = 0;
 
     screen->video = params->video;
 
@@ -348,10 +529,15 @@ sc_screen_init(struct sc_screen *screen,
         return false;
     }
 
-    if (!sc_fps_counter_init(&screen->fps_counter)) {
+    ok = sc_mutex_init(&screen->mutex);
+    if (!ok) {
         goto error_destroy_frame_buffer;
     }
 
+    if (!sc_fps_counter_init(&screen->fps_counter)) {
+        goto error_destroy_mutex;
+    }
+
     if (screen->video) {
         screen->orientation = params->orientation;
         if (screen->orientation != SC_ORIENTATION_0) {
@@ -414,8 +600,14 @@ sc_screen_init(struct sc_screen *screen,
 
     SDL_Surface *icon_novideo = params->video ? NULL : icon;
     bool mipmaps = params->video && params->mipmaps;
-    ok = sc_display_init(&screen->display, screen->window, icon_novideo,
-                         mipmaps);
+    bool pbo = params->video && params->pbo;
+    bool vsync = params->video && params->frame_scheduler;
+    if (screen->use_render_thread) {
+        ok = sc_screen_start_render_thread(screen, mipmaps, pbo, vsync);
+    } else {
+        ok = sc_display_init(&screen->display, screen->window, icon_novideo,
+                             mipmaps, pbo, vsync);
+    }
     if (icon) {
         scrcpy_icon_destroy(icon);
     }
@@ -473,17 +665,44 @@ sc_screen_init(struct sc_screen *screen,
     return true;
 
 error_destroy_display:
-    sc_display_destroy(&screen->display);
+    if (screen->use_render_thread) {
+        // The display is destroyed by the render thread
+        sc_render_thread_stop(&screen->render_thread);
+        sc_render_thread_join(&screen->render_thread);
+        sc_render_thread_destroy(&screen->render_thread);
+    } else {
+        sc_display_destroy(&screen->display);
+    }
 error_destroy_window:
     SDL_DestroyWindow(screen->window);
 error_destroy_fps_counter:
     sc_fps_counter_destroy(&screen->fps_counter);
+error_destroy_mutex:
+    sc_mutex_destroy(&screen->mutex);
 error_destroy_frame_buffer:
     sc_frame_buffer_destroy(&screen->fb);
 
     return false;
 }
 
+static void
+sc_screen_update_refresh_rate(struct sc_screen *screen) {
+    if (!screen->frame_scheduler) {
+        return;
+    }
+
+    int refresh_rate = 0; // unknown
+    int display_index = SDL_GetWindowDisplayIndex(screen->window);
+    if (display_index >= 0) {
+        SDL_DisplayMode mode;
+        if (!SDL_GetCurrentDisplayMode(display_index, &mode)) {
+            refresh_rate = mode.refresh_rate;
+        }
+    }
+
+    sc_frame_scheduler_set_refresh_rate(screen->frame_scheduler, refresh_rate);
+}
+
 static void
 sc_screen_show_initial_window(struct sc_screen *screen) {
     int x = screen->req.x != SC_WINDOW_POSITION_UNDEFINED
@@ -508,6 +727,7 @@ sc_screen_show_initial_window(struct sc_screen *screen) {
 
     SDL_ShowWindow(screen->window);
     sc_screen_update_content_rect(screen);
+    sc_screen_update_refresh_rate(screen);
 }
 
 void
@@ -518,11 +738,17 @@ sc_screen_hide_window(struct sc_screen *screen) {
 void
 sc_screen_interrupt(struct sc_screen *screen) {
     sc_fps_counter_interrupt(&screen->fps_counter);
+    if (screen->use_render_thread) {
+        sc_render_thread_stop(&screen->render_thread);
+    }
 }
 
 void
 sc_screen_join(struct sc_screen *screen) {
     sc_fps_counter_join(&screen->fps_counter);
+    if (screen->use_render_thread) {
+        sc_render_thread_join(&screen->render_thread);
+    }
 }
 
 void
@@ -530,10 +756,22 @@ sc_screen_destroy(struct sc_screen *screen) {
 #ifndef NDEBUG
     assert(!screen->open);
 #endif
-    sc_display_destroy(&screen->display);
+    if (screen->input_delay.count) {
+        LOGD("Input events dispatch delay: avg=%.1f ms max=%" PRIu32 " ms",
+             (double) screen->input_delay.total / screen->input_delay.count,
+             screen->input_delay.max);
+    }
+
+    if (screen->use_render_thread) {
+        // The display has been destroyed by the render thread
+        sc_render_thread_destroy(&screen->render_thread);
+    } else {
+        sc_display_destroy(&screen->display);
+    }
     av_frame_free(&screen->frame);
     SDL_DestroyWindow(screen->window);
     sc_fps_counter_destroy(&screen->fps_counter);
+    sc_mutex_destroy(&screen->mutex);
     sc_frame_buffer_destroy(&screen->fb);
 }
 
@@ -614,42 +852,97 @@ sc_screen_init_size(struct sc_screen *screen) {
         get_oriented_size(screen->frame_size, screen->orientation);
     screen->content_size = content_size;
 
+    if (screen->use_render_thread) {
+        // The texture is created by the render thread on first frame
+        return true;
+    }
+
     enum sc_display_result res =
         sc_display_set_texture_size(&screen->display, screen->frame_size);
     return res != SC_DISPLAY_RESULT_ERROR;
 }
 
-// recreate the texture and resize the window if the frame size has changed
-static enum sc_display_result
-prepare_for_frame(struct sc_screen *screen, struct sc_size new_frame_size) {
-    assert(screen->video);
+// resize the window if the video size has changed
+static void
+sc_screen_update_frame_size(struct sc_screen *screen,
+                            struct sc_size new_frame_size) {
+    if (screen->frame_size.width != new_frame_size.width
+            || screen->frame_size.height != new_frame_size.height) {
+        // frame dimension changed
+        screen->frame_size = new_frame_size;
 
-    if (screen->frame_size.width == new_frame_size.width
-            && screen->frame_size.height == new_frame_size.height) {
-        return SC_DISPLAY_RESULT_OK;
+        struct sc_size new_content_size =
+            get_oriented_size(new_frame_size, screen->orientation);
+        set_content_size(screen, new_content_size);
+
+        sc_screen_update_content_rect(screen);
     }
+}
 
-    // frame dimension changed
-    screen->frame_size = new_frame_size;
+static void
+sc_screen_on_first_frame(struct sc_screen *screen) {
+    assert(!screen->has_frame);
+    screen->has_frame = true;
+    // this is the very first frame, show the window
+    sc_screen_show_initial_window(screen);
 
-    struct sc_size new_content_size =
-        get_oriented_size(new_frame_size, screen->orientation);
-    set_content_size(screen, new_content_size);
+    if (sc_screen_is_relative_mode(screen)) {
+        // Capture mouse on start
+        sc_mouse_capture_set_active(&screen->mc, true);
+    }
+}
 
-    sc_screen_update_content_rect(screen);
+// Called on the main thread when the render thread is enabled, on first frame
+// and when the video size changes
+static void
+sc_screen_on_frame_size(void *userdata) {
+    struct sc_screen *screen = userdata;
+    assert(screen->use_render_thread);
+
+    sc_mutex_lock(&screen->mutex);
+    struct sc_size frame_size = screen->pending_frame_size;
+    sc_mutex_unlock(&screen->mutex);
+
+    sc_screen_update_frame_size(screen, frame_size);
+
+    if (!screen->has_frame) {
+        sc_screen_on_first_frame(screen);
+    }
+
+    // Pass the new content rect to the render thread
+    sc_screen_render(screen, true);
+}
+
+// resize the window if the video size has changed, and recreate the texture if
+// the texture size has changed
+//
+// The texture size is the video size, unless the frame has been downscaled.
+static enum sc_display_result
+prepare_for_frame(struct sc_screen *screen, struct sc_size new_frame_size,
+                  struct sc_size texture_size) {
+    assert(screen->video);
+
+    sc_screen_update_frame_size(screen, new_frame_size);
+
+    struct sc_size current = screen->display.texture_size;
+    if (current.width == texture_size.width
+            && current.height == texture_size.height) {
+        return SC_DISPLAY_RESULT_OK;
+    }
 
-    return sc_display_set_texture_size(&screen->display, screen->frame_size);
+    return sc_display_set_texture_size(&screen->display, texture_size);
 }
 
 static bool
-sc_screen_apply_frame(struct sc_screen *screen) {
+sc_screen_apply_frame(struct sc_screen *screen, struct sc_size frame_size) {
     assert(screen->video);
 
     sc_fps_counter_add_rendered_frame(&screen->fps_counter);
 
     AVFrame *frame = screen->frame;
-    struct sc_size new_frame_size = {frame->width, frame->height};
-    enum sc_display_result res = prepare_for_frame(screen, new_frame_size);
+    struct sc_size texture_size = {frame->width, frame->height};
+    enum sc_display_result res =
+        prepare_for_frame(screen, frame_size, texture_size);
     if (res == SC_DISPLAY_RESULT_ERROR) {
         return false;
     }
@@ -668,17 +961,21 @@ sc_screen_apply_frame(struct sc_screen *screen) {
     }
 
     if (!screen->has_frame) {
-        screen->has_frame = true;
-        // this is the very first frame, show the window
-        sc_screen_show_initial_window(screen);
-
-        if (sc_screen_is_relative_mode(screen)) {
-            // Capture mouse on start
-            sc_mouse_capture_set_active(&screen->mc, true);
-        }
+        sc_screen_on_first_frame(screen);
     }
 
     sc_screen_render(screen, false);
+
+    sc_tick now = sc_tick_now();
+    if (screen->frame_scheduler) {
+        // With vsync, the presentation is complete
+        sc_frame_scheduler_on_present(screen->frame_scheduler, frame->pts,
+                                      now);
+    }
+    if (screen->av_sync) {
+        sc_av_sync_report_video(screen->av_sync, frame->pts, now);
+    }
+
     return true;
 }
 
@@ -696,13 +993,19 @@ sc_screen_update_frame(struct sc_screen *screen) {
         } else {
             av_frame_unref(screen->resume_frame);
         }
+        sc_mutex_lock(&screen->mutex);
         sc_frame_buffer_consume(&screen->fb, screen->resume_frame);
+        screen->resume_frame_size = screen->pending_frame_size;
+        sc_mutex_unlock(&screen->mutex);
         return true;
     }
 
     av_frame_unref(screen->frame);
+    sc_mutex_lock(&screen->mutex);
     sc_frame_buffer_consume(&screen->fb, screen->frame);
-    return sc_screen_apply_frame(screen);
+    struct sc_size frame_size = screen->pending_frame_size;
+    sc_mutex_unlock(&screen->mutex);
+    return sc_screen_apply_frame(screen, frame_size);
 }
 
 void
@@ -714,13 +1017,15 @@ sc_screen_set_paused(struct sc_screen *screen, bool paused) {
         return;
     }
 
-    if (screen->paused && screen->resume_frame) {
+    if (screen->use_render_thread) {
+        sc_render_thread_set_paused(&screen->render_thread, paused);
+    } else if (screen->paused && screen->resume_frame) {
         // If display screen was paused, refresh the frame immediately, even if
         // the new state is also paused.
         av_frame_free(&screen->frame);
         screen->frame = screen->resume_frame;
         screen->resume_frame = NULL;
-        sc_screen_apply_frame(screen);
+        sc_screen_apply_frame(screen, screen->resume_frame_size);
     }
 
     if (!paused) {
@@ -798,6 +1103,18 @@ sc_screen_resize_to_pixel_perfect(struct sc_screen *screen) {
                                             content_size.height);
 }
 
+static void
+sc_screen_record_input_delay(struct sc_screen *screen, const SDL_Event *event) {
+    // The SDL timestamp is expressed in milliseconds since SDL initialization
+    uint32_t delay = SDL_GetTicks() - event->common.timestamp;
+
+    ++screen->input_delay.count;
+    screen->input_delay.total += delay;
+    if (delay > screen->input_delay.max) {
+        screen->input_delay.max = delay;
+    }
+}
+
 bool
 sc_screen_handle_event(struct sc_screen *screen, const SDL_Event *event) {
     switch (event->type) {
@@ -818,6 +1135,9 @@ sc_screen_handle_event(struct sc_screen *screen, const SDL_Event *event) {
             }
             return true;
         }
+        case SC_EVENT_RENDER_ERROR:
+            // The error has been logged by the render thread
+            return false;
         case SDL_WINDOWEVENT:
             if (!screen->video
                     && event->window.event == SDL_WINDOWEVENT_EXPOSED) {
@@ -837,13 +1157,28 @@ sc_screen_handle_event(struct sc_screen *screen, const SDL_Event *event) {
                 case SDL_WINDOWEVENT_SIZE_CHANGED:
                     sc_screen_render(screen, true);
                     break;
+                case SDL_WINDOWEVENT_MOVED:
+                    // The window may have been moved to another display
+                    sc_screen_update_refresh_rate(screen);
+                    break;
                 case SDL_WINDOWEVENT_MAXIMIZED:
                     screen->maximized = true;
                     break;
                 case SDL_WINDOWEVENT_MINIMIZED:
                     screen->minimized = true;
+                    if (screen->decoder) {
+                        // The frames are not visible, do not waste CPU
+                        sc_decoder_set_skip_nonref(screen->decoder, true);
+                    }
                     break;
                 case SDL_WINDOWEVENT_RESTORED:
+                    // The window is visible again, even in fullscreen (in
+                    // which case the early break below must not keep
+                    // skipping the non-reference frames forever)
+                    if (screen->minimized && screen->decoder) {
+                        sc_decoder_set_skip_nonref(screen->decoder, false);
+                    }
+                    screen->minimized = false;
                     if (screen->fullscreen) {
                         // On Windows, in maximized+fullscreen, disabling
                         // fullscreen mode unexpectedly triggers the "restored"
@@ -853,7 +1188,6 @@ sc_screen_handle_event(struct sc_screen *screen, const SDL_Event *event) {
                         break;
                     }
                     screen->maximized = false;
-                    screen->minimized = false;
                     apply_pending_resize(screen);
                     sc_screen_render(screen, true);
                     break;
@@ -867,6 +1201,7 @@ sc_screen_handle_event(struct sc_screen *screen, const SDL_Event *event) {
         return true;
     }
 
+    sc_screen_record_input_delay(screen, event);
     sc_input_manager_handle_event(&screen->im, event);
     return true;
 }
@@ -10,14 +10,19 @@
 #include <libavutil/frame.h>
 #include <libavutil/pixfmt.h>
 
+#include "av_sync.h"
 #include "controller.h"
 #include "coords.h"
+#include "decoder.h"
 #include "display.h"
 #include "fps_counter.h"
 #include "frame_buffer.h"
+#include "frame_converter.h"
+#include "frame_scheduler.h"
 #include "input_manager.h"
 #include "mouse_capture.h"
 #include "options.h"
+#include "render_thread.h"
 #include "trait/key_processor.h"
 #include "trait/frame_sink.h"
 #include "trait/mouse_processor.h"
@@ -35,6 +40,28 @@ struct sc_screen {
     struct sc_input_manager im;
     struct sc_mouse_capture mc; // only used in mouse relative mode
     struct sc_frame_buffer fb;
+    // Convert the frames the display does not support natively, or downscale
+    // them (only accessed from the frame producer thread)
+    struct sc_frame_converter frame_converter;
+    // Downscale the frames before upload if they are rendered much smaller
+    bool downscale;
+
+    // Frames may be downscaled before upload, so their size may differ from
+    // the video size: the video size of each frame is stored along the frame
+    // buffer
+    sc_mutex mutex;
+    struct sc_size pending_frame_size; // video size of the pending frame
+    // The size of the content rect, in the frame orientation (only used if
+    // downscale is enabled)
+    struct sc_size downscale_target_size;
+
+    // If enabled, the frames are uploaded and rendered by the render thread,
+    // which owns the display (the frame buffer is not used)
+    bool use_render_thread;
+    struct sc_render_thread render_thread;
+    // The size of the last frame pushed (only accessed from the frame producer
+    // thread)
+    struct sc_size last_frame_size;
     struct sc_fps_counter fps_counter;
 
     // The initial requested window properties
@@ -69,6 +96,24 @@ struct sc_screen {
 
     bool paused;
     AVFrame *resume_frame;
+    struct sc_size resume_frame_size;
+
+    // Notified when the window is minimized or restored (may be NULL)
+    struct sc_decoder *decoder;
+
+    // Notified of the display refresh rate and of the frame presentations
+    // (may be NULL)
+    struct sc_frame_scheduler *frame_scheduler;
+    // Notified of the frame presentations (may be NULL)
+    struct sc_av_sync *av_sync;
+
+    // Delay between the generation of the input events and their processing,
+    // in milliseconds
+    struct {
+        uint64_t count;
+        uint64_t total;
+        uint32_t max;
+    } input_delay;
 };
 
 struct sc_screen_params {
@@ -97,9 +142,23 @@ struct sc_screen_params {
 
     enum sc_orientation orientation;
     bool mipmaps;
+    bool pbo;
+    bool downscale;
+    bool render_thread;
 
     bool fullscreen;
     bool start_fps_counter;
+
+    // The decoder to skip non-reference frames while the window is minimized,
+    // or NULL if the frames are also consumed by other sinks
+    struct sc_decoder *decoder;
+
+    // The frame scheduler feeding the screen, or NULL to present the frames
+    // as soon as they are received (if set, vsync is enabled)
+    struct sc_frame_scheduler *frame_scheduler;
+
+    // The A/V sync to notify of the frame presentations (may be NULL)
+    struct sc_av_sync *av_sync;
 };
 
 // initialize screen, create window, renderer and texture (window is hidden)
@@ -53,8 +53,27 @@ get_server_path(void) {
     return server_path;
 }
 
+static uint16_t
+get_replay_port(void) {
+    char *value = sc_get_env("SCRCPY_REPLAY_PORT");
+    if (!value) {
+        return 0;
+    }
+
+    long port;
+    bool ok = sc_str_parse_integer(value, &port);
+    free(value);
+    if (!ok || port <= 0 || port > 0xFFFF) {
+        LOGW("Invalid SCRCPY_REPLAY_PORT, ignored");
+        return 0;
+    }
+
+    LOGD("Using SCRCPY_REPLAY_PORT: %ld", port);
+    return port;
+}
+
 static bool
-push_server(struct sc_intr *intr, const char *serial) {
+push_server(struct sc_intr *intr, const char *serial, unsigned flags) {
     char *server_path = get_server_path();
     if (!server_path) {
         return false;
@@ -64,7 +83,8 @@ push_server(struct sc_intr *intr, const char *serial) {
         free(server_path);
         return false;
     }
-    bool ok = sc_adb_push(intr, serial, server_path, SC_DEVICE_SERVER_PATH, 0);
+    bool ok = sc_adb_push(intr, serial, server_path, SC_DEVICE_SERVER_PATH,
+                          flags);
     free(server_path);
     return ok;
 }
@@ -277,6 +297,11 @@ execute_server(struct sc_server *server,
     if (params->audio_bit_rate) {
         ADD_PARAM("audio_bit_rate=%" PRIu32, params->audio_bit_rate);
     }
+    if (params->audio_frame_duration) {
+        assert(params->audio_frame_duration > 0);
+        uint64_t us = SC_TICK_TO_US(params->audio_frame_duration);
+        ADD_PARAM("audio_frame_duration=%" PRIu64, us);
+    }
     if (params->video_codec != SC_CODEC_H264) {
         ADD_PARAM("video_codec=%s",
                   sc_server_get_codec_name(params->video_codec));
@@ -324,6 +349,9 @@ execute_server(struct sc_server *server,
     if (server->tunnel.forward) {
         ADD_PARAM("tunnel_forward=true");
     }
+    if (params->multiplex) {
+        ADD_PARAM("multiplex=true");
+    }
     if (params->crop) {
         VALIDATE_STRING(params->crop);
         ADD_PARAM("crop=%s", params->crop);
@@ -452,8 +480,10 @@ execute_server(struct sc_server *server,
     //     Port: 5005
     // Then click on "Debug"
 #endif
-    // Inherit both stdout and stderr (all server logs are printed to stdout)
-    pid = sc_adb_execute(cmd, 0);
+    // Inherit both stdout and stderr (all server logs are printed to stdout,
+    // unless stdout is reserved for a data stream)
+    unsigned flags = params->stdout_reserved ? SC_ADB_STDOUT_TO_STDERR : 0;
+    pid = sc_adb_execute(cmd, flags);
 
 end:
     for (unsigned i = dyn_idx; i < count; ++i) {
@@ -550,11 +580,13 @@ sc_server_init(struct sc_server *server, const struct sc_server_params *params,
 
     server->serial = NULL;
     server->device_socket_name = NULL;
+    server->replay_port = 0;
     server->stopped = false;
 
     server->video_socket = SC_SOCKET_NONE;
     server->audio_socket = SC_SOCKET_NONE;
     server->control_socket = SC_SOCKET_NONE;
+    server->demultiplexer_initialized = false;
 
     sc_adb_tunnel_init(&server->tunnel);
 
@@ -585,11 +617,92 @@ device_read_info(struct sc_intr *intr, sc_socket device_socket,
     return true;
 }
 
+static bool
+sc_server_connect_multiplexed(struct sc_server *server,
+                              struct sc_server_info *info) {
+    struct sc_adb_tunnel *tunnel = &server->tunnel;
+    assert(tunnel->enabled);
+
+    const char *serial = server->serial;
+    assert(serial);
+
+    sc_socket device_socket;
+    if (!tunnel->forward) {
+        device_socket = net_accept_intr(&server->intr, tunnel->server_socket);
+    } else {
+        uint32_t tunnel_host = server->params.tunnel_host;
+        if (!tunnel_host) {
+            tunnel_host = IPV4_LOCALHOST;
+        }
+
+        uint16_t tunnel_port = server->params.tunnel_port;
+        if (!tunnel_port) {
+            tunnel_port = tunnel->local_port;
+        }
+
+        unsigned attempts = 100;
+        sc_tick delay = SC_TICK_FROM_MS(100);
+        device_socket = connect_to_server(server, attempts, delay, tunnel_host,
+                                          tunnel_port);
+    }
+
+    // we don't need the adb tunnel anymore
+    sc_adb_tunnel_close(tunnel, &server->intr, serial,
+                        server->device_socket_name);
+
+    if (device_socket == SC_SOCKET_NONE) {
+        return false;
+    }
+
+    // The device info is sent before any multiplexed chunk
+    bool ok = device_read_info(&server->intr, device_socket, info);
+    if (!ok) {
+        goto error_close_device_socket;
+    }
+
+    ok = sc_demultiplexer_init(&server->demultiplexer, device_socket,
+                               server->params.video, server->params.audio,
+                               server->params.control);
+    if (!ok) {
+        goto error_close_device_socket;
+    }
+
+    ok = sc_demultiplexer_start(&server->demultiplexer);
+    if (!ok) {
+        // This also closes the device socket
+        sc_demultiplexer_destroy(&server->demultiplexer);
+        return false;
+    }
+
+    // The consumers read from the demultiplexer in-memory streams, and the
+    // controller writes directly to the device socket (the video, audio and
+    // control sockets are not set)
+    server->demultiplexer_initialized = true;
+
+    return true;
+
+error_close_device_socket:
+    net_close(device_socket);
+
+    return false;
+}
+
 static bool
 sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
     struct sc_adb_tunnel *tunnel = &server->tunnel;
 
-    assert(tunnel->enabled);
+    // When replaying a stream dump, there is no adb tunnel
+    bool replay = server->replay_port;
+    assert(tunnel->enabled || replay);
+
+    if (server->params.multiplex) {
+        if (replay) {
+            LOGE("Multiplexing is not supported when replaying a stream dump");
+            return false;
+        }
+
+        return sc_server_connect_multiplexed(server, info);
+    }
 
     const char *serial = server->serial;
     assert(serial);
@@ -601,7 +714,7 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
     sc_socket video_socket = SC_SOCKET_NONE;
     sc_socket audio_socket = SC_SOCKET_NONE;
     sc_socket control_socket = SC_SOCKET_NONE;
-    if (!tunnel->forward) {
+    if (!replay && !tunnel->forward) {
         if (video) {
             video_socket =
                 net_accept_intr(&server->intr, tunnel->server_socket);
@@ -632,7 +745,9 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
         }
 
         uint16_t tunnel_port = server->params.tunnel_port;
-        if (!tunnel_port) {
+        if (replay) {
+            tunnel_port = server->replay_port;
+        } else if (!tunnel_port) {
             tunnel_port = tunnel->local_port;
         }
 
@@ -689,9 +804,11 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
         (void) ok; // error already logged
     }
 
-    // we don't need the adb tunnel anymore
-    sc_adb_tunnel_close(tunnel, &server->intr, serial,
-                        server->device_socket_name);
+    if (tunnel->enabled) {
+        // we don't need the adb tunnel anymore
+        sc_adb_tunnel_close(tunnel, &server->intr, serial,
+                            server->device_socket_name);
+    }
 
     sc_socket first_socket = video ? video_socket
                            : audio ? audio_socket
@@ -937,16 +1054,86 @@ sc_server_kill_adb_if_requested(struct sc_server *server) {
     }
 }
 
+static void
+sc_server_wait_stopped(struct sc_server *server) {
+    // Wait for server_stop()
+    sc_mutex_lock(&server->mutex);
+    while (!server->stopped) {
+        sc_cond_wait(&server->cond_stopped, &server->mutex);
+    }
+    sc_mutex_unlock(&server->mutex);
+
+    // Interrupt sockets to wake up socket blocking calls on the server
+
+    if (server->video_socket != SC_SOCKET_NONE) {
+        // There is no video_socket if --no-video is set
+        net_interrupt(server->video_socket);
+    }
+
+    if (server->audio_socket != SC_SOCKET_NONE) {
+        // There is no audio_socket if --no-audio is set
+        net_interrupt(server->audio_socket);
+    }
+
+    if (server->control_socket != SC_SOCKET_NONE) {
+        // There is no control_socket if --no-control is set
+        net_interrupt(server->control_socket);
+    }
+
+    if (server->demultiplexer_initialized) {
+        // Also wake up the consumers blocked on the in-memory streams
+        sc_demultiplexer_interrupt(&server->demultiplexer);
+        sc_demultiplexer_join(&server->demultiplexer);
+    }
+}
+
+static int
+run_server_replay(struct sc_server *server) {
+    // Connect to a local replay server (tools/scrcpy_replay.c) serving a
+    // stream dump recorded by --dump-stream, so that the client pipeline can
+    // be run without any device (no adb, no scrcpy-server)
+    LOGI("Replaying a stream dump from port %" PRIu16, server->replay_port);
+
+    server->serial = strdup("replay");
+    if (!server->serial) {
+        LOG_OOM();
+        goto error_connection_failed;
+    }
+
+    bool ok = sc_server_connect_to(server, &server->info);
+    if (!ok) {
+        goto error_connection_failed;
+    }
+
+    // Now connected
+    server->cbs->on_connected(server, server->cbs_userdata);
+
+    sc_server_wait_stopped(server);
+
+    return 0;
+
+error_connection_failed:
+    server->cbs->on_connection_failed(server, server->cbs_userdata);
+    return -1;
+}
+
 static int
 run_server(void *data) {
     struct sc_server *server = data;
 
     const struct sc_server_params *params = &server->params;
 
+    server->replay_port = get_replay_port();
+    if (server->replay_port) {
+        return run_server_replay(server);
+    }
+
     // Execute "adb start-server" before "adb devices" so that daemon starting
     // output/errors is correctly printed in the console ("adb devices" output
     // is parsed, so it is not output)
-    bool ok = sc_adb_start_server(&server->intr, 0);
+    unsigned adb_flags =
+        params->stdout_reserved ? SC_ADB_STDOUT_TO_STDERR : 0;
+    bool ok = sc_adb_start_server(&server->intr, adb_flags);
     if (!ok) {
         LOGE("Could not start adb server");
         goto error_connection_failed;
@@ -1028,7 +1215,7 @@ run_server(void *data) {
     assert(serial);
     LOGD("Device serial: %s", serial);
 
-    ok = push_server(&server->intr, serial);
+    ok = push_server(&server->intr, serial, adb_flags);
     if (!ok) {
         goto error_connection_failed;
     }
@@ -1097,29 +1284,7 @@ run_server(void *data) {
     // Now connected
     server->cbs->on_connected(server, server->cbs_userdata);
 
-    // Wait for server_stop()
-    sc_mutex_lock(&server->mutex);
-    while (!server->stopped) {
-        sc_cond_wait(&server->cond_stopped, &server->mutex);
-    }
-    sc_mutex_unlock(&server->mutex);
-
-    // Interrupt sockets to wake up socket blocking calls on the server
-
-    if (server->video_socket != SC_SOCKET_NONE) {
-        // There is no video_socket if --no-video is set
-        net_interrupt(server->video_socket);
-    }
-
-    if (server->audio_socket != SC_SOCKET_NONE) {
-        // There is no audio_socket if --no-audio is set
-        net_interrupt(server->audio_socket);
-    }
-
-    if (server->control_socket != SC_SOCKET_NONE) {
-        // There is no control_socket if --no-control is set
-        net_interrupt(server->control_socket);
-    }
+    sc_server_wait_stopped(server);
 
     // Give some delay for the server to terminate properly
 #define WATCHDOG_DELAY SC_TICK_FROM_SEC(1)
@@ -1189,6 +1354,10 @@ sc_server_destroy(struct sc_server *server) {
     if (server->control_socket != SC_SOCKET_NONE) {
         net_close(server->control_socket);
     }
+    if (server->demultiplexer_initialized) {
+        // The consumers are joined, the streams may be destroyed
+        sc_demultiplexer_destroy(&server->demultiplexer);
+    }
 
     free(server->serial);
     free(server->device_socket_name);
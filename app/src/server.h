@@ -7,6 +7,7 @@
 #include <stdint.h>
 
 #include "adb/adb_tunnel.h"
+#include "demultiplexer.h"
 #include "options.h"
 #include "util/intr.h"
 #include "util/net.h"
@@ -42,6 +43,7 @@ struct sc_server_params {
     uint16_t max_size;
     uint32_t video_bit_rate;
     uint32_t audio_bit_rate;
+    sc_tick audio_frame_duration; // 0 for the device default
     const char *max_fps; // float to be parsed by the server
     const char *angle; // float to be parsed by the server
     sc_tick screen_off_timeout;
@@ -57,6 +59,8 @@ struct sc_server_params {
     bool show_touches;
     bool stay_awake;
     bool force_adb_forward;
+    bool multiplex;
+    bool stdout_reserved; // redirect the adb and server outputs to stderr
     bool power_off_on_close;
     bool clipboard_autosync;
     bool downsize_on_error;
@@ -79,6 +83,10 @@ struct sc_server {
     char *serial;
     char *device_socket_name;
 
+    // Port of a local replay server (set by $SCRCPY_REPLAY_PORT) to connect to
+    // instead of a device, or 0
+    uint16_t replay_port;
+
     sc_thread thread;
     struct sc_server_info info; // initialized once connected
 
@@ -93,6 +101,10 @@ struct sc_server {
     sc_socket audio_socket;
     sc_socket control_socket;
 
+    // Only used if params.multiplex is set
+    struct sc_demultiplexer demultiplexer;
+    bool demultiplexer_initialized;
+
     const struct sc_server_callbacks *cbs;
     void *cbs_userdata;
 };
@@ -0,0 +1,69 @@
+#ifndef SC_SHM_FRAME_H
+#define SC_SHM_FRAME_H
+
+/**
+ * Layout of the shared memory segment written by the shm sink (--shm-sink)
+ *
+ * This header only depends on the C11 standard library, so that it may be
+ * used by external readers.
+ *
+ * The segment starts with a header, followed by `slot_count` slots of
+ * `slot_size` bytes each. Every slot starts with a slot header, followed by
+ * the planes of a single frame.
+ *
+ * The writer writes the frames in the slots in turn (frame N goes to slot
+ * N % slot_count), and protects each slot with a sequence lock:
+ *  - while a frame N is written, the slot `seq` is odd (2*N - 1);
+ *  - once written, the slot `seq` is 2*N, then the header `frame_seq` is set
+ *    to N.
+ *
+ * A reader accesses the frame data directly in the mapping (without copy),
+ * then checks that the slot `seq` has not changed in the meantime (otherwise,
+ * the frame has been overwritten while it was read, and must be discarded).
+ */
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define SC_SHM_MAGIC UINT32_C(0x4d485353) // "SSHM" in little-endian
+#define SC_SHM_VERSION 1
+
+#define SC_SHM_MAX_PLANES 4
+#define SC_SHM_FORMAT_NAME_SIZE 32
+
+// All offsets are aligned, so that the planes can be processed with SIMD
+#define SC_SHM_ALIGN 64
+
+struct sc_shm_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t reserved;
+    uint64_t slot_size; // in bytes, including the slot header
+    uint64_t slots_offset; // offset of the first slot from the segment start
+
+    // Sequence number of the last frame written (0 if none yet)
+    _Atomic uint64_t frame_seq;
+    // Set by the writer when it stops publishing frames
+    _Atomic uint32_t closed;
+};
+
+struct sc_shm_slot {
+    // Sequence lock: odd while the frame is written
+    _Atomic uint64_t seq;
+
+    int64_t pts; // in microseconds, INT64_MIN if unknown
+    uint32_t width;
+    uint32_t height;
+    uint32_t plane_count;
+    uint32_t reserved;
+    // FFmpeg pixel format name (e.g. "yuv420p"), nul-terminated
+    char format[SC_SHM_FORMAT_NAME_SIZE];
+    // Offsets of the planes, from the start of the slot header
+    uint64_t plane_offsets[SC_SHM_MAX_PLANES];
+    uint32_t strides[SC_SHM_MAX_PLANES]; // in bytes, aligned
+    uint32_t plane_widths[SC_SHM_MAX_PLANES]; // in bytes, without padding
+    uint32_t plane_heights[SC_SHM_MAX_PLANES]; // in rows
+};
+
+#endif
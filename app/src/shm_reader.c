@@ -0,0 +1,205 @@
+// This file does not include "common.h", so that it may be reused as is
+#ifndef _POSIX_C_SOURCE
+# define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "shm_reader.h"
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static inline const struct sc_shm_header *
+sc_shm_reader_get_header(struct sc_shm_reader *reader) {
+    return (const struct sc_shm_header *) reader->data;
+}
+
+static const struct sc_shm_slot *
+sc_shm_reader_get_slot(struct sc_shm_reader *reader, uint64_t seq) {
+    const struct sc_shm_header *header = sc_shm_reader_get_header(reader);
+    size_t index = seq % header->slot_count;
+    return (const struct sc_shm_slot *)
+        (reader->data + header->slots_offset + index * header->slot_size);
+}
+
+static bool
+sc_shm_reader_check_header(const struct sc_shm_header *header, size_t size) {
+    if (header->magic != SC_SHM_MAGIC || header->version != SC_SHM_VERSION) {
+        return false;
+    }
+
+    atomic_thread_fence(memory_order_acquire);
+
+    if (!header->slot_count
+            || header->slot_size < sizeof(struct sc_shm_slot)
+            || header->slots_offset < sizeof(*header)) {
+        return false;
+    }
+
+    uint64_t slots_size = header->slot_count * header->slot_size;
+    return header->slots_offset <= size
+        && slots_size / header->slot_count == header->slot_size // overflow
+        && slots_size <= size - header->slots_offset;
+}
+
+bool
+sc_shm_reader_open(struct sc_shm_reader *reader, const char *name) {
+    char path[256];
+    int r = snprintf(path, sizeof(path), "%s%s", name[0] == '/' ? "" : "/",
+                     name);
+    if (r < 0 || (size_t) r >= sizeof(path)) {
+        return false;
+    }
+
+    int fd = shm_open(path, O_RDONLY, 0);
+    if (fd == -1) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) || (size_t) st.st_size < sizeof(struct sc_shm_header)) {
+        close(fd);
+        return false;
+    }
+
+    size_t size = st.st_size;
+    void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    if (!sc_shm_reader_check_header(data, size)) {
+        munmap(data, size);
+        return false;
+    }
+
+    reader->data = data;
+    reader->size = size;
+    reader->last_seq = 0;
+
+    return true;
+}
+
+void
+sc_shm_reader_close(struct sc_shm_reader *reader) {
+    munmap((void *) reader->data, reader->size);
+}
+
+static bool
+sc_shm_reader_fill_frame(struct sc_shm_reader *reader,
+                         const struct sc_shm_slot *slot,
+                         struct sc_shm_frame *frame) {
+    const struct sc_shm_header *header = sc_shm_reader_get_header(reader);
+
+    // The slot may be overwritten concurrently: never trust its content
+    // before it is validated
+    unsigned plane_count = slot->plane_count;
+    if (plane_count > SC_SHM_MAX_PLANES) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < SC_SHM_MAX_PLANES; ++i) {
+        if (i >= plane_count) {
+            frame->data[i] = NULL;
+            frame->strides[i] = 0;
+            frame->plane_widths[i] = 0;
+            frame->plane_heights[i] = 0;
+            continue;
+        }
+
+        uint64_t offset = slot->plane_offsets[i];
+        uint32_t stride = slot->strides[i];
+        uint32_t plane_width = slot->plane_widths[i];
+        uint32_t plane_height = slot->plane_heights[i];
+        if (plane_width > stride
+                || offset < sizeof(*slot) || offset > header->slot_size
+                || (uint64_t) stride * plane_height
+                        > header->slot_size - offset) {
+            return false;
+        }
+
+        frame->data[i] = (const uint8_t *) slot + offset;
+        frame->strides[i] = stride;
+        frame->plane_widths[i] = plane_width;
+        frame->plane_heights[i] = plane_height;
+    }
+
+    frame->plane_count = plane_count;
+    frame->pts = slot->pts;
+    frame->width = slot->width;
+    frame->height = slot->height;
+    memcpy(frame->format, slot->format, sizeof(frame->format));
+    frame->format[sizeof(frame->format) - 1] = '\0';
+
+    return true;
+}
+
+enum sc_shm_reader_result
+sc_shm_reader_acquire(struct sc_shm_reader *reader,
+                      enum sc_shm_reader_mode mode,
+                      struct sc_shm_frame *frame) {
+    const struct sc_shm_header *header = sc_shm_reader_get_header(reader);
+
+    for (;;) {
+        uint64_t latest =
+            atomic_load_explicit(&header->frame_seq, memory_order_acquire);
+        if (latest <= reader->last_seq) {
+            bool closed =
+                atomic_load_explicit(&header->closed, memory_order_acquire);
+            return closed ? SC_SHM_READER_CLOSED : SC_SHM_READER_NO_FRAME;
+        }
+
+        uint64_t n = latest;
+        if (mode == SC_SHM_READER_MODE_NEXT
+                && latest - reader->last_seq < header->slot_count) {
+            // The next frame may still be available
+            n = reader->last_seq + 1;
+        }
+
+        const struct sc_shm_slot *slot = sc_shm_reader_get_slot(reader, n);
+        uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq != 2 * n) {
+            // Overwritten in the meantime, retry with the new latest frame
+            continue;
+        }
+
+        bool valid = sc_shm_reader_fill_frame(reader, slot, frame);
+
+        // The content must be read before checking the sequence number again
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != seq) {
+            continue;
+        }
+
+        if (!valid) {
+            // Stable but inconsistent content (corrupted segment), skip it
+            reader->last_seq = n;
+            continue;
+        }
+
+        frame->seq = n;
+        frame->skipped = n - reader->last_seq - 1;
+        frame->slot = slot;
+
+        reader->last_seq = n;
+
+        return SC_SHM_READER_OK;
+    }
+}
+
+bool
+sc_shm_reader_release(struct sc_shm_reader *reader,
+                      const struct sc_shm_frame *frame) {
+    (void) reader;
+
+    // The frame data must be read before checking the sequence number
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t seq =
+        atomic_load_explicit(&frame->slot->seq, memory_order_relaxed);
+    return seq == 2 * frame->seq;
+}
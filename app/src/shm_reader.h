@@ -0,0 +1,98 @@
+#ifndef SC_SHM_READER_H
+#define SC_SHM_READER_H
+
+/**
+ * Reader for the frames published by the shm sink (--shm-sink)
+ *
+ * Like shm_frame.h, this module only depends on the C11 standard library and
+ * POSIX, so that it may be reused by external programs.
+ *
+ * Any number of readers may read the same segment concurrently. The writer
+ * never waits for the readers: if a reader is too slow, the frame it is
+ * reading may be overwritten, which is reported by sc_shm_reader_release().
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "shm_frame.h"
+
+enum sc_shm_reader_mode {
+    // Always read the latest frame published (frames may be skipped)
+    SC_SHM_READER_MODE_LATEST,
+    // Read the frame following the previous frame read, as long as it is
+    // still available (otherwise, fallback to the latest frame)
+    SC_SHM_READER_MODE_NEXT,
+};
+
+enum sc_shm_reader_result {
+    SC_SHM_READER_OK,
+    SC_SHM_READER_NO_FRAME, // no new frame has been published yet
+    SC_SHM_READER_CLOSED, // the writer has stopped
+};
+
+struct sc_shm_reader {
+    const uint8_t *data; // the mapped segment
+    size_t size;
+
+    uint64_t last_seq; // sequence number of the last frame acquired
+};
+
+/**
+ * A frame acquired by a reader
+ *
+ * The plane pointers point directly to the shared memory: they are valid
+ * until the frame is overwritten by the writer.
+ */
+struct sc_shm_frame {
+    uint64_t seq;
+    int64_t pts; // in microseconds, INT64_MIN if unknown
+    uint32_t width;
+    uint32_t height;
+    char format[SC_SHM_FORMAT_NAME_SIZE]; // FFmpeg pixel format name
+
+    unsigned plane_count;
+    const uint8_t *data[SC_SHM_MAX_PLANES];
+    uint32_t strides[SC_SHM_MAX_PLANES]; // in bytes
+    uint32_t plane_widths[SC_SHM_MAX_PLANES]; // in bytes, without padding
+    uint32_t plane_heights[SC_SHM_MAX_PLANES];
+
+    // Number of frames skipped since the previous frame acquired
+    uint64_t skipped;
+
+    const struct sc_shm_slot *slot; // private
+};
+
+/**
+ * Map the shared memory segment
+ *
+ * The name is the one passed to --shm-sink (with or without the leading '/').
+ */
+bool
+sc_shm_reader_open(struct sc_shm_reader *reader, const char *name);
+
+void
+sc_shm_reader_close(struct sc_shm_reader *reader);
+
+/**
+ * Acquire a frame more recent than the previous one (without copy)
+ *
+ * The frame data may be accessed until sc_shm_reader_release() is called.
+ */
+enum sc_shm_reader_result
+sc_shm_reader_acquire(struct sc_shm_reader *reader,
+                      enum sc_shm_reader_mode mode,
+                      struct sc_shm_frame *frame);
+
+/**
+ * Release a frame acquired by sc_shm_reader_acquire()
+ *
+ * Return true if the frame was not overwritten while it was accessed (if it
+ * returns false, any data read from the frame must be discarded).
+ */
+bool
+sc_shm_reader_release(struct sc_shm_reader *reader,
+                      const struct sc_shm_frame *frame);
+
+#endif
@@ -0,0 +1,271 @@
+#include "shm_sink.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+
+#include "util/log.h"
+#include "util/str.h"
+
+/** Downcast frame_sink to sc_shm_sink */
+#define DOWNCAST(SINK) container_of(SINK, struct sc_shm_sink, frame_sink)
+
+static inline size_t
+sc_shm_align(size_t size) {
+    return (size + SC_SHM_ALIGN - 1) & ~((size_t) SC_SHM_ALIGN - 1);
+}
+
+static inline struct sc_shm_header *
+sc_shm_sink_get_header(struct sc_shm_sink *ss) {
+    return (struct sc_shm_header *) ss->data;
+}
+
+/**
+ * Compute the layout of the planes of a frame in a slot
+ *
+ * Return the slot size required for the frame (including the slot header),
+ * or 0 if the pixel format is not supported.
+ */
+static size_t
+sc_shm_sink_compute_layout(struct sc_shm_slot *slot, enum AVPixelFormat fmt,
+                           int width, int height) {
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmt);
+    if (!desc || desc->flags & AV_PIX_FMT_FLAG_HWACCEL) {
+        return 0;
+    }
+
+    int plane_count = av_pix_fmt_count_planes(fmt);
+    if (plane_count <= 0 || plane_count > SC_SHM_MAX_PLANES) {
+        return 0;
+    }
+
+    size_t offset = sc_shm_align(sizeof(*slot));
+    for (int i = 0; i < SC_SHM_MAX_PLANES; ++i) {
+        if (i >= plane_count) {
+            slot->plane_offsets[i] = 0;
+            slot->strides[i] = 0;
+            slot->plane_widths[i] = 0;
+            slot->plane_heights[i] = 0;
+            continue;
+        }
+
+        int linesize = av_image_get_linesize(fmt, width, i);
+        if (linesize <= 0) {
+            return 0;
+        }
+
+        bool chroma = (i == 1 || i == 2)
+                   && !(desc->flags & AV_PIX_FMT_FLAG_RGB);
+        int plane_height = chroma ? AV_CEIL_RSHIFT(height, desc->log2_chroma_h)
+                                  : height;
+
+        size_t stride = sc_shm_align(linesize);
+        slot->plane_offsets[i] = offset;
+        slot->strides[i] = stride;
+        slot->plane_widths[i] = linesize;
+        slot->plane_heights[i] = plane_height;
+        offset += stride * plane_height;
+    }
+
+    slot->plane_count = plane_count;
+
+    // The strides are aligned, so the total size is also aligned
+    return offset;
+}
+
+static bool
+sc_shm_sink_open(struct sc_shm_sink *ss, const AVCodecContext *ctx) {
+    // The frame size changes on device rotation, so reserve enough space for
+    // the largest dimension in both directions
+    int max_size = MAX(ctx->width, ctx->height);
+
+    struct sc_shm_slot layout;
+    size_t slot_size =
+        sc_shm_sink_compute_layout(&layout, ctx->pix_fmt, max_size, max_size);
+    if (!slot_size) {
+        LOGE("Unsupported pixel format for shm sink: %s",
+             av_get_pix_fmt_name(ctx->pix_fmt));
+        return false;
+    }
+
+    size_t slots_offset = sc_shm_align(sizeof(struct sc_shm_header));
+    size_t size = slots_offset + SC_SHM_SINK_SLOT_COUNT * slot_size;
+
+    // Never reuse (or remove) an existing object: it may be used by another
+    // session. Only the object created here is unlinked on close.
+    int fd = shm_open(ss->name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd == -1) {
+        if (errno == EEXIST) {
+            LOGE("Shared memory %s already exists (used by another scrcpy "
+                 "instance?), choose another name or remove it if it is "
+                 "stale", ss->name);
+        } else {
+            LOGE("Could not create shared memory %s: %s", ss->name,
+                 strerror(errno));
+        }
+        return false;
+    }
+
+    // The segment is zero-filled
+    if (ftruncate(fd, size)) {
+        LOGE("Could not resize shared memory %s: %s", ss->name,
+             strerror(errno));
+        goto error_unlink;
+    }
+
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        LOGE("Could not map shared memory %s: %s", ss->name, strerror(errno));
+        goto error_unlink;
+    }
+
+    // The mapping remains valid after the file descriptor is closed
+    close(fd);
+
+    ss->data = data;
+    ss->size = size;
+    ss->frame_seq = 0;
+    ss->too_large_logged = false;
+
+    struct sc_shm_header *header = sc_shm_sink_get_header(ss);
+    header->version = SC_SHM_VERSION;
+    header->slot_count = SC_SHM_SINK_SLOT_COUNT;
+    header->slot_size = slot_size;
+    header->slots_offset = slots_offset;
+
+    // Readers must not use the header before it is initialized
+    atomic_thread_fence(memory_order_release);
+    header->magic = SC_SHM_MAGIC;
+
+    LOGI("shm sink started: %s (%" SC_PRIsizet " bytes)", ss->name, size);
+
+    return true;
+
+error_unlink:
+    close(fd);
+    shm_unlink(ss->name);
+
+    return false;
+}
+
+static void
+sc_shm_sink_close(struct sc_shm_sink *ss) {
+    struct sc_shm_header *header = sc_shm_sink_get_header(ss);
+    atomic_store_explicit(&header->closed, 1, memory_order_release);
+
+    munmap(ss->data, ss->size);
+
+    // The readers which have already mapped the segment keep access to it
+    shm_unlink(ss->name);
+
+    LOGD("shm sink closed: %s (%" PRIu64 " frames)", ss->name, ss->frame_seq);
+}
+
+static bool
+sc_shm_sink_push(struct sc_shm_sink *ss, const AVFrame *frame) {
+    struct sc_shm_header *header = sc_shm_sink_get_header(ss);
+
+    struct sc_shm_slot layout;
+    size_t slot_size = sc_shm_sink_compute_layout(&layout, frame->format,
+                                                  frame->width, frame->height);
+    if (!slot_size || slot_size > header->slot_size) {
+        if (!ss->too_large_logged) {
+            LOGW("Frame %dx%d (%s) does not fit in shm sink slots, skipped",
+                 frame->width, frame->height,
+                 av_get_pix_fmt_name(frame->format));
+            ss->too_large_logged = true;
+        }
+        // Not fatal, the next frames may fit
+        return true;
+    }
+
+    uint64_t n = ss->frame_seq + 1;
+    size_t index = n % header->slot_count;
+    struct sc_shm_slot *slot = (struct sc_shm_slot *)
+        (ss->data + header->slots_offset + index * header->slot_size);
+
+    // Mark the slot as being written (odd sequence number)
+    atomic_store_explicit(&slot->seq, 2 * n - 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->pts = frame->pts;
+    slot->width = frame->width;
+    slot->height = frame->height;
+    slot->plane_count = layout.plane_count;
+    const char *format = av_get_pix_fmt_name(frame->format);
+    sc_strncpy(slot->format, format ? format : "", sizeof(slot->format));
+
+    uint8_t *slot_data = (uint8_t *) slot;
+    for (int i = 0; i < SC_SHM_MAX_PLANES; ++i) {
+        slot->plane_offsets[i] = layout.plane_offsets[i];
+        slot->strides[i] = layout.strides[i];
+        slot->plane_widths[i] = layout.plane_widths[i];
+        slot->plane_heights[i] = layout.plane_heights[i];
+
+        if (i < (int) layout.plane_count) {
+            av_image_copy_plane(slot_data + layout.plane_offsets[i],
+                                layout.strides[i], frame->data[i],
+                                frame->linesize[i], layout.plane_widths[i],
+                                layout.plane_heights[i]);
+        }
+    }
+
+    // Publish the frame
+    atomic_store_explicit(&slot->seq, 2 * n, memory_order_release);
+    atomic_store_explicit(&header->frame_seq, n, memory_order_release);
+
+    ss->frame_seq = n;
+
+    return true;
+}
+
+static bool
+sc_shm_frame_sink_open(struct sc_frame_sink *sink, const AVCodecContext *ctx) {
+    struct sc_shm_sink *ss = DOWNCAST(sink);
+    return sc_shm_sink_open(ss, ctx);
+}
+
+static void
+sc_shm_frame_sink_close(struct sc_frame_sink *sink) {
+    struct sc_shm_sink *ss = DOWNCAST(sink);
+    sc_shm_sink_close(ss);
+}
+
+static bool
+sc_shm_frame_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
+    struct sc_shm_sink *ss = DOWNCAST(sink);
+    return sc_shm_sink_push(ss, frame);
+}
+
+bool
+sc_shm_sink_init(struct sc_shm_sink *ss, const char *name) {
+    const char *start = name[0] == '/' ? "" : "/";
+    ss->name = sc_str_concat(start, name);
+    if (!ss->name) {
+        return false;
+    }
+
+    static const struct sc_frame_sink_ops ops = {
+        .open = sc_shm_frame_sink_open,
+        .close = sc_shm_frame_sink_close,
+        .push = sc_shm_frame_sink_push,
+    };
+
+    ss->frame_sink.ops = &ops;
+
+    return true;
+}
+
+void
+sc_shm_sink_destroy(struct sc_shm_sink *ss) {
+    free(ss->name);
+}
@@ -0,0 +1,47 @@
+#ifndef SC_SHM_SINK_H
+#define SC_SHM_SINK_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "shm_frame.h"
+#include "trait/frame_sink.h"
+
+#define SC_SHM_SINK_SLOT_COUNT 4
+
+/**
+ * Frame sink publishing the decoded frames to a POSIX shared memory segment
+ * (see shm_frame.h for the layout), so that local processes may read them
+ * without copy (see shm_reader.h).
+ *
+ * The frames are copied synchronously from push(), so the sink should be
+ * preceded by a frame queue if other sinks must not be delayed.
+ */
+struct sc_shm_sink {
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    char *name; // the shm object name, with a leading '/'
+
+    uint8_t *data; // the mapped segment
+    size_t size;
+
+    uint64_t frame_seq; // sequence number of the last frame written
+    bool too_large_logged;
+};
+
+/**
+ * Initialize a shm sink
+ *
+ * The name is the POSIX shared memory object name, with or without the
+ * leading '/' (it must not contain any other '/').
+ */
+bool
+sc_shm_sink_init(struct sc_shm_sink *ss, const char *name);
+
+void
+sc_shm_sink_destroy(struct sc_shm_sink *ss);
+
+#endif
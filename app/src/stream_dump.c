@@ -0,0 +1,66 @@
+#include "stream_dump.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <libavformat/avio.h>
+
+#include "util/log.h"
+
+bool
+sc_stream_dump_init(struct sc_stream_dump *dump, const char *filename) {
+    bool ok = sc_mutex_init(&dump->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    int r = avio_open(&dump->io, filename, AVIO_FLAG_WRITE);
+    if (r < 0) {
+        LOGE("Could not open stream dump file: %s", filename);
+        sc_mutex_destroy(&dump->mutex);
+        return false;
+    }
+
+    avio_write(dump->io, (const uint8_t *) SC_STREAM_DUMP_MAGIC,
+               SC_STREAM_DUMP_MAGIC_LENGTH);
+
+    dump->start = sc_tick_now();
+    dump->failed = false;
+
+    LOGI("Dumping streams to %s", filename);
+
+    return true;
+}
+
+void
+sc_stream_dump_destroy(struct sc_stream_dump *dump) {
+    avio_closep(&dump->io);
+    sc_mutex_destroy(&dump->mutex);
+}
+
+void
+sc_stream_dump_write(struct sc_stream_dump *dump,
+                     enum sc_stream_dump_stream stream,
+                     const uint8_t *data, size_t len) {
+    assert(len <= INT_MAX);
+
+    sc_tick now = sc_tick_now();
+
+    sc_mutex_lock(&dump->mutex);
+
+    if (dump->failed) {
+        sc_mutex_unlock(&dump->mutex);
+        return;
+    }
+
+    avio_w8(dump->io, stream);
+    avio_wb64(dump->io, SC_TICK_TO_US(now - dump->start));
+    avio_wb32(dump->io, len);
+    avio_write(dump->io, data, len);
+
+    if (dump->io->error) {
+        LOGE("Could not write to stream dump file, dump disabled");
+        dump->failed = true;
+    }
+
+    sc_mutex_unlock(&dump->mutex);
+}
@@ -0,0 +1,68 @@
+#ifndef SC_STREAM_DUMP_H
+#define SC_STREAM_DUMP_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/thread.h"
+#include "util/tick.h"
+
+/**
+ * Dump of the raw bytes received on the video and audio sockets.
+ *
+ * The dump file starts with SC_STREAM_DUMP_MAGIC, followed by a sequence of
+ * records:
+ *
+ * [.|. . . . . . . .|. . . .]. . . . . . . . . . . . . . . ...
+ *  ^ <-------------> <-----> <-----------------------------...
+ *  |     arrival      data            raw stream data
+ *  |     time (us)    size
+ *   `- stream (SC_STREAM_DUMP_STREAM_*)
+ *
+ * All integers are big-endian. The arrival time is relative to the opening of
+ * the dump.
+ *
+ * The concatenation of the data of all the records of a stream is exactly the
+ * sequence of bytes received on its socket (codec id, video size, then
+ * packets), so that it can be replayed by tools/scrcpy_replay.c.
+ */
+#define SC_STREAM_DUMP_MAGIC "scrcpy-dump-1"
+#define SC_STREAM_DUMP_MAGIC_LENGTH (sizeof(SC_STREAM_DUMP_MAGIC) - 1)
+#define SC_STREAM_DUMP_RECORD_HEADER_SIZE 13
+
+enum sc_stream_dump_stream {
+    SC_STREAM_DUMP_STREAM_VIDEO = 0,
+    SC_STREAM_DUMP_STREAM_AUDIO = 1,
+};
+
+// forward declarations
+typedef struct AVIOContext AVIOContext;
+
+struct sc_stream_dump {
+    // The video and audio demuxers write from their own threads
+    sc_mutex mutex;
+    AVIOContext *io;
+    sc_tick start;
+    bool failed;
+};
+
+bool
+sc_stream_dump_init(struct sc_stream_dump *dump, const char *filename);
+
+void
+sc_stream_dump_destroy(struct sc_stream_dump *dump);
+
+/**
+ * Append a record containing `data`, timestamped with the current time
+ *
+ * On error, the dump is disabled (the error is logged only once).
+ */
+void
+sc_stream_dump_write(struct sc_stream_dump *dump,
+                     enum sc_stream_dump_stream stream,
+                     const uint8_t *data, size_t len);
+
+#endif
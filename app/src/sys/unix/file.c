@@ -94,3 +94,7 @@ sc_file_is_regular(const char *path) {
     return S_ISREG(path_stat.st_mode);
 }
 
+bool
+sc_file_remove(const char *path) {
+    return !unlink(path);
+}
@@ -116,6 +116,9 @@ sc_process_execute_p(const char *const argv[], sc_pid *pid, unsigned flags,
             } else {
                 LOGE("Could not open /dev/null for stdout");
             }
+        } else if (flags & SC_PROCESS_STDOUT_TO_STDERR) {
+            // Before stderr is redirected (if it is)
+            dup2(STDERR_FILENO, STDOUT_FILENO);
         }
 
         if (perr) {
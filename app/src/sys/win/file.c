@@ -41,3 +41,16 @@ sc_file_is_regular(const char *path) {
     return S_ISREG(path_stat.st_mode);
 }
 
+bool
+sc_file_remove(const char *path) {
+    wchar_t *wide_path = sc_str_to_wchars(path);
+    if (!wide_path) {
+        LOG_OOM();
+        return false;
+    }
+
+    BOOL ok = DeleteFileW(wide_path);
+    free(wide_path);
+
+    return ok;
+}
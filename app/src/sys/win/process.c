@@ -81,7 +81,9 @@ sc_process_execute_p(const char *const argv[], HANDLE *handle, unsigned flags,
 
     si.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
     if (inherit_stdout) {
-        si.StartupInfo.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD std_handle = flags & SC_PROCESS_STDOUT_TO_STDERR
+                         ? STD_ERROR_HANDLE : STD_OUTPUT_HANDLE;
+        si.StartupInfo.hStdOutput = GetStdHandle(std_handle);
     }
     if (inherit_stderr) {
         si.StartupInfo.hStdError = GetStdHandle(STD_ERROR_HANDLE);
@@ -13,6 +13,9 @@
  */
 struct sc_frame_sink {
     const struct sc_frame_sink_ops *ops;
+
+    // Next sink of the same frame source (managed by the frame source)
+    struct sc_frame_sink *next;
 };
 
 struct sc_frame_sink_ops {
@@ -4,37 +4,51 @@
 
 void
 sc_frame_source_init(struct sc_frame_source *source) {
+    source->sinks = NULL;
     source->sink_count = 0;
 }
 
 void
 sc_frame_source_add_sink(struct sc_frame_source *source,
                          struct sc_frame_sink *sink) {
-    assert(source->sink_count < SC_FRAME_SOURCE_MAX_SINKS);
     assert(sink);
     assert(sink->ops);
-    source->sinks[source->sink_count++] = sink;
+
+    sink->next = NULL;
+
+    struct sc_frame_sink **plast = &source->sinks;
+    while (*plast) {
+        assert(*plast != sink);
+        plast = &(*plast)->next;
+    }
+    *plast = sink;
+
+    ++source->sink_count;
 }
 
 static void
-sc_frame_source_sinks_close_firsts(struct sc_frame_source *source,
+sc_frame_source_sinks_close_firsts(struct sc_frame_sink *sink,
                                     unsigned count) {
-    while (count) {
-        struct sc_frame_sink *sink = source->sinks[--count];
-        sink->ops->close(sink);
+    if (!count) {
+        return;
     }
+
+    // Close in reverse order
+    sc_frame_source_sinks_close_firsts(sink->next, count - 1);
+    sink->ops->close(sink);
 }
 
 bool
 sc_frame_source_sinks_open(struct sc_frame_source *source,
                            const AVCodecContext *ctx) {
     assert(source->sink_count);
-    for (unsigned i = 0; i < source->sink_count; ++i) {
-        struct sc_frame_sink *sink = source->sinks[i];
+    unsigned i = 0;
+    for (struct sc_frame_sink *sink = source->sinks; sink; sink = sink->next) {
         if (!sink->ops->open(sink, ctx)) {
-            sc_frame_source_sinks_close_firsts(source, i);
+            sc_frame_source_sinks_close_firsts(source->sinks, i);
             return false;
         }
+        ++i;
     }
 
     return true;
@@ -43,15 +57,14 @@ sc_frame_source_sinks_open(struct sc_frame_source *source,
 void
 sc_frame_source_sinks_close(struct sc_frame_source *source) {
     assert(source->sink_count);
-    sc_frame_source_sinks_close_firsts(source, source->sink_count);
+    sc_frame_source_sinks_close_firsts(source->sinks, source->sink_count);
 }
 
 bool
 sc_frame_source_sinks_push(struct sc_frame_source *source,
                             const AVFrame *frame) {
     assert(source->sink_count);
-    for (unsigned i = 0; i < source->sink_count; ++i) {
-        struct sc_frame_sink *sink = source->sinks[i];
+    for (struct sc_frame_sink *sink = source->sinks; sink; sink = sink->next) {
         if (!sink->ops->push(sink, frame)) {
             return false;
         }
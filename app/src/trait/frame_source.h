@@ -7,15 +7,16 @@
 
 #include "trait/frame_sink.h"
 
-#define SC_FRAME_SOURCE_MAX_SINKS 2
-
 /**
  * Frame source trait
  *
  * Component able to send AVFrames should implement this trait.
+ *
+ * The number of sinks is not limited: they are linked together (so adding a
+ * sink never allocates). A sink may only be added to a single source.
  */
 struct sc_frame_source {
-    struct sc_frame_sink *sinks[SC_FRAME_SOURCE_MAX_SINKS];
+    struct sc_frame_sink *sinks; // linked list, in insertion order
     unsigned sink_count;
 };
 
@@ -0,0 +1,115 @@
+#include "audio_convert.h"
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+# include <emmintrin.h>
+# define SC_AUDIO_CONVERT_SSE2
+#elif defined(__ARM_NEON)
+# include <arm_neon.h>
+# define SC_AUDIO_CONVERT_NEON
+#endif
+
+#define SC_S16_SCALE (1.0f / (1 << 15))
+#define SC_S32_SCALE (1.0f / (1U << 31))
+
+void
+sc_audio_convert_s16(float *dst, const int16_t *src, size_t count) {
+    size_t i = 0;
+
+#if defined(SC_AUDIO_CONVERT_SSE2)
+    const __m128 scale = _mm_set1_ps(SC_S16_SCALE);
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (src + i));
+        // Sign-extend to 32 bits: put each value in the upper half, then
+        // shift right arithmetically
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#elif defined(SC_AUDIO_CONVERT_NEON)
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t v = vld1q_s16(src + i);
+        int32x4_t lo = vmovl_s16(vget_low_s16(v));
+        int32x4_t hi = vmovl_s16(vget_high_s16(v));
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(lo), SC_S16_SCALE));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(hi), SC_S16_SCALE));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        dst[i] = src[i] * SC_S16_SCALE;
+    }
+}
+
+void
+sc_audio_convert_s32(float *dst, const int32_t *src, size_t count) {
+    size_t i = 0;
+
+#if defined(SC_AUDIO_CONVERT_SSE2)
+    const __m128 scale = _mm_set1_ps(SC_S32_SCALE);
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (src + i));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+#elif defined(SC_AUDIO_CONVERT_NEON)
+    for (; i + 4 <= count; i += 4) {
+        int32x4_t v = vld1q_s32(src + i);
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(v), SC_S32_SCALE));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        dst[i] = (float) src[i] * SC_S32_SCALE;
+    }
+}
+
+static void
+sc_audio_interleave_flt_stereo(float *dst, const float *left,
+                               const float *right, size_t samples) {
+    size_t i = 0;
+
+#if defined(SC_AUDIO_CONVERT_SSE2)
+    for (; i + 4 <= samples; i += 4) {
+        __m128 l = _mm_loadu_ps(left + i);
+        __m128 r = _mm_loadu_ps(right + i);
+        _mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(l, r));
+    }
+#elif defined(SC_AUDIO_CONVERT_NEON)
+    for (; i + 4 <= samples; i += 4) {
+        float32x4x2_t v = {{vld1q_f32(left + i), vld1q_f32(right + i)}};
+        vst2q_f32(dst + 2 * i, v);
+    }
+#endif
+
+    for (; i < samples; ++i) {
+        dst[2 * i] = left[i];
+        dst[2 * i + 1] = right[i];
+    }
+}
+
+void
+sc_audio_interleave_flt(float *dst, const float *const *src,
+                        unsigned channels, size_t offset, size_t samples) {
+    assert(channels);
+
+    if (channels == 1) {
+        memcpy(dst, src[0] + offset, samples * sizeof(float));
+        return;
+    }
+
+    if (channels == 2) {
+        sc_audio_interleave_flt_stereo(dst, src[0] + offset, src[1] + offset,
+                                       samples);
+        return;
+    }
+
+    for (size_t i = 0; i < samples; ++i) {
+        for (unsigned c = 0; c < channels; ++c) {
+            dst[i * channels + c] = src[c][offset + i];
+        }
+    }
+}
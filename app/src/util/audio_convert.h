@@ -0,0 +1,38 @@
+#ifndef SC_AUDIO_CONVERT_H
+#define SC_AUDIO_CONVERT_H
+
+#include "common.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Sample conversion kernels to interleaved float samples
+ *
+ * They produce the same values as libswresample (without dithering), so that
+ * the audio regulator may bypass it when no compensation is applied.
+ *
+ * They are vectorized with SSE2 or NEON when available at compile time.
+ */
+
+/**
+ * Convert `count` s16 values to float
+ */
+void
+sc_audio_convert_s16(float *dst, const int16_t *src, size_t count);
+
+/**
+ * Convert `count` s32 values to float
+ */
+void
+sc_audio_convert_s32(float *dst, const int32_t *src, size_t count);
+
+/**
+ * Interleave `samples` float samples of `channels` planes, starting at
+ * `offset` (in samples) in each plane
+ */
+void
+sc_audio_interleave_flt(float *dst, const float *const *src,
+                        unsigned channels, size_t offset, size_t samples);
+
+#endif
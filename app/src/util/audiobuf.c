@@ -151,3 +151,38 @@ sc_audiobuf_write_silence(struct sc_audiobuf *buf, uint32_t samples_count) {
 
     return samples_count;
 }
+
+uint32_t
+sc_audiobuf_write_with(struct sc_audiobuf *buf, uint32_t samples_count,
+                       sc_audiobuf_write_fn fn, void *userdata) {
+    // Only the writer thread can write head, so memory_order_relaxed is
+    // sufficient
+    uint32_t head = atomic_load_explicit(&buf->head, memory_order_relaxed);
+
+    // The tail cursor is updated after the data is consumed by the reader
+    uint32_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
+
+    uint32_t can_write = (buf->alloc_size + tail - head - 1) % buf->alloc_size;
+    if (!can_write) {
+        return 0;
+    }
+    if (samples_count > can_write) {
+        samples_count = can_write;
+    }
+
+    uint32_t right_count = buf->alloc_size - head;
+    if (right_count > samples_count) {
+        right_count = samples_count;
+    }
+    fn(buf->data + (head * buf->sample_size), 0, right_count, userdata);
+
+    if (samples_count > right_count) {
+        uint32_t left_count = samples_count - right_count;
+        fn(buf->data, right_count, left_count, userdata);
+    }
+
+    uint32_t new_head = (head + samples_count) % buf->alloc_size;
+    atomic_store_explicit(&buf->head, new_head, memory_order_release);
+
+    return samples_count;
+}
@@ -53,6 +53,26 @@ sc_audiobuf_write(struct sc_audiobuf *buf, const void *from,
 uint32_t
 sc_audiobuf_write_silence(struct sc_audiobuf *buf, uint32_t samples);
 
+/**
+ * Callback to write `samples_count` samples directly into the buffer
+ *
+ * The `offset` is the number of samples already written by the previous calls
+ * during the same sc_audiobuf_write_with() (the writable area may wrap around
+ * the end of the buffer).
+ */
+typedef void (*sc_audiobuf_write_fn)(uint8_t *to, uint32_t offset,
+                                     uint32_t samples_count, void *userdata);
+
+/**
+ * Write up to `samples_count` samples by calling `fn` (once or twice), without
+ * intermediate copy
+ *
+ * Return the number of samples written.
+ */
+uint32_t
+sc_audiobuf_write_with(struct sc_audiobuf *buf, uint32_t samples_count,
+                       sc_audiobuf_write_fn fn, void *userdata);
+
 static inline uint32_t
 sc_audiobuf_capacity(struct sc_audiobuf *buf) {
     assert(buf->alloc_size);
@@ -46,4 +46,10 @@ sc_file_get_local_path(const char *name);
 bool
 sc_file_is_regular(const char *path);
 
+/**
+ * Delete the file
+ */
+bool
+sc_file_remove(const char *path);
+
 #endif
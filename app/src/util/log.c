@@ -140,18 +140,21 @@ static const char *const sc_sdl_log_priority_names[SDL_NUM_LOG_PRIORITIES] = {
 static void SDLCALL
 sc_sdl_log_print(void *userdata, int category, SDL_LogPriority priority,
                  const char *message) {
-    (void) userdata;
     (void) category;
 
-    FILE *out = priority < SDL_LOG_PRIORITY_WARN ? stdout : stderr;
+    // Output for the logs below warnings
+    FILE *info_out = userdata;
+
+    FILE *out = priority < SDL_LOG_PRIORITY_WARN ? info_out : stderr;
     assert(priority < SDL_NUM_LOG_PRIORITIES);
     const char *prio_name = sc_sdl_log_priority_names[priority];
     fprintf(out, "%s: %s\n", prio_name, message);
 }
 
 void
-sc_log_configure(void) {
-    SDL_LogSetOutputFunction(sc_sdl_log_print, NULL);
+sc_log_configure(bool stdout_reserved) {
+    FILE *info_out = stdout_reserved ? stderr : stdout;
+    SDL_LogSetOutputFunction(sc_sdl_log_print, info_out);
     // Redirect FFmpeg logs to SDL logs
     av_log_set_callback(sc_av_log_callback);
 }
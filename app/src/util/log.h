@@ -3,6 +3,7 @@
 
 #include "common.h"
 
+#include <stdbool.h>
 #include <SDL2/SDL_log.h>
 
 #include "options.h"
@@ -35,7 +36,13 @@ bool
 sc_log_windows_error(const char *prefix, int error);
 #endif
 
+/**
+ * Configure the logs
+ *
+ * If stdout is reserved (to output a data stream), all the logs are written
+ * to stderr.
+ */
 void
-sc_log_configure(void);
+sc_log_configure(bool stdout_reserved);
 
 #endif
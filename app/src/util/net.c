@@ -2,6 +2,8 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #ifdef _WIN32
 # include <ws2tcpip.h>
@@ -202,6 +204,58 @@ net_accept(sc_socket server_socket) {
     return wrap(raw_sock);
 }
 
+bool
+net_socket_pair(sc_socket sockets[2]) {
+    sc_socket server_socket = net_socket();
+    if (server_socket == SC_SOCKET_NONE) {
+        return false;
+    }
+
+    // Let the system choose an available port
+    bool ok = net_listen(server_socket, IPV4_LOCALHOST, 0, 1);
+    if (!ok) {
+        goto error_close_server_socket;
+    }
+
+    SOCKADDR_IN sin;
+    socklen_t sinsize = sizeof(sin);
+    if (getsockname(unwrap(server_socket), (SOCKADDR *) &sin, &sinsize)
+            == SOCKET_ERROR) {
+        net_perror("getsockname");
+        goto error_close_server_socket;
+    }
+
+    uint16_t port = ntohs(sin.sin_port);
+
+    sc_socket client_socket = net_socket();
+    if (client_socket == SC_SOCKET_NONE) {
+        goto error_close_server_socket;
+    }
+
+    ok = net_connect(client_socket, IPV4_LOCALHOST, port);
+    if (!ok) {
+        goto error_close_client_socket;
+    }
+
+    sc_socket accepted_socket = net_accept(server_socket);
+    if (accepted_socket == SC_SOCKET_NONE) {
+        goto error_close_client_socket;
+    }
+
+    net_close(server_socket);
+
+    sockets[0] = accepted_socket;
+    sockets[1] = client_socket;
+    return true;
+
+error_close_client_socket:
+    net_close(client_socket);
+error_close_server_socket:
+    net_close(server_socket);
+
+    return false;
+}
+
 ssize_t
 net_recv(sc_socket socket, void *buf, size_t len) {
     sc_raw_socket raw_sock = unwrap(socket);
@@ -294,3 +348,80 @@ net_parse_ipv4(const char *s, uint32_t *ipv4) {
     *ipv4 = ntohl(addr.s_addr);
     return true;
 }
+
+bool
+sc_net_reader_init(struct sc_net_reader *reader, sc_socket socket,
+                   size_t capacity) {
+    assert(socket != SC_SOCKET_NONE);
+    assert(capacity);
+
+    reader->buf = malloc(capacity);
+    if (!reader->buf) {
+        LOG_OOM();
+        return false;
+    }
+
+    reader->socket = socket;
+    reader->cap = capacity;
+    reader->head = 0;
+    reader->tail = 0;
+    reader->recv_count = 0;
+
+    return true;
+}
+
+void
+sc_net_reader_destroy(struct sc_net_reader *reader) {
+    free(reader->buf);
+}
+
+ssize_t
+sc_net_reader_recv_all(struct sc_net_reader *reader, void *buf_,
+                       size_t len) {
+    uint8_t *buf = buf_;
+    size_t copied = 0;
+
+    while (copied < len) {
+        size_t buffered = reader->tail - reader->head;
+        if (buffered) {
+            size_t n = MIN(buffered, len - copied);
+            memcpy(buf + copied, reader->buf + reader->head, n);
+            reader->head += n;
+            copied += n;
+            continue;
+        }
+
+        // The buffer is empty
+        reader->head = 0;
+        reader->tail = 0;
+
+        size_t remaining = len - copied;
+        ssize_t r;
+        ++reader->recv_count;
+        if (remaining >= reader->cap) {
+            // Read directly to the destination, there is no benefit to
+            // buffering (the next bytes will be read by the next call)
+            r = net_recv_all(reader->socket, buf + copied, remaining);
+        } else {
+            // Read as many bytes as available (not only the requested ones),
+            // so that the next reads are served from memory
+            r = net_recv(reader->socket, reader->buf, reader->cap);
+        }
+
+        if (r <= 0) {
+            return copied ? (ssize_t) copied : r;
+        }
+
+        if (remaining >= reader->cap) {
+            copied += r;
+            if ((size_t) r < remaining) {
+                // End of stream or error
+                return copied;
+            }
+        } else {
+            reader->tail = r;
+        }
+    }
+
+    return copied;
+}
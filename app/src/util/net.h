@@ -60,6 +60,10 @@ net_listen(sc_socket server_socket, uint32_t addr, uint16_t port, int backlog);
 sc_socket
 net_accept(sc_socket server_socket);
 
+// Create a pair of connected sockets (over the loopback interface)
+bool
+net_socket_pair(sc_socket sockets[2]);
+
 // the _all versions wait/retry until len bytes have been written/read
 ssize_t
 net_recv(sc_socket socket, void *buf, size_t len);
@@ -93,4 +97,39 @@ net_set_tcp_nodelay(sc_socket socket, bool tcp_nodelay);
 bool
 net_parse_ipv4(const char *ip, uint32_t *ipv4);
 
+/**
+ * Buffered reader over a socket
+ *
+ * Reading a stream of small framed messages with net_recv_all() costs at
+ * least one syscall per field. Instead, the reader pulls as many bytes as
+ * available (up to its capacity) on each recv(), so that subsequent reads are
+ * served from memory.
+ *
+ * Large reads (at least as large as the buffer capacity) bypass the buffer to
+ * avoid an additional copy.
+ *
+ * A reader must be used from a single thread.
+ */
+struct sc_net_reader {
+    sc_socket socket;
+    uint8_t *buf;
+    size_t cap;
+    size_t head; // read cursor
+    size_t tail; // write cursor (end of buffered data)
+
+    // Number of recv() calls, for statistics
+    uint64_t recv_count;
+};
+
+bool
+sc_net_reader_init(struct sc_net_reader *reader, sc_socket socket,
+                   size_t capacity);
+
+void
+sc_net_reader_destroy(struct sc_net_reader *reader);
+
+// Like net_recv_all(), but through the reader buffer
+ssize_t
+sc_net_reader_recv_all(struct sc_net_reader *reader, void *buf, size_t len);
+
 #endif
@@ -352,6 +352,25 @@ sc_vecdeque_growsize_(size_t value)
     ok; \
 })
 
+/**
+ * Return a pointer to the item at the front, without removing it
+ *
+ * It is an error to call this function if the VecDeque is empty.
+ */
+#define sc_vecdeque_peekref(pv) \
+({ \
+    assert(!sc_vecdeque_is_empty(pv)); \
+    &(pv)->data[(pv)->origin]; \
+})
+
+/**
+ * Return the item at the front, without removing it
+ *
+ * It is an error to call this function if the VecDeque is empty.
+ */
+#define sc_vecdeque_peek(pv) \
+    (*sc_vecdeque_peekref(pv))
+
 /**
  * Pop an item and return a pointer to it (still in the VecDeque)
  *
@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <libavutil/pixdesc.h>
 
 #include "util/log.h"
 #include "util/str.h"
@@ -111,6 +112,36 @@ encode_and_write_frame(struct sc_v4l2_sink *vs, const AVFrame *frame) {
     return true;
 }
 
+static enum AVPixelFormat
+sc_v4l2_sink_get_format(enum AVPixelFormat format) {
+    switch (format) {
+        // Pixel formats supported by the v4l2 muxer
+        case AV_PIX_FMT_YUV420P:
+        case AV_PIX_FMT_NV12:
+        case AV_PIX_FMT_NV21:
+            return format;
+        default:
+            // YUVJ420P has the same layout, other formats are converted
+            return AV_PIX_FMT_YUV420P;
+    }
+}
+
+static const AVFrame *
+sc_v4l2_sink_prepare_frame(struct sc_v4l2_sink *vs, AVFrame *frame) {
+    if (frame->format == vs->format) {
+        return frame;
+    }
+
+    if (frame->format == AV_PIX_FMT_YUVJ420P
+            && vs->format == AV_PIX_FMT_YUV420P) {
+        // Same memory layout, only the color range differs
+        frame->format = AV_PIX_FMT_YUV420P;
+        return frame;
+    }
+
+    return sc_frame_converter_convert(&vs->frame_converter, frame);
+}
+
 static int
 run_v4l2_sink(void *data) {
     struct sc_v4l2_sink *vs = data;
@@ -132,7 +163,14 @@ run_v4l2_sink(void *data) {
 
         sc_frame_buffer_consume(&vs->fb, vs->frame);
 
-        bool ok = encode_and_write_frame(vs, vs->frame);
+        const AVFrame *frame = sc_v4l2_sink_prepare_frame(vs, vs->frame);
+        if (!frame) {
+            av_frame_unref(vs->frame);
+            LOGE("Could not convert frame for v4l2 sink");
+            break;
+        }
+
+        bool ok = encode_and_write_frame(vs, frame);
         av_frame_unref(vs->frame);
         if (!ok) {
             LOGE("Could not send frame to v4l2 sink");
@@ -147,19 +185,26 @@ run_v4l2_sink(void *data) {
 
 static bool
 sc_v4l2_sink_open(struct sc_v4l2_sink *vs, const AVCodecContext *ctx) {
-    assert(ctx->pix_fmt == AV_PIX_FMT_YUV420P);
-    (void) ctx;
+    // Write the decoder output format directly if the device supports it. The
+    // frames in another format (the actual format may only be known on first
+    // frame) are converted.
+    vs->format = sc_v4l2_sink_get_format(ctx->pix_fmt);
 
     bool ok = sc_frame_buffer_init(&vs->fb);
     if (!ok) {
         return false;
     }
 
-    ok = sc_mutex_init(&vs->mutex);
+    ok = sc_frame_converter_init(&vs->frame_converter, vs->format);
     if (!ok) {
         goto error_frame_buffer_destroy;
     }
 
+    ok = sc_mutex_init(&vs->mutex);
+    if (!ok) {
+        goto error_frame_converter_destroy;
+    }
+
     ok = sc_cond_init(&vs->cond);
     if (!ok) {
         goto error_mutex_destroy;
@@ -216,6 +261,7 @@ sc_v4l2_sink_open(struct sc_v4l2_sink *vs, const AVCodecContext *ctx) {
 
     // The codec is from the v4l2 encoder, not from the decoder
     ostream->codecpar->codec_id = encoder->id;
+    ostream->codecpar->format = vs->format;
 
     int ret = avio_open(&vs->format_ctx->pb, vs->device_name, AVIO_FLAG_WRITE);
     if (ret < 0) {
@@ -232,7 +278,7 @@ sc_v4l2_sink_open(struct sc_v4l2_sink *vs, const AVCodecContext *ctx) {
 
     vs->encoder_ctx->width = ctx->width;
     vs->encoder_ctx->height = ctx->height;
-    vs->encoder_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+    vs->encoder_ctx->pix_fmt = vs->format;
     vs->encoder_ctx->time_base.num = 1;
     vs->encoder_ctx->time_base.den = 1;
 
@@ -264,7 +310,8 @@ sc_v4l2_sink_open(struct sc_v4l2_sink *vs, const AVCodecContext *ctx) {
         goto error_av_packet_free;
     }
 
-    LOGI("v4l2 sink started to device: %s", vs->device_name);
+    LOGI("v4l2 sink started to device: %s (%s)", vs->device_name,
+         av_get_pix_fmt_name(vs->format));
 
     return true;
 
@@ -282,6 +329,8 @@ error_cond_destroy:
     sc_cond_destroy(&vs->cond);
 error_mutex_destroy:
     sc_mutex_destroy(&vs->mutex);
+error_frame_converter_destroy:
+    sc_frame_converter_destroy(&vs->frame_converter);
 error_frame_buffer_destroy:
     sc_frame_buffer_destroy(&vs->fb);
 
@@ -304,6 +353,7 @@ sc_v4l2_sink_close(struct sc_v4l2_sink *vs) {
     avformat_free_context(vs->format_ctx);
     sc_cond_destroy(&vs->cond);
     sc_mutex_destroy(&vs->mutex);
+    sc_frame_converter_destroy(&vs->frame_converter);
     sc_frame_buffer_destroy(&vs->fb);
 }
 
@@ -8,6 +8,7 @@
 #include <libavformat/avformat.h>
 
 #include "frame_buffer.h"
+#include "frame_converter.h"
 #include "trait/frame_sink.h"
 #include "util/thread.h"
 
@@ -20,6 +21,11 @@ struct sc_v4l2_sink {
 
     char *device_name;
 
+    // The pixel format written to the device
+    enum AVPixelFormat format;
+    // Convert the frames in other formats (only accessed from the v4l2 thread)
+    struct sc_frame_converter frame_converter;
+
     sc_thread thread;
     sc_mutex mutex;
     sc_cond cond;
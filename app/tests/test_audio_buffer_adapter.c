@@ -0,0 +1,152 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+#include "audio_buffer_adapter.h"
+
+// Replay synthetic arrival dates of 20ms audio packets received with jitter
+
+#define SAMPLE_RATE 48000
+#define BLOCK 960 // 20ms
+#define BLOCK_DURATION 20000 // in microseconds
+#define MS(ms) ((ms) * SAMPLE_RATE / 1000) // in samples
+
+struct test_stream {
+    // Packets are received late by a duration uniform in [0, jitter]
+    sc_tick jitter;
+    int64_t pts;
+    uint32_t seed;
+};
+
+static sc_tick
+test_random(struct test_stream *ts, sc_tick max) {
+    // Deterministic pseudo-random generator (LCG)
+    ts->seed = ts->seed * 1664525 + 1013904223;
+    return (sc_tick) ((ts->seed >> 8) % (max + 1));
+}
+
+// Push 1 second of packets, then terminate the period
+static uint32_t
+test_period(struct sc_audio_buffer_adapter *adapter, struct test_stream *ts,
+            uint32_t underflow) {
+    for (unsigned i = 0; i < 50; ++i) {
+        sc_tick date = SC_TICK_FROM_MS(30) + ts->pts
+                     + test_random(ts, ts->jitter);
+        sc_audio_buffer_adapter_push(adapter, date, ts->pts, BLOCK);
+        ts->pts += BLOCK_DURATION;
+    }
+
+    return sc_audio_buffer_adapter_update(adapter, 50 * BLOCK, underflow);
+}
+
+static void test_audio_buffer_adapter_jitter(void) {
+    struct test_stream ts = {
+        .jitter = SC_TICK_FROM_MS(40),
+        .seed = 42,
+    };
+
+    struct sc_audio_buffer_adapter adapter;
+    sc_audio_buffer_adapter_init(&adapter, SAMPLE_RATE, MS(50), MS(20),
+                                 MS(500));
+
+    // The target increases immediately to absorb the jitter
+    uint32_t target = test_period(&adapter, &ts, 0);
+    assert(target >= BLOCK + MS(35));
+
+    for (unsigned i = 0; i < 100; ++i) {
+        target = test_period(&adapter, &ts, 0);
+    }
+
+    // The target must cover the block, the jitter and the margin, but not
+    // much more
+    assert(target >= BLOCK + MS(40));
+    assert(target <= BLOCK + MS(40) + MS(10));
+}
+
+static void test_audio_buffer_adapter_decrease(void) {
+    struct test_stream ts = {
+        .jitter = SC_TICK_FROM_MS(2),
+        .seed = 42,
+    };
+
+    struct sc_audio_buffer_adapter adapter;
+    sc_audio_buffer_adapter_init(&adapter, SAMPLE_RATE, MS(300), MS(20),
+                                 MS(500));
+
+    // Do not decrease immediately
+    uint32_t target = test_period(&adapter, &ts, 0);
+    assert(target == MS(300));
+
+    // 5 minutes without underflow
+    for (unsigned i = 0; i < 300; ++i) {
+        uint32_t new_target = test_period(&adapter, &ts, 0);
+        // Never increase above the value required by the jitter
+        assert(new_target <= target
+                || new_target <= BLOCK + MS(2) + MS(10));
+        target = new_target;
+    }
+
+    // Converged to the smallest value covering the jitter
+    assert(target <= BLOCK + MS(2) + MS(10));
+}
+
+static void test_audio_buffer_adapter_underflow(void) {
+    struct test_stream ts = {
+        .jitter = SC_TICK_FROM_MS(2),
+        .seed = 42,
+    };
+
+    struct sc_audio_buffer_adapter adapter;
+    sc_audio_buffer_adapter_init(&adapter, SAMPLE_RATE, MS(60), MS(20),
+                                 MS(500));
+
+    uint32_t target = test_period(&adapter, &ts, 0);
+    assert(target == MS(60));
+
+    // On underflow, the target increases immediately
+    target = test_period(&adapter, &ts, MS(5));
+    assert(target == MS(75));
+
+    // It decreases later, but not back to the value which caused the underflow
+    for (unsigned i = 0; i < 200; ++i) {
+        target = test_period(&adapter, &ts, 0);
+        assert(target > MS(60));
+    }
+    assert(target == MS(70));
+}
+
+static void test_audio_buffer_adapter_bounds(void) {
+    struct test_stream ts = {
+        .jitter = SC_TICK_FROM_MS(200),
+        .seed = 42,
+    };
+
+    struct sc_audio_buffer_adapter adapter;
+    sc_audio_buffer_adapter_init(&adapter, SAMPLE_RATE, MS(50), MS(40),
+                                 MS(100));
+
+    uint32_t target = test_period(&adapter, &ts, 0);
+    assert(target == MS(100));
+
+    target = test_period(&adapter, &ts, MS(100));
+    assert(target == MS(100));
+
+    ts.jitter = 0;
+    for (unsigned i = 0; i < 1000; ++i) {
+        target = test_period(&adapter, &ts, 0);
+    }
+    assert(target == MS(40));
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_audio_buffer_adapter_jitter();
+    test_audio_buffer_adapter_decrease();
+    test_audio_buffer_adapter_underflow();
+    test_audio_buffer_adapter_bounds();
+
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+#include "util/audio_convert.h"
+
+// Use odd counts to test both the vectorized and the remaining samples
+
+static void test_audio_convert_s16(void) {
+    int16_t src[19];
+    float dst[19];
+    for (int i = 0; i < 19; ++i) {
+        src[i] = (int16_t) (i * 3449 - 32768);
+    }
+    src[18] = 32767;
+
+    sc_audio_convert_s16(dst, src, 19);
+
+    assert(dst[0] == -1.0f);
+    assert(dst[18] == 32767 / 32768.0f);
+    for (int i = 0; i < 19; ++i) {
+        assert(dst[i] == src[i] / 32768.0f);
+    }
+}
+
+static void test_audio_convert_s32(void) {
+    int32_t src[11];
+    float dst[11];
+    for (int i = 0; i < 11; ++i) {
+        src[i] = INT32_MIN + i * 390451572;
+    }
+
+    sc_audio_convert_s32(dst, src, 11);
+
+    assert(dst[0] == -1.0f);
+    for (int i = 0; i < 11; ++i) {
+        assert(dst[i] == (float) src[i] / 2147483648.0f);
+    }
+}
+
+static void test_audio_interleave_flt(void) {
+    float left[13];
+    float right[13];
+    float center[13];
+    for (int i = 0; i < 13; ++i) {
+        left[i] = i;
+        right[i] = -i;
+        center[i] = 100 + i;
+    }
+
+    float dst[3 * 13];
+
+    const float *stereo[] = {left, right};
+    sc_audio_interleave_flt(dst, stereo, 2, 2, 11);
+    for (int i = 0; i < 11; ++i) {
+        assert(dst[2 * i] == left[2 + i]);
+        assert(dst[2 * i + 1] == right[2 + i]);
+    }
+
+    const float *three[] = {left, right, center};
+    sc_audio_interleave_flt(dst, three, 3, 0, 13);
+    for (int i = 0; i < 13; ++i) {
+        assert(dst[3 * i] == left[i]);
+        assert(dst[3 * i + 1] == right[i]);
+        assert(dst[3 * i + 2] == center[i]);
+    }
+
+    const float *mono[] = {center};
+    sc_audio_interleave_flt(dst, mono, 1, 5, 8);
+    for (int i = 0; i < 8; ++i) {
+        assert(dst[i] == center[5 + i]);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_audio_convert_s16();
+    test_audio_convert_s32();
+    test_audio_interleave_flt();
+
+    return 0;
+}
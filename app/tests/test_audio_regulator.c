@@ -0,0 +1,198 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+
+#include "audio_regulator.h"
+#include "util/thread.h"
+
+#define SAMPLE_RATE 48000
+#define CHANNELS 2
+#define SAMPLE_SIZE (CHANNELS * sizeof(float))
+#define FRAME_SAMPLES 960 // 20ms
+#define TARGET_BUFFERING 2400 // 50ms
+
+struct test_producer {
+    struct sc_audio_regulator *ar;
+    unsigned frames;
+    bool ok;
+    atomic_bool done;
+};
+
+static AVCodecContext *
+create_codec_context(void) {
+    AVCodecContext *ctx = avcodec_alloc_context3(NULL);
+    assert(ctx);
+
+    ctx->sample_fmt = AV_SAMPLE_FMT_FLT;
+    ctx->sample_rate = SAMPLE_RATE;
+#ifdef SCRCPY_LAVU_HAS_CHLAYOUT
+    ctx->ch_layout = (AVChannelLayout) AV_CHANNEL_LAYOUT_STEREO;
+#else
+    ctx->channel_layout = AV_CH_LAYOUT_STEREO;
+    ctx->channels = CHANNELS;
+#endif
+
+    return ctx;
+}
+
+// Each sample (for all channels) contains its index in the stream, so that
+// the consumer can check that the samples are received in order
+static bool
+push_frame(struct sc_audio_regulator *ar, AVFrame *frame, float *data,
+           unsigned index) {
+    for (unsigned i = 0; i < FRAME_SAMPLES; ++i) {
+        float value = index * FRAME_SAMPLES + i;
+        for (unsigned c = 0; c < CHANNELS; ++c) {
+            data[i * CHANNELS + c] = value;
+        }
+    }
+
+    frame->data[0] = (uint8_t *) data;
+    frame->nb_samples = FRAME_SAMPLES;
+    // PTS in microseconds
+    frame->pts = (int64_t) index * FRAME_SAMPLES * 1000000 / SAMPLE_RATE;
+
+    return sc_audio_regulator_push(ar, frame);
+}
+
+static void test_audio_regulator_drop_before_playback(void) {
+    AVCodecContext *ctx = create_codec_context();
+
+    struct sc_audio_regulator ar;
+    bool ok = sc_audio_regulator_init(&ar, SAMPLE_SIZE, ctx, TARGET_BUFFERING,
+                                      TARGET_BUFFERING, TARGET_BUFFERING);
+    assert(ok);
+
+    AVFrame *frame = av_frame_alloc();
+    assert(frame);
+    static float data[FRAME_SAMPLES * CHANNELS];
+
+    // Push 10 frames before the playback starts: the producer must not drop
+    // the samples itself, but request the consumer to drop them
+    for (unsigned i = 0; i < 10; ++i) {
+        ok = push_frame(&ar, frame, data, i);
+        assert(ok);
+    }
+
+    // Before playback, the buffering is limited to the target + 10ms
+    uint32_t max_buffering = TARGET_BUFFERING + SAMPLE_RATE / 100;
+    uint32_t dropped = 10 * FRAME_SAMPLES - max_buffering;
+    assert(sc_audiobuf_can_read(&ar.buf) == 10 * FRAME_SAMPLES);
+    assert(atomic_load(&ar.drop_request) == dropped);
+
+    static float out[240 * CHANNELS];
+    int64_t pts = sc_audio_regulator_pull(&ar, (uint8_t *) out, 240);
+
+    // The oldest samples have been dropped
+    assert(out[0] == (float) dropped);
+    assert(out[239 * CHANNELS] == (float) dropped + 239);
+    assert(pts == (int64_t) dropped * 1000000 / SAMPLE_RATE);
+    assert(atomic_load(&ar.drop_request) == 0);
+    assert(sc_audiobuf_can_read(&ar.buf) == max_buffering - 240);
+
+    frame->data[0] = NULL;
+    av_frame_free(&frame);
+    sc_audio_regulator_destroy(&ar);
+    avcodec_free_context(&ctx);
+}
+
+static int
+run_producer(void *data) {
+    struct test_producer *producer = data;
+
+    AVFrame *frame = av_frame_alloc();
+    assert(frame);
+    float *samples = malloc(FRAME_SAMPLES * SAMPLE_SIZE);
+    assert(samples);
+
+    producer->ok = true;
+    for (unsigned i = 0; i < producer->frames; ++i) {
+        // Push much faster than the consumer pulls, to trigger the drops
+        if (!push_frame(producer->ar, frame, samples, i)) {
+            producer->ok = false;
+            break;
+        }
+    }
+
+    free(samples);
+    frame->data[0] = NULL;
+    av_frame_free(&frame);
+
+    atomic_store(&producer->done, true);
+    return 0;
+}
+
+static void test_audio_regulator_concurrent_drops(void) {
+    AVCodecContext *ctx = create_codec_context();
+
+    struct sc_audio_regulator ar;
+    bool ok = sc_audio_regulator_init(&ar, SAMPLE_SIZE, ctx, TARGET_BUFFERING,
+                                      TARGET_BUFFERING, TARGET_BUFFERING);
+    assert(ok);
+
+    struct test_producer producer = {
+        .ar = &ar,
+        .frames = 2000,
+    };
+    atomic_init(&producer.done, false);
+
+    sc_thread thread;
+    ok = sc_thread_create(&thread, run_producer, "test-producer", &producer);
+    assert(ok);
+
+    static float out[240 * CHANNELS];
+    float last = -1;
+    uint64_t played = 0;
+
+    // The consumer runs concurrently with the producer, which requests to
+    // drop samples all the time
+    for (;;) {
+        // Read the flag before pulling: if the producer is done and the buffer
+        // is empty, then all the samples have been consumed
+        bool done = atomic_load(&producer.done);
+        int64_t pts = sc_audio_regulator_pull(&ar, (uint8_t *) out, 240);
+        if (pts == -1) {
+            // Silence (not started or underflow)
+            if (done) {
+                break;
+            }
+            continue;
+        }
+
+        for (unsigned i = 0; i < 240; ++i) {
+            float value = out[i * CHANNELS];
+            // All channels have the same value
+            assert(out[i * CHANNELS + 1] == value);
+            // The samples are received in order (some may be dropped). The
+            // compensation may resample, so allow a small error.
+            assert(value > last - 1);
+            last = value;
+        }
+
+        played += 240;
+    }
+
+    sc_thread_join(&thread, NULL);
+    assert(producer.ok);
+
+    // Many samples have been dropped, but the last ones have been played
+    assert(played < producer.frames * FRAME_SAMPLES);
+    assert(last > producer.frames * FRAME_SAMPLES / 2);
+
+    sc_audio_regulator_destroy(&ar);
+    avcodec_free_context(&ctx);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_audio_regulator_drop_before_playback();
+    test_audio_regulator_concurrent_drops();
+
+    return 0;
+}
@@ -124,6 +124,45 @@ static void test_audiobuf_partial_read_write(void) {
     sc_audiobuf_destroy(&buf);
 }
 
+static void
+write_sequence(uint8_t *to, uint32_t offset, uint32_t samples_count,
+               void *userdata) {
+    uint32_t *next = userdata;
+    uint32_t *out = (uint32_t *) to;
+    for (uint32_t i = 0; i < samples_count; ++i) {
+        out[i] = *next + offset + i;
+    }
+}
+
+static void test_audiobuf_write_with(void) {
+    struct sc_audiobuf buf;
+    uint32_t data[10];
+
+    bool ok = sc_audiobuf_init(&buf, 4, 10);
+    assert(ok);
+
+    uint32_t r = sc_audiobuf_write_silence(&buf, 7);
+    assert(r == 7);
+    r = sc_audiobuf_read(&buf, NULL, 7);
+    assert(r == 7);
+
+    // The writable area wraps around the end of the buffer
+    uint32_t first = 1;
+    uint32_t w = sc_audiobuf_write_with(&buf, 8, write_sequence, &first);
+    assert(w == 8);
+
+    first = 9;
+    w = sc_audiobuf_write_with(&buf, 6, write_sequence, &first);
+    assert(w == 2);
+
+    r = sc_audiobuf_read(&buf, data, 10);
+    assert(r == 10);
+    uint32_t expected[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    assert(!memcmp(data, expected, 40));
+
+    sc_audiobuf_destroy(&buf);
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -131,6 +170,7 @@ int main(int argc, char *argv[]) {
     test_audiobuf_simple();
     test_audiobuf_boundaries();
     test_audiobuf_partial_read_write();
+    test_audiobuf_write_with();
 
     return 0;
 }
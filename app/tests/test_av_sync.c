@@ -0,0 +1,71 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "av_sync.h"
+#include "util/tick.h"
+
+static void test_av_sync_no_audio(void) {
+    struct sc_av_sync sync;
+    bool ok = sc_av_sync_init(&sync);
+    assert(ok);
+
+    sc_tick date;
+    ok = sc_av_sync_get_video_date(&sync, 1000, &date);
+    assert(!ok);
+
+    // Not measured without audio clock
+    sc_av_sync_report_video(&sync, 1000, sc_tick_now());
+    assert(!sync.stats.count);
+
+    sc_av_sync_destroy(&sync);
+}
+
+static void test_av_sync_video_date(void) {
+    struct sc_av_sync sync;
+    bool ok = sc_av_sync_init(&sync);
+    assert(ok);
+
+    sc_tick now = sc_tick_now();
+
+    // The audio samples are audible 50ms after their PTS (in system time)
+    sc_tick offset = now + SC_TICK_FROM_MS(50);
+    for (int64_t pts = 0; pts < 200000; pts += 5000) {
+        sc_av_sync_report_audio(&sync, pts, pts + offset);
+
+        // The video clock is updated by the consumer
+        sc_tick date;
+        ok = sc_av_sync_get_video_date(&sync, pts, &date);
+        assert(ok);
+        assert(date == pts + offset);
+    }
+
+    sc_tick date;
+    ok = sc_av_sync_get_video_date(&sync, 250000, &date);
+    assert(ok);
+    assert(date == 250000 + offset);
+
+    // Video presented 10ms late, then 2ms early
+    sc_av_sync_report_video(&sync, 200000,
+                            200000 + offset + SC_TICK_FROM_MS(10));
+    sc_av_sync_report_video(&sync, 210000,
+                            210000 + offset - SC_TICK_FROM_MS(2));
+
+    assert(sync.stats.count == 2);
+    assert(sync.stats.min_offset == -SC_TICK_FROM_MS(2));
+    assert(sync.stats.max_offset == SC_TICK_FROM_MS(10));
+    assert(sync.stats.total_offset == SC_TICK_FROM_MS(8));
+
+    sc_av_sync_destroy(&sync);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_av_sync_no_audio();
+    test_av_sync_video_date();
+
+    return 0;
+}
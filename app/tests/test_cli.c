@@ -49,6 +49,7 @@ static void test_options(void) {
         "--video-bit-rate", "5M",
         "--crop", "100:200:300:400",
         "--fullscreen",
+        "--frame-queue-policy", "block",
         "--max-fps", "30",
         "--max-size", "1024",
         // "--no-control" is not compatible with "--turn-screen-off"
@@ -77,6 +78,7 @@ static void test_options(void) {
     assert(opts->video_bit_rate == 5000000);
     assert(!strcmp(opts->crop, "100:200:300:400"));
     assert(opts->fullscreen);
+    assert(opts->frame_queue_policy == SC_FRAME_QUEUE_POLICY_BLOCK);
     assert(!strcmp(opts->max_fps, "30"));
     assert(opts->max_size == 1024);
     assert(opts->port_range.first == 1234);
@@ -121,6 +123,66 @@ static void test_options2(void) {
     assert(opts->record_format == SC_RECORD_FORMAT_MP4);
 }
 
+static void test_record_segments(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {
+        "scrcpy",
+        "--record", "rec-%Y%m%d-%H%M%S.mkv",
+        "--record-segment-duration", "600",
+        "--record-segment-size", "500",
+    };
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+
+    const struct scrcpy_options *opts = &args.opts;
+    assert(!strcmp(opts->record_filename, "rec-%Y%m%d-%H%M%S.mkv"));
+    assert(opts->record_segment_duration == SC_TICK_FROM_SEC(600));
+    assert(opts->record_segment_size == UINT64_C(500000000));
+}
+
+static void test_record_segments_invalid(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    // without recording
+    char *argv[] = {"scrcpy", "--record-segment-duration", "600"};
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(!ok);
+
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--record-segment-size=500"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+
+    // out of range
+    args.opts = scrcpy_options_default;
+    char *argv3[] = {
+        "scrcpy",
+        "--record", "file.mkv",
+        "--record-segment-duration", "0",
+    };
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv3), argv3);
+    assert(!ok);
+
+    args.opts = scrcpy_options_default;
+    char *argv4[] = {
+        "scrcpy",
+        "--record", "file.mkv",
+        "--record-segment-size", "-1",
+    };
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv4), argv4);
+    assert(!ok);
+}
+
 static void test_parse_shortcut_mods(void) {
     uint8_t mods;
     bool ok;
@@ -157,6 +219,8 @@ int main(int argc, char *argv[]) {
     test_flag_help();
     test_options();
     test_options2();
+    test_record_segments();
+    test_record_segments_invalid();
     test_parse_shortcut_mods();
     return 0;
 }
@@ -0,0 +1,189 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "clock.h"
+
+// Replay synthetic timestamps of a 60 fps stream received with jitter
+
+#define FRAME_INTERVAL 16667 // in microseconds
+
+struct test_stream {
+    // Device clock drift relative to the computer clock
+    double drift;
+    // Minimal latency
+    sc_tick latency;
+    // The network jitter is uniform in [0, jitter]
+    sc_tick jitter;
+
+    uint32_t seed;
+};
+
+static sc_tick
+test_random(struct test_stream *ts, sc_tick max) {
+    // Deterministic pseudo-random generator (LCG)
+    ts->seed = ts->seed * 1664525 + 1013904223;
+    return (sc_tick) ((ts->seed >> 8) % (max + 1));
+}
+
+// The reception date of a packet if received without any jitter
+static sc_tick
+test_base_date(struct test_stream *ts, sc_tick pts) {
+    return (sc_tick) (pts * (1 + ts->drift)) + ts->latency;
+}
+
+// The expected reception date (without outliers)
+static sc_tick
+test_expected_date(struct test_stream *ts, sc_tick pts) {
+    return test_base_date(ts, pts) + ts->jitter / 2;
+}
+
+static sc_tick
+test_prediction_error(struct sc_clock *clock, struct test_stream *ts,
+                      sc_tick pts) {
+    return llabs(sc_clock_to_system_time(clock, pts)
+                 - test_expected_date(ts, pts));
+}
+
+static void test_clock_jitter(void) {
+    struct test_stream ts = {
+        .drift = 0,
+        .latency = SC_TICK_FROM_MS(20),
+        .jitter = SC_TICK_FROM_MS(4),
+        .seed = 42,
+    };
+
+    struct sc_clock clock;
+    sc_clock_init(&clock);
+
+    sc_tick max_error = 0;
+    for (unsigned i = 0; i < 10000; ++i) {
+        sc_tick pts = i * FRAME_INTERVAL;
+        if (i >= 100) {
+            sc_tick error = test_prediction_error(&clock, &ts, pts);
+            if (error > max_error) {
+                max_error = error;
+            }
+        }
+
+        sc_tick system = test_base_date(&ts, pts) + test_random(&ts, ts.jitter);
+        sc_clock_update(&clock, system, pts);
+    }
+
+    assert(max_error <= SC_TICK_FROM_MS(2));
+}
+
+static void test_clock_bursts(void) {
+    struct test_stream ts = {
+        .drift = 0,
+        .latency = SC_TICK_FROM_MS(20),
+        .jitter = SC_TICK_FROM_MS(2),
+        .seed = 42,
+    };
+
+    struct sc_clock clock;
+    sc_clock_init(&clock);
+
+    sc_tick max_error = 0;
+    for (unsigned i = 0; i < 20000; ++i) {
+        sc_tick pts = i * FRAME_INTERVAL;
+
+        // Every 5 seconds, the network is stalled for 150ms, then the
+        // pending packets are received at once
+        unsigned burst_pos = i % 300;
+        bool in_burst = burst_pos >= 200 && burst_pos < 210;
+
+        if (i >= 100 && !in_burst) {
+            sc_tick error = test_prediction_error(&clock, &ts, pts);
+            if (error > max_error) {
+                max_error = error;
+            }
+        }
+
+        sc_tick system = test_base_date(&ts, pts) + test_random(&ts, ts.jitter);
+        if (in_burst) {
+            // All the pending packets are received at the end of the stall
+            sc_tick last_pts = (i - burst_pos + 209) * FRAME_INTERVAL;
+            system = test_base_date(&ts, last_pts) + SC_TICK_FROM_MS(150);
+        }
+
+        sc_clock_update(&clock, system, pts);
+    }
+
+    // Without outlier rejection, each burst would shift the estimation by
+    // several milliseconds
+    assert(max_error <= SC_TICK_FROM_MS(2));
+}
+
+static void test_clock_drift(void) {
+    struct test_stream ts = {
+        .drift = 0.0002, // 200 ppm
+        .latency = SC_TICK_FROM_MS(20),
+        .jitter = SC_TICK_FROM_MS(4),
+        .seed = 42,
+    };
+
+    struct sc_clock clock;
+    sc_clock_init(&clock);
+
+    // 1 hour
+    unsigned count = 60 * 60 * 60;
+    for (unsigned i = 0; i < count; ++i) {
+        sc_tick pts = i * FRAME_INTERVAL;
+        sc_tick system = test_base_date(&ts, pts) + test_random(&ts, ts.jitter);
+        sc_clock_update(&clock, system, pts);
+    }
+
+    // The device screen does not change for 1 minute, so no frame is
+    // received. With 200 ppm of drift, ignoring the drift would result in an
+    // error of 12 ms.
+    sc_tick pts = (count + 60 * 60) * FRAME_INTERVAL;
+    sc_tick error = test_prediction_error(&clock, &ts, pts);
+    assert(error <= SC_TICK_FROM_MS(2));
+}
+
+static void test_clock_latency_change(void) {
+    struct test_stream ts = {
+        .drift = 0,
+        .latency = SC_TICK_FROM_MS(20),
+        .jitter = SC_TICK_FROM_MS(2),
+        .seed = 42,
+    };
+
+    struct sc_clock clock;
+    sc_clock_init(&clock);
+
+    for (unsigned i = 0; i < 1000; ++i) {
+        sc_tick pts = i * FRAME_INTERVAL;
+        sc_tick system = test_base_date(&ts, pts) + test_random(&ts, ts.jitter);
+        sc_clock_update(&clock, system, pts);
+    }
+
+    // The latency increases permanently (the points must not be rejected
+    // forever)
+    ts.latency += SC_TICK_FROM_MS(50);
+
+    for (unsigned i = 1000; i < 1300; ++i) {
+        sc_tick pts = i * FRAME_INTERVAL;
+        sc_tick system = test_base_date(&ts, pts) + test_random(&ts, ts.jitter);
+        sc_clock_update(&clock, system, pts);
+    }
+
+    sc_tick pts = 1300 * FRAME_INTERVAL;
+    sc_tick error = test_prediction_error(&clock, &ts, pts);
+    assert(error <= SC_TICK_FROM_MS(2));
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_clock_jitter();
+    test_clock_bursts();
+    test_clock_drift();
+    test_clock_latency_change();
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libavutil/frame.h>
+
+#include "frame_converter.h"
+
+#define WIDTH 32
+#define HEIGHT 16
+
+static AVFrame *
+create_nv12_frame(int width, int height, int64_t pts) {
+    AVFrame *frame = av_frame_alloc();
+    assert(frame);
+    frame->format = AV_PIX_FMT_NV12;
+    frame->width = width;
+    frame->height = height;
+    frame->pts = pts;
+
+    int r = av_frame_get_buffer(frame, 0);
+    assert(!r);
+    (void) r;
+
+    for (int y = 0; y < height; ++y) {
+        uint8_t *line = frame->data[0] + y * frame->linesize[0];
+        for (int x = 0; x < width; ++x) {
+            line[x] = 16 + (x + y) % 200;
+        }
+    }
+
+    // Interleaved U and V
+    for (int y = 0; y < height / 2; ++y) {
+        uint8_t *line = frame->data[1] + y * frame->linesize[1];
+        for (int x = 0; x < width / 2; ++x) {
+            line[2 * x] = 64 + x;
+            line[2 * x + 1] = 192 - y;
+        }
+    }
+
+    return frame;
+}
+
+static void
+assert_yuv420p_frame(const AVFrame *out, const AVFrame *in) {
+    assert(out->format == AV_PIX_FMT_YUV420P);
+    assert(out->width == in->width);
+    assert(out->height == in->height);
+    assert(out->pts == in->pts);
+
+    // NV12 to YUV420P only deinterleaves the chroma planes
+    for (int y = 0; y < in->height; ++y) {
+        const uint8_t *src = in->data[0] + y * in->linesize[0];
+        const uint8_t *dst = out->data[0] + y * out->linesize[0];
+        for (int x = 0; x < in->width; ++x) {
+            assert(dst[x] == src[x]);
+        }
+    }
+
+    for (int y = 0; y < in->height / 2; ++y) {
+        const uint8_t *src = in->data[1] + y * in->linesize[1];
+        const uint8_t *u = out->data[1] + y * out->linesize[1];
+        const uint8_t *v = out->data[2] + y * out->linesize[2];
+        for (int x = 0; x < in->width / 2; ++x) {
+            assert(u[x] == src[2 * x]);
+            assert(v[x] == src[2 * x + 1]);
+        }
+    }
+}
+
+static void test_convert_nv12(void) {
+    struct sc_frame_converter fc;
+    bool ok = sc_frame_converter_init(&fc, AV_PIX_FMT_YUV420P);
+    assert(ok);
+
+    AVFrame *frame = create_nv12_frame(WIDTH, HEIGHT, 42);
+    const AVFrame *out = sc_frame_converter_convert(&fc, frame);
+    assert(out);
+    assert_yuv420p_frame(out, frame);
+
+    // The converted frame may be referenced by the caller
+    AVFrame *ref = av_frame_alloc();
+    assert(ref);
+    int r = av_frame_ref(ref, out);
+    assert(!r);
+    (void) r;
+
+    av_frame_free(&frame);
+
+    // A new size is handled
+    frame = create_nv12_frame(HEIGHT, WIDTH, 43);
+    out = sc_frame_converter_convert(&fc, frame);
+    assert(out);
+    assert_yuv420p_frame(out, frame);
+
+    // The referenced frame is not overwritten by the next conversion
+    assert(ref->pts == 42);
+    assert(ref->width == WIDTH);
+    assert(ref->data[0] != out->data[0]);
+
+    av_frame_free(&ref);
+    av_frame_free(&frame);
+    sc_frame_converter_destroy(&fc);
+}
+
+static void test_convert_keep_color_range(void) {
+    struct sc_frame_converter fc;
+    bool ok = sc_frame_converter_init(&fc, AV_PIX_FMT_YUV420P);
+    assert(ok);
+
+    AVFrame *frame = create_nv12_frame(WIDTH, HEIGHT, 0);
+    frame->color_range = AVCOL_RANGE_JPEG;
+
+    const AVFrame *out = sc_frame_converter_convert(&fc, frame);
+    assert(out);
+    assert(out->color_range == AVCOL_RANGE_JPEG);
+    // The sample values are not scaled to the limited range
+    assert_yuv420p_frame(out, frame);
+
+    av_frame_free(&frame);
+    sc_frame_converter_destroy(&fc);
+}
+
+static void test_downscale_yuv420p(void) {
+    struct sc_frame_converter fc;
+    bool ok = sc_frame_converter_init(&fc, AV_PIX_FMT_YUV420P);
+    assert(ok);
+
+    AVFrame *frame = av_frame_alloc();
+    assert(frame);
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = WIDTH;
+    frame->height = HEIGHT;
+    frame->pts = 42;
+    int r = av_frame_get_buffer(frame, 0);
+    assert(!r);
+    (void) r;
+
+    // Uniform color
+    for (int y = 0; y < HEIGHT; ++y) {
+        memset(frame->data[0] + y * frame->linesize[0], 100, WIDTH);
+    }
+    for (int y = 0; y < HEIGHT / 2; ++y) {
+        memset(frame->data[1] + y * frame->linesize[1], 64, WIDTH / 2);
+        memset(frame->data[2] + y * frame->linesize[2], 192, WIDTH / 2);
+    }
+
+    // The input and output pixel formats may be the same when scaling
+    const AVFrame *out =
+        sc_frame_converter_scale(&fc, frame, WIDTH / 2, HEIGHT / 2);
+    assert(out);
+    assert(out->format == AV_PIX_FMT_YUV420P);
+    assert(out->width == WIDTH / 2);
+    assert(out->height == HEIGHT / 2);
+    assert(out->pts == 42);
+
+    for (int y = 0; y < HEIGHT / 2; ++y) {
+        const uint8_t *line = out->data[0] + y * out->linesize[0];
+        for (int x = 0; x < WIDTH / 2; ++x) {
+            assert(abs(line[x] - 100) <= 1);
+        }
+    }
+    for (int y = 0; y < HEIGHT / 4; ++y) {
+        const uint8_t *u = out->data[1] + y * out->linesize[1];
+        const uint8_t *v = out->data[2] + y * out->linesize[2];
+        for (int x = 0; x < WIDTH / 4; ++x) {
+            assert(abs(u[x] - 64) <= 1);
+            assert(abs(v[x] - 192) <= 1);
+        }
+    }
+
+    av_frame_free(&frame);
+    sc_frame_converter_destroy(&fc);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_convert_nv12();
+    test_convert_keep_color_range();
+    test_downscale_yuv420p();
+
+    return 0;
+}
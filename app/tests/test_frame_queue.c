@@ -0,0 +1,244 @@
+#include "common.h"
+
+#include <assert.h>
+#include <libavutil/frame.h>
+
+#include "frame_queue.h"
+#include "util/thread.h"
+
+#define MAX_RECEIVED 64
+
+// A sink recording the pts of the received frames, which can be blocked
+struct test_sink {
+    struct sc_frame_sink frame_sink;
+
+    sc_mutex mutex;
+    sc_cond cond;
+    bool blocked;
+    bool entered; // a push has been called while blocked
+
+    int64_t received[MAX_RECEIVED];
+    unsigned count;
+    bool opened;
+};
+
+#define DOWNCAST(SINK) container_of(SINK, struct test_sink, frame_sink)
+
+static bool
+test_sink_open(struct sc_frame_sink *sink, const AVCodecContext *ctx) {
+    (void) ctx;
+    struct test_sink *ts = DOWNCAST(sink);
+    ts->opened = true;
+    return true;
+}
+
+static void
+test_sink_close(struct sc_frame_sink *sink) {
+    struct test_sink *ts = DOWNCAST(sink);
+    ts->opened = false;
+}
+
+static bool
+test_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
+    struct test_sink *ts = DOWNCAST(sink);
+
+    sc_mutex_lock(&ts->mutex);
+    ts->entered = true;
+    sc_cond_broadcast(&ts->cond);
+    while (ts->blocked) {
+        sc_cond_wait(&ts->cond, &ts->mutex);
+    }
+    assert(ts->count < MAX_RECEIVED);
+    ts->received[ts->count++] = frame->pts;
+    sc_cond_broadcast(&ts->cond);
+    sc_mutex_unlock(&ts->mutex);
+
+    return true;
+}
+
+static void
+test_sink_init(struct test_sink *ts, bool blocked) {
+    static const struct sc_frame_sink_ops ops = {
+        .open = test_sink_open,
+        .close = test_sink_close,
+        .push = test_sink_push,
+    };
+
+    ts->frame_sink.ops = &ops;
+
+    bool ok = sc_mutex_init(&ts->mutex);
+    assert(ok);
+    ok = sc_cond_init(&ts->cond);
+    assert(ok);
+
+    ts->blocked = blocked;
+    ts->entered = false;
+    ts->count = 0;
+    ts->opened = false;
+}
+
+static void
+test_sink_destroy(struct test_sink *ts) {
+    sc_cond_destroy(&ts->cond);
+    sc_mutex_destroy(&ts->mutex);
+}
+
+static void
+test_sink_wait_entered(struct test_sink *ts) {
+    sc_mutex_lock(&ts->mutex);
+    while (!ts->entered) {
+        sc_cond_wait(&ts->cond, &ts->mutex);
+    }
+    sc_mutex_unlock(&ts->mutex);
+}
+
+static void
+test_sink_unblock(struct test_sink *ts) {
+    sc_mutex_lock(&ts->mutex);
+    ts->blocked = false;
+    sc_cond_broadcast(&ts->cond);
+    sc_mutex_unlock(&ts->mutex);
+}
+
+static void
+test_sink_wait_count(struct test_sink *ts, unsigned count) {
+    sc_mutex_lock(&ts->mutex);
+    while (ts->count < count) {
+        sc_cond_wait(&ts->cond, &ts->mutex);
+    }
+    sc_mutex_unlock(&ts->mutex);
+}
+
+static void
+push_frame(struct sc_frame_queue *fq, int64_t pts) {
+    AVFrame *frame = av_frame_alloc();
+    assert(frame);
+    frame->pts = pts;
+
+    bool ok = fq->frame_sink.ops->push(&fq->frame_sink, frame);
+    assert(ok);
+
+    av_frame_free(&frame);
+}
+
+static void test_frame_queue_keep_latest(void) {
+    struct test_sink ts;
+    test_sink_init(&ts, true);
+
+    struct sc_frame_queue fq;
+    sc_frame_queue_init(&fq, "test", 2, SC_FRAME_QUEUE_POLICY_KEEP_LATEST);
+    sc_frame_source_add_sink(&fq.frame_source, &ts.frame_sink);
+
+    bool ok = fq.frame_sink.ops->open(&fq.frame_sink, NULL);
+    assert(ok);
+    assert(ts.opened);
+
+    // The first frame is consumed by the sink, which blocks
+    push_frame(&fq, 0);
+    test_sink_wait_entered(&ts);
+
+    // The pusher is never blocked, the oldest frames are dropped
+    for (int64_t pts = 1; pts < 10; ++pts) {
+        push_frame(&fq, pts);
+    }
+
+    struct sc_frame_queue_stats stats;
+    sc_frame_queue_get_stats(&fq, &stats);
+    assert(stats.depth == 2);
+    assert(stats.max_depth == 2);
+    assert(stats.pushed == 10);
+    assert(stats.dropped == 7);
+
+    test_sink_unblock(&ts);
+    test_sink_wait_count(&ts, 3);
+
+    fq.frame_sink.ops->close(&fq.frame_sink);
+    assert(!ts.opened);
+
+    assert(ts.count == 3);
+    assert(ts.received[0] == 0);
+    assert(ts.received[1] == 8);
+    assert(ts.received[2] == 9);
+
+    test_sink_destroy(&ts);
+}
+
+static void test_frame_queue_block(void) {
+    struct test_sink ts;
+    test_sink_init(&ts, false);
+
+    struct sc_frame_queue fq;
+    sc_frame_queue_init(&fq, "test", 1, SC_FRAME_QUEUE_POLICY_BLOCK);
+    sc_frame_source_add_sink(&fq.frame_source, &ts.frame_sink);
+
+    bool ok = fq.frame_sink.ops->open(&fq.frame_sink, NULL);
+    assert(ok);
+
+    for (int64_t pts = 0; pts < 32; ++pts) {
+        push_frame(&fq, pts);
+    }
+
+    test_sink_wait_count(&ts, 32);
+
+    struct sc_frame_queue_stats stats;
+    sc_frame_queue_get_stats(&fq, &stats);
+    assert(stats.max_depth == 1);
+    assert(stats.pushed == 32);
+    assert(stats.dropped == 0);
+
+    fq.frame_sink.ops->close(&fq.frame_sink);
+
+    // No frame is lost, in order
+    assert(ts.count == 32);
+    for (unsigned i = 0; i < 32; ++i) {
+        assert(ts.received[i] == i);
+    }
+
+    test_sink_destroy(&ts);
+}
+
+static void test_frame_queue_many_sinks(void) {
+    // More sinks than the previous fixed limit of a frame source
+    struct test_sink sinks[5];
+
+    struct sc_frame_queue fq;
+    sc_frame_queue_init(&fq, "test", 4, SC_FRAME_QUEUE_POLICY_BLOCK);
+    for (unsigned i = 0; i < 5; ++i) {
+        test_sink_init(&sinks[i], false);
+        sc_frame_source_add_sink(&fq.frame_source, &sinks[i].frame_sink);
+    }
+
+    assert(fq.frame_source.sink_count == 5);
+
+    bool ok = fq.frame_sink.ops->open(&fq.frame_sink, NULL);
+    assert(ok);
+
+    for (int64_t pts = 0; pts < 8; ++pts) {
+        push_frame(&fq, pts);
+    }
+
+    // The sinks are called in order, so the last one receives the frames last
+    test_sink_wait_count(&sinks[4], 8);
+
+    fq.frame_sink.ops->close(&fq.frame_sink);
+
+    for (unsigned i = 0; i < 5; ++i) {
+        assert(!sinks[i].opened);
+        assert(sinks[i].count == 8);
+        for (unsigned j = 0; j < 8; ++j) {
+            assert(sinks[i].received[j] == j);
+        }
+        test_sink_destroy(&sinks[i]);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_frame_queue_keep_latest();
+    test_frame_queue_block();
+    test_frame_queue_many_sinks();
+
+    return 0;
+}
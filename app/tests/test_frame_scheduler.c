@@ -0,0 +1,197 @@
+#include "common.h"
+
+#include <assert.h>
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+
+#include "frame_scheduler.h"
+#include "util/tick.h"
+
+// 60 Hz
+#define INTERVAL (SC_TICK_FREQ / 60)
+
+// An arbitrary date of a past vsync
+#define VSYNC_ORIGIN SC_TICK_FROM_SEC(1000)
+
+static void
+init_scheduler(struct sc_frame_scheduler *fs) {
+    bool ok = sc_frame_scheduler_init(fs);
+    assert(ok);
+
+    sc_frame_scheduler_set_refresh_rate(fs, 60);
+    // Give the phase of the refresh cycle
+    sc_frame_scheduler_on_present(fs, -1, VSYNC_ORIGIN);
+}
+
+static void
+push(struct sc_frame_scheduler *fs, int64_t pts, sc_tick date) {
+    AVFrame *frame = av_frame_alloc();
+    assert(frame);
+    frame->format = AV_PIX_FMT_GRAY8;
+    frame->width = 2;
+    frame->height = 2;
+    int r = av_frame_get_buffer(frame, 0);
+    assert(!r);
+    (void) r;
+    frame->pts = pts;
+
+    bool ok = sc_frame_scheduler_push_at(fs, frame, date);
+    assert(ok);
+    (void) ok;
+
+    av_frame_free(&frame);
+}
+
+// Select the frame for the vsync, and report its presentation on the vsync
+//
+// Return the pts of the selected frame, or -1 if none.
+static int64_t
+select_and_present(struct sc_frame_scheduler *fs, sc_tick vsync) {
+    AVFrame *frame = sc_frame_scheduler_select_at(fs, vsync);
+    if (!frame) {
+        return -1;
+    }
+
+    int64_t pts = frame->pts;
+    av_frame_free(&frame);
+
+    sc_frame_scheduler_on_present(fs, pts, vsync);
+    return pts;
+}
+
+static void test_latency(void) {
+    // 60 fps, received with a constant latency, at various phases of the
+    // refresh cycle
+    for (sc_tick phase = 0; phase < INTERVAL; phase += 1000) {
+        struct sc_frame_scheduler fs;
+        init_scheduler(&fs);
+
+        sc_tick offset = VSYNC_ORIGIN + SC_TICK_FROM_SEC(1) + phase;
+        for (int i = 0; i < 100; ++i) {
+            int64_t pts = i * (int64_t) INTERVAL;
+            sc_tick date = offset + pts;
+            push(&fs, pts, date);
+
+            // The selection happens half a refresh interval before the vsync
+            sc_tick vsync = sc_frame_scheduler_next_vsync_at(&fs, date);
+            assert(vsync - date >= INTERVAL / 2);
+            assert(vsync - date < INTERVAL + INTERVAL / 2);
+
+            // The frame is presented on the first vsync it can be rendered
+            // for
+            int64_t selected = select_and_present(&fs, vsync);
+            assert(selected == pts);
+        }
+
+        assert(fs.stats.presented == 100);
+        assert(fs.stats.dropped == 0);
+        assert(fs.stats.missed_vsyncs == 0);
+        assert(fs.stats.max_latency < INTERVAL + INTERVAL / 2);
+
+        sc_frame_scheduler_destroy(&fs);
+    }
+}
+
+static void test_drop_superseded(void) {
+    struct sc_frame_scheduler fs;
+    init_scheduler(&fs);
+
+    sc_tick date = VSYNC_ORIGIN + SC_TICK_FROM_SEC(1);
+
+    // 3 frames received between two selections (a burst)
+    push(&fs, 0, date);
+    push(&fs, 5000, date + 100);
+    push(&fs, 10000, date + 200);
+
+    sc_tick vsync = sc_frame_scheduler_next_vsync_at(&fs, date + 200);
+    assert(select_and_present(&fs, vsync) == 10000);
+    assert(fs.stats.dropped == 2);
+
+    // Nothing for the next vsync
+    assert(select_and_present(&fs, vsync + INTERVAL) == -1);
+
+    sc_frame_scheduler_destroy(&fs);
+}
+
+static void test_queue_capacity(void) {
+    struct sc_frame_scheduler fs;
+    init_scheduler(&fs);
+
+    sc_tick date = VSYNC_ORIGIN + SC_TICK_FROM_SEC(1);
+
+    // Never selected: the oldest frames are dropped
+    unsigned count = SC_FRAME_SCHEDULER_QUEUE_CAPACITY + 3;
+    for (unsigned i = 0; i < count; ++i) {
+        push(&fs, i * 1000, date + i * 1000);
+    }
+
+    assert(sc_vecdeque_size(&fs.queue) == SC_FRAME_SCHEDULER_QUEUE_CAPACITY);
+    assert(fs.stats.dropped == 3);
+
+    sc_tick vsync = sc_frame_scheduler_next_vsync_at(&fs, date + count * 1000);
+    assert(select_and_present(&fs, vsync) == (count - 1) * 1000);
+    assert(fs.stats.dropped == count - 1);
+
+    sc_frame_scheduler_destroy(&fs);
+}
+
+static void test_cadence(void) {
+    struct sc_frame_scheduler fs;
+    init_scheduler(&fs);
+
+    // 30 fps on a 60 Hz display, received with a jitter of +/- 2ms
+    sc_tick offset = VSYNC_ORIGIN + SC_TICK_FROM_SEC(1);
+    static const sc_tick jitter[] = {0, 2000, -2000, 1000, -1000, 1500};
+
+    sc_tick last_vsync = 0;
+    int next = 0; // index of the next frame to push
+    int presented = 0;
+    for (int k = 1; k < 400; ++k) {
+        sc_tick vsync = offset + k * INTERVAL;
+        sc_tick selection = vsync - INTERVAL / 2;
+
+        // Receive the frames up to the selection
+        for (;;) {
+            int64_t pts = next * (int64_t) (2 * INTERVAL);
+            sc_tick date = offset + pts + jitter[next % ARRAY_LEN(jitter)];
+            if (date > selection) {
+                break;
+            }
+            push(&fs, pts, date);
+            ++next;
+        }
+
+        int64_t pts = select_and_present(&fs, vsync);
+        if (pts == -1) {
+            continue;
+        }
+
+        if (presented > 32) {
+            // Once the clock is stable, one frame every 2 vsyncs
+            assert(vsync - last_vsync == 2 * INTERVAL);
+            // Presented at most one refresh interval after its expected date
+            sc_tick expected = offset + pts;
+            assert(vsync >= expected - INTERVAL / 2);
+            assert(vsync <= expected + INTERVAL);
+        }
+
+        last_vsync = vsync;
+        ++presented;
+    }
+
+    assert(presented > 150);
+    assert(fs.stats.dropped == 0);
+
+    sc_frame_scheduler_destroy(&fs);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_latency();
+    test_drop_superseded();
+    test_queue_capacity();
+    test_cadence();
+    return 0;
+}
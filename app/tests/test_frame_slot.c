@@ -0,0 +1,161 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+#include <libavutil/frame.h>
+
+#include "frame_slot.h"
+#include "util/thread.h"
+
+#define STRESS_COUNT 100000
+
+static AVFrame *
+create_frame(void) {
+    AVFrame *frame = av_frame_alloc();
+    assert(frame);
+    frame->format = AV_PIX_FMT_GRAY8;
+    frame->width = 16;
+    frame->height = 1;
+    int r = av_frame_get_buffer(frame, 0);
+    assert(!r);
+    (void) r;
+    return frame;
+}
+
+// Write the pts into the frame content, to detect torn frames
+static void
+set_frame_pts(AVFrame *frame, int64_t pts) {
+    frame->pts = pts;
+    int r = av_frame_make_writable(frame);
+    assert(!r);
+    (void) r;
+    memcpy(frame->data[0], &pts, sizeof(pts));
+}
+
+static int64_t
+get_content_pts(const AVFrame *frame) {
+    int64_t pts;
+    memcpy(&pts, frame->data[0], sizeof(pts));
+    return pts;
+}
+
+static void test_frame_slot_basic(void) {
+    struct sc_frame_slot slot;
+    bool ok = sc_frame_slot_init(&slot);
+    assert(ok);
+
+    assert(!sc_frame_slot_has_new_frame(&slot));
+    assert(!sc_frame_slot_consume(&slot));
+
+    AVFrame *frame = create_frame();
+
+    bool skipped;
+    set_frame_pts(frame, 1);
+    ok = sc_frame_slot_push(&slot, frame, &skipped);
+    assert(ok);
+    assert(!skipped);
+    assert(sc_frame_slot_has_new_frame(&slot));
+
+    const AVFrame *out = sc_frame_slot_consume(&slot);
+    assert(out);
+    assert(out->pts == 1);
+    assert(!sc_frame_slot_has_new_frame(&slot));
+    assert(!sc_frame_slot_consume(&slot));
+
+    // Push 2 frames without consuming: the first one is skipped
+    set_frame_pts(frame, 2);
+    ok = sc_frame_slot_push(&slot, frame, &skipped);
+    assert(ok);
+    assert(!skipped);
+
+    set_frame_pts(frame, 3);
+    ok = sc_frame_slot_push(&slot, frame, &skipped);
+    assert(ok);
+    assert(skipped);
+
+    out = sc_frame_slot_consume(&slot);
+    assert(out);
+    assert(out->pts == 3);
+    assert(get_content_pts(out) == 3);
+    assert(!sc_frame_slot_consume(&slot));
+
+    av_frame_free(&frame);
+    sc_frame_slot_destroy(&slot);
+}
+
+struct stress_producer {
+    struct sc_frame_slot *slot;
+    unsigned skipped;
+};
+
+static int
+run_stress_producer(void *data) {
+    struct stress_producer *producer = data;
+
+    AVFrame *frame = create_frame();
+
+    for (int64_t pts = 1; pts <= STRESS_COUNT; ++pts) {
+        // A new buffer for each frame (the previous one may be referenced)
+        set_frame_pts(frame, pts);
+
+        bool skipped;
+        bool ok = sc_frame_slot_push(producer->slot, frame, &skipped);
+        assert(ok);
+        (void) ok;
+        if (skipped) {
+            ++producer->skipped;
+        }
+    }
+
+    av_frame_free(&frame);
+    return 0;
+}
+
+static void test_frame_slot_stress(void) {
+    struct sc_frame_slot slot;
+    bool ok = sc_frame_slot_init(&slot);
+    assert(ok);
+
+    struct stress_producer producer = {
+        .slot = &slot,
+        .skipped = 0,
+    };
+
+    sc_thread thread;
+    ok = sc_thread_create(&thread, run_stress_producer, "test-producer",
+                          &producer);
+    assert(ok);
+
+    unsigned consumed = 0;
+    int64_t last_pts = 0;
+    while (last_pts != STRESS_COUNT) {
+        const AVFrame *out = sc_frame_slot_consume(&slot);
+        if (!out) {
+            continue;
+        }
+
+        // The frames are consumed in order, and never torn
+        assert(out->pts > last_pts);
+        assert(get_content_pts(out) == out->pts);
+        last_pts = out->pts;
+        ++consumed;
+    }
+
+    sc_thread_join(&thread, NULL);
+
+    // Every frame is either consumed or skipped
+    assert(!sc_frame_slot_has_new_frame(&slot));
+    assert(consumed + producer.skipped == STRESS_COUNT);
+
+    sc_frame_slot_destroy(&slot);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_frame_slot_basic();
+    test_frame_slot_stress();
+
+    return 0;
+}
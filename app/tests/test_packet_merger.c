@@ -0,0 +1,171 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+#include <libavcodec/avcodec.h>
+
+#include "packet_merger.h"
+
+static const uint8_t config_data[] = {0, 0, 0, 1, 0x67, 0x42, 0, 0, 0, 1, 0x68};
+static const uint8_t media_data[] = {0, 0, 0, 1, 0x65, 0x88, 0x84, 0x21};
+
+static AVPacket *
+new_packet(const uint8_t *data, size_t size, size_t headroom, int64_t pts) {
+    AVPacket *packet = av_packet_alloc();
+    assert(packet);
+
+    int ret = av_new_packet(packet, headroom + size);
+    assert(!ret);
+
+    packet->data += headroom;
+    packet->size = size;
+    memcpy(packet->data, data, size);
+    packet->pts = pts;
+
+    return packet;
+}
+
+static void
+assert_merged(const AVPacket *packet) {
+    assert(packet->size == sizeof(config_data) + sizeof(media_data));
+    assert(!memcmp(packet->data, config_data, sizeof(config_data)));
+    assert(!memcmp(packet->data + sizeof(config_data), media_data,
+                   sizeof(media_data)));
+}
+
+static void test_packet_merger_with_headroom(void) {
+    struct sc_packet_merger merger;
+    sc_packet_merger_init(&merger);
+
+    assert(sc_packet_merger_get_headroom(&merger) == 0);
+
+    AVPacket *config = new_packet(config_data, sizeof(config_data), 0,
+                                  AV_NOPTS_VALUE);
+    bool ok = sc_packet_merger_merge(&merger, config);
+    assert(ok);
+    // The config packet is not modified
+    assert(config->size == sizeof(config_data));
+
+    // The merger keeps a reference, the config packet may be released
+    av_packet_free(&config);
+
+    size_t headroom = sc_packet_merger_get_headroom(&merger);
+    assert(headroom == sizeof(config_data));
+
+    AVPacket *media = new_packet(media_data, sizeof(media_data), headroom, 42);
+    uint8_t *buf_data = media->buf->data;
+    ok = sc_packet_merger_merge(&merger, media);
+    assert(ok);
+    assert_merged(media);
+    // Written in place, in front of the media payload
+    assert(media->data == buf_data);
+    assert(media->pts == 42);
+
+    assert(sc_packet_merger_get_headroom(&merger) == 0);
+
+    av_packet_free(&media);
+
+    // No pending config packet, the next media packet must not be modified
+    media = new_packet(media_data, sizeof(media_data), 0, 43);
+    ok = sc_packet_merger_merge(&merger, media);
+    assert(ok);
+    assert(media->size == sizeof(media_data));
+    assert(!memcmp(media->data, media_data, sizeof(media_data)));
+
+    av_packet_free(&media);
+
+    sc_packet_merger_destroy(&merger);
+}
+
+static void test_packet_merger_without_headroom(void) {
+    struct sc_packet_merger merger;
+    sc_packet_merger_init(&merger);
+
+    AVPacket *config = new_packet(config_data, sizeof(config_data), 0,
+                                  AV_NOPTS_VALUE);
+    bool ok = sc_packet_merger_merge(&merger, config);
+    assert(ok);
+    av_packet_free(&config);
+
+    AVPacket *media = new_packet(media_data, sizeof(media_data), 0, 42);
+    ok = sc_packet_merger_merge(&merger, media);
+    assert(ok);
+    assert_merged(media);
+
+    av_packet_free(&media);
+
+    sc_packet_merger_destroy(&merger);
+}
+
+static void test_packet_merger_not_writable(void) {
+    struct sc_packet_merger merger;
+    sc_packet_merger_init(&merger);
+
+    AVPacket *config = new_packet(config_data, sizeof(config_data), 0,
+                                  AV_NOPTS_VALUE);
+    bool ok = sc_packet_merger_merge(&merger, config);
+    assert(ok);
+    av_packet_free(&config);
+
+    size_t headroom = sc_packet_merger_get_headroom(&merger);
+    AVPacket *media = new_packet(media_data, sizeof(media_data), headroom, 42);
+
+    // Another reference to the same buffer must not be corrupted
+    AVPacket *other = av_packet_clone(media);
+    assert(other);
+
+    ok = sc_packet_merger_merge(&merger, media);
+    assert(ok);
+    assert_merged(media);
+
+    assert(other->size == sizeof(media_data));
+    assert(!memcmp(other->data, media_data, sizeof(media_data)));
+
+    av_packet_free(&other);
+    av_packet_free(&media);
+
+    sc_packet_merger_destroy(&merger);
+}
+
+static void test_packet_merger_config_replaced(void) {
+    struct sc_packet_merger merger;
+    sc_packet_merger_init(&merger);
+
+    static const uint8_t old_config_data[] = {0, 0, 0, 1, 0x67, 0x4d};
+
+    AVPacket *config = new_packet(old_config_data, sizeof(old_config_data), 0,
+                                  AV_NOPTS_VALUE);
+    bool ok = sc_packet_merger_merge(&merger, config);
+    assert(ok);
+    av_packet_free(&config);
+
+    // A new config packet replaces the pending one
+    config = new_packet(config_data, sizeof(config_data), 0, AV_NOPTS_VALUE);
+    ok = sc_packet_merger_merge(&merger, config);
+    assert(ok);
+    av_packet_free(&config);
+
+    size_t headroom = sc_packet_merger_get_headroom(&merger);
+    assert(headroom == sizeof(config_data));
+
+    AVPacket *media = new_packet(media_data, sizeof(media_data), headroom, 42);
+    ok = sc_packet_merger_merge(&merger, media);
+    assert(ok);
+    assert_merged(media);
+
+    av_packet_free(&media);
+
+    sc_packet_merger_destroy(&merger);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_packet_merger_with_headroom();
+    test_packet_merger_without_headroom();
+    test_packet_merger_not_writable();
+    test_packet_merger_config_replaced();
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+#include <libavcodec/avcodec.h>
+
+#include "packet_pool.h"
+
+static void test_packet_pool_reuse(void) {
+    struct sc_packet_pool pool;
+    sc_packet_pool_init(&pool);
+
+    AVPacket *packet = av_packet_alloc();
+    assert(packet);
+
+    bool ok = sc_packet_pool_new_packet(&pool, packet, 1000);
+    assert(ok);
+    assert(packet->size == 1000);
+    assert(packet->buf);
+    assert(packet->buf->size >= 1000 + AV_INPUT_BUFFER_PADDING_SIZE);
+    assert(pool.hits == 0);
+    assert(pool.misses == 1);
+
+    uint8_t *data = packet->data;
+    av_packet_unref(packet);
+
+    // Same size class, the buffer must be reused
+    ok = sc_packet_pool_new_packet(&pool, packet, 600);
+    assert(ok);
+    assert(packet->size == 600);
+    assert(packet->data == data);
+    assert(pool.hits == 1);
+    assert(pool.misses == 1);
+
+    av_packet_unref(packet);
+
+    // Another size class
+    ok = sc_packet_pool_new_packet(&pool, packet, 100000);
+    assert(ok);
+    assert(packet->size == 100000);
+    assert(pool.hits == 1);
+    assert(pool.misses == 2);
+
+    av_packet_unref(packet);
+    av_packet_free(&packet);
+
+    sc_packet_pool_destroy(&pool);
+}
+
+static void test_packet_pool_padding(void) {
+    struct sc_packet_pool pool;
+    sc_packet_pool_init(&pool);
+
+    AVPacket *packet = av_packet_alloc();
+    assert(packet);
+
+    bool ok = sc_packet_pool_new_packet(&pool, packet, 2000);
+    assert(ok);
+    memset(packet->data, 0xFF, packet->buf->size);
+    av_packet_unref(packet);
+
+    // The reused buffer contains garbage, but the padding must be zeroed
+    ok = sc_packet_pool_new_packet(&pool, packet, 1500);
+    assert(ok);
+    assert(pool.hits == 1);
+    for (int i = 0; i < AV_INPUT_BUFFER_PADDING_SIZE; ++i) {
+        assert(packet->data[1500 + i] == 0);
+    }
+
+    av_packet_unref(packet);
+    av_packet_free(&packet);
+
+    sc_packet_pool_destroy(&pool);
+}
+
+static void test_packet_pool_ref_outlives_pool(void) {
+    struct sc_packet_pool pool;
+    sc_packet_pool_init(&pool);
+
+    AVPacket *packet = av_packet_alloc();
+    assert(packet);
+
+    bool ok = sc_packet_pool_new_packet(&pool, packet, 42);
+    assert(ok);
+    memset(packet->data, 42, 42);
+
+    // A sink keeps a reference
+    AVPacket *ref = av_packet_alloc();
+    assert(ref);
+    int r = av_packet_ref(ref, packet);
+    assert(!r);
+    av_packet_unref(packet);
+
+    // While the buffer is referenced, it may not be reused
+    ok = sc_packet_pool_new_packet(&pool, packet, 42);
+    assert(ok);
+    assert(packet->data != ref->data);
+    assert(pool.misses == 2);
+    av_packet_unref(packet);
+
+    sc_packet_pool_destroy(&pool);
+
+    // The reference must still be valid after the pool is destroyed
+    for (int i = 0; i < 42; ++i) {
+        assert(ref->data[i] == 42);
+    }
+
+    av_packet_free(&ref);
+    av_packet_free(&packet);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_packet_pool_reuse();
+    test_packet_pool_padding();
+    test_packet_pool_ref_outlives_pool();
+
+    return 0;
+}
@@ -0,0 +1,351 @@
+#include "common.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+
+#include "pcm_sink.h"
+#include "util/binary.h"
+#include "util/process.h"
+
+#define SAMPLE_RATE 48000
+#define CHANNELS 2
+#define FRAME_SAMPLES 960 // 20ms
+
+static AVCodecContext *
+create_codec_context(enum AVSampleFormat fmt) {
+    AVCodecContext *ctx = avcodec_alloc_context3(NULL);
+    assert(ctx);
+
+    ctx->sample_fmt = fmt;
+    ctx->sample_rate = SAMPLE_RATE;
+#ifdef SCRCPY_LAVU_HAS_CHLAYOUT
+    ctx->ch_layout = (AVChannelLayout) AV_CHANNEL_LAYOUT_STEREO;
+#else
+    ctx->channel_layout = AV_CH_LAYOUT_STEREO;
+    ctx->channels = CHANNELS;
+#endif
+
+    return ctx;
+}
+
+static void
+get_path(char *path, size_t len, const char *name) {
+    // Unique per process, so that tests may run in parallel
+    int r = snprintf(path, len, "/tmp/scrcpy-test-%s-%ld", name,
+                     (long) getpid());
+    assert(r > 0 && (size_t) r < len);
+    (void) r;
+}
+
+// The left and right samples of the sample i are i and -i
+static void
+push_s16(struct sc_pcm_sink *ps, unsigned index) {
+    static int16_t data[FRAME_SAMPLES * CHANNELS];
+    for (unsigned i = 0; i < FRAME_SAMPLES; ++i) {
+        int16_t value = (int16_t) (index * FRAME_SAMPLES + i);
+        data[i * CHANNELS] = value;
+        data[i * CHANNELS + 1] = -value;
+    }
+
+    AVFrame *frame = av_frame_alloc();
+    assert(frame);
+    frame->format = AV_SAMPLE_FMT_S16;
+    frame->nb_samples = FRAME_SAMPLES;
+    frame->data[0] = (uint8_t *) data;
+
+    bool ok = ps->frame_sink.ops->push(&ps->frame_sink, frame);
+    assert(ok);
+
+    // The data is not owned by the frame
+    frame->data[0] = NULL;
+    av_frame_free(&frame);
+}
+
+static void
+read_fully(int fd, uint8_t *buf, size_t len) {
+    while (len) {
+        ssize_t r = read(fd, buf, len);
+        assert(r > 0);
+        buf += r;
+        len -= r;
+    }
+}
+
+static void
+assert_header(const uint8_t *header, enum sc_pcm_sink_format format) {
+    assert(!memcmp(header, SC_PCM_SINK_MAGIC, SC_PCM_SINK_MAGIC_LENGTH));
+    assert(header[SC_PCM_SINK_MAGIC_LENGTH] == format);
+    assert(header[SC_PCM_SINK_MAGIC_LENGTH + 1] == CHANNELS);
+    assert(sc_read32be(&header[SC_PCM_SINK_MAGIC_LENGTH + 2]) == SAMPLE_RATE);
+}
+
+static void
+assert_s16_samples(const int16_t *samples, unsigned count, unsigned first) {
+    for (unsigned i = 0; i < count; ++i) {
+        int16_t value = (int16_t) (first + i);
+        assert(samples[i * CHANNELS] == value);
+        assert(samples[i * CHANNELS + 1] == -value);
+    }
+}
+
+static void test_pcm_sink_file(void) {
+    char path[64];
+    get_path(path, sizeof(path), "pcm");
+
+    struct sc_pcm_sink ps;
+    bool ok = sc_pcm_sink_init(&ps, path);
+    assert(ok);
+
+    AVCodecContext *ctx = create_codec_context(AV_SAMPLE_FMT_S16);
+    ok = ps.frame_sink.ops->open(&ps.frame_sink, ctx);
+    assert(ok);
+
+    for (unsigned i = 0; i < 10; ++i) {
+        push_s16(&ps, i);
+    }
+
+    // All the buffered samples are written on close
+    ps.frame_sink.ops->close(&ps.frame_sink);
+    sc_pcm_sink_destroy(&ps);
+    avcodec_free_context(&ctx);
+
+    size_t data_size = 10 * FRAME_SAMPLES * CHANNELS * sizeof(int16_t);
+    size_t size = SC_PCM_SINK_HEADER_SIZE + data_size;
+    uint8_t *buf = malloc(size);
+    assert(buf);
+
+    int fd = open(path, O_RDONLY);
+    assert(fd != -1);
+    read_fully(fd, buf, size);
+    // Nothing more
+    assert(read(fd, buf, 1) == 0);
+    close(fd);
+    unlink(path);
+
+    assert_header(buf, SC_PCM_SINK_FORMAT_S16);
+    assert_s16_samples((const int16_t *) (buf + SC_PCM_SINK_HEADER_SIZE),
+                       10 * FRAME_SAMPLES, 0);
+
+    free(buf);
+}
+
+// Execute a child process like the server, which logs to its stdout
+static void
+execute_child_logging_to_stdout(void) {
+    const char *const argv[] = {"sh", "-c", "echo '[server] INFO: test'",
+                                NULL};
+    sc_pid pid;
+    enum sc_process_result r =
+        sc_process_execute(argv, &pid, SC_PROCESS_STDOUT_TO_STDERR);
+    assert(r == SC_PROCESS_SUCCESS);
+    sc_exit_code exit_code = sc_process_wait(pid, true);
+    assert(exit_code == 0);
+    (void) exit_code;
+}
+
+static void test_pcm_sink_stdout(void) {
+    char out_path[64];
+    get_path(out_path, sizeof(out_path), "pcm-stdout");
+    char err_path[64];
+    get_path(err_path, sizeof(err_path), "pcm-stderr");
+
+    // Capture stdout and stderr
+    fflush(stdout);
+    fflush(stderr);
+    int saved_stdout = dup(STDOUT_FILENO);
+    int saved_stderr = dup(STDERR_FILENO);
+    assert(saved_stdout != -1 && saved_stderr != -1);
+    int out = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    int err = open(err_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    assert(out != -1 && err != -1);
+    dup2(out, STDOUT_FILENO);
+    dup2(err, STDERR_FILENO);
+    close(out);
+    close(err);
+
+    struct sc_pcm_sink ps;
+    bool ok = sc_pcm_sink_init(&ps, SC_PCM_SINK_STDOUT);
+    assert(ok);
+
+    AVCodecContext *ctx = create_codec_context(AV_SAMPLE_FMT_S16);
+    ok = ps.frame_sink.ops->open(&ps.frame_sink, ctx);
+    assert(ok);
+
+    push_s16(&ps, 0);
+    push_s16(&ps, 1);
+
+    // The child process output must not be interleaved with the samples
+    execute_child_logging_to_stdout();
+
+    push_s16(&ps, 2);
+    push_s16(&ps, 3);
+
+    ps.frame_sink.ops->close(&ps.frame_sink);
+    sc_pcm_sink_destroy(&ps);
+    avcodec_free_context(&ctx);
+
+    // Restore stdout and stderr
+    dup2(saved_stdout, STDOUT_FILENO);
+    dup2(saved_stderr, STDERR_FILENO);
+    close(saved_stdout);
+    close(saved_stderr);
+
+    // Only the header and the samples reach stdout
+    size_t data_size = 4 * FRAME_SAMPLES * CHANNELS * sizeof(int16_t);
+    size_t size = SC_PCM_SINK_HEADER_SIZE + data_size;
+    uint8_t *buf = malloc(size);
+    assert(buf);
+
+    int fd = open(out_path, O_RDONLY);
+    assert(fd != -1);
+    read_fully(fd, buf, size);
+    // Nothing more
+    assert(read(fd, buf, 1) == 0);
+    close(fd);
+    unlink(out_path);
+
+    assert_header(buf, SC_PCM_SINK_FORMAT_S16);
+    assert_s16_samples((const int16_t *) (buf + SC_PCM_SINK_HEADER_SIZE),
+                       4 * FRAME_SAMPLES, 0);
+
+    // The child process output is written to stderr
+    char log[64];
+    fd = open(err_path, O_RDONLY);
+    assert(fd != -1);
+    ssize_t r = read(fd, log, sizeof(log) - 1);
+    assert(r > 0);
+    log[r] = '\0';
+    assert(strstr(log, "[server] INFO: test"));
+    close(fd);
+    unlink(err_path);
+
+    free(buf);
+}
+
+static void test_pcm_sink_fifo_drop_oldest(void) {
+    char path[64];
+    get_path(path, sizeof(path), "pcm-fifo");
+
+    int r = mkfifo(path, 0600);
+    assert(!r);
+    (void) r;
+
+    struct sc_pcm_sink ps;
+    bool ok = sc_pcm_sink_init(&ps, path);
+    assert(ok);
+
+    AVCodecContext *ctx = create_codec_context(AV_SAMPLE_FMT_S16);
+    ok = ps.frame_sink.ops->open(&ps.frame_sink, ctx);
+    assert(ok);
+
+    // Without reader, the sink must not block, and only the most recent
+    // samples are kept
+    unsigned frames = 2 * SAMPLE_RATE / FRAME_SAMPLES; // 2 seconds
+    for (unsigned i = 0; i < frames; ++i) {
+        push_s16(&ps, i);
+    }
+
+    unsigned kept = SAMPLE_RATE * SC_PCM_SINK_BUFFER_MS / 1000;
+    unsigned first = frames * FRAME_SAMPLES - kept;
+
+    // Blocks until the sink opens the FIFO
+    int fd = open(path, O_RDONLY);
+    assert(fd != -1);
+
+    size_t data_size = kept * CHANNELS * sizeof(int16_t);
+    uint8_t *buf = malloc(SC_PCM_SINK_HEADER_SIZE + data_size);
+    assert(buf);
+    read_fully(fd, buf, SC_PCM_SINK_HEADER_SIZE + data_size);
+
+    assert_header(buf, SC_PCM_SINK_FORMAT_S16);
+    assert_s16_samples((const int16_t *) (buf + SC_PCM_SINK_HEADER_SIZE),
+                       kept, first);
+
+    ps.frame_sink.ops->close(&ps.frame_sink);
+    sc_pcm_sink_destroy(&ps);
+    avcodec_free_context(&ctx);
+
+    // The sink closed the FIFO without writing anything else
+    assert(read(fd, buf, 1) == 0);
+    close(fd);
+    unlink(path);
+
+    free(buf);
+}
+
+static void test_pcm_sink_planar(void) {
+    char path[64];
+    get_path(path, sizeof(path), "pcm-planar");
+
+    struct sc_pcm_sink ps;
+    bool ok = sc_pcm_sink_init(&ps, path);
+    assert(ok);
+
+    AVCodecContext *ctx = create_codec_context(AV_SAMPLE_FMT_FLTP);
+    ok = ps.frame_sink.ops->open(&ps.frame_sink, ctx);
+    assert(ok);
+
+    static float left[FRAME_SAMPLES];
+    static float right[FRAME_SAMPLES];
+    for (unsigned i = 0; i < FRAME_SAMPLES; ++i) {
+        left[i] = i / 1024.f;
+        right[i] = -(i / 1024.f);
+    }
+
+    AVFrame *frame = av_frame_alloc();
+    assert(frame);
+    frame->format = AV_SAMPLE_FMT_FLTP;
+    frame->nb_samples = FRAME_SAMPLES;
+    frame->data[0] = (uint8_t *) left;
+    frame->data[1] = (uint8_t *) right;
+
+    ok = ps.frame_sink.ops->push(&ps.frame_sink, frame);
+    assert(ok);
+
+    memset(frame->data, 0, sizeof(frame->data));
+    av_frame_free(&frame);
+
+    ps.frame_sink.ops->close(&ps.frame_sink);
+    sc_pcm_sink_destroy(&ps);
+    avcodec_free_context(&ctx);
+
+    size_t size = SC_PCM_SINK_HEADER_SIZE
+                + FRAME_SAMPLES * CHANNELS * sizeof(float);
+    uint8_t *buf = malloc(size);
+    assert(buf);
+
+    int fd = open(path, O_RDONLY);
+    assert(fd != -1);
+    read_fully(fd, buf, size);
+    close(fd);
+    unlink(path);
+
+    // Planar samples are interleaved
+    assert_header(buf, SC_PCM_SINK_FORMAT_F32);
+    const float *samples = (const float *) (buf + SC_PCM_SINK_HEADER_SIZE);
+    for (unsigned i = 0; i < FRAME_SAMPLES; ++i) {
+        assert(samples[i * CHANNELS] == left[i]);
+        assert(samples[i * CHANNELS + 1] == right[i]);
+    }
+
+    free(buf);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_pcm_sink_file();
+    test_pcm_sink_stdout();
+    test_pcm_sink_fifo_drop_oldest();
+    test_pcm_sink_planar();
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "record_filename.h"
+
+static void
+assert_insert_index(const char *filename, unsigned index,
+                    const char *expected) {
+    char *s = sc_record_filename_insert_index(filename, index);
+    assert(s);
+    assert(!strcmp(s, expected));
+    free(s);
+}
+
+static void test_insert_index(void) {
+    // extension
+    assert_insert_index("file.mkv", 1, "file-1.mkv");
+    assert_insert_index("file.tar.mkv", 2, "file.tar-2.mkv");
+    assert_insert_index("file.", 3, "file-3.");
+
+    // no extension
+    assert_insert_index("file", 4, "file-4");
+
+    // dotfile
+    assert_insert_index(".mkv", 5, ".mkv-5");
+    assert_insert_index("dir/.mkv", 6, "dir/.mkv-6");
+
+    // path containing dots
+    assert_insert_index("my.dir/file", 7, "my.dir/file-7");
+    assert_insert_index("/tmp/my.dir/file.mp4", 8, "/tmp/my.dir/file-8.mp4");
+    assert_insert_index("./file.mp4", 9, "./file-9.mp4");
+    assert_insert_index("../file", 10, "../file-10");
+
+    assert_insert_index("file.mkv", UINT32_MAX, "file-4294967295.mkv");
+}
+
+static void test_expand(void) {
+    struct tm tm = {
+        .tm_year = 2026 - 1900,
+        .tm_mon = 9, // October
+        .tm_mday = 17,
+        .tm_hour = 3,
+        .tm_min = 14,
+        .tm_sec = 8,
+    };
+
+    char *s = sc_record_filename_expand("rec-%Y%m%d-%H%M%S.mkv", &tm);
+    assert(s);
+    assert(!strcmp(s, "rec-20261017-031408.mkv"));
+    free(s);
+
+    s = sc_record_filename_expand("/tmp/my.dir/file.mp4", &tm);
+    assert(s);
+    assert(!strcmp(s, "/tmp/my.dir/file.mp4"));
+    free(s);
+
+    s = sc_record_filename_expand("100%%.mkv", &tm);
+    assert(s);
+    assert(!strcmp(s, "100%.mkv"));
+    free(s);
+}
+
+static void
+assert_segment(const char *expanded, const char *prev, unsigned index,
+               const char *expected) {
+    char *s = sc_record_filename_get_segment(expanded, prev, index);
+    assert(s);
+    assert(!strcmp(s, expected));
+    free(s);
+}
+
+static void test_get_segment(void) {
+    // first segment
+    assert_segment("file.mkv", NULL, 0, "file.mkv");
+
+    // different name
+    assert_segment("rec-031408.mkv", "rec-031308.mkv", 1, "rec-031408.mkv");
+
+    // same name
+    assert_segment("file.mkv", "file.mkv", 1, "file-1.mkv");
+    assert_segment("file", "file", 2, "file-2");
+    assert_segment(".mkv", ".mkv", 3, ".mkv-3");
+    assert_segment("my.dir/file", "my.dir/file", 4, "my.dir/file-4");
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_insert_index();
+    test_expand();
+    test_get_segment();
+    return 0;
+}
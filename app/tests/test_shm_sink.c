@@ -0,0 +1,288 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+
+#include "shm_reader.h"
+#include "shm_sink.h"
+
+#define WIDTH 64
+#define HEIGHT 32
+
+static uint8_t y_plane[WIDTH * HEIGHT];
+static uint8_t u_plane[WIDTH / 2 * HEIGHT / 2];
+static uint8_t v_plane[WIDTH / 2 * HEIGHT / 2];
+
+static void
+get_name(char *name, size_t len) {
+    // Unique per process, so that tests may run in parallel
+    int r = snprintf(name, len, "scrcpy-test-%ld", (long) getpid());
+    assert(r > 0 && (size_t) r < len);
+    (void) r;
+}
+
+static void
+open_sink(struct sc_shm_sink *ss, const char *name) {
+    bool ok = sc_shm_sink_init(ss, name);
+    assert(ok);
+
+    AVCodecContext *ctx = avcodec_alloc_context3(NULL);
+    assert(ctx);
+    ctx->width = WIDTH;
+    ctx->height = HEIGHT;
+    ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+
+    ok = ss->frame_sink.ops->open(&ss->frame_sink, ctx);
+    assert(ok);
+
+    avcodec_free_context(&ctx);
+}
+
+static void
+close_sink(struct sc_shm_sink *ss) {
+    ss->frame_sink.ops->close(&ss->frame_sink);
+    sc_shm_sink_destroy(ss);
+}
+
+static void
+push_frame(struct sc_shm_sink *ss, int width, int height, int64_t pts) {
+    // Fill the planes with a value depending on the pts
+    memset(y_plane, (uint8_t) pts, sizeof(y_plane));
+    memset(u_plane, (uint8_t) (pts + 1), sizeof(u_plane));
+    memset(v_plane, (uint8_t) (pts + 2), sizeof(v_plane));
+
+    AVFrame *frame = av_frame_alloc();
+    assert(frame);
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = width;
+    frame->height = height;
+    frame->pts = pts;
+    frame->data[0] = y_plane;
+    frame->data[1] = u_plane;
+    frame->data[2] = v_plane;
+    frame->linesize[0] = width;
+    frame->linesize[1] = width / 2;
+    frame->linesize[2] = width / 2;
+
+    bool ok = ss->frame_sink.ops->push(&ss->frame_sink, frame);
+    assert(ok);
+
+    // The data is not owned by the frame
+    memset(frame->data, 0, sizeof(frame->data));
+    av_frame_free(&frame);
+}
+
+static void
+assert_frame(const struct sc_shm_frame *frame, int64_t pts) {
+    assert(frame->pts == pts);
+    assert(frame->width == WIDTH);
+    assert(frame->height == HEIGHT);
+    assert(!strcmp(frame->format, "yuv420p"));
+    assert(frame->plane_count == 3);
+
+    assert(frame->plane_widths[0] == WIDTH);
+    assert(frame->plane_heights[0] == HEIGHT);
+    assert(frame->plane_widths[1] == WIDTH / 2);
+    assert(frame->plane_heights[1] == HEIGHT / 2);
+
+    for (unsigned i = 0; i < 3; ++i) {
+        // The strides are aligned
+        assert(!(frame->strides[i] % SC_SHM_ALIGN));
+        assert(!((uintptr_t) frame->data[i] % SC_SHM_ALIGN));
+
+        uint8_t expected = (uint8_t) (pts + i);
+        for (uint32_t y = 0; y < frame->plane_heights[i]; ++y) {
+            const uint8_t *line = frame->data[i] + y * frame->strides[i];
+            for (uint32_t x = 0; x < frame->plane_widths[i]; ++x) {
+                assert(line[x] == expected);
+            }
+        }
+    }
+}
+
+static void test_shm_latest(void) {
+    char name[64];
+    get_name(name, sizeof(name));
+
+    struct sc_shm_sink ss;
+    open_sink(&ss, name);
+
+    struct sc_shm_reader reader;
+    bool ok = sc_shm_reader_open(&reader, name);
+    assert(ok);
+
+    struct sc_shm_frame frame;
+    enum sc_shm_reader_result result =
+        sc_shm_reader_acquire(&reader, SC_SHM_READER_MODE_LATEST, &frame);
+    assert(result == SC_SHM_READER_NO_FRAME);
+
+    push_frame(&ss, WIDTH, HEIGHT, 10);
+
+    result = sc_shm_reader_acquire(&reader, SC_SHM_READER_MODE_LATEST, &frame);
+    assert(result == SC_SHM_READER_OK);
+    assert(frame.seq == 1);
+    assert(frame.skipped == 0);
+    assert_frame(&frame, 10);
+    assert(sc_shm_reader_release(&reader, &frame));
+
+    // The same frame is not returned twice
+    result = sc_shm_reader_acquire(&reader, SC_SHM_READER_MODE_LATEST, &frame);
+    assert(result == SC_SHM_READER_NO_FRAME);
+
+    push_frame(&ss, WIDTH, HEIGHT, 11);
+    push_frame(&ss, WIDTH, HEIGHT, 12);
+    push_frame(&ss, WIDTH, HEIGHT, 13);
+
+    result = sc_shm_reader_acquire(&reader, SC_SHM_READER_MODE_LATEST, &frame);
+    assert(result == SC_SHM_READER_OK);
+    assert(frame.seq == 4);
+    assert(frame.skipped == 2);
+    assert_frame(&frame, 13);
+    assert(sc_shm_reader_release(&reader, &frame));
+
+    close_sink(&ss);
+
+    result = sc_shm_reader_acquire(&reader, SC_SHM_READER_MODE_LATEST, &frame);
+    assert(result == SC_SHM_READER_CLOSED);
+
+    sc_shm_reader_close(&reader);
+
+    // The segment has been removed
+    ok = sc_shm_reader_open(&reader, name);
+    assert(!ok);
+}
+
+static void test_shm_next(void) {
+    char name[64];
+    get_name(name, sizeof(name));
+
+    struct sc_shm_sink ss;
+    open_sink(&ss, name);
+
+    struct sc_shm_reader reader;
+    bool ok = sc_shm_reader_open(&reader, name);
+    assert(ok);
+
+    push_frame(&ss, WIDTH, HEIGHT, 20);
+    push_frame(&ss, WIDTH, HEIGHT, 21);
+
+    // The frames are read in sequence
+    struct sc_shm_frame frame;
+    enum sc_shm_reader_result result =
+        sc_shm_reader_acquire(&reader, SC_SHM_READER_MODE_NEXT, &frame);
+    assert(result == SC_SHM_READER_OK);
+    assert(frame.seq == 1);
+    assert(frame.skipped == 0);
+    assert_frame(&frame, 20);
+    assert(sc_shm_reader_release(&reader, &frame));
+
+    result = sc_shm_reader_acquire(&reader, SC_SHM_READER_MODE_NEXT, &frame);
+    assert(result == SC_SHM_READER_OK);
+    assert(frame.seq == 2);
+    assert_frame(&frame, 21);
+
+    // Overwrite all the slots while the frame is accessed
+    for (int64_t pts = 22; pts < 22 + SC_SHM_SINK_SLOT_COUNT + 1; ++pts) {
+        push_frame(&ss, WIDTH, HEIGHT, pts);
+    }
+
+    // The reader is notified that the frame has been overwritten
+    assert(!sc_shm_reader_release(&reader, &frame));
+
+    // The next frame is not available anymore, the latest one is returned
+    result = sc_shm_reader_acquire(&reader, SC_SHM_READER_MODE_NEXT, &frame);
+    assert(result == SC_SHM_READER_OK);
+    assert(frame.seq == 2 + SC_SHM_SINK_SLOT_COUNT + 1);
+    assert(frame.skipped == SC_SHM_SINK_SLOT_COUNT);
+    assert_frame(&frame, 22 + SC_SHM_SINK_SLOT_COUNT);
+    assert(sc_shm_reader_release(&reader, &frame));
+
+    sc_shm_reader_close(&reader);
+    close_sink(&ss);
+}
+
+static void test_shm_rotation(void) {
+    char name[64];
+    get_name(name, sizeof(name));
+
+    struct sc_shm_sink ss;
+    open_sink(&ss, name);
+
+    struct sc_shm_reader reader;
+    bool ok = sc_shm_reader_open(&reader, name);
+    assert(ok);
+
+    // A rotated frame fits in the slots
+    push_frame(&ss, HEIGHT, WIDTH, 30);
+
+    struct sc_shm_frame frame;
+    enum sc_shm_reader_result result =
+        sc_shm_reader_acquire(&reader, SC_SHM_READER_MODE_LATEST, &frame);
+    assert(result == SC_SHM_READER_OK);
+    assert(frame.width == HEIGHT);
+    assert(frame.height == WIDTH);
+    assert(frame.plane_widths[0] == HEIGHT);
+    assert(frame.plane_heights[0] == WIDTH);
+    assert(sc_shm_reader_release(&reader, &frame));
+
+    sc_shm_reader_close(&reader);
+    close_sink(&ss);
+}
+
+static void test_shm_name_in_use(void) {
+    char name[64];
+    get_name(name, sizeof(name));
+
+    struct sc_shm_sink ss;
+    open_sink(&ss, name);
+
+    // Another sink must not take over (nor remove) an existing object
+    struct sc_shm_sink ss2;
+    bool ok = sc_shm_sink_init(&ss2, name);
+    assert(ok);
+
+    AVCodecContext *ctx = avcodec_alloc_context3(NULL);
+    assert(ctx);
+    ctx->width = WIDTH;
+    ctx->height = HEIGHT;
+    ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+
+    ok = ss2.frame_sink.ops->open(&ss2.frame_sink, ctx);
+    assert(!ok);
+    sc_shm_sink_destroy(&ss2);
+
+    avcodec_free_context(&ctx);
+
+    // The first sink is still readable
+    struct sc_shm_reader reader;
+    ok = sc_shm_reader_open(&reader, name);
+    assert(ok);
+
+    push_frame(&ss, WIDTH, HEIGHT, 40);
+
+    struct sc_shm_frame frame;
+    enum sc_shm_reader_result result =
+        sc_shm_reader_acquire(&reader, SC_SHM_READER_MODE_LATEST, &frame);
+    assert(result == SC_SHM_READER_OK);
+    assert_frame(&frame, 40);
+    assert(sc_shm_reader_release(&reader, &frame));
+
+    sc_shm_reader_close(&reader);
+    close_sink(&ss);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_shm_latest();
+    test_shm_next();
+    test_shm_rotation();
+    test_shm_name_in_use();
+
+    return 0;
+}
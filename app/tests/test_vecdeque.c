@@ -34,6 +34,11 @@ static void test_vecdeque_push_pop(void) {
     assert(ok);
     assert(sc_vecdeque_size(&vdq) == 2);
 
+    // Peeking does not remove the item
+    v = sc_vecdeque_peek(&vdq);
+    assert(v == 12);
+    assert(sc_vecdeque_size(&vdq) == 2);
+
     int *p = sc_vecdeque_popref(&vdq);
     assert(p);
     assert(*p == 12);
@@ -0,0 +1,433 @@
+/**
+ * Development tool to replay a stream dump recorded by scrcpy --dump-stream.
+ *
+ * It listens on a localhost port and behaves like the scrcpy server in
+ * "adb forward" mode, so that the client pipeline (demuxer, decoder, screen,
+ * recorder...) can be run and benchmarked without any device:
+ *
+ *     scrcpy-replay dump.bin 27183 &
+ *     SCRCPY_REPLAY_PORT=27183 scrcpy
+ *
+ * The client must be started with the same streams as the dump (e.g. with
+ * --no-audio if the dump contains only video). If control is enabled, the
+ * control messages sent by the client are ignored.
+ *
+ * By default, the records are sent according to their arrival time in the
+ * dump. With --asap, they are sent as fast as possible.
+ */
+
+#include "common.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libavformat/avio.h>
+
+#include "stream_dump.h"
+#include "util/binary.h"
+#include "util/log.h"
+#include "util/net.h"
+#include "util/str.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+#define SC_REPLAY_DEFAULT_PORT 27183
+#define SC_REPLAY_DEVICE_NAME "scrcpy-replay"
+#define SC_REPLAY_DEVICE_NAME_FIELD_LENGTH 64
+
+struct sc_replay {
+    const char *filename;
+    uint16_t port;
+    bool asap;
+
+    bool has_video;
+    bool has_audio;
+
+    sc_socket server_socket;
+    sc_socket video_socket;
+    sc_socket audio_socket;
+
+    // Optional, accepted asynchronously (only if control is enabled on the
+    // client)
+    sc_thread control_thread;
+    sc_mutex mutex;
+    sc_socket control_socket; // protected by mutex
+    bool stopped; // protected by mutex
+
+    // Never signaled, only used to wait until a deadline
+    sc_cond sleep_cond;
+};
+
+struct sc_replay_record {
+    uint8_t stream;
+    sc_tick ts;
+    uint32_t len;
+};
+
+static bool
+sc_replay_read_magic(AVIOContext *io) {
+    uint8_t magic[SC_STREAM_DUMP_MAGIC_LENGTH];
+    int r = avio_read(io, magic, SC_STREAM_DUMP_MAGIC_LENGTH);
+    return r == SC_STREAM_DUMP_MAGIC_LENGTH
+        && !memcmp(magic, SC_STREAM_DUMP_MAGIC, SC_STREAM_DUMP_MAGIC_LENGTH);
+}
+
+// Return false on end of file
+static bool
+sc_replay_read_record_header(AVIOContext *io,
+                             struct sc_replay_record *record) {
+    uint8_t header[SC_STREAM_DUMP_RECORD_HEADER_SIZE];
+    int r = avio_read(io, header, SC_STREAM_DUMP_RECORD_HEADER_SIZE);
+    if (r != SC_STREAM_DUMP_RECORD_HEADER_SIZE) {
+        return false;
+    }
+
+    record->stream = header[0];
+    record->ts = SC_TICK_FROM_US(sc_read64be(&header[1]));
+    record->len = sc_read32be(&header[9]);
+    return true;
+}
+
+static bool
+sc_replay_scan(struct sc_replay *replay) {
+    AVIOContext *io;
+    if (avio_open(&io, replay->filename, AVIO_FLAG_READ) < 0) {
+        LOGE("Could not open %s", replay->filename);
+        return false;
+    }
+
+    bool ok = sc_replay_read_magic(io);
+    if (!ok) {
+        LOGE("Not a stream dump: %s", replay->filename);
+        avio_closep(&io);
+        return false;
+    }
+
+    replay->has_video = false;
+    replay->has_audio = false;
+
+    struct sc_replay_record record;
+    while (sc_replay_read_record_header(io, &record)) {
+        if (record.stream == SC_STREAM_DUMP_STREAM_VIDEO) {
+            replay->has_video = true;
+        } else if (record.stream == SC_STREAM_DUMP_STREAM_AUDIO) {
+            replay->has_audio = true;
+        }
+        avio_skip(io, record.len);
+    }
+
+    avio_closep(&io);
+
+    if (!replay->has_video && !replay->has_audio) {
+        LOGE("Empty stream dump: %s", replay->filename);
+        return false;
+    }
+
+    return true;
+}
+
+static int
+run_control(void *data) {
+    struct sc_replay *replay = data;
+
+    // Fails once the server socket is interrupted if the client does not
+    // connect any control socket
+    sc_socket socket = net_accept(replay->server_socket);
+    if (socket == SC_SOCKET_NONE) {
+        return 0;
+    }
+
+    sc_mutex_lock(&replay->mutex);
+    replay->control_socket = socket;
+    if (replay->stopped) {
+        // Stopped between accept() and the assignment
+        net_interrupt(socket);
+    }
+    sc_mutex_unlock(&replay->mutex);
+
+    // Ignore all control messages
+    uint8_t buf[1024];
+    while (net_recv(socket, buf, sizeof(buf)) > 0) {
+        // do nothing
+    }
+
+    return 0;
+}
+
+static bool
+sc_replay_accept(struct sc_replay *replay) {
+    replay->server_socket = net_socket();
+    if (replay->server_socket == SC_SOCKET_NONE) {
+        LOGE("Could not create server socket");
+        return false;
+    }
+
+    bool ok = net_listen(replay->server_socket, IPV4_LOCALHOST, replay->port,
+                         3);
+    if (!ok) {
+        LOGE("Could not listen on port %" PRIu16, replay->port);
+        net_close(replay->server_socket);
+        return false;
+    }
+
+    LOGI("Waiting for a client on port %" PRIu16 " (video: %s, audio: %s)...",
+         replay->port, replay->has_video ? "yes" : "no",
+         replay->has_audio ? "yes" : "no");
+
+    sc_socket first_socket = net_accept(replay->server_socket);
+    if (first_socket == SC_SOCKET_NONE) {
+        goto error_close_server_socket;
+    }
+
+    // The client reads one byte to detect a working connection
+    uint8_t dummy = 0;
+    if (net_send_all(first_socket, &dummy, 1) != 1) {
+        net_close(first_socket);
+        goto error_close_server_socket;
+    }
+
+    if (replay->has_video) {
+        replay->video_socket = first_socket;
+    }
+
+    if (replay->has_audio) {
+        if (!replay->has_video) {
+            replay->audio_socket = first_socket;
+        } else {
+            replay->audio_socket = net_accept(replay->server_socket);
+            if (replay->audio_socket == SC_SOCKET_NONE) {
+                net_close(first_socket);
+                goto error_close_server_socket;
+            }
+        }
+    }
+
+    ok = sc_mutex_init(&replay->mutex);
+    if (!ok) {
+        goto error_close_stream_sockets;
+    }
+
+    ok = sc_cond_init(&replay->sleep_cond);
+    if (!ok) {
+        goto error_destroy_mutex;
+    }
+
+    ok = sc_thread_create(&replay->control_thread, run_control,
+                          "scrcpy-replay-ctl", replay);
+    if (!ok) {
+        LOGE("Could not start control thread");
+        goto error_destroy_cond;
+    }
+
+    uint8_t name[SC_REPLAY_DEVICE_NAME_FIELD_LENGTH] = {0};
+    memcpy(name, SC_REPLAY_DEVICE_NAME, sizeof(SC_REPLAY_DEVICE_NAME));
+    if (net_send_all(first_socket, name, sizeof(name)) != sizeof(name)) {
+        net_interrupt(replay->server_socket);
+        sc_thread_join(&replay->control_thread, NULL);
+        goto error_destroy_cond;
+    }
+
+    return true;
+
+error_destroy_cond:
+    sc_cond_destroy(&replay->sleep_cond);
+error_destroy_mutex:
+    sc_mutex_destroy(&replay->mutex);
+error_close_stream_sockets:
+    if (replay->video_socket != SC_SOCKET_NONE) {
+        net_close(replay->video_socket);
+    }
+    if (replay->audio_socket != SC_SOCKET_NONE) {
+        net_close(replay->audio_socket);
+    }
+error_close_server_socket:
+    net_close(replay->server_socket);
+    return false;
+}
+
+static void
+sc_replay_sleep(struct sc_replay *replay, sc_tick deadline) {
+    sc_mutex_lock(&replay->mutex);
+    while (sc_cond_timedwait(&replay->sleep_cond, &replay->mutex, deadline)) {
+        // spurious wake-up
+    }
+    sc_mutex_unlock(&replay->mutex);
+}
+
+static bool
+sc_replay_stream(struct sc_replay *replay) {
+    AVIOContext *io;
+    if (avio_open(&io, replay->filename, AVIO_FLAG_READ) < 0) {
+        LOGE("Could not open %s", replay->filename);
+        return false;
+    }
+
+    bool ok = sc_replay_read_magic(io);
+    assert(ok); // already checked by sc_replay_scan()
+
+    uint8_t *buf = NULL;
+    size_t buf_size = 0;
+
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+    sc_tick start = sc_tick_now();
+
+    struct sc_replay_record record;
+    while (sc_replay_read_record_header(io, &record)) {
+        if (record.len > buf_size) {
+            uint8_t *new_buf = realloc(buf, record.len);
+            if (!new_buf) {
+                LOG_OOM();
+                ok = false;
+                break;
+            }
+            buf = new_buf;
+            buf_size = record.len;
+        }
+
+        if (avio_read(io, buf, record.len) != (int) record.len) {
+            LOGW("Truncated stream dump");
+            break;
+        }
+
+        sc_socket socket;
+        if (record.stream == SC_STREAM_DUMP_STREAM_VIDEO) {
+            socket = replay->video_socket;
+        } else if (record.stream == SC_STREAM_DUMP_STREAM_AUDIO) {
+            socket = replay->audio_socket;
+        } else {
+            LOGW("Unknown stream %" PRIu8 ", record ignored", record.stream);
+            continue;
+        }
+
+        if (!replay->asap) {
+            sc_tick deadline = start + record.ts;
+            if (deadline > sc_tick_now()) {
+                sc_replay_sleep(replay, deadline);
+            }
+        }
+
+        ssize_t w = net_send_all(socket, buf, record.len);
+        if (w < 0 || (uint32_t) w != record.len) {
+            LOGI("Client disconnected");
+            break;
+        }
+
+        ++count;
+        bytes += record.len;
+    }
+
+    sc_tick duration = sc_tick_now() - start;
+    LOGI("Replayed %" PRIu64 " records (%" PRIu64 " bytes) in %" PRItick
+         " ms", count, bytes, SC_TICK_TO_MS(duration));
+
+    free(buf);
+    avio_closep(&io);
+
+    return ok;
+}
+
+static void
+sc_replay_close(struct sc_replay *replay) {
+    // Wake up the control thread, blocked either on accept() or on recv()
+    sc_mutex_lock(&replay->mutex);
+    replay->stopped = true;
+    net_interrupt(replay->server_socket);
+    if (replay->control_socket != SC_SOCKET_NONE) {
+        net_interrupt(replay->control_socket);
+    }
+    sc_mutex_unlock(&replay->mutex);
+
+    sc_thread_join(&replay->control_thread, NULL);
+    sc_cond_destroy(&replay->sleep_cond);
+    sc_mutex_destroy(&replay->mutex);
+
+    // Closing the stream sockets notifies end-of-stream to the client
+    if (replay->video_socket != SC_SOCKET_NONE) {
+        net_close(replay->video_socket);
+    }
+    if (replay->audio_socket != SC_SOCKET_NONE) {
+        net_close(replay->audio_socket);
+    }
+    if (replay->control_socket != SC_SOCKET_NONE) {
+        net_close(replay->control_socket);
+    }
+    net_close(replay->server_socket);
+}
+
+static void
+print_usage(const char *arg0) {
+    fprintf(stderr, "Usage: %s [--asap] <dump-file> [port]\n"
+                    "Default port is %d.\n",
+            arg0, SC_REPLAY_DEFAULT_PORT);
+}
+
+int
+main(int argc, char *argv[]) {
+    struct sc_replay replay = {
+        .filename = NULL,
+        .port = SC_REPLAY_DEFAULT_PORT,
+        .asap = false,
+        .video_socket = SC_SOCKET_NONE,
+        .audio_socket = SC_SOCKET_NONE,
+        .control_socket = SC_SOCKET_NONE,
+        .stopped = false,
+    };
+
+    const char *port = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--asap")) {
+            replay.asap = true;
+        } else if (!replay.filename) {
+            replay.filename = argv[i];
+        } else if (!port) {
+            port = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!replay.filename) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (port) {
+        long value;
+        bool ok = sc_str_parse_integer(port, &value);
+        if (!ok || value <= 0 || value > 0xFFFF) {
+            LOGE("Invalid port: %s", port);
+            return 1;
+        }
+        replay.port = value;
+    }
+
+    if (!sc_replay_scan(&replay)) {
+        return 1;
+    }
+
+    if (!net_init()) {
+        return 1;
+    }
+
+    int ret = 1;
+
+    if (!sc_replay_accept(&replay)) {
+        goto end;
+    }
+
+    bool ok = sc_replay_stream(&replay);
+    sc_replay_close(&replay);
+
+    if (ok) {
+        ret = 0;
+    }
+
+end:
+    net_cleanup();
+    return ret;
+}
@@ -0,0 +1,168 @@
+/**
+ * Test client for the shared memory frame sink (scrcpy --shm-sink).
+ *
+ * It maps the segment published by scrcpy, reads the frames without copy and
+ * prints statistics every second:
+ *
+ *     scrcpy --shm-sink=scrcpy &
+ *     scrcpy-shm-reader scrcpy
+ *
+ * With --next, the frames are read in sequence as long as they are available
+ * (instead of always reading the latest frame). With --output, the frames are
+ * written as raw video (planes concatenated, without padding), which can be
+ * played for example by:
+ *
+ *     ffplay -f rawvideo -pixel_format yuv420p -video_size 1080x2400 out.raw
+ *
+ * It only depends on the reader module (shm_reader.c), like any external
+ * consumer would.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "shm_reader.h"
+
+// Delay between polls when no new frame is available
+#define SC_SHM_READER_POLL_INTERVAL_NS 1000000 // 1 ms
+
+static void
+sc_sleep_ns(long ns) {
+    struct timespec ts = {
+        .tv_sec = ns / 1000000000,
+        .tv_nsec = ns % 1000000000,
+    };
+    nanosleep(&ts, NULL);
+}
+
+static int64_t
+sc_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool
+write_frame(FILE *file, const struct sc_shm_frame *frame) {
+    for (unsigned i = 0; i < frame->plane_count; ++i) {
+        // Write the lines without the padding
+        uint32_t width = frame->plane_widths[i];
+        for (uint32_t y = 0; y < frame->plane_heights[i]; ++y) {
+            const uint8_t *line = frame->data[i]
+                                + (size_t) y * frame->strides[i];
+            if (fwrite(line, 1, width, file) != width) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static void
+print_usage(const char *arg0) {
+    fprintf(stderr, "Usage: %s [--next] [--output <file>] <name>\n", arg0);
+}
+
+int
+main(int argc, char *argv[]) {
+    const char *name = NULL;
+    const char *output = NULL;
+    enum sc_shm_reader_mode mode = SC_SHM_READER_MODE_LATEST;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--next")) {
+            mode = SC_SHM_READER_MODE_NEXT;
+        } else if (!strcmp(argv[i], "--output") && i + 1 < argc) {
+            output = argv[++i];
+        } else if (!name) {
+            name = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!name) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    struct sc_shm_reader reader;
+    fprintf(stderr, "Waiting for shared memory '%s'...\n", name);
+    while (!sc_shm_reader_open(&reader, name)) {
+        sc_sleep_ns(100 * SC_SHM_READER_POLL_INTERVAL_NS);
+    }
+
+    FILE *file = NULL;
+    if (output) {
+        file = fopen(output, "wb");
+        if (!file) {
+            fprintf(stderr, "Could not open %s\n", output);
+            sc_shm_reader_close(&reader);
+            return 1;
+        }
+    }
+
+    uint64_t read = 0;
+    uint64_t skipped = 0;
+    uint64_t torn = 0;
+    int64_t next_report = sc_now_ms() + 1000;
+    int ret = 0;
+
+    for (;;) {
+        struct sc_shm_frame frame;
+        enum sc_shm_reader_result result =
+            sc_shm_reader_acquire(&reader, mode, &frame);
+        if (result == SC_SHM_READER_CLOSED) {
+            fprintf(stderr, "Writer closed\n");
+            break;
+        }
+
+        if (result == SC_SHM_READER_OK) {
+            bool ok = !file || write_frame(file, &frame);
+            if (!ok) {
+                fprintf(stderr, "Could not write frame\n");
+                ret = 1;
+                break;
+            }
+
+            if (sc_shm_reader_release(&reader, &frame)) {
+                ++read;
+            } else {
+                // Overwritten while it was read (the written data is garbage)
+                ++torn;
+            }
+            skipped += frame.skipped;
+        } else {
+            sc_sleep_ns(SC_SHM_READER_POLL_INTERVAL_NS);
+        }
+
+        int64_t now = sc_now_ms();
+        if (now >= next_report) {
+            if (result == SC_SHM_READER_OK) {
+                fprintf(stderr, "frame #%" PRIu64 ": %" PRIu32 "x%" PRIu32
+                                " %s pts=%" PRId64 "\n", frame.seq,
+                        frame.width, frame.height, frame.format, frame.pts);
+            }
+            fprintf(stderr, "read=%" PRIu64 " skipped=%" PRIu64
+                            " torn=%" PRIu64 "\n", read, skipped, torn);
+            next_report = now + 1000;
+        }
+    }
+
+    fprintf(stderr, "Total: read=%" PRIu64 " skipped=%" PRIu64
+                    " torn=%" PRIu64 "\n", read, skipped, torn);
+
+    if (file) {
+        fclose(file);
+    }
+    sc_shm_reader_close(&reader);
+
+    return ret;
+}
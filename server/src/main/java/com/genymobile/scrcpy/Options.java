@@ -34,9 +34,11 @@ public class Options {
     private boolean audioDup;
     private int videoBitRate = 8000000;
     private int audioBitRate = 128000;
+    private int audioFrameDuration; // in microseconds, 0 for the default
     private float maxFps;
     private float angle;
     private boolean tunnelForward;
+    private boolean multiplex;
     private Rect crop;
     private boolean control = true;
     private int displayId;
@@ -128,6 +130,10 @@ public class Options {
         return audioBitRate;
     }
 
+    public int getAudioFrameDuration() {
+        return audioFrameDuration;
+    }
+
     public float getMaxFps() {
         return maxFps;
     }
@@ -140,6 +146,10 @@ public class Options {
         return tunnelForward;
     }
 
+    public boolean getMultiplex() {
+        return multiplex;
+    }
+
     public Rect getCrop() {
         return crop;
     }
@@ -367,6 +377,9 @@ public class Options {
                 case "audio_bit_rate":
                     options.audioBitRate = Integer.parseInt(value);
                     break;
+                case "audio_frame_duration":
+                    options.audioFrameDuration = Integer.parseInt(value);
+                    break;
                 case "max_fps":
                     options.maxFps = parseFloat("max_fps", value);
                     break;
@@ -376,6 +389,9 @@ public class Options {
                 case "tunnel_forward":
                     options.tunnelForward = Boolean.parseBoolean(value);
                     break;
+                case "multiplex":
+                    options.multiplex = Boolean.parseBoolean(value);
+                    break;
                 case "crop":
                     if (!value.isEmpty()) {
                         options.crop = parseCrop(value);
@@ -10,7 +10,7 @@ public interface AudioCapture {
     void stop();
 
     /**
-     * Read a chunk of {@link AudioConfig#MAX_READ_SIZE} samples.
+     * Read a chunk of at most {@link AudioConfig#MAX_READ_SIZE} bytes (less if a frame duration is requested).
      *
      * @param outDirectBuffer The target buffer
      * @param outBufferInfo The info to provide to MediaCodec
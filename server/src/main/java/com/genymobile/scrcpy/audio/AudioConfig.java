@@ -19,6 +19,20 @@ public final class AudioConfig {
         // Not instantiable
     }
 
+    /**
+     * Return the size (in bytes) of the chunks to read, so that each chunk matches one encoder frame of the requested duration.
+     *
+     * @param frameDurationUs the frame duration in microseconds, or 0 for the default
+     * @return the read size in bytes
+     */
+    public static int getReadSize(int frameDurationUs) {
+        if (frameDurationUs <= 0) {
+            return MAX_READ_SIZE;
+        }
+        int samples = (int) ((long) frameDurationUs * SAMPLE_RATE / 1000000);
+        return Math.min(Math.max(samples, 1) * CHANNELS * BYTES_PER_SAMPLE, MAX_READ_SIZE);
+    }
+
     public static AudioFormat createAudioFormat() {
         AudioFormat.Builder builder = new AudioFormat.Builder();
         builder.setEncoding(ENCODING);
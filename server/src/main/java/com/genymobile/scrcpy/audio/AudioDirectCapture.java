@@ -26,12 +26,14 @@ public class AudioDirectCapture implements AudioCapture {
     private static final int ENCODING = AudioConfig.ENCODING;
 
     private final int audioSource;
+    private final int readSize;
 
     private AudioRecord recorder;
     private AudioRecordReader reader;
 
-    public AudioDirectCapture(AudioSource audioSource) {
+    public AudioDirectCapture(AudioSource audioSource, int frameDurationUs) {
         this.audioSource = audioSource.getDirectAudioSource();
+        this.readSize = AudioConfig.getReadSize(frameDurationUs);
     }
 
     @TargetApi(AndroidVersions.API_23_ANDROID_6_0)
@@ -101,7 +103,7 @@ public class AudioDirectCapture implements AudioCapture {
             recorder = Workarounds.createAudioRecord(audioSource, SAMPLE_RATE, CHANNEL_CONFIG, CHANNELS, CHANNEL_MASK, ENCODING);
         }
         recorder.startRecording();
-        reader = new AudioRecordReader(recorder);
+        reader = new AudioRecordReader(recorder, readSize);
     }
 
     @Override
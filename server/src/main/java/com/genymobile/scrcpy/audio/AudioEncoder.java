@@ -52,6 +52,7 @@ public final class AudioEncoder implements AsyncProcessor {
     private final AudioCapture capture;
     private final Streamer streamer;
     private final int bitRate;
+    private final int frameDuration; // in microseconds, 0 for the default
     private final List<CodecOption> codecOptions;
     private final String encoderName;
 
@@ -75,17 +76,25 @@ public final class AudioEncoder implements AsyncProcessor {
         this.capture = capture;
         this.streamer = streamer;
         this.bitRate = options.getAudioBitRate();
+        this.frameDuration = options.getAudioFrameDuration();
         this.codecOptions = options.getAudioCodecOptions();
         this.encoderName = options.getAudioEncoder();
     }
 
-    private static MediaFormat createFormat(String mimeType, int bitRate, List<CodecOption> codecOptions) {
+    private static MediaFormat createFormat(String mimeType, int bitRate, int frameDuration, List<CodecOption> codecOptions) {
         MediaFormat format = new MediaFormat();
         format.setString(MediaFormat.KEY_MIME, mimeType);
         format.setInteger(MediaFormat.KEY_BIT_RATE, bitRate);
         format.setInteger(MediaFormat.KEY_CHANNEL_COUNT, CHANNELS);
         format.setInteger(MediaFormat.KEY_SAMPLE_RATE, SAMPLE_RATE);
 
+        if (frameDuration > 0) {
+            // Input buffers are submitted as soon as one frame is captured. There is no standard key to configure the encoder frame duration,
+            // encoder-specific keys may be passed via --audio-codec-options (they are applied afterwards, so they take precedence).
+            format.setInteger(MediaFormat.KEY_MAX_INPUT_SIZE, AudioConfig.getReadSize(frameDuration));
+            Ln.d("Audio frame duration: " + frameDuration + "us");
+        }
+
         if (codecOptions != null) {
             for (CodecOption option : codecOptions) {
                 String key = option.getKey();
@@ -228,7 +237,7 @@ public final class AudioEncoder implements AsyncProcessor {
             mediaCodecThread = new HandlerThread("media-codec");
             mediaCodecThread.start();
 
-            MediaFormat format = createFormat(codec.getMimeType(), bitRate, codecOptions);
+            MediaFormat format = createFormat(codec.getMimeType(), bitRate, frameDuration, codecOptions);
             mediaCodec.setCallback(new EncoderCallback(), new Handler(mediaCodecThread.getLooper()));
             mediaCodec.configure(format, null, null, MediaCodec.CONFIGURE_FLAG_ENCODE);
 
@@ -20,12 +20,14 @@ import java.nio.ByteBuffer;
 public final class AudioPlaybackCapture implements AudioCapture {
 
     private final boolean keepPlayingOnDevice;
+    private final int readSize;
 
     private AudioRecord recorder;
     private AudioRecordReader reader;
 
-    public AudioPlaybackCapture(boolean keepPlayingOnDevice) {
+    public AudioPlaybackCapture(boolean keepPlayingOnDevice, int frameDurationUs) {
         this.keepPlayingOnDevice = keepPlayingOnDevice;
+        this.readSize = AudioConfig.getReadSize(frameDurationUs);
     }
 
     @SuppressLint("PrivateApi")
@@ -119,7 +121,7 @@ public final class AudioPlaybackCapture implements AudioCapture {
     public void start() throws AudioCaptureException {
         recorder = createAudioRecord();
         recorder.startRecording();
-        reader = new AudioRecordReader(recorder);
+        reader = new AudioRecordReader(recorder, readSize);
     }
 
     @Override
@@ -16,19 +16,21 @@ public class AudioRecordReader {
             (1000000 + AudioConfig.SAMPLE_RATE - 1) / AudioConfig.SAMPLE_RATE; // 1 sample in microseconds (used for fixing PTS)
 
     private final AudioRecord recorder;
+    private final int readSize;
 
     private final AudioTimestamp timestamp = new AudioTimestamp();
     private long previousRecorderTimestamp = -1;
     private long previousPts = 0;
     private long nextPts = 0;
 
-    public AudioRecordReader(AudioRecord recorder) {
+    public AudioRecordReader(AudioRecord recorder, int readSize) {
         this.recorder = recorder;
+        this.readSize = readSize;
     }
 
     @TargetApi(AndroidVersions.API_24_ANDROID_7_0)
     public int read(ByteBuffer outDirectBuffer, MediaCodec.BufferInfo outBufferInfo) {
-        int r = recorder.read(outDirectBuffer, AudioConfig.MAX_READ_SIZE);
+        int r = recorder.read(outDirectBuffer, readSize);
         if (r <= 0) {
             return r;
         }
@@ -13,6 +13,7 @@ import com.genymobile.scrcpy.device.Size;
 import com.genymobile.scrcpy.util.Ln;
 import com.genymobile.scrcpy.util.LogUtils;
 import com.genymobile.scrcpy.video.SurfaceCapture;
+import com.genymobile.scrcpy.video.SurfaceEncoder;
 import com.genymobile.scrcpy.video.VirtualDisplayListener;
 import com.genymobile.scrcpy.wrappers.ClipboardManager;
 import com.genymobile.scrcpy.wrappers.InputManager;
@@ -99,6 +100,8 @@ public class Controller implements AsyncProcessor, VirtualDisplayListener {
 
     // Used for resetting video encoding on RESET_VIDEO message
     private SurfaceCapture surfaceCapture;
+    // Used for requesting a key frame on REQUEST_KEYFRAME message
+    private SurfaceEncoder surfaceEncoder;
 
     public Controller(ControlChannel controlChannel, CleanUp cleanUp, Options options) {
         this.displayId = options.getDisplayId();
@@ -151,6 +154,10 @@ public class Controller implements AsyncProcessor, VirtualDisplayListener {
         this.surfaceCapture = surfaceCapture;
     }
 
+    public void setSurfaceEncoder(SurfaceEncoder surfaceEncoder) {
+        this.surfaceEncoder = surfaceEncoder;
+    }
+
     private UhidManager getUhidManager() {
         if (uhidManager == null) {
             int uhidDisplayId = displayId;
@@ -330,6 +337,9 @@ public class Controller implements AsyncProcessor, VirtualDisplayListener {
             case ControlMessage.TYPE_RESET_VIDEO:
                 resetVideo();
                 break;
+            case ControlMessage.TYPE_REQUEST_KEYFRAME:
+                requestKeyFrame();
+                break;
             default:
                 // do nothing
         }
@@ -753,4 +763,11 @@ public class Controller implements AsyncProcessor, VirtualDisplayListener {
             surfaceCapture.requestInvalidate();
         }
     }
+
+    private void requestKeyFrame() {
+        if (surfaceEncoder != null) {
+            Ln.d("Key frame requested");
+            surfaceEncoder.requestKeyFrame();
+        }
+    }
 }
@@ -1,6 +1,7 @@
 package com.genymobile.scrcpy.device;
 
 import com.genymobile.scrcpy.control.ControlChannel;
+import com.genymobile.scrcpy.util.Codec;
 import com.genymobile.scrcpy.util.IO;
 import com.genymobile.scrcpy.util.StringUtils;
 
@@ -28,16 +29,47 @@ public final class DesktopConnection implements Closeable {
     private final LocalSocket controlSocket;
     private final ControlChannel controlChannel;
 
+    // Only in multiplexed mode (all the streams share a single socket)
+    private final LocalSocket muxSocket;
+    private final Multiplexer multiplexer;
+    private final Multiplexer.Stream videoMuxStream;
+    private final Multiplexer.Stream audioMuxStream;
+
     private DesktopConnection(LocalSocket videoSocket, LocalSocket audioSocket, LocalSocket controlSocket) throws IOException {
         this.videoSocket = videoSocket;
         this.audioSocket = audioSocket;
         this.controlSocket = controlSocket;
+        this.muxSocket = null;
+        this.multiplexer = null;
+        this.videoMuxStream = null;
+        this.audioMuxStream = null;
 
         videoFd = videoSocket != null ? videoSocket.getFileDescriptor() : null;
         audioFd = audioSocket != null ? audioSocket.getFileDescriptor() : null;
         controlChannel = controlSocket != null ? new ControlChannel(controlSocket) : null;
     }
 
+    private DesktopConnection(LocalSocket muxSocket, boolean video, boolean audio, boolean control) throws IOException {
+        this.videoSocket = null;
+        this.audioSocket = null;
+        this.controlSocket = null;
+        this.muxSocket = muxSocket;
+
+        this.videoFd = null;
+        this.audioFd = null;
+
+        multiplexer = new Multiplexer(muxSocket.getFileDescriptor());
+        videoMuxStream = video ? multiplexer.openStream(Multiplexer.STREAM_VIDEO) : null;
+        audioMuxStream = audio ? multiplexer.openStream(Multiplexer.STREAM_AUDIO) : null;
+        if (control) {
+            // The control messages are the only data sent by the client, so they are not multiplexed
+            Multiplexer.Stream deviceMessageStream = multiplexer.openStream(Multiplexer.STREAM_CONTROL);
+            controlChannel = new ControlChannel(muxSocket.getInputStream(), deviceMessageStream);
+        } else {
+            controlChannel = null;
+        }
+    }
+
     private static LocalSocket connect(String abstractName) throws IOException {
         LocalSocket localSocket = new LocalSocket();
         localSocket.connect(new LocalSocketAddress(abstractName));
@@ -53,10 +85,14 @@ public final class DesktopConnection implements Closeable {
         return SOCKET_NAME_PREFIX + String.format("_%08x", scid);
     }
 
-    public static DesktopConnection open(int scid, boolean tunnelForward, boolean video, boolean audio, boolean control, boolean sendDummyByte)
-            throws IOException {
+    public static DesktopConnection open(int scid, boolean tunnelForward, boolean video, boolean audio, boolean control, boolean sendDummyByte,
+            boolean multiplex) throws IOException {
         String socketName = getSocketName(scid);
 
+        if (multiplex) {
+            return openMultiplexed(socketName, tunnelForward, video, audio, control, sendDummyByte);
+        }
+
         LocalSocket videoSocket = null;
         LocalSocket audioSocket = null;
         LocalSocket controlSocket = null;
@@ -115,6 +151,29 @@ public final class DesktopConnection implements Closeable {
         return new DesktopConnection(videoSocket, audioSocket, controlSocket);
     }
 
+    private static DesktopConnection openMultiplexed(String socketName, boolean tunnelForward, boolean video, boolean audio, boolean control,
+            boolean sendDummyByte) throws IOException {
+        LocalSocket muxSocket;
+        if (tunnelForward) {
+            try (LocalServerSocket localServerSocket = new LocalServerSocket(socketName)) {
+                muxSocket = localServerSocket.accept();
+            }
+        } else {
+            muxSocket = connect(socketName);
+        }
+
+        try {
+            if (tunnelForward && sendDummyByte) {
+                // send one byte so the client may read() to detect a connection error
+                muxSocket.getOutputStream().write(0);
+            }
+            return new DesktopConnection(muxSocket, video, audio, control);
+        } catch (IOException | RuntimeException e) {
+            muxSocket.close();
+            throw e;
+        }
+    }
+
     private LocalSocket getFirstSocket() {
         if (videoSocket != null) {
             return videoSocket;
@@ -126,6 +185,10 @@ public final class DesktopConnection implements Closeable {
     }
 
     public void shutdown() throws IOException {
+        if (muxSocket != null) {
+            muxSocket.shutdownInput();
+            muxSocket.shutdownOutput();
+        }
         if (videoSocket != null) {
             videoSocket.shutdownInput();
             videoSocket.shutdownOutput();
@@ -141,6 +204,10 @@ public final class DesktopConnection implements Closeable {
     }
 
     public void close() throws IOException {
+        if (multiplexer != null) {
+            multiplexer.close();
+            muxSocket.close();
+        }
         if (videoSocket != null) {
             videoSocket.close();
         }
@@ -160,16 +227,26 @@ public final class DesktopConnection implements Closeable {
         System.arraycopy(deviceNameBytes, 0, buffer, 0, len);
         // byte[] are always 0-initialized in java, no need to set '\0' explicitly
 
-        FileDescriptor fd = getFirstSocket().getFileDescriptor();
-        IO.writeFully(fd, buffer, 0, buffer.length);
+        if (multiplexer != null) {
+            multiplexer.writeRaw(buffer, 0, buffer.length);
+        } else {
+            FileDescriptor fd = getFirstSocket().getFileDescriptor();
+            IO.writeFully(fd, buffer, 0, buffer.length);
+        }
     }
 
-    public FileDescriptor getVideoFd() {
-        return videoFd;
+    public Streamer createVideoStreamer(Codec codec, boolean sendCodecMeta, boolean sendFrameMeta) {
+        if (videoMuxStream != null) {
+            return new Streamer(videoMuxStream, codec, sendCodecMeta, sendFrameMeta);
+        }
+        return new Streamer(videoFd, codec, sendCodecMeta, sendFrameMeta);
     }
 
-    public FileDescriptor getAudioFd() {
-        return audioFd;
+    public Streamer createAudioStreamer(Codec codec, boolean sendCodecMeta, boolean sendFrameMeta) {
+        if (audioMuxStream != null) {
+            return new Streamer(audioMuxStream, codec, sendCodecMeta, sendFrameMeta);
+        }
+        return new Streamer(audioFd, codec, sendCodecMeta, sendFrameMeta);
     }
 
     public ControlChannel getControlChannel() {
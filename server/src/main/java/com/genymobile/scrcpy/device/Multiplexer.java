@@ -0,0 +1,149 @@
+package com.genymobile.scrcpy.device;
+
+import com.genymobile.scrcpy.util.IO;
+
+import java.io.Closeable;
+import java.io.FileDescriptor;
+import java.io.IOException;
+import java.io.OutputStream;
+import java.nio.ByteBuffer;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.locks.ReentrantLock;
+
+/**
+ * Share a single socket between several streams (video, audio and device messages).
+ * <p>
+ * Each stream writes its data to the socket directly (from the writer thread), in chunks:
+ * <pre>
+ * [stream id: 1 byte][length: 4 bytes][length bytes of payload]
+ * </pre>
+ * A chunk with a length of 0 means that the stream is ended.
+ * <p>
+ * The chunks are limited to {@link #MAX_CHUNK_LENGTH}, and the socket is acquired fairly for each chunk, so that a large video packet does
+ * not delay audio packets for too long.
+ */
+public final class Multiplexer implements Closeable {
+
+    public static final int STREAM_VIDEO = 0;
+    public static final int STREAM_AUDIO = 1;
+    public static final int STREAM_CONTROL = 2;
+
+    private static final int HEADER_LENGTH = 5;
+    private static final int MAX_CHUNK_LENGTH = 1 << 14; // 16k
+
+    private final FileDescriptor fd;
+    // Fair, so that the streams write their chunks in turn
+    private final ReentrantLock lock = new ReentrantLock(true);
+    // Only accessed with the lock held
+    private final ByteBuffer header = ByteBuffer.allocate(HEADER_LENGTH);
+
+    private final List<Stream> streams = new ArrayList<>();
+
+    /**
+     * A stream, written as chunks to the shared socket.
+     */
+    public final class Stream extends OutputStream {
+
+        private final int id;
+        private boolean closed;
+
+        private Stream(int id) {
+            this.id = id;
+        }
+
+        public void write(ByteBuffer buffer) throws IOException {
+            while (buffer.hasRemaining()) {
+                int len = Math.min(buffer.remaining(), MAX_CHUNK_LENGTH);
+                ByteBuffer chunk = buffer.duplicate();
+                chunk.limit(chunk.position() + len);
+                writeChunk(id, chunk);
+                buffer.position(buffer.position() + len);
+            }
+        }
+
+        @Override
+        public void write(int b) throws IOException {
+            write(new byte[] {(byte) b}, 0, 1);
+        }
+
+        @Override
+        public void write(byte[] b, int off, int len) throws IOException {
+            write(ByteBuffer.wrap(b, off, len));
+        }
+
+        /**
+         * End the stream (the client is notified by an empty chunk).
+         */
+        @Override
+        public void close() throws IOException {
+            synchronized (this) {
+                if (closed) {
+                    return;
+                }
+                closed = true;
+            }
+            writeChunk(id, null);
+        }
+    }
+
+    public Multiplexer(FileDescriptor fd) {
+        this.fd = fd;
+    }
+
+    /**
+     * Open a stream.
+     *
+     * @param streamId the stream id
+     * @return the stream to write the data to
+     */
+    public Stream openStream(int streamId) {
+        Stream stream = new Stream(streamId);
+        streams.add(stream);
+        return stream;
+    }
+
+    /**
+     * Write data to the socket directly (outside any stream), before any stream data is written.
+     */
+    public void writeRaw(byte[] data, int offset, int len) throws IOException {
+        lock.lock();
+        try {
+            IO.writeFully(fd, data, offset, len);
+        } finally {
+            lock.unlock();
+        }
+    }
+
+    private void writeChunk(int streamId, ByteBuffer payload) throws IOException {
+        int len = payload != null ? payload.remaining() : 0;
+
+        lock.lock();
+        try {
+            header.clear();
+            header.put((byte) streamId);
+            header.putInt(len);
+            header.flip();
+            IO.writeFully(fd, header);
+            if (len != 0) {
+                IO.writeFully(fd, payload);
+            }
+        } finally {
+            lock.unlock();
+        }
+    }
+
+    /**
+     * End all the streams (ignored if the socket is already shut down).
+     */
+    @Override
+    public void close() {
+        for (Stream stream : streams) {
+            try {
+                stream.close();
+            } catch (IOException e) {
+                // ignore, the client will detect the end of the socket anyway
+            }
+        }
+    }
+}
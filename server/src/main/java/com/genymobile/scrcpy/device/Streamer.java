@@ -17,7 +17,9 @@ public final class Streamer {
     private static final long PACKET_FLAG_CONFIG = 1L << 63;
     private static final long PACKET_FLAG_KEY_FRAME = 1L << 62;
 
+    // Exactly one of fd and muxStream is set
     private final FileDescriptor fd;
+    private final Multiplexer.Stream muxStream;
     private final Codec codec;
     private final boolean sendCodecMeta;
     private final boolean sendFrameMeta;
@@ -25,7 +27,16 @@ public final class Streamer {
     private final ByteBuffer headerBuffer = ByteBuffer.allocate(12);
 
     public Streamer(FileDescriptor fd, Codec codec, boolean sendCodecMeta, boolean sendFrameMeta) {
+        this(fd, null, codec, sendCodecMeta, sendFrameMeta);
+    }
+
+    public Streamer(Multiplexer.Stream muxStream, Codec codec, boolean sendCodecMeta, boolean sendFrameMeta) {
+        this(null, muxStream, codec, sendCodecMeta, sendFrameMeta);
+    }
+
+    private Streamer(FileDescriptor fd, Multiplexer.Stream muxStream, Codec codec, boolean sendCodecMeta, boolean sendFrameMeta) {
         this.fd = fd;
+        this.muxStream = muxStream;
         this.codec = codec;
         this.sendCodecMeta = sendCodecMeta;
         this.sendFrameMeta = sendFrameMeta;
@@ -35,12 +46,20 @@ public final class Streamer {
         return codec;
     }
 
+    private void write(ByteBuffer buffer) throws IOException {
+        if (muxStream != null) {
+            muxStream.write(buffer);
+        } else {
+            IO.writeFully(fd, buffer);
+        }
+    }
+
     public void writeAudioHeader() throws IOException {
         if (sendCodecMeta) {
             ByteBuffer buffer = ByteBuffer.allocate(4);
             buffer.putInt(codec.getId());
             buffer.flip();
-            IO.writeFully(fd, buffer);
+            write(buffer);
         }
     }
 
@@ -51,7 +70,7 @@ public final class Streamer {
             buffer.putInt(videoSize.getWidth());
             buffer.putInt(videoSize.getHeight());
             buffer.flip();
-            IO.writeFully(fd, buffer);
+            write(buffer);
         }
     }
 
@@ -63,7 +82,7 @@ public final class Streamer {
         if (error) {
             code[3] = 1;
         }
-        IO.writeFully(fd, code, 0, code.length);
+        write(ByteBuffer.wrap(code));
     }
 
     public void writePacket(ByteBuffer buffer, long pts, boolean config, boolean keyFrame) throws IOException {
@@ -76,10 +95,10 @@ public final class Streamer {
         }
 
         if (sendFrameMeta) {
-            writeFrameMeta(fd, buffer.remaining(), pts, config, keyFrame);
+            writeFrameMeta(buffer.remaining(), pts, config, keyFrame);
         }
 
-        IO.writeFully(fd, buffer);
+        write(buffer);
     }
 
     public void writePacket(ByteBuffer codecBuffer, MediaCodec.BufferInfo bufferInfo) throws IOException {
@@ -89,7 +108,7 @@ public final class Streamer {
         writePacket(codecBuffer, pts, config, keyFrame);
     }
 
-    private void writeFrameMeta(FileDescriptor fd, int packetSize, long pts, boolean config, boolean keyFrame) throws IOException {
+    private void writeFrameMeta(int packetSize, long pts, boolean config, boolean keyFrame) throws IOException {
         headerBuffer.clear();
 
         long ptsAndFlags;
@@ -105,7 +124,7 @@ public final class Streamer {
         headerBuffer.putLong(ptsAndFlags);
         headerBuffer.putInt(packetSize);
         headerBuffer.flip();
-        IO.writeFully(fd, headerBuffer);
+        write(headerBuffer);
     }
 
     private static void fixOpusConfigPacket(ByteBuffer buffer) throws IOException {
@@ -1,6 +1,7 @@
 package com.genymobile.scrcpy.video;
 
 import android.media.MediaCodec;
+import android.os.Bundle;
 
 import java.util.concurrent.atomic.AtomicBoolean;
 
@@ -26,6 +27,19 @@ public class CaptureReset implements SurfaceCapture.CaptureListener {
         }
     }
 
+    public synchronized void requestSyncFrame() {
+        if (runningMediaCodec != null) {
+            Bundle params = new Bundle();
+            params.putInt(MediaCodec.PARAMETER_KEY_REQUEST_SYNC_FRAME, 0);
+            try {
+                runningMediaCodec.setParameters(params);
+            } catch (IllegalStateException e) {
+                // ignore
+            }
+        }
+        // Otherwise, the next encoding session starts with a sync frame anyway
+    }
+
     public synchronized void setRunningMediaCodec(MediaCodec runningMediaCodec) {
         this.runningMediaCodec = runningMediaCodec;
     }
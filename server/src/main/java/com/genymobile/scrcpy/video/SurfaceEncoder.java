@@ -285,6 +285,15 @@ public class SurfaceEncoder implements AsyncProcessor {
         return format;
     }
 
+    /**
+     * Request the encoder to produce a sync frame (key frame) as soon as possible.
+     * <p>
+     * This is cheaper than a capture reset: the encoding session is not restarted.
+     */
+    public void requestKeyFrame() {
+        reset.requestSyncFrame();
+    }
+
     @Override
     public void start(TerminationListener listener) {
         thread = new Thread(() -> {